@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocation_counter.h"
+
+namespace {
+std::atomic<std::size_t> calls = 0;
+std::atomic<std::size_t> bytes = 0;
+
+auto allocate(std::size_t size, std::align_val_t alignment) -> void * {
+    calls.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+
+    // aligned_alloc wants the size to be a multiple of the alignment
+    auto align = std::max(static_cast<std::size_t>(alignment), alignof(std::max_align_t));
+    auto *pointer = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+} // namespace
+
+auto allocations::total() -> Counts {
+    return {calls.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed)};
+}
+
+auto operator new(std::size_t size) -> void * {
+    return allocate(size, std::align_val_t(alignof(std::max_align_t)));
+}
+
+auto operator new[](std::size_t size) -> void * {
+    return allocate(size, std::align_val_t(alignof(std::max_align_t)));
+}
+
+auto operator new(std::size_t size, std::align_val_t alignment) -> void * {
+    return allocate(size, alignment);
+}
+
+auto operator new[](std::size_t size, std::align_val_t alignment) -> void * {
+    return allocate(size, alignment);
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t /*size*/) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t /*size*/) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t /*alignment*/) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t /*alignment*/) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept {
+    std::free(pointer);
+}
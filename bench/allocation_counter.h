@@ -0,0 +1,30 @@
+#ifndef BENCH_ALLOCATION_COUNTER_H
+#define BENCH_ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+// The benchmark executable replaces the global operator new/delete (see
+// allocation_counter.cpp) so we can see how many times something goes to
+// the heap, not just how long it takes.
+namespace allocations {
+
+struct Counts {
+    std::size_t calls = 0;
+    std::size_t bytes = 0;
+};
+
+// Allocations made on any thread since the program started
+auto total() -> Counts;
+
+// Runs `function` and returns how many allocations it made
+template <typename Function>
+auto count(Function &&function) -> Counts {
+    auto before = total();
+    function();
+    auto after = total();
+    return {after.calls - before.calls, after.bytes - before.bytes};
+}
+
+} // namespace allocations
+
+#endif // BENCH_ALLOCATION_COUNTER_H
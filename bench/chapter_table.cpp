@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "chapter_table.h"
+#include "mangadex.h"
+
+namespace {
+
+// A big library: 200 titles with 500 chapters each, in a few languages,
+// with the odd joint release and the same chapter released by more then
+// one group
+auto generateChapters() -> std::vector<mangadex::Chapter> {
+    constexpr std::size_t titles = 200;
+    constexpr std::size_t chaptersPerTitle = 500;
+    constexpr std::array<char const *, 6> languages = {"en", "es-la", "pt-br", "fr", "id", "ru"};
+
+    std::mt19937_64 rng(7);
+    auto randomId = [&rng] {
+        std::array<std::uint8_t, 16> bytes{};
+        for (auto &byte : bytes) {
+            byte = static_cast<std::uint8_t>(rng());
+        }
+        return core::Uuid(bytes);
+    };
+
+    std::vector<core::Uuid> groups(300);
+    std::generate(groups.begin(), groups.end(), randomId);
+
+    std::vector<mangadex::Chapter> chapters;
+    chapters.reserve(titles * chaptersPerTitle);
+    for (std::size_t title = 0; title < titles; title++) {
+        auto mangaId = randomId();
+        for (std::size_t i = 0; i < chaptersPerTitle; i++) {
+            mangadex::Chapter chapter;
+            chapter.id = randomId();
+            chapter.mangaId = mangaId;
+            chapter.scanlationGroups.push_back(groups[rng() % groups.size()]);
+            if (rng() % 20 == 0) {
+                chapter.scanlationGroups.push_back(groups[rng() % groups.size()]);
+            }
+            chapter.volume = std::to_string(i / 10 + 1);
+            chapter.chapter = std::to_string(rng() % (chaptersPerTitle / 2));
+            chapter.title = "Chapter title that doesn't fit in the small string buffer";
+            chapter.translatedLanguage = languages[rng() % languages.size()];
+            chapter.publishAt = "2023-01-01T00:00:00+00:00";
+            chapter.publishAt[3] = static_cast<char>('0' + rng() % 4);
+            chapter.publishAt[6] = static_cast<char>('1' + rng() % 9);
+            chapter.pages = static_cast<std::uint32_t>(rng() % 40 + 1);
+            chapters.push_back(std::move(chapter));
+        }
+    }
+    return chapters;
+}
+
+} // namespace
+
+// The same queries the library view runs, over a vector of Chapter (what
+// the feed parser hands out) and over a ChapterTable
+TEST_CASE("Chapter list queries, 100k chapters", "[chapters]") {
+    const auto chapters = generateChapters();
+    mangadex::ChapterTable table;
+    table.reserve(chapters.size());
+    for (auto const &chapter : chapters) {
+        table.append(chapter);
+    }
+    REQUIRE(table.size() == chapters.size());
+
+    const auto group = chapters[1234].scanlationGroups.front();
+    // Pretend the first half of every title has been read
+    std::unordered_set<core::Uuid> read;
+    for (std::size_t i = 0; i < chapters.size(); i++) {
+        if (i % 500 < 250) {
+            read.insert(chapters[i].id);
+            table.setFlags(static_cast<mangadex::ChapterTable::Row>(i), mangadex::ChapterTable::Read);
+        }
+    }
+
+    BENCHMARK("vector<Chapter>: filter by language") {
+        std::vector<mangadex::Chapter const *> selected;
+        for (auto const &chapter : chapters) {
+            if (chapter.translatedLanguage == "en") {
+                selected.push_back(&chapter);
+            }
+        }
+        return selected.size();
+    };
+
+    BENCHMARK("ChapterTable: filter by language") {
+        return table.filterLanguage(table.all(), "en").size();
+    };
+
+    BENCHMARK("vector<Chapter>: filter by group") {
+        std::vector<mangadex::Chapter const *> selected;
+        for (auto const &chapter : chapters) {
+            if (std::find(chapter.scanlationGroups.begin(), chapter.scanlationGroups.end(), group) != chapter.scanlationGroups.end()) {
+                selected.push_back(&chapter);
+            }
+        }
+        return selected.size();
+    };
+
+    BENCHMARK("ChapterTable: filter by group") {
+        return table.filterGroup(table.all(), group).size();
+    };
+
+    BENCHMARK("vector<Chapter>: newest unread") {
+        std::vector<mangadex::Chapter const *> selected;
+        for (auto const &chapter : chapters) {
+            if (!read.contains(chapter.id)) {
+                selected.push_back(&chapter);
+            }
+        }
+        std::sort(selected.begin(), selected.end(), [](auto const *a, auto const *b) {
+            return a->publishAt > b->publishAt;
+        });
+        return selected.size();
+    };
+
+    BENCHMARK("ChapterTable: newest unread") {
+        return table.newestUnread(table.all()).size();
+    };
+
+    BENCHMARK("vector<Chapter>: English, sorted and deduped by chapter number") {
+        std::vector<mangadex::Chapter const *> selected;
+        for (auto const &chapter : chapters) {
+            if (chapter.translatedLanguage == "en") {
+                selected.push_back(&chapter);
+            }
+        }
+        std::stable_sort(selected.begin(), selected.end(), [](auto const *a, auto const *b) {
+            if (a->mangaId != b->mangaId) {
+                return a->mangaId < b->mangaId;
+            }
+            return std::stof(a->chapter) < std::stof(b->chapter);
+        });
+        auto end = std::unique(selected.begin(), selected.end(), [](auto const *a, auto const *b) {
+            return a->mangaId == b->mangaId && a->chapter == b->chapter;
+        });
+        return static_cast<std::size_t>(end - selected.begin());
+    };
+
+    BENCHMARK("ChapterTable: English, sorted and deduped by chapter number") {
+        auto rows = table.filterLanguage(table.all(), "en");
+        table.sortByNumber(rows);
+        return table.dedupeByNumber(rows).size();
+    };
+}
@@ -0,0 +1,83 @@
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "file_io.h"
+
+namespace {
+
+// A chapter's worth of pages at a time, sized like typical data saver pages
+constexpr std::size_t pageCount = 500;
+constexpr std::size_t pageSize = 256 * 1024;
+
+struct ScratchDirectory {
+    std::filesystem::path path;
+
+    ScratchDirectory() : path(std::filesystem::temp_directory_path() / "manga-manager-bench-file-io") {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+    ~ScratchDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+    }
+};
+
+auto writeAll(core::FileWriter &writer, std::filesystem::path const &directory, std::string const &page) -> std::size_t {
+    std::atomic<std::size_t> written = 0;
+    for (std::size_t i = 0; i < pageCount; i++) {
+        writer.write(directory / (std::to_string(i) + ".png"), page, [&written](std::error_code error) {
+            if (!error) {
+                written++;
+            }
+        });
+    }
+    writer.flush();
+    return written.load();
+}
+
+} // namespace
+
+TEST_CASE("core::FileWriter", "[file_io]") {
+    ScratchDirectory scratch;
+    std::string page(pageSize, 'x');
+
+    std::vector<core::IoBackend> backends = {core::IoBackend::Threads};
+    try {
+        core::makeFileWriter(core::IoBackend::IoUring);
+        backends.push_back(core::IoBackend::IoUring);
+    } catch (std::system_error const &error) {
+        WARN("io_uring not available: " << error.what());
+    }
+
+    // What the CLI used to do, one std::ofstream per page on the calling thread
+    BENCHMARK("Write 500 pages with std::ofstream") {
+        std::size_t written = 0;
+        for (std::size_t i = 0; i < pageCount; i++) {
+            std::ofstream outf{scratch.path / (std::to_string(i) + ".png"), std::ios::binary};
+            outf << page;
+            if (outf) {
+                written++;
+            }
+        }
+        return written;
+    };
+
+    for (auto backend : backends) {
+        for (bool sync : {false, true}) {
+            auto writer = core::makeFileWriter(backend, {.sync = sync});
+            REQUIRE(writeAll(*writer, scratch.path, page) == pageCount);
+
+            BENCHMARK(std::string("Write 500 pages with ") + std::string(writer->name()) + (sync ? ", fsync" : "")) {
+                return writeAll(*writer, scratch.path, page);
+            };
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef BENCH_FIXTURES_H
+#define BENCH_FIXTURES_H
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace fixtures {
+
+// Load a file from the fixtures directory (bench/fixtures) into memory
+// e.g. fixtures::load("mangadex/manga_feed.json")
+inline auto load(std::string_view name) -> std::string {
+    const auto path = std::string(BENCH_FIXTURES_DIR) + "/" + std::string(name);
+
+    std::ifstream inf{path, std::ios::binary};
+    if (!inf) {
+        throw std::runtime_error("Unable to open fixture: " + path);
+    }
+
+    return {std::istreambuf_iterator<char>(inf), std::istreambuf_iterator<char>()};
+}
+
+} // namespace fixtures
+
+#endif // BENCH_FIXTURES_H
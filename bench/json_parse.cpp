@@ -0,0 +1,78 @@
+#include <string>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <nlohmann/json.hpp>
+
+#include "allocation_counter.h"
+#include "fixtures.h"
+#include "json_arena.h"
+#include "mangadex.h"
+
+// A full page (500 chapters) of a /manga/{id}/feed response
+TEST_CASE("MangaDex feed parsing", "[json][mangadex]") {
+    const auto feed = fixtures::load("mangadex/manga_feed.json");
+    REQUIRE(nlohmann::json::parse(feed).at("data").size() == 500);
+
+    BENCHMARK("Parse feed into nlohmann::json") {
+        return nlohmann::json::parse(feed);
+    };
+
+    // What a provider will end up doing with every response, parse it and
+    // then pull out the fields it cares about
+    BENCHMARK("Parse feed and read chapter attributes") {
+        auto json = nlohmann::json::parse(feed);
+
+        std::size_t pages = 0;
+        for (auto const &chapter : json.at("data")) {
+            auto const &attributes = chapter.at("attributes");
+            pages += attributes.at("pages").get<std::size_t>();
+            [[maybe_unused]] auto language = attributes.at("translatedLanguage").get<std::string>();
+        }
+        return pages;
+    };
+}
+
+// Same as above, but parsed into a JsonArena the way the providers do it.
+// The arena is warmed up first, as it would be after the first response.
+TEST_CASE("MangaDex feed parsing into a JSON arena", "[json][mangadex][arena]") {
+    const auto feed = fixtures::load("mangadex/manga_feed.json");
+    core::JsonArena arena;
+
+    auto parseIntoArena = [&] {
+        core::JsonArenaScope scope(arena);
+        auto json = core::ArenaJson::parse(feed);
+        return json.at("data").size();
+    };
+    REQUIRE(parseIntoArena() == 500);
+
+    // Not a timing, but the number of trips to the heap is the point of the
+    // arena, so check it actually saves them
+    auto heap = allocations::count([&] { return nlohmann::json::parse(feed); });
+    auto pooled = allocations::count(parseIntoArena);
+    WARN("nlohmann::json: " << heap.calls << " allocations (" << heap.bytes << " bytes), "
+                            << "ArenaJson: " << pooled.calls << " allocations (" << pooled.bytes << " bytes)");
+    CHECK(pooled.calls < heap.calls / 100);
+
+    BENCHMARK("Parse feed into core::ArenaJson") {
+        return parseIntoArena();
+    };
+
+    BENCHMARK("Parse feed and read chapter attributes from core::ArenaJson") {
+        core::JsonArenaScope scope(arena);
+        auto json = core::ArenaJson::parse(feed);
+
+        std::size_t pages = 0;
+        for (auto const &chapter : json.at("data")) {
+            auto const &attributes = chapter.at("attributes");
+            pages += attributes.at("pages").get<std::size_t>();
+            [[maybe_unused]] auto language = core::toString(attributes.at("translatedLanguage"));
+        }
+        return pages;
+    };
+
+    // The whole thing, down to the mangadex::Chapter structs
+    BENCHMARK("mangadex::parseFeed") {
+        return mangadex::parseFeed(feed);
+    };
+}
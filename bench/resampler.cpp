@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numbers>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "resampler.h"
+#include "vulkan_renderer.h"
+
+namespace {
+
+// A scanned page, shown fit-to-width in a window of a typical size
+constexpr vk::Extent2D pageExtent{.width = 1024, .height = 1536};
+constexpr vk::Extent2D shownExtent{.width = 600, .height = 900};
+
+// Fine detail that aliases badly if downscaling skips source pixels:
+// screentone dots over a gradient, with hard black and white edges
+auto syntheticPage() -> std::vector<std::uint8_t> {
+    std::vector<std::uint8_t> pixels(std::size_t(pageExtent.width) * pageExtent.height * 4);
+    for (std::uint32_t y = 0; y < pageExtent.height; y++) {
+        for (std::uint32_t x = 0; x < pageExtent.width; x++) {
+            auto *pixel = &pixels[(std::size_t(y) * pageExtent.width + x) * 4];
+            auto tone = ((x / 3 + y / 3) % 2 == 0) ? 0 : 255;
+            auto value = x < pageExtent.width / 2 ? tone : (y * 255 / pageExtent.height);
+            pixel[0] = pixel[1] = pixel[2] = static_cast<std::uint8_t>(value);
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+auto srgbToLinear(float value) -> float {
+    return value <= 0.04045F ? value / 12.92F : std::pow((value + 0.055F) / 1.055F, 2.4F);
+}
+
+auto linearToSrgb(float value) -> float {
+    return value <= 0.0031308F ? value * 12.92F : 1.055F * std::pow(value, 1.0F / 2.4F) - 0.055F;
+}
+
+auto lanczos3(float x) -> float {
+    auto sinc = [](float v) { return v == 0.0F ? 1.0F : std::sin(std::numbers::pi_v<float> * v) / (std::numbers::pi_v<float> * v); };
+    x = std::abs(x);
+    return x < 3.0F ? sinc(x) * sinc(x / 3.0F) : 0.0F;
+}
+
+// One pass of the same separable filter as resample.comp, on linear floats
+void resampleAxis(std::vector<float> const &source, std::uint32_t sourceWidth, std::uint32_t sourceHeight,
+    std::vector<float> &destination, std::uint32_t destinationWidth, std::uint32_t destinationHeight, bool vertical) {
+    destination.assign(std::size_t(destinationWidth) * destinationHeight * 4, 0.0F);
+    auto sourceSize = vertical ? sourceHeight : sourceWidth;
+    auto destinationSize = vertical ? destinationHeight : destinationWidth;
+    auto scale = static_cast<float>(sourceSize) / static_cast<float>(destinationSize);
+    auto kernelScale = std::max(scale, 1.0F);
+    auto support = 3.0F * kernelScale;
+
+    for (std::uint32_t y = 0; y < destinationHeight; y++) {
+        for (std::uint32_t x = 0; x < destinationWidth; x++) {
+            auto position = vertical ? y : x;
+            auto centre = (static_cast<float>(position) + 0.5F) * scale;
+            auto first = std::max(static_cast<int>(std::floor(centre - support)), 0);
+            auto last = std::min(static_cast<int>(std::ceil(centre + support)), static_cast<int>(sourceSize) - 1);
+
+            float sum[4] = {};
+            float weightSum = 0.0F;
+            for (auto i = first; i <= last; i++) {
+                auto weight = lanczos3((static_cast<float>(i) + 0.5F - centre) / kernelScale);
+                auto sx = vertical ? x : static_cast<std::uint32_t>(i);
+                auto sy = vertical ? static_cast<std::uint32_t>(i) : y;
+                auto const *texel = &source[(std::size_t(sy) * sourceWidth + sx) * 4];
+                for (int channel = 0; channel < 4; channel++) {
+                    sum[channel] += weight * texel[channel];
+                }
+                weightSum += weight;
+            }
+            auto *out = &destination[(std::size_t(y) * destinationWidth + x) * 4];
+            for (int channel = 0; channel < 4; channel++) {
+                out[channel] = sum[channel] / weightSum;
+            }
+        }
+    }
+}
+
+// What we'd do without the GPU
+auto resampleOnCpu(std::vector<std::uint8_t> const &pixels) -> std::vector<std::uint8_t> {
+    std::vector<float> linear(pixels.size());
+    for (std::size_t i = 0; i < pixels.size(); i++) {
+        auto value = static_cast<float>(pixels[i]) / 255.0F;
+        linear[i] = (i % 4 == 3) ? value : srgbToLinear(value);
+    }
+
+    std::vector<float> horizontal;
+    std::vector<float> vertical;
+    resampleAxis(linear, pageExtent.width, pageExtent.height, horizontal, shownExtent.width, pageExtent.height, false);
+    resampleAxis(horizontal, shownExtent.width, pageExtent.height, vertical, shownExtent.width, shownExtent.height, true);
+
+    std::vector<std::uint8_t> result(vertical.size());
+    for (std::size_t i = 0; i < vertical.size(); i++) {
+        auto value = std::clamp(vertical[i], 0.0F, 1.0F);
+        value = (i % 4 == 3) ? value : linearToSrgb(value);
+        result[i] = static_cast<std::uint8_t>(std::lround(value * 255.0F));
+    }
+    return result;
+}
+
+auto transition(vk::Image image, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess, vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
+    return vk::ImageMemoryBarrier{
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = dstAccess,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = vk::ImageSubresourceRange{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1}};
+}
+
+auto hostBuffer(VulkanRender &renderer, vk::DeviceSize size, vk::BufferUsageFlags usage) -> GpuBuffer {
+    return createGpuBuffer(renderer.gpuAllocator(), renderer.logicalDevice(),
+        vk::BufferCreateInfo{
+            .flags = vk::BufferCreateFlags(),
+            .size = size,
+            .usage = usage,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr},
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+auto imageCopy(vk::Extent2D extent) -> vk::BufferImageCopy {
+    return vk::BufferImageCopy{
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = vk::ImageSubresourceLayers{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1},
+        .imageOffset = vk::Offset3D{.x = 0, .y = 0, .z = 0},
+        .imageExtent = vk::Extent3D{.width = extent.width, .height = extent.height, .depth = 1}};
+}
+
+} // namespace
+
+// Headless like the other [vulkan] benchmarks, so runs under lavapipe:
+// VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./manga-manager-bench "[resample]"
+TEST_CASE("Resampler page downscaling", "[vulkan][resample]") {
+    VulkanRender renderer("manga-manager-bench");
+    renderer.selectPhysicalDevice();
+    renderer.initDevice();
+    auto const &device = renderer.logicalDevice();
+
+    // The page, uploaded like TextureManager does
+    auto pixels = syntheticPage();
+    auto page = createGpuImage(renderer.gpuAllocator(), device,
+        vk::ImageCreateInfo{
+            .flags = vk::ImageCreateFlags(),
+            .imageType = vk::ImageType::e2D,
+            .format = vk::Format::eR8G8B8A8Srgb,
+            .extent = vk::Extent3D{.width = pageExtent.width, .height = pageExtent.height, .depth = 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = vk::ImageLayout::eUndefined},
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    auto pageView = vk::raii::ImageView(device,
+        vk::ImageViewCreateInfo{
+            .flags = vk::ImageViewCreateFlags(),
+            .image = *page.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = vk::Format::eR8G8B8A8Srgb,
+            .components = vk::ComponentMapping(),
+            .subresourceRange = vk::ImageSubresourceRange{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1}});
+
+    auto staging = hostBuffer(renderer, pixels.size(), vk::BufferUsageFlagBits::eTransferSrc);
+    std::memcpy(staging.allocation.mapped(), pixels.data(), pixels.size());
+    renderer.submitNow([&](vk::raii::CommandBuffer const &commandBuffer) {
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(),
+            nullptr, nullptr,
+            transition(*page.image, {}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal));
+        commandBuffer.copyBufferToImage(*staging.buffer, *page.image, vk::ImageLayout::eTransferDstOptimal, imageCopy(pageExtent));
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(),
+            nullptr, nullptr,
+            transition(*page.image, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal));
+    });
+
+    auto &resampler = renderer.pageResampler();
+    auto target = resampler.createTarget(*pageView, pageExtent, shownExtent);
+    // record() doesn't wait for them
+    renderer.pipelineManager().waitAll();
+    REQUIRE(resampler.ready());
+
+    // Resample on the GPU and read it back
+    auto readback = hostBuffer(renderer, std::size_t(shownExtent.width) * shownExtent.height * 4, vk::BufferUsageFlagBits::eTransferDst);
+    renderer.submitNow([&](vk::raii::CommandBuffer const &commandBuffer) {
+        CHECK(resampler.record(commandBuffer, *target, ResampleFilter::Lanczos3));
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(),
+            nullptr, nullptr,
+            transition(target->image(), vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead,
+                vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal));
+        commandBuffer.copyImageToBuffer(target->image(), vk::ImageLayout::eTransferSrcOptimal, *readback.buffer, imageCopy(shownExtent));
+    });
+
+    // Same filter on the CPU, in floats. The GPU filters in half floats
+    // between the passes, so allow a little rounding
+    auto expected = resampleOnCpu(pixels);
+    auto const *actual = reinterpret_cast<std::uint8_t const *>(readback.allocation.mapped());
+    int maxError = 0;
+    for (std::size_t i = 0; i < expected.size(); i++) {
+        maxError = std::max(maxError, std::abs(int(actual[i]) - int(expected[i])));
+    }
+    CHECK(maxError <= 2);
+
+    BENCHMARK("Lanczos3 1024x1536 -> 600x900, CPU") {
+        return resampleOnCpu(pixels);
+    };
+
+    // Including the submit and the wait, so this is the latency of a zoom
+    // change rather then the throughput
+    BENCHMARK("Lanczos3 1024x1536 -> 600x900, GPU") {
+        renderer.submitNow([&](vk::raii::CommandBuffer const &commandBuffer) {
+            resampler.record(commandBuffer, *target, ResampleFilter::Lanczos3);
+        });
+    };
+
+    BENCHMARK("Bicubic 1024x1536 -> 600x900, GPU") {
+        renderer.submitNow([&](vk::raii::CommandBuffer const &commandBuffer) {
+            resampler.record(commandBuffer, *target, ResampleFilter::Bicubic);
+        });
+    };
+
+    target.reset();
+    renderer.waitIdle();
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "strip_view.h"
+#include "vulkan_renderer.h"
+
+namespace {
+
+// A long webtoon chapter: 60 images of 800 x 12000, 2.2 GiB if it were all
+// resident at once
+constexpr std::uint32_t imageWidth = 800;
+constexpr std::uint32_t imageHeight = 12000;
+constexpr std::size_t imageCount = 60;
+
+void syntheticRows(std::size_t image, std::uint32_t /*firstRow*/, std::uint32_t rowCount, PageWriter &writer) {
+    for (std::uint32_t y = 0; y < rowCount; y++) {
+        std::ranges::fill(writer.row(y), std::byte(image));
+    }
+}
+
+} // namespace
+
+// VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./manga-manager-bench "[strip]"
+TEST_CASE("StripView scrolling", "[vulkan][textures][strip]") {
+    VulkanRender renderer("manga-manager-bench");
+    renderer.selectPhysicalDevice();
+    renderer.initDevice();
+
+    StripViewOptions options{
+        .tileHeight = 2048, .vramBudget = 64 * 1024 * 1024, .prefetchScreens = 1.0F, .decodeThreads = 2, .memoryBudget = nullptr};
+    StripView strip(renderer, std::vector<StripImage>(imageCount, StripImage{imageWidth, imageHeight}), syntheticRows, options);
+    strip.setViewport(imageWidth, 1200.0F);
+    CHECK(strip.tileCount() == imageCount * 6);
+    CHECK(strip.totalHeight() == float(imageCount * imageHeight));
+
+    // Scrolling through the whole strip a screen at a time, everything on
+    // screen is resident once the uploads have caught up, and memory stays
+    // within budget however far down we are
+    std::vector<StripView::VisibleTile> tiles;
+    std::vector<QuadInstance> quads;
+    while (true) {
+        strip.update();
+        strip.waitIdle();
+        strip.update();
+        strip.visibleTiles(tiles);
+        REQUIRE(!tiles.empty());
+        for (auto const &tile : tiles) {
+            CHECK(tile.texture != nullptr);
+        }
+        // And drawn from the texture table, not as placeholders
+        quads.clear();
+        strip.build(quads);
+        CHECK(quads.size() == tiles.size());
+        for (auto const &quad : quads) {
+            CHECK(quad.texture != QuadInstance::noTexture);
+        }
+        CHECK(strip.residentBytes() <= options.vramBudget);
+
+        if (strip.scrollOffset() + 1200.0F >= strip.totalHeight()) {
+            break;
+        }
+        strip.scrollBy(1200.0F);
+    }
+
+    // What a frame of smooth scrolling costs the render thread, at 16 px a
+    // frame with the decodes and uploads running in the background
+    strip.scrollTo(0.0F);
+    BENCHMARK("Scroll a frame") {
+        if (strip.scrollOffset() + 1200.0F >= strip.totalHeight()) {
+            strip.scrollTo(0.0F);
+        }
+        strip.scrollBy(16.0F);
+        strip.update();
+        strip.visibleTiles(tiles);
+        return tiles.size();
+    };
+
+    strip.waitIdle();
+    renderer.waitIdle();
+}
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "texture_manager.h"
+#include "vulkan_renderer.h"
+
+namespace {
+
+// Roughly a scanned page, 6 MiB once decoded
+constexpr std::uint32_t pageWidth = 1024;
+constexpr std::uint32_t pageHeight = 1536;
+constexpr std::uint32_t pageCount = 40;
+
+void syntheticPage(TextureManager::PageIndex index, PageWriter &writer) {
+    writer.begin(pageWidth, pageHeight);
+    for (std::uint32_t y = 0; y < pageHeight; y++) {
+        std::ranges::fill(writer.row(y), std::byte(index));
+    }
+}
+
+} // namespace
+
+// Headless like the other [vulkan] benchmarks, so runs under lavapipe:
+// VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./manga-manager-bench "[textures]"
+TEST_CASE("TextureManager page streaming", "[vulkan][textures]") {
+    VulkanRender renderer("manga-manager-bench");
+    renderer.selectPhysicalDevice();
+    renderer.initDevice();
+
+    // Room for the current page and two either side, nothing more. Staged
+    // pages count against a budget of a few pages, so some of them have to
+    // wait their turn
+    core::MemoryBudget budget(16 * 1024 * 1024);
+    TextureManagerOptions options{.vramBudget = 32 * 1024 * 1024, .prefetch = 2, .decodeThreads = 2, .memoryBudget = &budget};
+    TextureManager textures(renderer, pageCount, syntheticPage, options);
+
+    // Reading through the chapter, the next page is always ready by the
+    // time we turn to it, and we stay within budget
+    textures.show(0);
+    textures.waitIdle();
+    for (TextureManager::PageIndex page = 1; page < pageCount; page++) {
+        textures.show(page);
+        CHECK(textures.find(page) != nullptr);
+        textures.waitIdle();
+        CHECK(textures.residentBytes() <= options.vramBudget);
+    }
+    CHECK(textures.find(0) == nullptr);
+    // Every page's staging memory is given back once it's uploaded
+    CHECK(renderer.stagingRing().used() == 0);
+    CHECK(renderer.stagingRing().dedicatedUsed() == 0);
+    CHECK(budget.used() == 0);
+    CHECK(budget.peak() <= budget.limit());
+
+    // What a page turn costs the render thread, with the uploads it kicks
+    // off running in the background
+    TextureManager::PageIndex page = 0;
+    BENCHMARK("Turn a page") {
+        page = (page + 1) % pageCount;
+        textures.show(page);
+        textures.update();
+        return textures.find(page);
+    };
+
+    textures.waitIdle();
+    renderer.waitIdle();
+}
@@ -0,0 +1,41 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "thumbnail_grid.h"
+
+// No GPU needed, this is the CPU side of drawing the library grid: culling
+// to the scroll window and filling in the instances for the single draw
+TEST_CASE("ThumbnailGrid culling", "[grid]") {
+    ThumbnailGrid grid;
+    grid.setViewport(1920.0F, 1080.0F);
+    std::vector<QuadInstance> quads;
+    auto noCover = [](std::size_t) { return QuadInstance::noTexture; };
+
+    for (std::size_t items : {100, 10'000, 100'000}) {
+        grid.setItemCount(items);
+        grid.scrollTo(grid.contentHeight() / 2.0F);
+
+        // However big the library, only what's on screen (plus the partly
+        // visible rows at the edges) turns into quads
+        quads.clear();
+        grid.build(quads, noCover);
+        REQUIRE(!quads.empty());
+        CHECK(quads.size() <= grid.columns() * 6);
+        for (auto const &quad : quads) {
+            CHECK(quad.rect.y + quad.rect.w > 0.0F);
+            CHECK(quad.rect.y < 1080.0F);
+        }
+
+        BENCHMARK("Build a frame of " + std::to_string(items) + " covers") {
+            quads.clear();
+            grid.scrollBy(3.0F);
+            grid.build(quads, noCover);
+            return quads.size();
+        };
+    }
+}
@@ -0,0 +1,88 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "uuid.h"
+
+// Roughly a large library's worth of chapter ids
+TEST_CASE("core::Uuid", "[uuid]") {
+    constexpr std::size_t count = 100'000;
+
+    std::mt19937_64 rng(42);
+    std::vector<core::Uuid> uuids;
+    std::vector<std::string> strings;
+    uuids.reserve(count);
+    strings.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        std::array<std::uint8_t, 16> bytes{};
+        for (auto &byte : bytes) {
+            byte = static_cast<std::uint8_t>(rng());
+        }
+        uuids.emplace_back(bytes);
+        strings.push_back(uuids.back().toString());
+    }
+    REQUIRE(core::Uuid::fromString(strings.front()) == uuids.front());
+
+    BENCHMARK("Parse 100k UUIDs") {
+        std::size_t valid = 0;
+        for (auto const &string : strings) {
+            valid += core::Uuid::parse(string).has_value() ? 1 : 0;
+        }
+        return valid;
+    };
+
+    BENCHMARK("Format 100k UUIDs") {
+        std::array<char, core::Uuid::stringLength> text{};
+        std::size_t checksum = 0;
+        for (auto const &uuid : uuids) {
+            uuid.format(text.data());
+            checksum += static_cast<unsigned char>(text[35]);
+        }
+        return checksum;
+    };
+
+    BENCHMARK("Hash 100k UUIDs") {
+        std::size_t checksum = 0;
+        for (auto const &uuid : uuids) {
+            checksum ^= std::hash<core::Uuid>{}(uuid);
+        }
+        return checksum;
+    };
+
+    BENCHMARK("Hash 100k UUID strings") {
+        std::size_t checksum = 0;
+        for (auto const &string : strings) {
+            checksum ^= std::hash<std::string>{}(string);
+        }
+        return checksum;
+    };
+
+    // The kind of join a library view does, e.g. "which of these chapters
+    // have been read"
+    std::unordered_set<core::Uuid> uuidSet(uuids.begin(), uuids.end());
+    std::unordered_set<std::string> stringSet(strings.begin(), strings.end());
+
+    BENCHMARK("Look up 100k UUIDs in an unordered_set") {
+        std::size_t found = 0;
+        for (auto const &uuid : uuids) {
+            found += uuidSet.count(uuid);
+        }
+        return found;
+    };
+
+    BENCHMARK("Look up 100k UUID strings in an unordered_set") {
+        std::size_t found = 0;
+        for (auto const &string : strings) {
+            found += stringSet.count(string);
+        }
+        return found;
+    };
+}
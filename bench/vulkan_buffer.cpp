@@ -0,0 +1,66 @@
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "vulkan_renderer.h"
+
+// Runs against whatever Vulkan device is found first, so on a CPU only
+// machine (e.g. a CI box) this will be using lavapipe (Mesa's software
+// rasterizer). No window or surface is created.
+//
+// To force lavapipe on a machine with a GPU:
+// VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./manga-manager-bench "[vulkan]"
+TEST_CASE("VulkanRender::createBuffer uploads", "[vulkan][upload]") {
+    VulkanRender renderer("manga-manager-bench");
+    renderer.selectPhysicalDevice();
+    renderer.initDevice();
+
+    // Static as we don't want a 1 MiB array sitting on the stack
+    static const std::array<std::byte, 4 * 1024> small{};
+    static const std::array<std::byte, 256 * 1024> medium{};
+    static const std::array<std::byte, 1024 * 1024> large{};
+
+    BENCHMARK("createBuffer 4 KiB vertex buffer") {
+        return renderer.createBuffer(vk::BufferUsageFlagBits::eVertexBuffer, small);
+    };
+
+    BENCHMARK("createBuffer 256 KiB vertex buffer") {
+        return renderer.createBuffer(vk::BufferUsageFlagBits::eVertexBuffer, medium);
+    };
+
+    BENCHMARK("createBuffer 1 MiB vertex buffer") {
+        return renderer.createBuffer(vk::BufferUsageFlagBits::eVertexBuffer, large);
+    };
+}
+
+// A library's worth of thumbnails is thousands of small buffers/images, each
+// of which used to be its own vkAllocateMemory
+TEST_CASE("GpuAllocator sub-allocation", "[vulkan][allocator]") {
+    VulkanRender renderer("manga-manager-bench");
+    renderer.selectPhysicalDevice();
+    renderer.initDevice();
+    auto &allocator = renderer.gpuAllocator();
+
+    constexpr std::size_t count = 1000;
+    auto requirements = vk::MemoryRequirements{.size = 64 * 1024, .alignment = 256, .memoryTypeBits = ~0U};
+
+    std::vector<GpuAllocator::Allocation> allocations;
+    allocations.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        allocations.push_back(allocator.allocate(requirements, vk::MemoryPropertyFlagBits::eDeviceLocal));
+    }
+    // 1000 * 64 KiB fits in a handful of 64 MiB blocks
+    CHECK(allocator.deviceAllocations() <= 2);
+    allocations.clear();
+
+    BENCHMARK("Allocate and free 1000 64 KiB ranges") {
+        for (std::size_t i = 0; i < count; i++) {
+            allocations.push_back(allocator.allocate(requirements, vk::MemoryPropertyFlagBits::eDeviceLocal));
+        }
+        allocations.clear();
+        return allocations.size();
+    };
+}
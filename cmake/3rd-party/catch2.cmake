@@ -8,8 +8,9 @@ include(FetchContent)
 FetchContent_Declare(
     Catch2
     GIT_REPOSITORY https://github.com/catchorg/Catch2.git
-    GIT_TAG v3.4.0
-    FIND_PACKAGE_ARGS
+    # v3.5.0 or newer is needed for the JSON reporter used by the benchmarks
+    GIT_TAG v3.5.2
+    FIND_PACKAGE_ARGS 3.5
     )
 
 FetchContent_MakeAvailable(Catch2)
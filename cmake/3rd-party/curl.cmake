@@ -0,0 +1,7 @@
+if(TARGET CURL::libcurl)
+    return()
+endif()
+
+message(VERBOSE "Third-party targets available: 'CURL::libcurl'")
+
+find_package(CURL REQUIRED)
@@ -4,6 +4,9 @@ endif()
 
 message(VERBOSE "Third-party targets available: 'imgui::imgui'")
 
+# The SDL2 backend below links against it
+include(sdl2)
+
 include(FetchContent)
 FetchContent_Declare(
     imgui
@@ -17,15 +20,17 @@ set(IMGUI_BUILD_METAL_BINDING OFF)
 set(IMGUI_BUILD_OSX_BINDING OFF)
 set(IMGUI_BUILD_SDL2_BINDING ON)
 set(IMGUI_BUILD_SDL2_RENDERER_BINDING OFF)
-set(IMGUI_BUILD_VULKAN_BINDING ON)
+# We draw ImGui ourselves, see ImGuiRenderer
+set(IMGUI_BUILD_VULKAN_BINDING OFF)
 set(IMGUI_BUILD_WIN32_BINDING OFF)
 set(IMGUI_FREETYPE OFF)
 set(IMGUI_USE_WCHAR32 OFF)
 
 # Taken from:
 # - https://github.com/microsoft/vcpkg/blob/master/ports/imgui/CMakeLists.txt
-# - https://github.com/microsoft/vcpkg/blob/master/ports/imgui/imgui-config.cmake.in
-add_library(imgui "")
+# Minus the install and package config parts, it's only ever linked
+# statically into our own targets.
+add_library(imgui STATIC "")
 add_library(imgui::imgui ALIAS imgui)
 target_include_directories(
     imgui
@@ -57,7 +62,8 @@ endif()
 
 if(IMGUI_BUILD_SDL2_BINDING)
     target_link_libraries(imgui PUBLIC SDL2::SDL2)
-    target_sources(imgui PRIVATE ${imgui_SOURCE_DIR}/backends/imgui_impl_sdl.cpp)
+    # The SDL2 backend was renamed to imgui_impl_sdl2 in 1.89
+    target_sources(imgui PRIVATE ${imgui_SOURCE_DIR}/backends/imgui_impl_sdl2.cpp)
 endif()
 
 if(IMGUI_BUILD_SDL2_RENDERER_BINDING)
@@ -87,76 +93,3 @@ endif()
 
 # Check for obsolete functions
 target_compile_definitions(imgui PUBLIC IMGUI_DISABLE_OBSOLETE_FUNCTIONS)
-
-list(REMOVE_DUPLICATES BINDINGS_SOURCES)
-
-install(
-    TARGETS imgui
-    EXPORT imgui_target
-    ARCHIVE DESTINATION lib
-    LIBRARY DESTINATION lib
-    RUNTIME DESTINATION bin
-)
-
-foreach(BINDING_TARGET ${BINDING_TARGETS})
-    install(
-        TARGETS ${BINDING_TARGET}
-        EXPORT imgui_target
-        ARCHIVE DESTINATION lib
-        LIBRARY DESTINATION lib
-        RUNTIME DESTINATION bin
-    )
-endforeach()
-
-if(NOT IMGUI_SKIP_HEADERS)
-    install(FILES
-        ${imgui_SOURCE_DIR}/imgui.h
-        ${imgui_SOURCE_DIR}/imconfig.h
-        ${imgui_SOURCE_DIR}/imgui_internal.h
-        ${imgui_SOURCE_DIR}/imstb_textedit.h
-        ${imgui_SOURCE_DIR}/imstb_rectpack.h
-        ${imgui_SOURCE_DIR}/imstb_truetype.h
-        ${imgui_SOURCE_DIR}/misc/cpp/imgui_stdlib.h
-        DESTINATION include
-    )
-
-    if(IMGUI_BUILD_METAL_BINDING)
-        install(FILES ${imgui_SOURCE_DIR}/backends/imgui_impl_metal.h DESTINATION include)
-    endif()
-
-    if(IMGUI_BUILD_OSX_BINDING)
-        install(FILES ${imgui_SOURCE_DIR}/backends/imgui_impl_osx.h DESTINATION include)
-    endif()
-
-    if(IMGUI_BUILD_SDL2_BINDING)
-        install(FILES ${imgui_SOURCE_DIR}/backends/imgui_impl_sdl.h DESTINATION include)
-    endif()
-
-     if(IMGUI_BUILD_SDL2_RENDERER_BINDING)
-        install(FILES ${imgui_SOURCE_DIR}/backends/imgui_impl_sdlrenderer.h DESTINATION include)
-    endif()
-
-    if(IMGUI_BUILD_VULKAN_BINDING)
-        install(FILES ${imgui_SOURCE_DIR}/backends/imgui_impl_vulkan.h DESTINATION include)
-    endif()
-
-    if(IMGUI_BUILD_WIN32_BINDING)
-        install(FILES ${imgui_SOURCE_DIR}/backends/imgui_impl_win32.h DESTINATION include)
-    endif()
-
-    if(IMGUI_FREETYPE)
-        install(FILES ${imgui_SOURCE_DIR}/misc/freetype/imgui_freetype.h DESTINATION include)
-    endif()
-endif()
-
-include(CMakePackageConfigHelpers)
-configure_package_config_file(imgui-config.cmake.in imgui-config.cmake INSTALL_DESTINATION 3rd-party/imgui)
-
-install(FILES ${CMAKE_CURRENT_BINARY_DIR}/imgui-config.cmake DESTINATION 3rd-party/imgui)
-
-install(
-    EXPORT imgui_target
-    NAMESPACE imgui::
-    FILE imgui-targets.cmake
-    DESTINATION 3rd-party/imgui
-)
@@ -29,6 +29,10 @@ endif()
 
 option(BUILD_EXAMPLES  "Build all examples" OFF)
 
+option(BUILD_BENCHMARKS "Build the benchmark suite" OFF)
+
+option(BUILD_TOOLS "Build developer tools (e.g. the MangaDex API simulator)" OFF)
+
 # Set a default build type if none was specified
 if(NOT CMAKE_BUILD_TYPE AND NOT CMAKE_CONFIGURATION_TYPES)
     message(STATUS "Setting build type to 'RelWithDebInfo' as none was specified.")
@@ -0,0 +1,159 @@
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "file_io.h"
+#include "thread_pool.h"
+
+#ifdef MANGA_MANAGER_HAS_IO_URING
+#include "file_io_uring.h"
+#endif
+
+namespace core {
+
+namespace {
+
+#if defined(__unix__) || defined(__APPLE__)
+
+auto writeWholeFile(std::filesystem::path const &path, std::string const &data, bool sync) -> std::error_code {
+    auto lastError = [] { return std::error_code(errno, std::generic_category()); };
+
+    auto fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return lastError();
+    }
+
+    std::error_code error;
+    std::size_t written = 0;
+    while (written < data.size()) {
+        auto result = ::write(fd, data.data() + written, data.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = lastError();
+            break;
+        }
+        written += static_cast<std::size_t>(result);
+    }
+
+    if (!error && sync && ::fsync(fd) != 0) {
+        error = lastError();
+    }
+    if (::close(fd) != 0 && !error) {
+        error = lastError();
+    }
+    return error;
+}
+
+#else
+
+// No fsync through iostreams, `sync` is best effort here
+auto writeWholeFile(std::filesystem::path const &path, std::string const &data, bool /*sync*/) -> std::error_code {
+    std::ofstream outf{path, std::ios::binary | std::ios::trunc};
+    if (!outf || !outf.write(data.data(), static_cast<std::streamsize>(data.size())) || !outf.flush()) {
+        return std::make_error_code(std::errc::io_error);
+    }
+    return {};
+}
+
+#endif
+
+// Plain blocking writes, moved off the caller's thread onto a small pool
+class ThreadFileWriter final : public FileWriter {
+  public:
+    explicit ThreadFileWriter(FileWriterOptions const &writerOptions) : options(writerOptions),
+                                                                        pool(writerOptions.threads) {}
+
+    ~ThreadFileWriter() override {
+        flush();
+    }
+
+    ThreadFileWriter(ThreadFileWriter const &) = delete;
+    auto operator=(ThreadFileWriter const &) -> ThreadFileWriter & = delete;
+
+    void write(std::filesystem::path path, std::string data, Completion completion) override {
+        {
+            std::unique_lock lock(mutex);
+            slotFreed.wait(lock, [this] { return inFlight < std::max<std::size_t>(options.maxInFlight, 1); });
+            inFlight++;
+        }
+
+        pool.submit([this, path = std::move(path), data = std::move(data), completion = std::move(completion)] {
+            auto error = writeWholeFile(path, data, options.sync);
+            if (completion) {
+                completion(error);
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                inFlight--;
+            }
+            slotFreed.notify_all();
+        });
+    }
+
+    void flush() override {
+        pool.wait();
+    }
+
+    [[nodiscard]] auto name() const -> std::string_view override {
+        return "threads";
+    }
+
+  private:
+    const FileWriterOptions options;
+    std::mutex mutex;
+    std::condition_variable slotFreed;
+    std::size_t inFlight = 0;
+    // Last, so the workers are gone before anything they use
+    ThreadPool pool;
+};
+
+} // namespace
+
+auto parseIoBackend(std::string_view name) -> IoBackend {
+    if (name == "auto") {
+        return IoBackend::Auto;
+    }
+    if (name == "io_uring") {
+        return IoBackend::IoUring;
+    }
+    if (name == "threads") {
+        return IoBackend::Threads;
+    }
+    throw std::invalid_argument("Unknown I/O backend: " + std::string(name));
+}
+
+auto makeFileWriter(IoBackend backend, FileWriterOptions options) -> std::unique_ptr<FileWriter> {
+    switch (backend) {
+    case IoBackend::IoUring:
+#ifdef MANGA_MANAGER_HAS_IO_URING
+        return makeIoUringFileWriter(options);
+#else
+        throw std::system_error(std::make_error_code(std::errc::function_not_supported), "io_uring isn't available on this platform");
+#endif
+    case IoBackend::Auto:
+#ifdef MANGA_MANAGER_HAS_IO_URING
+        // Disabled (e.g. by seccomp in a container, or
+        // kernel.io_uring_disabled) or too old a kernel
+        try {
+            return makeIoUringFileWriter(options);
+        } catch (std::system_error const &) {
+        }
+#endif
+        return std::make_unique<ThreadFileWriter>(options);
+    case IoBackend::Threads:
+        return std::make_unique<ThreadFileWriter>(options);
+    }
+    throw std::invalid_argument("Unknown I/O backend");
+}
+
+} // namespace core
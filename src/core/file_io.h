@@ -0,0 +1,61 @@
+#ifndef INCLUDE_FILE_IO_H
+#define INCLUDE_FILE_IO_H
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace core {
+
+enum class IoBackend {
+    // io_uring when the kernel supports it, otherwise Threads
+    Auto,
+    // Linux only, one ring shared by every caller
+    IoUring,
+    // Blocking writes on a pool of threads, works everywhere
+    Threads,
+};
+
+// "auto", "io_uring" or "threads", throws std::invalid_argument otherwise
+auto parseIoBackend(std::string_view) -> IoBackend;
+
+struct FileWriterOptions {
+    // fsync every file before reporting it as written
+    bool sync = false;
+    // Files being written at once, writes past this block until one finishes
+    std::size_t maxInFlight = 64;
+    // Thread backend only
+    std::size_t threads = 4;
+};
+
+// Writes whole files (e.g. downloaded pages) asynchronously.
+//
+// Writing tens of thousands of small files with blocking std::ofstream calls
+// means several syscalls per file, each one blocking whichever thread
+// happened to be downloading. Instead, hand the data over here and carry on.
+class FileWriter {
+  public:
+    // Called once the file is written (or failed to be), from one of the
+    // writer's threads, so keep it short
+    using Completion = std::function<void(std::error_code)>;
+
+    virtual ~FileWriter() = default;
+
+    // Creates or truncates `path` and writes `data` to it
+    virtual void write(std::filesystem::path path, std::string data, Completion) = 0;
+    // Block until every write so far has completed
+    virtual void flush() = 0;
+    [[nodiscard]] virtual auto name() const -> std::string_view = 0;
+};
+
+// Throws std::system_error if the requested backend isn't available (Auto
+// always succeeds)
+auto makeFileWriter(IoBackend, FileWriterOptions = {}) -> std::unique_ptr<FileWriter>;
+
+} // namespace core
+
+#endif // INCLUDE_FILE_IO_H
@@ -0,0 +1,520 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "file_io.h"
+#include "file_io_uring.h"
+
+// io_uring, driven directly through its syscalls rather then liburing, the
+// few parts we use are simple enough not to warrant another dependency.
+// https://kernel.dk/io_uring.pdf
+//
+// Each file is a chain of linked requests that the kernel runs in order:
+//   openat -> write -> fsync (optional) -> close
+// The file is opened straight into a slot of a registered ("direct") file
+// table, so the later requests can refer to it without ever seeing the fd.
+// The write goes straight from the caller's buffer, which is kept alive
+// until it completes.
+//
+// A single thread reaps the completions, and each time it wakes up submits
+// every chain queued since the last time in one io_uring_enter(). So while
+// writes are in flight, new files cost no syscalls of their own, only a
+// write to an idle ring is submitted straight away.
+//
+// Needs Linux 5.15 or later (for direct descriptors), the constructor checks
+// and throws otherwise, so makeFileWriter(IoBackend::Auto) can fall back.
+
+namespace core {
+
+namespace {
+
+auto setup(unsigned entries, io_uring_params &params) -> int {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+auto enter(int ring, unsigned toSubmit, unsigned minComplete, unsigned flags) -> int {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+auto registerResource(int ring, unsigned opcode, void const *arg, unsigned count) -> int {
+    return static_cast<int>(syscall(__NR_io_uring_register, ring, opcode, arg, count));
+}
+
+auto systemError(int error, char const *what) -> std::system_error {
+    return {error, std::generic_category(), what};
+}
+
+template <typename T>
+auto offset(void *base, std::uint32_t bytes) -> T * {
+    return reinterpret_cast<T *>(static_cast<char *>(base) + bytes);
+}
+
+enum Operation : std::uint64_t {
+    Open = 0,
+    Write = 1,
+    Sync = 2,
+    Close = 3,
+};
+
+constexpr std::uint64_t stopUserData = std::numeric_limits<std::uint64_t>::max();
+
+class IoUringFileWriter final : public FileWriter {
+  public:
+    explicit IoUringFileWriter(FileWriterOptions const &);
+    ~IoUringFileWriter() override;
+    IoUringFileWriter(IoUringFileWriter const &) = delete;
+    auto operator=(IoUringFileWriter const &) -> IoUringFileWriter & = delete;
+
+    void write(std::filesystem::path, std::string, Completion) override;
+    void flush() override;
+    [[nodiscard]] auto name() const -> std::string_view override {
+        return "io_uring";
+    }
+
+  private:
+    struct Slot {
+        std::string path;
+        std::string data;
+        Completion completion;
+        unsigned size = 0;
+        unsigned pending = 0;
+        int error = 0;
+    };
+
+    const FileWriterOptions options;
+    int ring = -1;
+
+    // Submission queue, only touched with submitMutex held
+    std::mutex submitMutex;
+    // Requests filled in, but not submitted yet
+    unsigned queued = 0;
+    // Submitted, but not reaped yet. While there are any the reaper is sure
+    // to wake up again, and submits what's queued when it does
+    unsigned outstanding = 0;
+    // Where the next request goes, the kernel only sees the requests once
+    // the tail is moved up to it
+    unsigned sqLocalTail = 0;
+    void *sqRing = nullptr;
+    std::size_t sqRingSize = 0;
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned *sqArray = nullptr;
+    io_uring_sqe *sqes = nullptr;
+    std::size_t sqesSize = 0;
+
+    // Completion queue, only touched by the reaper thread
+    void *cqRing = nullptr;
+    std::size_t cqRingSize = 0;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe *cqes = nullptr;
+
+    // One registered file (and one Slot) per file in flight
+    std::mutex slotMutex;
+    std::condition_variable slotFreed;
+    std::vector<Slot> slots;
+    std::vector<unsigned> freeSlots;
+
+    std::thread reaper;
+
+    void mapRings(io_uring_params const &);
+    void checkDirectOpen();
+    auto waitForCqe() -> io_uring_cqe;
+    auto nextSqe() -> io_uring_sqe *;
+    void queue();
+    auto submit(unsigned toSubmit) -> unsigned;
+    void reap();
+    void complete(io_uring_cqe const &);
+    void close();
+};
+
+IoUringFileWriter::IoUringFileWriter(FileWriterOptions const &writerOptions) : options(writerOptions) {
+    auto inFlight = static_cast<unsigned>(std::max<std::size_t>(options.maxInFlight, 1));
+
+    // Up to 4 requests per file
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CLAMP;
+    ring = setup(inFlight * 4, params);
+    if (ring < 0) {
+        throw systemError(errno, "io_uring_setup");
+    }
+
+    try {
+        mapRings(params);
+
+        // Empty (-1) slots, filled in by openat
+        std::vector<int> files(inFlight, -1);
+        if (registerResource(ring, IORING_REGISTER_FILES, files.data(), inFlight) < 0) {
+            throw systemError(errno, "io_uring_register(IORING_REGISTER_FILES)");
+        }
+
+        slots.resize(inFlight);
+        for (unsigned slot = inFlight; slot > 0; slot--) {
+            freeSlots.push_back(slot - 1);
+        }
+
+        // Reaps its own completions, so before the reaper is started
+        checkDirectOpen();
+        reaper = std::thread([this] { reap(); });
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+IoUringFileWriter::~IoUringFileWriter() {
+    flush();
+    close();
+}
+
+void IoUringFileWriter::mapRings(io_uring_params const &params) {
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    auto singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap) {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        sqRing = nullptr;
+        throw systemError(errno, "mmap(IORING_OFF_SQ_RING)");
+    }
+
+    if (singleMap) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            cqRing = nullptr;
+            throw systemError(errno, "mmap(IORING_OFF_CQ_RING)");
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    auto *sqeMemory = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+    if (sqeMemory == MAP_FAILED) {
+        throw systemError(errno, "mmap(IORING_OFF_SQES)");
+    }
+    sqes = static_cast<io_uring_sqe *>(sqeMemory);
+
+    sqHead = offset<unsigned>(sqRing, params.sq_off.head);
+    sqTail = offset<unsigned>(sqRing, params.sq_off.tail);
+    sqMask = *offset<unsigned>(sqRing, params.sq_off.ring_mask);
+    sqArray = offset<unsigned>(sqRing, params.sq_off.array);
+    sqLocalTail = *sqTail;
+
+    cqHead = offset<unsigned>(cqRing, params.cq_off.head);
+    cqTail = offset<unsigned>(cqRing, params.cq_off.tail);
+    cqMask = *offset<unsigned>(cqRing, params.cq_off.ring_mask);
+    cqes = offset<io_uring_cqe>(cqRing, params.cq_off.cqes);
+}
+
+// Opening into a direct descriptor is the newest feature we rely on, try it
+// once up front rather then failing every write later
+void IoUringFileWriter::checkDirectOpen() {
+    auto probe = (std::filesystem::temp_directory_path() / ("manga-manager-io_uring-" + std::to_string(getpid()))).string();
+
+    {
+        std::lock_guard lock(submitMutex);
+        auto *open = nextSqe();
+        open->opcode = IORING_OP_OPENAT;
+        open->fd = AT_FDCWD;
+        open->addr = reinterpret_cast<std::uint64_t>(probe.c_str());
+        open->len = 0600;
+        open->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+        open->file_index = 1;
+        queue();
+        while (queued != 0) {
+            submit(queued);
+        }
+    }
+    auto opened = waitForCqe().res;
+
+    if (opened > 0) {
+        // Kernels before 5.15 don't know about file_index, and open a normal
+        // descriptor instead
+        ::close(opened);
+    } else if (opened == 0) {
+        std::lock_guard lock(submitMutex);
+        auto *close = nextSqe();
+        close->opcode = IORING_OP_CLOSE;
+        close->file_index = 1;
+        queue();
+        while (queued != 0) {
+            submit(queued);
+        }
+    }
+    if (opened == 0) {
+        waitForCqe();
+    }
+
+    std::error_code ignored;
+    std::filesystem::remove(probe, ignored);
+    if (opened != 0) {
+        throw systemError(opened > 0 ? EOPNOTSUPP : -opened, "io_uring openat into a registered file");
+    }
+}
+
+// Only for before the reaper is started
+auto IoUringFileWriter::waitForCqe() -> io_uring_cqe {
+    while (*cqHead == std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire)) {
+        if (enter(ring, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            throw systemError(errno, "io_uring_enter");
+        }
+    }
+    auto cqe = cqes[*cqHead & cqMask];
+    std::atomic_ref<unsigned>(*cqHead).store(*cqHead + 1, std::memory_order_release);
+
+    std::lock_guard lock(submitMutex);
+    outstanding--;
+    return cqe;
+}
+
+// Must be called with submitMutex held. Filled in by the caller, then
+// handed to the kernel with queue()
+auto IoUringFileWriter::nextSqe() -> io_uring_sqe * {
+    auto index = sqLocalTail & sqMask;
+    auto *sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    sqLocalTail++;
+    return sqe;
+}
+
+// Must be called with submitMutex held. Makes every request since the last
+// call visible to the kernel at once, so it never sees half of a chain
+void IoUringFileWriter::queue() {
+    auto tail = *sqTail;
+    queued += sqLocalTail - tail;
+    std::atomic_ref<unsigned>(*sqTail).store(sqLocalTail, std::memory_order_release);
+}
+
+// Must be called with submitMutex held. Returns how many of the first
+// `toSubmit` queued requests were submitted, busy or interrupted isn't an
+// error, the rest just stay queued
+auto IoUringFileWriter::submit(unsigned toSubmit) -> unsigned {
+    auto result = enter(ring, toSubmit, 0, 0);
+    if (result < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+            return 0;
+        }
+        throw systemError(errno, "io_uring_enter");
+    }
+    auto submitted = static_cast<unsigned>(result);
+    queued -= submitted;
+    outstanding += submitted;
+    return submitted;
+}
+
+void IoUringFileWriter::write(std::filesystem::path path, std::string data, Completion completion) {
+    if (data.size() > std::numeric_limits<unsigned>::max()) {
+        if (completion) {
+            completion(std::make_error_code(std::errc::file_too_large));
+        }
+        return;
+    }
+
+    unsigned index = 0;
+    {
+        std::unique_lock lock(slotMutex);
+        slotFreed.wait(lock, [this] { return !freeSlots.empty(); });
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    // Nothing else touches the slot until its requests complete. The data is
+    // written from where it is, so kept alive until then
+    auto &slot = slots[index];
+    slot.path = path.string();
+    slot.data = std::move(data);
+    slot.completion = std::move(completion);
+    slot.size = static_cast<unsigned>(slot.data.size());
+    slot.error = 0;
+    slot.pending = options.sync ? 4 : 3;
+
+    auto userData = [index](Operation operation) {
+        return (static_cast<std::uint64_t>(index) << 8U) | operation;
+    };
+
+    std::lock_guard lock(submitMutex);
+
+    // Hard links, so the rest of the chain still runs (and most importantly
+    // the close) when a request before it fails
+    auto *open = nextSqe();
+    open->opcode = IORING_OP_OPENAT;
+    open->flags = IOSQE_IO_HARDLINK;
+    open->fd = AT_FDCWD;
+    open->addr = reinterpret_cast<std::uint64_t>(slot.path.c_str());
+    open->len = 0644;
+    // No O_CLOEXEC, the kernel refuses it for direct descriptors (which
+    // are never inherited anyway)
+    open->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+    open->file_index = index + 1;
+    open->user_data = userData(Open);
+
+    auto *write = nextSqe();
+    write->opcode = IORING_OP_WRITE;
+    write->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    write->fd = static_cast<std::int32_t>(index);
+    write->addr = reinterpret_cast<std::uint64_t>(slot.data.data());
+    write->len = slot.size;
+    write->off = 0;
+    write->user_data = userData(Write);
+
+    if (options.sync) {
+        auto *sync = nextSqe();
+        sync->opcode = IORING_OP_FSYNC;
+        sync->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+        sync->fd = static_cast<std::int32_t>(index);
+        sync->user_data = userData(Sync);
+    }
+
+    auto *close = nextSqe();
+    close->opcode = IORING_OP_CLOSE;
+    close->file_index = index + 1;
+    close->user_data = userData(Close);
+
+    queue();
+    // Otherwise the reaper picks it up the next time it wakes up
+    while (queued != 0 && outstanding == 0) {
+        submit(queued);
+    }
+}
+
+void IoUringFileWriter::flush() {
+    std::unique_lock lock(slotMutex);
+    slotFreed.wait(lock, [this] { return freeSlots.size() == slots.size(); });
+}
+
+void IoUringFileWriter::reap() {
+    while (true) {
+        auto head = *cqHead;
+        auto tail = std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire);
+
+        if (head == tail) {
+            // Everything queued since we last got here goes in together.
+            // Submitting is done with the lock held, the kernel takes
+            // requests from the front of the queue whoever asks, so two
+            // threads submitting at once would lose track of what's queued
+            {
+                std::lock_guard lock(submitMutex);
+                try {
+                    while (queued != 0) {
+                        submit(queued);
+                    }
+                } catch (std::system_error const &) {
+                    return;
+                }
+            }
+
+            // Anything queued from here on is either submitted by whoever
+            // queued it, or there's something outstanding to wake us up
+            if (enter(ring, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return;
+            }
+            continue;
+        }
+
+        auto reaped = tail - head;
+        for (; head != tail; head++) {
+            auto cqe = cqes[head & cqMask];
+            if (cqe.user_data == stopUserData) {
+                std::atomic_ref<unsigned>(*cqHead).store(head + 1, std::memory_order_release);
+                return;
+            }
+            complete(cqe);
+        }
+        std::atomic_ref<unsigned>(*cqHead).store(head, std::memory_order_release);
+
+        std::lock_guard lock(submitMutex);
+        outstanding -= reaped;
+    }
+}
+
+void IoUringFileWriter::complete(io_uring_cqe const &cqe) {
+    auto index = static_cast<unsigned>(cqe.user_data >> 8U);
+    auto operation = static_cast<Operation>(cqe.user_data & 0xFFU);
+    auto &slot = slots[index];
+
+    // Keep the first error, anything after it is usually just fallout (e.g.
+    // a write to a file that failed to open)
+    if (slot.error == 0) {
+        if (cqe.res < 0) {
+            slot.error = -cqe.res;
+        } else if (operation == Write && static_cast<unsigned>(cqe.res) != slot.size) {
+            slot.error = EIO;
+        }
+    }
+
+    if (--slot.pending != 0) {
+        return;
+    }
+
+    // Before the slot is given back, so flush() waits for completions too
+    if (slot.completion) {
+        slot.completion(slot.error == 0 ? std::error_code() : std::error_code(slot.error, std::generic_category()));
+    }
+    slot.completion = nullptr;
+    slot.data.clear();
+    slot.data.shrink_to_fit();
+
+    {
+        std::lock_guard lock(slotMutex);
+        freeSlots.push_back(index);
+    }
+    slotFreed.notify_all();
+}
+
+void IoUringFileWriter::close() {
+    if (reaper.joinable()) {
+        {
+            std::lock_guard lock(submitMutex);
+            auto *stop = nextSqe();
+            stop->opcode = IORING_OP_NOP;
+            stop->user_data = stopUserData;
+            queue();
+            while (queued != 0 && outstanding == 0) {
+                submit(queued);
+            }
+        }
+        reaper.join();
+    }
+
+    if (sqes != nullptr) {
+        munmap(sqes, sqesSize);
+    }
+    if (cqRing != nullptr && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    if (sqRing != nullptr) {
+        munmap(sqRing, sqRingSize);
+    }
+    if (ring >= 0) {
+        ::close(ring);
+    }
+}
+
+} // namespace
+
+auto makeIoUringFileWriter(FileWriterOptions const &options) -> std::unique_ptr<FileWriter> {
+    return std::make_unique<IoUringFileWriter>(options);
+}
+
+} // namespace core
@@ -0,0 +1,16 @@
+#ifndef INCLUDE_FILE_IO_URING_H
+#define INCLUDE_FILE_IO_URING_H
+
+#include <memory>
+
+#include "file_io.h"
+
+namespace core {
+
+// Linux only, see file_io_uring.cpp. Throws std::system_error when the
+// kernel doesn't support everything we need
+auto makeIoUringFileWriter(FileWriterOptions const &) -> std::unique_ptr<FileWriter>;
+
+} // namespace core
+
+#endif // INCLUDE_FILE_IO_URING_H
@@ -1,8 +1,250 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+
+#include <curl/curl.h>
 #include <fmt/core.h>
-#include <nlohmann/json.hpp>
 
 #include "http.h"
 
 namespace http {
 
+namespace {
+
+// Give up on a connection that hasn't sent anything for this long, instead
+// of waiting forever on a stalled server
+constexpr long connectTimeoutSeconds = 10;
+constexpr long lowSpeedLimitBytes = 1;
+constexpr long lowSpeedTimeSeconds = 30;
+
+// Everything the callbacks need for a single transfer
+struct Transfer {
+    Response response;
+    core::MemoryBudget *budget = nullptr;
+};
+
+auto writeCallback(char *data, std::size_t size, std::size_t count, void *userData) -> std::size_t {
+    auto *transfer = static_cast<Transfer *>(userData);
+    auto &response = transfer->response;
+
+    // No (or a wrong) Content-Length, account for it as it arrives instead.
+    // Can't block here as we already hold part of the budget
+    auto needed = response.body.size() + size * count;
+    if (transfer->budget != nullptr && needed > response.reservation.size()) {
+        response.reservation.overcommit(needed - response.reservation.size());
+    }
+
+    response.body.append(data, size * count);
+    return size * count;
+}
+
+auto headerCallback(char *data, std::size_t size, std::size_t count, void *userData) -> std::size_t {
+    auto *transfer = static_cast<Transfer *>(userData);
+    auto *response = &transfer->response;
+    auto line = std::string_view(data, size * count);
+
+    // A new status line means we got redirected (or a 100 Continue), only
+    // keep the headers from the final response
+    if (line.starts_with("HTTP/")) {
+        response->headers.clear();
+        return size * count;
+    }
+
+    auto colon = line.find(':');
+    if (colon == std::string_view::npos) {
+        return size * count;
+    }
+
+    std::string name(line.substr(0, colon));
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    auto value = line.substr(colon + 1);
+    auto begin = value.find_first_not_of(" \t");
+    auto end = value.find_last_not_of(" \t\r\n");
+    response->headers[name] = (begin == std::string_view::npos) ? std::string() : std::string(value.substr(begin, end - begin + 1));
+
+    // Nothing of the body has arrived yet, so this is the one place we can
+    // safely block until there is room in the budget for it
+    if (name == "content-length" && transfer->budget != nullptr && response->body.empty()) {
+        std::size_t length = 0;
+        auto const &header = response->headers[name];
+        std::from_chars(header.data(), header.data() + header.size(), length);
+
+        response->reservation.release();
+        response->reservation = transfer->budget->reserve(length);
+        response->body.reserve(length);
+    }
+
+    return size * count;
+}
+
+} // namespace
+
+auto encode(std::string_view input) -> std::string {
+    std::string output;
+    output.reserve(input.size());
+
+    for (auto c : input) {
+        auto uc = static_cast<unsigned char>(c);
+        if (std::isalnum(uc) || c == '-' || c == '.' || c == '_' || c == '~') {
+            output += c;
+        } else {
+            output += fmt::format("%{:02X}", uc);
+        }
+    }
+
+    return output;
+}
+
+auto buildUrl(std::string_view base, std::string_view path, Query const &query) -> std::string {
+    std::string url;
+    url.reserve(base.size() + path.size() + query.size() * 32);
+
+    url += base;
+    if (url.ends_with('/') && path.starts_with('/')) {
+        url.pop_back();
+    } else if (!url.ends_with('/') && !path.empty() && !path.starts_with('/')) {
+        url += '/';
+    }
+    url += path;
+
+    char separator = '?';
+    for (auto const &[key, value] : query) {
+        url += separator;
+        url += encode(key);
+        url += '=';
+        url += encode(value);
+        separator = '&';
+    }
+
+    return url;
+}
+
+auto Response::header(std::string_view name) const -> std::optional<std::string_view> {
+    auto it = headers.find(name);
+    if (it == headers.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+// libcurl's share interface. Lets all of our easy handles share one DNS
+// cache, TLS session cache and cookie jar. libcurl calls back into
+// lock/unlock whenever it touches the shared data, so we need one mutex per
+// type of shared data. Not the connection cache, libcurl doesn't support
+// sharing that between handles running on different threads at once.
+struct Session::Share {
+    CURLSH *handle = nullptr;
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> mutexes;
+
+    Share() : handle(curl_share_init()) {
+        if (handle == nullptr) {
+            throw Error("Unable to create a curl share handle");
+        }
+
+        curl_share_setopt(handle, CURLSHOPT_LOCKFUNC, &Share::lock);
+        curl_share_setopt(handle, CURLSHOPT_UNLOCKFUNC, &Share::unlock);
+        curl_share_setopt(handle, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
+    }
+
+    ~Share() {
+        curl_share_cleanup(handle);
+    }
+
+    Share(Share const &) = delete;
+    auto operator=(Share const &) -> Share & = delete;
+
+    static void lock(CURL * /*handle*/, curl_lock_data data, curl_lock_access /*access*/, void *userData) {
+        static_cast<Share *>(userData)->mutexes.at(static_cast<std::size_t>(data)).lock();
+    }
+
+    static void unlock(CURL * /*handle*/, curl_lock_data data, void *userData) {
+        static_cast<Share *>(userData)->mutexes.at(static_cast<std::size_t>(data)).unlock();
+    }
+};
+
+Session::Session(std::string sessionUserAgent) : userAgent(std::move(sessionUserAgent)) {
+    // curl_global_init isn't thread safe, and must be called before
+    // anything else in libcurl. We never call curl_global_cleanup, as the
+    // process is exiting by then anyway
+    static std::once_flag curlInitialised;
+    std::call_once(curlInitialised, [] {
+        if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+            throw Error("Unable to initialise libcurl");
+        }
+    });
+
+    share = std::make_unique<Share>();
+}
+
+Session::~Session() {
+    // Easy handles need to go before the share handle they are attached to
+    for (auto *handle : idleHandles) {
+        curl_easy_cleanup(handle);
+    }
+}
+
+auto Session::acquireHandle() -> void * {
+    {
+        std::lock_guard lock(handleMutex);
+        if (!idleHandles.empty()) {
+            auto *handle = idleHandles.back();
+            idleHandles.pop_back();
+            return handle;
+        }
+    }
+
+    CURL *handle = curl_easy_init();
+    if (handle == nullptr) {
+        throw Error("Unable to create a curl handle");
+    }
+
+    curl_easy_setopt(handle, CURLOPT_SHARE, share->handle);
+    curl_easy_setopt(handle, CURLOPT_USERAGENT, userAgent.c_str());
+    // We are used from multiple threads, so signals are off limits
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+    // Empty string means any encoding curl was built with (gzip, br, etc)
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, connectTimeoutSeconds);
+    curl_easy_setopt(handle, CURLOPT_LOW_SPEED_LIMIT, lowSpeedLimitBytes);
+    curl_easy_setopt(handle, CURLOPT_LOW_SPEED_TIME, lowSpeedTimeSeconds);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &writeCallback);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, &headerCallback);
+
+    return handle;
+}
+
+void Session::releaseHandle(void *handle) {
+    std::lock_guard lock(handleMutex);
+    idleHandles.push_back(handle);
+}
+
+auto Session::get(std::string const &url, core::MemoryBudget *budget) -> Response {
+    auto *handle = acquireHandle();
+    Transfer transfer{.response = {}, .budget = budget};
+
+    curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &transfer);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, &transfer);
+
+    auto result = curl_easy_perform(handle);
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &transfer.response.status);
+
+    // The handle is still perfectly usable after a failed transfer
+    releaseHandle(handle);
+
+    if (result != CURLE_OK) {
+        throw Error(fmt::format("GET {} failed: {}", url, curl_easy_strerror(result)));
+    }
+
+    return std::move(transfer.response);
+}
+
 } // namespace http
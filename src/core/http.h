@@ -1,8 +1,81 @@
 #ifndef INCLUDE_HTTP_H
 #define INCLUDE_HTTP_H
 
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "memory_budget.h"
+
 namespace http {
 
+// Kept as a list (and in order) instead of a map, as APIs like MangaDex
+// expect repeated keys for arrays, e.g. "translatedLanguage[]=en&translatedLanguage[]=fr"
+using Query = std::vector<std::pair<std::string, std::string>>;
+
+// Percent-encode everything but the RFC 3986 unreserved characters
+auto encode(std::string_view) -> std::string;
+// e.g. buildUrl("https://api.mangadex.org", "/manga/{id}/feed", {{"limit", "500"}})
+auto buildUrl(std::string_view base, std::string_view path, Query const &query = {}) -> std::string;
+
+struct Response {
+    long status = 0;
+    std::string body;
+    // Header names are lower cased, as they are case insensitive
+    std::map<std::string, std::string, std::less<>> headers;
+    // Bytes held against the memory budget (if any) for the body, given
+    // back when the response is destroyed
+    core::MemoryBudget::Reservation reservation;
+
+    [[nodiscard]] auto header(std::string_view) const -> std::optional<std::string_view>;
+};
+
+// Thrown when a request couldn't be completed at all, e.g. DNS failures,
+// connection resets or timeouts. HTTP error statuses are NOT thrown, they
+// are returned as a normal response
+class Error : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+// Thread safe HTTP(S) client backed by libcurl.
+//
+// Keeps a pool of handles which share a DNS cache, TLS sessions and cookies.
+// Each handle keeps its own connections open (keep-alive) between requests,
+// and handles are reused by whichever thread asks next, so most requests
+// skip the TCP handshake, and the rest at least resume a TLS session instead
+// of doing a full handshake.
+class Session {
+  public:
+    explicit Session(std::string userAgent = "manga-manager");
+    ~Session();
+    Session(Session const &) = delete;
+    auto operator=(Session const &) -> Session & = delete;
+
+    // When given a budget, the body is reserved against it before it is
+    // downloaded (using Content-Length), blocking while the budget is full
+    auto get(std::string const &url, core::MemoryBudget *budget = nullptr) -> Response;
+
+  private:
+    struct Share;
+
+    const std::string userAgent;
+    std::unique_ptr<Share> share;
+    // Idle CURL easy handles, ready to be reused
+    std::mutex handleMutex;
+    std::vector<void *> idleHandles;
+
+    auto acquireHandle() -> void *;
+    void releaseHandle(void *);
+};
+
 } // namespace http
 
 #endif // INCLUDE_HTTP_H
@@ -0,0 +1,67 @@
+#include "json_arena.h"
+
+namespace core {
+
+namespace {
+thread_local std::pmr::memory_resource *currentResource = nullptr;
+} // namespace
+
+auto currentJsonResource() -> std::pmr::memory_resource * {
+    return currentResource != nullptr ? currentResource : std::pmr::new_delete_resource();
+}
+
+auto JsonArena::Upstream::do_allocate(std::size_t bytes, std::size_t alignment) -> void * {
+    allocated += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void JsonArena::Upstream::do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+}
+
+auto JsonArena::Upstream::do_is_equal(std::pmr::memory_resource const &other) const noexcept -> bool {
+    return this == &other;
+}
+
+JsonArena::JsonArena(std::size_t initialSize) : buffer(initialSize) {
+    monotonic.emplace(buffer.data(), buffer.size(), &upstream);
+}
+
+auto JsonArena::resource() -> std::pmr::memory_resource * {
+    return &*monotonic;
+}
+
+void JsonArena::reset() {
+    monotonic->release();
+
+    // Didn't fit last time, make room for the whole thing next time so we
+    // aren't going back to the heap for every big response
+    if (upstream.allocated != 0) {
+        auto size = buffer.size() + upstream.allocated;
+        upstream.allocated = 0;
+        monotonic.reset();
+        buffer = std::vector<std::byte>(size);
+        monotonic.emplace(buffer.data(), buffer.size(), &upstream);
+    }
+}
+
+auto JsonArena::capacity() const -> std::size_t {
+    return buffer.size();
+}
+
+auto JsonArena::forThread() -> JsonArena & {
+    thread_local JsonArena arena;
+    return arena;
+}
+
+JsonArenaScope::JsonArenaScope(JsonArena &jsonArena) : arena(jsonArena),
+                                                       previous(currentResource) {
+    currentResource = arena.resource();
+}
+
+JsonArenaScope::~JsonArenaScope() {
+    currentResource = previous;
+    arena.reset();
+}
+
+} // namespace core
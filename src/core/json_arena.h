@@ -0,0 +1,125 @@
+#ifndef INCLUDE_JSON_ARENA_H
+#define INCLUDE_JSON_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace core {
+
+// Parsing an API response with nlohmann::json makes thousands of small heap
+// allocations (every string, object and array), which all get thrown away
+// together a moment later once we've pulled out the few fields we want.
+//
+// JsonArena is a bump allocator for exactly that: everything is carved out
+// of one buffer and freed in one go by reset(). The buffer is kept around
+// between responses, and grows to fit the biggest response seen so far, so
+// once warmed up parsing a response doesn't touch the heap at all.
+class JsonArena {
+  public:
+    explicit JsonArena(std::size_t initialSize = 64 * 1024);
+    JsonArena(JsonArena const &) = delete;
+    auto operator=(JsonArena const &) -> JsonArena & = delete;
+
+    [[nodiscard]] auto resource() -> std::pmr::memory_resource *;
+    // Frees everything allocated from the arena. Anything still using it
+    // is left dangling, so only call this once all of it is gone.
+    void reset();
+    [[nodiscard]] auto capacity() const -> std::size_t;
+
+    // One arena per thread, for the common case of parsing a response on
+    // whichever thread downloaded it
+    static auto forThread() -> JsonArena &;
+
+  private:
+    // Sits between the bump allocator and the heap, so we know how much the
+    // buffer overflowed by
+    class Upstream : public std::pmr::memory_resource {
+      public:
+        std::size_t allocated = 0;
+
+      private:
+        auto do_allocate(std::size_t, std::size_t) -> void * override;
+        void do_deallocate(void *, std::size_t, std::size_t) override;
+        [[nodiscard]] auto do_is_equal(std::pmr::memory_resource const &) const noexcept -> bool override;
+    };
+
+    std::vector<std::byte> buffer;
+    Upstream upstream;
+    std::optional<std::pmr::monotonic_buffer_resource> monotonic;
+};
+
+// Makes an arena the one ArenaJson values on this thread allocate from,
+// until the scope ends. The arena is reset on the way out, so every
+// ArenaJson made inside the scope has to be gone by then, e.g.
+//
+//     JsonArenaScope scope(JsonArena::forThread());
+//     auto json = ArenaJson::parse(body); // Destroyed before scope
+//
+// Scopes over different arenas nest, the previous arena (if any) comes back
+// when one ends.
+class JsonArenaScope {
+  public:
+    explicit JsonArenaScope(JsonArena &);
+    ~JsonArenaScope();
+    JsonArenaScope(JsonArenaScope const &) = delete;
+    auto operator=(JsonArenaScope const &) -> JsonArenaScope & = delete;
+
+  private:
+    JsonArena &arena;
+    std::pmr::memory_resource *previous;
+};
+
+// The memory resource ArenaAllocator is currently using on this thread,
+// the normal heap when there's no JsonArenaScope
+auto currentJsonResource() -> std::pmr::memory_resource *;
+
+// nlohmann::basic_json default constructs its allocators, so it can't carry
+// a std::pmr::polymorphic_allocator around with it. Instead this stateless
+// allocator forwards to whichever resource is current on this thread.
+template <typename T>
+class ArenaAllocator {
+  public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    template <typename U>
+    ArenaAllocator(ArenaAllocator<U> const & /*other*/) noexcept {} // NOLINT(google-explicit-constructor)
+
+    [[nodiscard]] auto allocate(std::size_t count) -> T * {
+        return static_cast<T *>(currentJsonResource()->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *pointer, std::size_t count) noexcept {
+        currentJsonResource()->deallocate(pointer, count * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    auto operator==(ArenaAllocator<U> const & /*other*/) const noexcept -> bool {
+        return true;
+    }
+};
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+// Drop in for nlohmann::json whose strings, objects and arrays all live in
+// the current JsonArena. Only use it inside a JsonArenaScope, and copy out
+// anything that needs to outlive it (see toString).
+using ArenaJson = nlohmann::basic_json<std::map, std::vector, ArenaString, bool, std::int64_t, std::uint64_t, double, ArenaAllocator>;
+
+// Copy a string out of the arena, into memory that outlives it
+inline auto toString(ArenaJson const &json) -> std::string {
+    auto const &value = json.get_ref<ArenaString const &>();
+    return {value.data(), value.size()};
+}
+
+} // namespace core
+
+#endif // INCLUDE_JSON_ARENA_H
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <utility>
+
+#include "memory_budget.h"
+
+namespace core {
+
+MemoryBudget::Reservation::Reservation(MemoryBudget *owner, std::size_t size) : budget(owner),
+                                                                                bytes(size) {}
+
+MemoryBudget::Reservation::~Reservation() {
+    release();
+}
+
+MemoryBudget::Reservation::Reservation(Reservation &&other) noexcept : budget(std::exchange(other.budget, nullptr)),
+                                                                       bytes(std::exchange(other.bytes, 0)) {}
+
+auto MemoryBudget::Reservation::operator=(Reservation &&other) noexcept -> Reservation & {
+    if (this != &other) {
+        release();
+        budget = std::exchange(other.budget, nullptr);
+        bytes = std::exchange(other.bytes, 0);
+    }
+    return *this;
+}
+
+auto MemoryBudget::Reservation::size() const -> std::size_t {
+    return bytes;
+}
+
+void MemoryBudget::Reservation::overcommit(std::size_t extra) {
+    if (budget == nullptr) {
+        return;
+    }
+
+    budget->add(extra);
+    bytes += extra;
+}
+
+void MemoryBudget::Reservation::release() {
+    if (budget != nullptr) {
+        budget->release(bytes);
+    }
+    budget = nullptr;
+    bytes = 0;
+}
+
+MemoryBudget::MemoryBudget(std::size_t limit) : limitBytes(limit) {}
+
+auto MemoryBudget::fits(std::size_t bytes) const -> bool {
+    // Nothing else in flight means it has to be let through, no matter how
+    // big, otherwise it would wait forever
+    return inUse == 0 || inUse + bytes <= limitBytes;
+}
+
+auto MemoryBudget::reserve(std::size_t bytes) -> Reservation {
+    {
+        std::unique_lock lock(mutex);
+        auto ticket = nextTicket++;
+        available.wait(lock, [&] { return ticket == nowServing && fits(bytes); });
+
+        nowServing++;
+        inUse += bytes;
+        highWater = std::max(highWater, inUse);
+    }
+
+    // Whoever is next in line might fit as well
+    available.notify_all();
+    return {this, bytes};
+}
+
+auto MemoryBudget::tryReserve(std::size_t bytes) -> std::optional<Reservation> {
+    std::lock_guard lock(mutex);
+    if (nextTicket != nowServing || !fits(bytes)) {
+        return std::nullopt;
+    }
+
+    inUse += bytes;
+    highWater = std::max(highWater, inUse);
+    return Reservation(this, bytes);
+}
+
+void MemoryBudget::add(std::size_t bytes) {
+    std::lock_guard lock(mutex);
+    inUse += bytes;
+    highWater = std::max(highWater, inUse);
+}
+
+void MemoryBudget::release(std::size_t bytes) {
+    {
+        std::lock_guard lock(mutex);
+        inUse -= bytes;
+    }
+    available.notify_all();
+}
+
+auto MemoryBudget::limit() const -> std::size_t {
+    return limitBytes;
+}
+
+auto MemoryBudget::used() const -> std::size_t {
+    std::lock_guard lock(mutex);
+    return inUse;
+}
+
+auto MemoryBudget::peak() const -> std::size_t {
+    std::lock_guard lock(mutex);
+    return highWater;
+}
+
+} // namespace core
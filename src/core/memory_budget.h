@@ -0,0 +1,83 @@
+#ifndef INCLUDE_MEMORY_BUDGET_H
+#define INCLUDE_MEMORY_BUDGET_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+namespace core {
+
+// Caps how many bytes of "in flight" data (response bodies, decoded pages,
+// upload staging buffers, etc) can exist at once, no matter how many
+// downloads or decodes are running in parallel.
+//
+// Producers reserve bytes before allocating and block while the budget is
+// used up. Reservations are handed out first come first served, so one big
+// page can't be starved by a steady stream of small ones. A single
+// reservation bigger then the whole budget is allowed through once it's
+// the only one, rather then blocking forever.
+class MemoryBudget {
+  public:
+    // Move only RAII handle, gives its bytes back to the budget on
+    // destruction. A default constructed reservation isn't tied to any
+    // budget and does nothing.
+    class Reservation {
+      public:
+        Reservation() = default;
+        ~Reservation();
+        Reservation(Reservation &&) noexcept;
+        auto operator=(Reservation &&) noexcept -> Reservation &;
+        Reservation(Reservation const &) = delete;
+        auto operator=(Reservation const &) -> Reservation & = delete;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+        // Account for more bytes without blocking, going over the limit if
+        // need be. For when data turns out bigger then first thought (e.g.
+        // a response without a Content-Length), and blocking while already
+        // holding a reservation could deadlock.
+        void overcommit(std::size_t);
+        void release();
+
+      private:
+        friend class MemoryBudget;
+        Reservation(MemoryBudget *, std::size_t);
+
+        MemoryBudget *budget = nullptr;
+        std::size_t bytes = 0;
+    };
+
+    explicit MemoryBudget(std::size_t limitBytes);
+    MemoryBudget(MemoryBudget const &) = delete;
+    auto operator=(MemoryBudget const &) -> MemoryBudget & = delete;
+
+    // Blocks until the bytes fit in the budget
+    auto reserve(std::size_t) -> Reservation;
+    // Never blocks, fails if the bytes don't fit right now or someone is
+    // already waiting
+    auto tryReserve(std::size_t) -> std::optional<Reservation>;
+
+    [[nodiscard]] auto limit() const -> std::size_t;
+    [[nodiscard]] auto used() const -> std::size_t;
+    // High water mark of used(), handy for checking the budget is sized right
+    [[nodiscard]] auto peak() const -> std::size_t;
+
+  private:
+    const std::size_t limitBytes;
+    mutable std::mutex mutex;
+    std::condition_variable available;
+    std::size_t inUse = 0;
+    std::size_t highWater = 0;
+    // Ticket lock style queue, so waiters are served in order
+    std::uint64_t nextTicket = 0;
+    std::uint64_t nowServing = 0;
+
+    [[nodiscard]] auto fits(std::size_t) const -> bool;
+    void add(std::size_t);
+    void release(std::size_t);
+};
+
+} // namespace core
+
+#endif // INCLUDE_MEMORY_BUDGET_H
@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <thread>
+
+#include "rate_limiter.h"
+
+namespace core {
+
+RateLimiter::RateLimiter(double tokensPerSecond, double burst) : rate(tokensPerSecond),
+                                                                 capacity(burst),
+                                                                 tokens(burst),
+                                                                 last(std::chrono::steady_clock::now()) {}
+
+void RateLimiter::acquire() {
+    std::chrono::steady_clock::time_point readyAt;
+    {
+        std::lock_guard lock(mutex);
+        auto now = std::chrono::steady_clock::now();
+
+        tokens = std::min(capacity, tokens + std::chrono::duration<double>(now - last).count() * rate);
+        last = now;
+
+        // Take the token now, even if that puts us into debt. Every caller
+        // then sleeps for their share of the debt, which hands out tokens in
+        // the order they were asked for instead of whoever wakes up first
+        tokens -= 1.0;
+
+        readyAt = std::max(pausedUntil, now);
+        if (tokens < 0.0) {
+            readyAt += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(-tokens / rate));
+        }
+    }
+
+    std::this_thread::sleep_until(readyAt);
+}
+
+void RateLimiter::pauseUntil(std::chrono::steady_clock::time_point until) {
+    std::lock_guard lock(mutex);
+    pausedUntil = std::max(pausedUntil, until);
+}
+
+} // namespace core
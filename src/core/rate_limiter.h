@@ -0,0 +1,34 @@
+#ifndef INCLUDE_RATE_LIMITER_H
+#define INCLUDE_RATE_LIMITER_H
+
+#include <chrono>
+#include <mutex>
+
+namespace core {
+
+// Token bucket rate limiter.
+// acquire() blocks the caller until they are allowed to go ahead, so it can
+// be shared between any number of threads making requests to the same API
+class RateLimiter {
+  public:
+    // e.g. RateLimiter(5.0, 5.0) allows 5 requests a second, with up to 5
+    // requests allowed to go through back to back after being idle
+    RateLimiter(double tokensPerSecond, double burst);
+
+    void acquire();
+    // Stop handing out tokens until the given point in time. For when the
+    // server tells us we have been rate limited anyway (e.g. a 429 response)
+    void pauseUntil(std::chrono::steady_clock::time_point);
+
+  private:
+    std::mutex mutex;
+    const double rate;
+    const double capacity;
+    double tokens;
+    std::chrono::steady_clock::time_point last;
+    std::chrono::steady_clock::time_point pausedUntil;
+};
+
+} // namespace core
+
+#endif // INCLUDE_RATE_LIMITER_H
@@ -0,0 +1,149 @@
+#include <algorithm>
+
+#include "scheduler.h"
+
+namespace core {
+
+Scheduler::Scheduler(std::size_t workerCount) {
+    workerCount = std::max<std::size_t>(workerCount, 1);
+    workers.reserve(workerCount);
+
+    for (std::size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([this](std::stop_token const &stopToken) { work(stopToken); });
+    }
+}
+
+Scheduler::~Scheduler() {
+    // Destroyed outside the lock, whatever the tasks captured might want to
+    // submit or wait on its way out
+    std::array<Level, priorityCount> dropped;
+    {
+        std::lock_guard lock(mutex);
+        for (auto &worker : workers) {
+            worker.request_stop();
+        }
+        for (std::size_t priority = 0; priority < levels.size(); priority++) {
+            dropped.at(priority).queues.swap(levels.at(priority).queues);
+            levels.at(priority).turns.clear();
+        }
+        queued = 0;
+    }
+    // std::jthread joins on destruction
+    workers.clear();
+}
+
+void Scheduler::submit(std::string const &group, Priority priority, Task task) {
+    {
+        std::lock_guard lock(mutex);
+        auto &level = levels.at(static_cast<std::size_t>(priority));
+        auto &queue = level.queues[group];
+
+        if (queue.empty()) {
+            level.turns.push_back(group);
+        }
+
+        queue.push_back(std::move(task));
+        queued++;
+    }
+
+    workAvailable.notify_one();
+}
+
+void Scheduler::setConcurrency(Priority priority, std::size_t limit) {
+    {
+        std::lock_guard lock(mutex);
+        levels.at(static_cast<std::size_t>(priority)).concurrency = std::max<std::size_t>(limit, 1);
+    }
+
+    // Raising a limit might mean there is work to pick up now
+    workAvailable.notify_all();
+}
+
+void Scheduler::wait() {
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [this] { return queued == 0 && running == 0; });
+}
+
+auto Scheduler::failures() const -> std::size_t {
+    std::lock_guard lock(mutex);
+    return failed;
+}
+
+// Must be called with the mutex held
+auto Scheduler::runnable() const -> bool {
+    return std::any_of(levels.begin(), levels.end(), [](Level const &level) {
+        return !level.turns.empty() && level.running < level.concurrency;
+    });
+}
+
+// Must be called with the mutex held, and only when runnable()
+auto Scheduler::next() -> std::pair<Task, std::size_t> {
+    for (std::size_t priority = 0; priority < levels.size(); priority++) {
+        auto &level = levels.at(priority);
+        if (level.turns.empty() || level.running >= level.concurrency) {
+            continue;
+        }
+
+        auto group = std::move(level.turns.front());
+        level.turns.pop_front();
+
+        auto queue = level.queues.find(group);
+        auto task = std::move(queue->second.front());
+        queue->second.pop_front();
+
+        // Back of the line for this group if it has more to do
+        if (queue->second.empty()) {
+            level.queues.erase(queue);
+        } else {
+            level.turns.push_back(std::move(group));
+        }
+
+        queued--;
+        level.running++;
+        return {std::move(task), priority};
+    }
+
+    return {};
+}
+
+void Scheduler::work(std::stop_token const &stopToken) {
+    std::unique_lock lock(mutex);
+
+    while (true) {
+        // wait() only gives up on a stop request if there's nothing to run,
+        // anything a running task queued after the destructor emptied the
+        // queues is dropped too
+        if (!workAvailable.wait(lock, stopToken, [this] { return runnable(); }) || stopToken.stop_requested()) {
+            return;
+        }
+
+        auto [task, priority] = next();
+        running++;
+        lock.unlock();
+
+        bool threw = false;
+        try {
+            task();
+        } catch (...) {
+            threw = true;
+        }
+        // Let go of anything the task captured before taking the lock again
+        task = nullptr;
+
+        lock.lock();
+        running--;
+        levels.at(priority).running--;
+        if (threw) {
+            failed++;
+        }
+
+        if (queued == 0 && running == 0) {
+            idle.notify_all();
+        } else if (queued != 0) {
+            // Finishing might have freed up a capped priority
+            workAvailable.notify_one();
+        }
+    }
+}
+
+} // namespace core
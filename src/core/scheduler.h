@@ -0,0 +1,83 @@
+#ifndef INCLUDE_SCHEDULER_H
+#define INCLUDE_SCHEDULER_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace core {
+
+// A fixed pool of worker threads running tasks in priority order.
+//
+// Every task belongs to a group (e.g. the manga it is for). Within a
+// priority, groups take turns (round robin), so a group that queues up
+// thousands of tasks only ever gets its fair share of the workers and can't
+// starve everyone else. Higher priorities always run first.
+//
+// Tasks are free to submit more tasks (e.g. fetching a feed queues up the
+// chapter downloads).
+//
+// The number of workers a priority can occupy at once can be capped. Handy
+// when a priority's tasks mostly sit waiting on a rate limit, so they don't
+// hog every worker while lower priority work could be getting done.
+class Scheduler {
+  public:
+    enum class Priority : std::uint8_t {
+        High = 0,
+        Normal = 1,
+        Low = 2,
+    };
+
+    using Task = std::function<void()>;
+
+    explicit Scheduler(std::size_t workers = std::thread::hardware_concurrency());
+    // Running tasks are finished, anything still queued is dropped
+    ~Scheduler();
+    Scheduler(Scheduler const &) = delete;
+    auto operator=(Scheduler const &) -> Scheduler & = delete;
+
+    void submit(std::string const &group, Priority, Task);
+    // Run at most `limit` tasks of this priority at the same time
+    void setConcurrency(Priority, std::size_t limit);
+    // Block until every task (including any they submitted) has finished
+    void wait();
+    // Number of tasks that ended by throwing an exception
+    [[nodiscard]] auto failures() const -> std::size_t;
+
+  private:
+    struct Level {
+        std::unordered_map<std::string, std::deque<Task>> queues;
+        // Groups with queued tasks, each group appears at most once
+        std::deque<std::string> turns;
+        std::size_t running = 0;
+        std::size_t concurrency = std::numeric_limits<std::size_t>::max();
+    };
+
+    static constexpr std::size_t priorityCount = 3;
+
+    mutable std::mutex mutex;
+    std::condition_variable_any workAvailable;
+    std::condition_variable idle;
+    std::array<Level, priorityCount> levels;
+    std::size_t queued = 0;
+    std::size_t running = 0;
+    std::size_t failed = 0;
+    std::vector<std::jthread> workers;
+
+    void work(std::stop_token const &);
+    auto runnable() const -> bool;
+    auto next() -> std::pair<Task, std::size_t>;
+};
+
+} // namespace core
+
+#endif // INCLUDE_SCHEDULER_H
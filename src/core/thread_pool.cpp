@@ -0,0 +1,73 @@
+#include <algorithm>
+
+#include "thread_pool.h"
+
+namespace core {
+
+ThreadPool::ThreadPool(std::size_t workerCount) {
+    workerCount = std::max<std::size_t>(workerCount, 1);
+    workers.reserve(workerCount);
+
+    for (std::size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([this](std::stop_token const &stopToken) { work(stopToken); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    for (auto &worker : workers) {
+        worker.request_stop();
+    }
+    // std::jthread joins on destruction
+    workers.clear();
+}
+
+void ThreadPool::submit(Job job) {
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [this] { return jobs.empty() && running == 0; });
+}
+
+auto ThreadPool::size() const -> std::size_t {
+    return workers.size();
+}
+
+void ThreadPool::work(std::stop_token const &stopToken) {
+    std::unique_lock lock(mutex);
+
+    while (true) {
+        if (!jobAvailable.wait(lock, stopToken, [this] { return !jobs.empty(); })) {
+            // Asked to stop
+            return;
+        }
+
+        auto job = std::move(jobs.front());
+        jobs.pop_front();
+        running++;
+        lock.unlock();
+
+        // Jobs are expected to deal with their own errors, don't let one
+        // take down the worker
+        try {
+            job();
+        } catch (...) {
+        }
+        // Let go of anything the job captured before taking the lock again
+        job = nullptr;
+
+        lock.lock();
+        running--;
+        if (jobs.empty() && running == 0) {
+            idle.notify_all();
+        }
+    }
+}
+
+} // namespace core
@@ -0,0 +1,44 @@
+#ifndef INCLUDE_THREAD_POOL_H
+#define INCLUDE_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+// Plain first in, first out pool of worker threads. For short, CPU or
+// blocking I/O bound jobs that don't need the fairness and priorities of
+// Scheduler.
+class ThreadPool {
+  public:
+    using Job = std::function<void()>;
+
+    explicit ThreadPool(std::size_t workers = std::thread::hardware_concurrency());
+    // Finishes every job already submitted
+    ~ThreadPool();
+    ThreadPool(ThreadPool const &) = delete;
+    auto operator=(ThreadPool const &) -> ThreadPool & = delete;
+
+    void submit(Job);
+    // Block until every job (including any they submitted) has finished
+    void wait();
+    [[nodiscard]] auto size() const -> std::size_t;
+
+  private:
+    std::mutex mutex;
+    std::condition_variable_any jobAvailable;
+    std::condition_variable idle;
+    std::deque<Job> jobs;
+    std::size_t running = 0;
+    std::vector<std::jthread> workers;
+
+    void work(std::stop_token const &);
+};
+
+} // namespace core
+
+#endif // INCLUDE_THREAD_POOL_H
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "timer_wheel.h"
+
+namespace core {
+
+TimerWheel::TimerWheel(Clock::duration tick, std::size_t slots) : tickLength(tick),
+                                                                  wheel(slots),
+                                                                  cursorTime(Clock::now()) {
+    if (tick <= Clock::duration::zero() || slots == 0) {
+        throw std::invalid_argument("TimerWheel needs a positive tick and at least one slot");
+    }
+}
+
+auto TimerWheel::schedule(Clock::duration delay, Callback callback) -> Id {
+    std::lock_guard lock(mutex);
+
+    // Round up, so a timer never fires early. Always at least one tick, as
+    // the current slot has already been run
+    auto untilDeadline = std::max(Clock::now() + delay - cursorTime, Clock::duration::zero());
+    auto ticks = std::max<std::uint64_t>(static_cast<std::uint64_t>((untilDeadline + tickLength - Clock::duration(1)) / tickLength), 1);
+
+    auto slot = (cursor + ticks) % wheel.size();
+    auto id = nextId++;
+    wheel[slot].push_back(Timer{id, (ticks - 1) / wheel.size(), std::move(callback)});
+    pending.emplace(id, slot);
+    return id;
+}
+
+auto TimerWheel::cancel(Id id) -> bool {
+    std::lock_guard lock(mutex);
+
+    auto it = pending.find(id);
+    if (it == pending.end()) {
+        return false;
+    }
+
+    auto &timers = wheel[it->second];
+    std::erase_if(timers, [id](Timer const &timer) { return timer.id == id; });
+    pending.erase(it);
+    return true;
+}
+
+auto TimerWheel::advance(Clock::time_point now) -> std::size_t {
+    std::vector<Callback> due;
+
+    {
+        std::lock_guard lock(mutex);
+        while (cursorTime + tickLength <= now) {
+            cursor = (cursor + 1) % wheel.size();
+            cursorTime += tickLength;
+
+            auto &timers = wheel[cursor];
+            auto firing = std::stable_partition(timers.begin(), timers.end(), [](Timer const &timer) {
+                return timer.rounds != 0;
+            });
+            for (auto it = firing; it != timers.end(); ++it) {
+                pending.erase(it->id);
+                due.push_back(std::move(it->callback));
+            }
+            timers.erase(firing, timers.end());
+            for (auto &timer : timers) {
+                timer.rounds--;
+            }
+        }
+    }
+
+    // Outside the lock, so callbacks can schedule new timers
+    for (auto &callback : due) {
+        callback();
+    }
+    return due.size();
+}
+
+auto TimerWheel::nextTick() const -> Clock::time_point {
+    std::lock_guard lock(mutex);
+    return cursorTime + tickLength;
+}
+
+auto TimerWheel::size() const -> std::size_t {
+    std::lock_guard lock(mutex);
+    return pending.size();
+}
+
+} // namespace core
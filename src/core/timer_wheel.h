@@ -0,0 +1,63 @@
+#ifndef INCLUDE_TIMER_WHEEL_H
+#define INCLUDE_TIMER_WHEEL_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace core {
+
+// Hashed timing wheel, for keeping a large number of coarse timers (e.g. one
+// poll timer per followed title) where scheduling and cancelling are O(1).
+//
+// The wheel is a ring of slots, each `tick` long. A timer goes into the
+// slot its deadline falls in, along with how many full turns of the wheel
+// to wait first, so timers further out then one turn don't need a bigger
+// wheel. Timers only fire with tick resolution, and never early.
+//
+// Nothing runs on its own, call advance() regularly (e.g. once a tick from
+// a main loop), which runs the due callbacks on the calling thread.
+// Callbacks are free to schedule more timers (e.g. to repeat themselves).
+// Thread safe.
+class TimerWheel {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+    using Id = std::uint64_t;
+
+    explicit TimerWheel(Clock::duration tick = std::chrono::seconds(1), std::size_t slots = 512);
+
+    auto schedule(Clock::duration delay, Callback) -> Id;
+    // False if the timer already fired or was never scheduled
+    auto cancel(Id) -> bool;
+    // Run every timer due by `now`, returns how many ran
+    auto advance(Clock::time_point now = Clock::now()) -> std::size_t;
+    // When the next slot comes up, for sleeping until
+    [[nodiscard]] auto nextTick() const -> Clock::time_point;
+    [[nodiscard]] auto size() const -> std::size_t;
+
+  private:
+    struct Timer {
+        Id id;
+        // Full turns of the wheel left before this fires
+        std::uint64_t rounds;
+        Callback callback;
+    };
+
+    const Clock::duration tickLength;
+    mutable std::mutex mutex;
+    std::vector<std::vector<Timer>> wheel;
+    // Slot we are currently in, and when it started
+    std::size_t cursor = 0;
+    Clock::time_point cursorTime;
+    Id nextId = 1;
+    // Which slot each pending timer is in, for cancel()
+    std::unordered_map<Id, std::size_t> pending;
+};
+
+} // namespace core
+
+#endif // INCLUDE_TIMER_WHEEL_H
@@ -0,0 +1,191 @@
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MANGA_MANAGER_UUID_SSE2 1
+#endif
+
+#include "uuid.h"
+
+namespace core {
+
+namespace {
+
+// Where the hex digits of each group start in the string form
+constexpr std::array<std::size_t, 5> groupOffsets = {0, 9, 14, 19, 24};
+constexpr std::array<std::size_t, 5> groupLengths = {8, 4, 4, 4, 12};
+
+// Drop the dashes, leaving 32 hex digits
+auto gatherHex(std::string_view text, char *hex) -> bool {
+    if (text.size() != Uuid::stringLength || text[8] != '-' || text[13] != '-' || text[18] != '-' || text[23] != '-') {
+        return false;
+    }
+
+    std::size_t position = 0;
+    for (std::size_t group = 0; group < groupOffsets.size(); group++) {
+        std::memcpy(hex + position, text.data() + groupOffsets[group], groupLengths[group]);
+        position += groupLengths[group];
+    }
+    return true;
+}
+
+// And put them back
+void scatterHex(char const *hex, char *out) {
+    std::size_t position = 0;
+    for (std::size_t group = 0; group < groupOffsets.size(); group++) {
+        std::memcpy(out + groupOffsets[group], hex + position, groupLengths[group]);
+        position += groupLengths[group];
+    }
+    out[8] = out[13] = out[18] = out[23] = '-';
+}
+
+#ifdef MANGA_MANAGER_UUID_SSE2
+
+// 16 hex digits into 8 bytes, false if any of them aren't hex
+auto decodeHex(__m128i chars, std::uint8_t *out) -> bool {
+    // '0'-'9'
+    auto digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    auto isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    // 'a'-'f' and 'A'-'F', setting 0x20 makes uppercase lowercase
+    auto letters = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    auto isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+
+    if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xFFFF) {
+        return false;
+    }
+
+    auto nibbles = _mm_or_si128(_mm_and_si128(digits, isDigit),
+        _mm_and_si128(_mm_add_epi8(letters, _mm_set1_epi8(10)), isLetter));
+
+    // Each 16 bit lane holds two nibbles, the first (high) one in the low byte
+    auto high = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00FF)), 4);
+    auto low = _mm_srli_epi16(nibbles, 8);
+    auto packed = _mm_packus_epi16(_mm_or_si128(high, low), _mm_setzero_si128());
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out), packed);
+    return true;
+}
+
+// 16 bytes into 32 lowercase hex digits
+void encodeHex(std::uint8_t const *bytes, char *out) {
+    auto value = _mm_loadu_si128(reinterpret_cast<__m128i const *>(bytes));
+    auto mask = _mm_set1_epi8(0x0F);
+    auto high = _mm_and_si128(_mm_srli_epi16(value, 4), mask);
+    auto low = _mm_and_si128(value, mask);
+
+    auto toAscii = [](__m128i nibbles) {
+        auto isLetter = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+        auto ascii = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+        return _mm_add_epi8(ascii, _mm_and_si128(isLetter, _mm_set1_epi8('a' - '0' - 10)));
+    };
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), toAscii(_mm_unpacklo_epi8(high, low)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), toAscii(_mm_unpackhi_epi8(high, low)));
+}
+
+#else
+
+auto hexValue(char c) -> int {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+#endif
+
+} // namespace
+
+auto Uuid::parse(std::string_view text) -> std::optional<Uuid> {
+    std::array<char, 32> hex{};
+    if (!gatherHex(text, hex.data())) {
+        return std::nullopt;
+    }
+
+    Uuid uuid;
+#ifdef MANGA_MANAGER_UUID_SSE2
+    if (!decodeHex(_mm_loadu_si128(reinterpret_cast<__m128i const *>(hex.data())), uuid.bytes.data()) ||
+        !decodeHex(_mm_loadu_si128(reinterpret_cast<__m128i const *>(hex.data() + 16)), uuid.bytes.data() + 8)) {
+        return std::nullopt;
+    }
+#else
+    for (std::size_t i = 0; i < uuid.bytes.size(); i++) {
+        auto high = hexValue(hex[i * 2]);
+        auto low = hexValue(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) {
+            return std::nullopt;
+        }
+        uuid.bytes[i] = static_cast<std::uint8_t>((high << 4) | low);
+    }
+#endif
+    return uuid;
+}
+
+auto Uuid::fromString(std::string_view text) -> Uuid {
+    if (auto uuid = parse(text)) {
+        return *uuid;
+    }
+    throw std::invalid_argument("Invalid UUID: " + std::string(text));
+}
+
+void Uuid::format(char *out) const {
+    std::array<char, 32> hex{};
+#ifdef MANGA_MANAGER_UUID_SSE2
+    encodeHex(bytes.data(), hex.data());
+#else
+    constexpr std::string_view digits = "0123456789abcdef";
+    for (std::size_t i = 0; i < bytes.size(); i++) {
+        hex[i * 2] = digits[bytes[i] >> 4];
+        hex[i * 2 + 1] = digits[bytes[i] & 0x0F];
+    }
+#endif
+    scatterHex(hex.data(), out);
+}
+
+auto Uuid::toString() const -> std::string {
+    std::string text(stringLength, '\0');
+    format(text.data());
+    return text;
+}
+
+auto Uuid::hash() const -> std::size_t {
+    // Random (v4) UUIDs are already well mixed, but not every id out there
+    // is (e.g. the simulator's counting ones), so give it a cheap mix anyway
+    std::uint64_t high = 0;
+    std::uint64_t low = 0;
+    std::memcpy(&high, bytes.data(), sizeof(high));
+    std::memcpy(&low, bytes.data() + sizeof(high), sizeof(low));
+
+    auto mixed = (low ^ std::rotl(high, 32)) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<std::size_t>(mixed ^ (mixed >> 32));
+}
+
+void UuidInterner::reserve(std::size_t count) {
+    ids.reserve(count);
+    indices.reserve(count);
+}
+
+auto UuidInterner::intern(Uuid uuid) -> Index {
+    auto [it, inserted] = indices.try_emplace(uuid, static_cast<Index>(ids.size()));
+    if (inserted) {
+        ids.push_back(uuid);
+    }
+    return it->second;
+}
+
+auto UuidInterner::find(Uuid uuid) const -> std::optional<Index> {
+    auto it = indices.find(uuid);
+    if (it == indices.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+} // namespace core
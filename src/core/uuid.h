@@ -0,0 +1,108 @@
+#ifndef INCLUDE_UUID_H
+#define INCLUDE_UUID_H
+
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace core {
+
+// A 128 bit UUID, e.g. "f9c33607-9180-4ba6-b85c-e4b5faee7192".
+// MangaDex identifies everything (manga, chapters, groups, authors, tags,
+// etc) with one, and a large library has a lot of them. Stored as the raw
+// 16 bytes it's less then half the size of the string (which doesn't fit
+// in the small string buffer either), is trivially copyable, and compares
+// and hashes as a couple of integers.
+//
+// Ordering matches the ordering of the lowercase string form.
+class Uuid {
+  public:
+    static constexpr std::size_t stringLength = 36;
+
+    // The nil UUID, all zeros
+    constexpr Uuid() = default;
+    constexpr explicit Uuid(std::array<std::uint8_t, 16> const &uuidBytes) : bytes(uuidBytes) {}
+
+    // Accepts the canonical 8-4-4-4-12 form, in either case
+    static auto parse(std::string_view) -> std::optional<Uuid>;
+    // Same as parse, but throws std::invalid_argument on bad input
+    static auto fromString(std::string_view) -> Uuid;
+
+    // Writes the lowercase canonical form, exactly stringLength characters
+    void format(char *out) const;
+    [[nodiscard]] auto toString() const -> std::string;
+
+    [[nodiscard]] constexpr auto isNil() const -> bool {
+        return *this == Uuid();
+    }
+    [[nodiscard]] constexpr auto data() const -> std::array<std::uint8_t, 16> const & {
+        return bytes;
+    }
+    [[nodiscard]] auto hash() const -> std::size_t;
+
+    constexpr auto operator<=>(Uuid const &) const = default;
+
+  private:
+    std::array<std::uint8_t, 16> bytes{};
+};
+
+static_assert(sizeof(Uuid) == 16);
+static_assert(std::is_trivially_copyable_v<Uuid>);
+
+} // namespace core
+
+template <>
+struct std::hash<core::Uuid> {
+    auto operator()(core::Uuid const &uuid) const noexcept -> std::size_t {
+        return uuid.hash();
+    }
+};
+
+namespace core {
+
+// Hands out small, dense indices (0, 1, 2...) for UUIDs, the same UUID
+// always getting the same index. Lets tables refer to an entity with a 4
+// byte index instead of a 16 byte id, and joins between them become plain
+// array lookups.
+class UuidInterner {
+  public:
+    using Index = std::uint32_t;
+
+    void reserve(std::size_t);
+    auto intern(Uuid) -> Index;
+    [[nodiscard]] auto find(Uuid) const -> std::optional<Index>;
+    [[nodiscard]] auto operator[](Index index) const -> Uuid {
+        return ids[index];
+    }
+    [[nodiscard]] auto size() const -> std::size_t {
+        return ids.size();
+    }
+
+  private:
+    std::vector<Uuid> ids;
+    std::unordered_map<Uuid, Index> indices;
+};
+
+} // namespace core
+
+template <>
+struct fmt::formatter<core::Uuid> : fmt::formatter<std::string_view> {
+    template <typename FormatContext>
+    auto format(core::Uuid const &uuid, FormatContext &context) const {
+        std::array<char, core::Uuid::stringLength> text{};
+        uuid.format(text.data());
+        return fmt::formatter<std::string_view>::format(std::string_view(text.data(), text.size()), context);
+    }
+};
+
+#endif // INCLUDE_UUID_H
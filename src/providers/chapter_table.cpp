@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <unordered_set>
+
+#include "chapter_table.h"
+
+namespace mangadex {
+
+namespace {
+
+// Maps a float onto an unsigned integer with the same ordering, so sort
+// keys can be compared as plain integers. NaN (no number) sorts last.
+auto orderable(float value) -> std::uint32_t {
+    if (std::isnan(value)) {
+        return std::numeric_limits<std::uint32_t>::max();
+    }
+    auto bits = std::bit_cast<std::uint32_t>(value);
+    return (bits & 0x80000000U) != 0 ? ~bits : bits | 0x80000000U;
+}
+
+auto parseInt(std::string_view text, std::size_t offset, std::size_t length, int &value) -> bool {
+    if (offset + length > text.size()) {
+        return false;
+    }
+    auto const *begin = text.data() + offset;
+    auto [end, error] = std::from_chars(begin, begin + length, value);
+    return error == std::errc() && end == begin + length;
+}
+
+} // namespace
+
+auto parseNumber(std::string_view text) -> float {
+    float value = std::numeric_limits<float>::quiet_NaN();
+    if (!text.empty()) {
+        auto const *last = text.data() + text.size();
+        auto [end, error] = std::from_chars(text.data(), last, value);
+        // All of it, "10.5a" isn't a number
+        if (error != std::errc() || end != last) {
+            return std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+    return value;
+}
+
+auto parseTimestamp(std::string_view text) -> std::int64_t {
+    // 2021-05-22T19:26:49+00:00
+    // 0123456789012345678901234
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+    if (!parseInt(text, 0, 4, year) || !parseInt(text, 5, 2, month) || !parseInt(text, 8, 2, day) ||
+        !parseInt(text, 11, 2, hour) || !parseInt(text, 14, 2, minute) || !parseInt(text, 17, 2, second)) {
+        return 0;
+    }
+
+    std::chrono::year_month_day date{std::chrono::year(year), std::chrono::month(static_cast<unsigned>(month)), std::chrono::day(static_cast<unsigned>(day))};
+    if (!date.ok()) {
+        return 0;
+    }
+
+    auto seconds = std::chrono::sys_days(date).time_since_epoch() +
+                   std::chrono::hours(hour) + std::chrono::minutes(minute) + std::chrono::seconds(second);
+
+    // Anything but UTC ("Z" or "+00:00") has its offset taken off
+    int offsetHours = 0;
+    int offsetMinutes = 0;
+    if (text.size() >= 25 && (text[19] == '+' || text[19] == '-') &&
+        parseInt(text, 20, 2, offsetHours) && parseInt(text, 23, 2, offsetMinutes)) {
+        auto offset = std::chrono::hours(offsetHours) + std::chrono::minutes(offsetMinutes);
+        seconds += text[19] == '+' ? -offset : offset;
+    }
+
+    return std::chrono::duration_cast<std::chrono::seconds>(seconds).count();
+}
+
+void ChapterTable::reserve(std::size_t count) {
+    chapterIds.reserve(count);
+    mangas.reserve(count);
+    languages.reserve(count);
+    volumes.reserve(count);
+    numbers.reserve(count);
+    published.reserve(count);
+    pageCounts.reserve(count);
+    flagBits.reserve(count);
+    groupOffsets.reserve(count + 1);
+    groupList.reserve(count);
+    titles.reserve(count);
+    volumeTexts.reserve(count);
+    numberTexts.reserve(count);
+}
+
+auto ChapterTable::append(Chapter const &chapter) -> Row {
+    auto language = findLanguage(chapter.translatedLanguage);
+    if (!language) {
+        language = static_cast<std::uint16_t>(languageNames.size());
+        languageNames.push_back(chapter.translatedLanguage);
+    }
+
+    auto row = chapterIds.intern(chapter.id);
+    auto isNew = row == mangas.size();
+    auto external = static_cast<std::uint8_t>(chapter.pages == 0 ? External : 0);
+
+    if (isNew) {
+        mangas.push_back(mangaIds.intern(chapter.mangaId));
+        languages.push_back(*language);
+        volumes.push_back(parseNumber(chapter.volume));
+        numbers.push_back(parseNumber(chapter.chapter));
+        published.push_back(parseTimestamp(chapter.publishAt));
+        pageCounts.push_back(chapter.pages);
+        flagBits.push_back(external);
+        for (auto group : chapter.scanlationGroups) {
+            groupList.push_back(groupIds.intern(group));
+        }
+        groupOffsets.push_back(static_cast<std::uint32_t>(groupList.size()));
+        titles.push_back(chapter.title);
+        volumeTexts.push_back(chapter.volume);
+        numberTexts.push_back(chapter.chapter);
+        return row;
+    }
+
+    // Already known, e.g. from an earlier sync. Groups are left as they
+    // were, they don't change after upload and rewriting them would mean
+    // shifting every row after this one
+    mangas[row] = mangaIds.intern(chapter.mangaId);
+    languages[row] = *language;
+    volumes[row] = parseNumber(chapter.volume);
+    numbers[row] = parseNumber(chapter.chapter);
+    published[row] = parseTimestamp(chapter.publishAt);
+    pageCounts[row] = chapter.pages;
+    flagBits[row] = static_cast<std::uint8_t>((flagBits[row] & ~External) | external);
+    titles[row] = chapter.title;
+    volumeTexts[row] = chapter.volume;
+    numberTexts[row] = chapter.chapter;
+    return row;
+}
+
+void ChapterTable::append(Feed const &feed) {
+    reserve(size() + feed.chapters.size());
+    for (auto const &chapter : feed.chapters) {
+        append(chapter);
+    }
+}
+
+auto ChapterTable::size() const -> std::size_t {
+    return mangas.size();
+}
+
+auto ChapterTable::find(core::Uuid chapterId) const -> std::optional<Row> {
+    return chapterIds.find(chapterId);
+}
+
+auto ChapterTable::id(Row row) const -> core::Uuid {
+    return chapterIds[row];
+}
+
+auto ChapterTable::mangaId(Row row) const -> core::Uuid {
+    return mangaIds[mangas[row]];
+}
+
+auto ChapterTable::language(Row row) const -> std::string_view {
+    return languageNames[languages[row]];
+}
+
+auto ChapterTable::volume(Row row) const -> float {
+    return volumes[row];
+}
+
+auto ChapterTable::number(Row row) const -> float {
+    return numbers[row];
+}
+
+auto ChapterTable::groups(Row row) const -> std::span<Index const> {
+    return std::span(groupList).subspan(groupOffsets[row], groupOffsets[row + 1] - groupOffsets[row]);
+}
+
+auto ChapterTable::groupId(Index index) const -> core::Uuid {
+    return groupIds[index];
+}
+
+auto ChapterTable::publishedAt(Row row) const -> std::int64_t {
+    return published[row];
+}
+
+auto ChapterTable::pages(Row row) const -> std::uint32_t {
+    return pageCounts[row];
+}
+
+auto ChapterTable::flags(Row row) const -> std::uint8_t {
+    return flagBits[row];
+}
+
+auto ChapterTable::title(Row row) const -> std::string const & {
+    return titles[row];
+}
+
+auto ChapterTable::volumeText(Row row) const -> std::string const & {
+    return volumeTexts[row];
+}
+
+auto ChapterTable::numberText(Row row) const -> std::string const & {
+    return numberTexts[row];
+}
+
+void ChapterTable::setFlags(Row row, std::uint8_t bits) {
+    flagBits[row] |= bits;
+}
+
+void ChapterTable::clearFlags(Row row, std::uint8_t bits) {
+    flagBits[row] = static_cast<std::uint8_t>(flagBits[row] & ~bits);
+}
+
+auto ChapterTable::findLanguage(std::string_view name) const -> std::optional<std::uint16_t> {
+    auto it = std::find(languageNames.begin(), languageNames.end(), name);
+    if (it == languageNames.end()) {
+        return std::nullopt;
+    }
+    return static_cast<std::uint16_t>(it - languageNames.begin());
+}
+
+auto ChapterTable::all() const -> Selection {
+    Selection rows(size());
+    for (std::size_t row = 0; row < rows.size(); row++) {
+        rows[row] = static_cast<Row>(row);
+    }
+    return rows;
+}
+
+auto ChapterTable::filterLanguage(Selection const &rows, std::string_view name) const -> Selection {
+    auto language = findLanguage(name);
+    if (!language) {
+        return {};
+    }
+    return select(rows, [&, wanted = *language](Row row) { return languages[row] == wanted; });
+}
+
+auto ChapterTable::filterManga(Selection const &rows, core::Uuid manga) const -> Selection {
+    auto index = mangaIds.find(manga);
+    if (!index) {
+        return {};
+    }
+    return select(rows, [&, wanted = *index](Row row) { return mangas[row] == wanted; });
+}
+
+auto ChapterTable::filterGroup(Selection const &rows, core::Uuid group) const -> Selection {
+    auto index = groupIds.find(group);
+    if (!index) {
+        return {};
+    }
+    return select(rows, [&, wanted = *index](Row row) {
+        auto rowGroups = groups(row);
+        return std::find(rowGroups.begin(), rowGroups.end(), wanted) != rowGroups.end();
+    });
+}
+
+auto ChapterTable::filterFlags(Selection const &rows, std::uint8_t mask, std::uint8_t value) const -> Selection {
+    return select(rows, [&](Row row) { return (flagBits[row] & mask) == value; });
+}
+
+void ChapterTable::sortByNumber(Selection &rows) const {
+    // Pack each row's sort key into integers up front, so the sort itself
+    // only compares integers sitting next to each other in memory rather
+    // then chasing rows around the columns
+    struct Key {
+        std::uint64_t mangaVolume;
+        std::uint32_t number;
+        Row row;
+    };
+
+    std::vector<Key> keys;
+    keys.reserve(rows.size());
+    for (auto row : rows) {
+        keys.push_back({(static_cast<std::uint64_t>(mangas[row]) << 32U) | orderable(volumes[row]), orderable(numbers[row]), row});
+    }
+
+    std::sort(keys.begin(), keys.end(), [](Key const &a, Key const &b) {
+        return std::tie(a.mangaVolume, a.number, a.row) < std::tie(b.mangaVolume, b.number, b.row);
+    });
+
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        rows[i] = keys[i].row;
+    }
+}
+
+void ChapterTable::sortByPublished(Selection &rows, bool newestFirst) const {
+    std::vector<std::pair<std::int64_t, Row>> keys;
+    keys.reserve(rows.size());
+    for (auto row : rows) {
+        keys.emplace_back(newestFirst ? -published[row] : published[row], row);
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        rows[i] = keys[i].second;
+    }
+}
+
+auto ChapterTable::newestUnread(Selection const &rows) const -> Selection {
+    auto unread = filterFlags(rows, Read, 0);
+    sortByPublished(unread);
+    return unread;
+}
+
+auto ChapterTable::dedupeByNumber(Selection const &rows) const -> Selection {
+    std::unordered_set<std::uint64_t> seen;
+    seen.reserve(rows.size());
+
+    return select(rows, [&](Row row) {
+        if (std::isnan(numbers[row])) {
+            return true;
+        }
+        return seen.insert((static_cast<std::uint64_t>(mangas[row]) << 32U) | orderable(numbers[row])).second;
+    });
+}
+
+} // namespace mangadex
@@ -0,0 +1,146 @@
+#ifndef INCLUDE_CHAPTER_TABLE_H
+#define INCLUDE_CHAPTER_TABLE_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mangadex.h"
+#include "uuid.h"
+
+namespace mangadex {
+
+// Every chapter in the library, stored column by column (structure of
+// arrays) rather then as a vector of Chapter.
+//
+// Filtering on language or sorting by chapter number only has to walk the
+// columns involved, which are small and packed together (e.g. 2 bytes per
+// chapter for the language), instead of dragging every chapter's strings
+// through the cache. The loops are kept simple and branch free so the
+// compiler can vectorize them, which keeps things snappy with 100k+
+// chapters in the library.
+//
+// Queries work on a Selection, a list of rows, and return a new one. Start
+// with all() and chain filters, e.g.
+//
+//     auto rows = table.dedupeByNumber(table.filterLanguage(table.all(), "en"));
+//
+// Strings only needed for display (titles, original volume/chapter text)
+// live in their own columns and are never touched by queries.
+class ChapterTable {
+  public:
+    using Row = std::uint32_t;
+    using Selection = std::vector<Row>;
+    // Languages, mangas and groups are interned, columns hold these indices
+    using Index = core::UuidInterner::Index;
+
+    enum Flags : std::uint8_t {
+        Read = 1U << 0U,
+        Downloaded = 1U << 1U,
+        // Hosted off site (e.g. official publisher), there are no pages to get
+        External = 1U << 2U,
+    };
+
+    void reserve(std::size_t);
+    // Adding a chapter that's already in the table updates it in place,
+    // keeping its flags
+    auto append(Chapter const &) -> Row;
+    void append(Feed const &);
+    [[nodiscard]] auto size() const -> std::size_t;
+    // Row of a chapter, if it's in the table
+    [[nodiscard]] auto find(core::Uuid) const -> std::optional<Row>;
+
+    // Columns
+    [[nodiscard]] auto id(Row) const -> core::Uuid;
+    [[nodiscard]] auto mangaId(Row) const -> core::Uuid;
+    [[nodiscard]] auto language(Row) const -> std::string_view;
+    // NaN when the chapter has no volume/number
+    [[nodiscard]] auto volume(Row) const -> float;
+    [[nodiscard]] auto number(Row) const -> float;
+    [[nodiscard]] auto groups(Row) const -> std::span<Index const>;
+    [[nodiscard]] auto groupId(Index) const -> core::Uuid;
+    // Seconds since the Unix epoch
+    [[nodiscard]] auto publishedAt(Row) const -> std::int64_t;
+    [[nodiscard]] auto pages(Row) const -> std::uint32_t;
+    [[nodiscard]] auto flags(Row) const -> std::uint8_t;
+    [[nodiscard]] auto title(Row) const -> std::string const &;
+    [[nodiscard]] auto volumeText(Row) const -> std::string const &;
+    [[nodiscard]] auto numberText(Row) const -> std::string const &;
+
+    void setFlags(Row, std::uint8_t);
+    void clearFlags(Row, std::uint8_t);
+
+    // Queries
+    [[nodiscard]] auto all() const -> Selection;
+    [[nodiscard]] auto filterLanguage(Selection const &, std::string_view) const -> Selection;
+    [[nodiscard]] auto filterManga(Selection const &, core::Uuid) const -> Selection;
+    // Chapters the group worked on, including joint releases
+    [[nodiscard]] auto filterGroup(Selection const &, core::Uuid) const -> Selection;
+    // Rows where (flags & mask) == value, e.g. filterFlags(rows, Read, 0) for unread
+    [[nodiscard]] auto filterFlags(Selection const &, std::uint8_t mask, std::uint8_t value) const -> Selection;
+    // By manga, then volume, then chapter number. Chapters without a number
+    // go last
+    void sortByNumber(Selection &) const;
+    void sortByPublished(Selection &, bool newestFirst = true) const;
+    // Unread chapters, most recently published first
+    [[nodiscard]] auto newestUnread(Selection const &) const -> Selection;
+    // Keep one row per chapter number of each manga (the first one in the
+    // selection, so sort or filter first to pick which release wins).
+    // Chapters without a number are all kept. The result is in the same
+    // order as the selection.
+    [[nodiscard]] auto dedupeByNumber(Selection const &) const -> Selection;
+
+  private:
+    // Hot columns, used by queries. Chapter ids are interned in row order,
+    // so chapterIds doubles as the id column
+    core::UuidInterner chapterIds;
+    std::vector<Index> mangas;
+    std::vector<std::uint16_t> languages;
+    std::vector<float> volumes;
+    std::vector<float> numbers;
+    std::vector<std::int64_t> published;
+    std::vector<std::uint32_t> pageCounts;
+    std::vector<std::uint8_t> flagBits;
+    // Groups of row n are groupList[groupOffsets[n]] to groupList[groupOffsets[n + 1]]
+    std::vector<std::uint32_t> groupOffsets{0};
+    std::vector<Index> groupList;
+
+    // Cold columns, only for display
+    std::vector<std::string> titles;
+    std::vector<std::string> volumeTexts;
+    std::vector<std::string> numberTexts;
+
+    core::UuidInterner mangaIds;
+    core::UuidInterner groupIds;
+    std::vector<std::string> languageNames;
+
+    [[nodiscard]] auto findLanguage(std::string_view) const -> std::optional<std::uint16_t>;
+
+    // Branch free "stream compaction": every row is written, but the output
+    // position only moves on when it matches, so there's no unpredictable
+    // branch per row
+    template <typename Predicate>
+    static auto select(Selection const &rows, Predicate predicate) -> Selection {
+        Selection selected(rows.size());
+        std::size_t count = 0;
+        for (auto row : rows) {
+            selected[count] = row;
+            count += predicate(row) ? 1U : 0U;
+        }
+        selected.resize(count);
+        return selected;
+    }
+};
+
+// "10.5" -> 10.5f, NaN for empty or unparsable text
+auto parseNumber(std::string_view) -> float;
+// ISO 8601 as MangaDex sends it ("2021-05-22T19:26:49+00:00") to seconds
+// since the Unix epoch, 0 when unparsable
+auto parseTimestamp(std::string_view) -> std::int64_t;
+
+} // namespace mangadex
+
+#endif // INCLUDE_CHAPTER_TABLE_H
@@ -1,43 +1,603 @@
-#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <fmt/core.h> // Will change to std::format when compilers support it
 #include <nlohmann/json.hpp>
 
+#include "chapter_table.h"
+#include "file_io.h"
 #include "http.h"
 #include "mangadex.h"
+#include "scheduler.h"
+#include "timer_wheel.h"
+#include "uuid.h"
 
 static void show_usage(const std::string &name) {
-    std::cerr << "Usage: " << name << " [options] <id>\n\n"
+    std::cerr << "Usage: " << name << " [options] <id>\n"
+              << "       " << name << " [options] --batch <file>\n\n"
               << "Options:\n"
               << "\t-d,--download\t\tDownload Chapters\n"
               << "\t-o,--output-directory\tSpecify output directory.\n\t\t\t\tIf not specified then current directory is used\n"
+              << "\t-b,--batch <file>\tRead manga ids from <file>, one per line. Use - for stdin\n"
+              << "\t-j,--jobs <n>\t\tNumber of requests to run at once (default 8)\n"
+              << "\t-m,--memory <MiB>\tCap on memory used by in flight downloads (default 256)\n"
+              << "\t-l,--language <lang>\tOnly fetch chapters in <lang>, can be repeated\n"
+              << "\t--data-saver\t\tDownload the compressed (data saver) pages\n"
+              << "\t--api-url <url>\t\tUse a different API server, e.g. mangadex-simulator\n"
+              << "\t--io-backend <name>\tHow pages are written: auto (default), io_uring or threads\n"
+              << "\t--fsync\t\t\tMake sure every page is on disk before counting it as downloaded\n"
+              << "\t--daemon\t\tKeep running, checking the titles for new chapters\n"
+              << "\t--interval <minutes>\tHow often --daemon checks each title (default 30)\n"
               << "\t-h,--help\t\tShow this help message\n"
               << "\t-V,--version\t\tDisplay version information"
               << std::endl;
 }
 
-auto writeFile(const std::string &data, const std::string &filename) -> bool {
-    std::ofstream outf{filename, std::ios::binary};
-    if (!outf) {
-        std::cerr << "Failed to write" << filename << std::endl;
-        return false;
+namespace {
+
+struct Options {
+    bool download = false;
+    bool dataSaver = false;
+    std::filesystem::path outputDirectory = std::filesystem::current_path();
+    std::string batchFile;
+    std::size_t jobs = 8;
+    std::size_t memoryBudget = 256 * 1024 * 1024;
+    std::vector<std::string> languages;
+    std::string apiUrl = std::string(mangadex::apiUrl);
+    core::IoBackend ioBackend = core::IoBackend::Auto;
+    bool fsync = false;
+    bool daemon = false;
+    std::chrono::minutes interval{30};
+    std::vector<core::Uuid> ids;
+};
+
+std::atomic<bool> stopRequested = false;
+
+void handleSignal(int /*signal*/) {
+    stopRequested = true;
+}
+
+// UTC, in the form MangaDex's *Since parameters want, e.g. "2023-01-31T12:00:00"
+auto formatTimestamp(std::chrono::system_clock::time_point time) -> std::string {
+    auto days = std::chrono::floor<std::chrono::days>(time);
+    std::chrono::year_month_day date{days};
+    std::chrono::hh_mm_ss clock{std::chrono::floor<std::chrono::seconds>(time - days)};
+    return fmt::format("{:04}-{:02}-{:02}T{:02}:{:02}:{:02}", static_cast<int>(date.year()),
+        static_cast<unsigned>(date.month()), static_cast<unsigned>(date.day()),
+        clock.hours().count(), clock.minutes().count(), clock.seconds().count());
+}
+
+// Reads one id per line, ignoring blank lines and # comments
+auto readIds(std::istream &input) -> std::vector<std::string> {
+    std::vector<std::string> ids;
+    std::string line;
+
+    while (std::getline(input, line)) {
+        auto begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#') {
+            continue;
+        }
+        auto end = line.find_last_not_of(" \t\r");
+        ids.push_back(line.substr(begin, end - begin + 1));
     }
-    outf << data;
-    return true;
+
+    return ids;
 }
 
-auto main(int argc, const char **argv) -> int {
-    // TODO: Fix this very crude commandline parsing
+// Everything shared between the tasks for one run. Every task, for every
+// title, goes through the one scheduler and the one client, so connections,
+// caches and rate limit state are shared across the whole batch
+class Sync {
+  public:
+    Sync(Options const &syncOptions) : options(syncOptions),
+                                       budget(syncOptions.memoryBudget),
+                                       client(syncOptions.apiUrl, &budget),
+                                       writer(core::makeFileWriter(syncOptions.ioBackend, {.sync = syncOptions.fsync})),
+                                       scheduler(syncOptions.jobs) {
+        // Feeds and at-home lookups spend most of their time waiting on
+        // MangaDex's rate limits, don't let them tie up every worker while
+        // there are pages that could be downloading
+        scheduler.setConcurrency(feedPriority, std::max<std::size_t>(options.jobs / 2, 1));
+        scheduler.setConcurrency(chapterPriority, 2);
+    }
+
+    auto run() -> int {
+        for (auto const &id : options.ids) {
+            queueFeed(id, 0);
+        }
+
+        scheduler.wait();
+        writer->flush();
+
+        printSummary();
+        return (failures != 0 || scheduler.failures() != 0) ? 1 : 0;
+    }
+
+    // Stay up until asked to stop, checking every title for new chapters
+    // every `interval` (give or take some jitter) and downloading them as
+    // soon as they show up. The connections, caches and the library all
+    // stay warm between checks, rather then starting from scratch each time.
+    auto runDaemon(std::atomic<bool> const &stop) -> int {
+        // Spread the first round out a bit, rather then asking for every
+        // title at the same moment
+        auto spread = std::min<std::chrono::steady_clock::duration>(options.interval, std::chrono::seconds(options.ids.size()));
+        for (auto const &id : options.ids) {
+            schedulePoll(id, randomDuration(std::chrono::steady_clock::duration::zero(), spread));
+        }
+
+        fmt::print(stderr, "Following {} titles, checking every {} minutes\n", options.ids.size(), options.interval.count());
+
+        while (!stop) {
+            timers.advance();
+            std::this_thread::sleep_until(timers.nextTick());
+        }
+
+        // No more polls, and anything queued is skipped. The tasks already
+        // running are left to finish before the writes they started are
+        // waited for
+        fmt::print(stderr, "Stopping\n");
+        stopping = true;
+        scheduler.wait();
+        writer->flush();
+        printSummary();
+        return 0;
+    }
+
+  private:
+    // Priorities, highest first:
+    // - Feeds, so we learn about all the work there is to do early
+    // - At-home server lookups, which are heavily rate limited
+    // - Page downloads, the bulk of the work
+    // Within each priority every title takes turns.
+    static constexpr auto feedPriority = core::Scheduler::Priority::High;
+    static constexpr auto chapterPriority = core::Scheduler::Priority::Normal;
+    static constexpr auto pagePriority = core::Scheduler::Priority::Low;
+
+    // Daemon mode retries a title that failed to update after a minute,
+    // doubling each time it fails again, up to this
+    static constexpr auto minBackoff = std::chrono::minutes(1);
+    static constexpr auto maxBackoff = std::chrono::hours(6);
+    // When checking for new chapters, overlap with the last check a bit to
+    // allow for clock differences and chapters that took a while to appear
+    static constexpr auto pollOverlap = std::chrono::minutes(10);
+
+    // Per title state in daemon mode
+    struct Follow {
+        // Start of the last successful check, nullopt until there is one
+        std::optional<std::chrono::system_clock::time_point> lastChecked;
+        unsigned failures = 0;
+        // Chapters that failed to download. A check only asks for chapters
+        // that changed since the last one, so these are tried again on the
+        // next check rather then waiting for them to come up by themselves
+        std::vector<mangadex::Chapter> retry;
+    };
+
+    // A chapter's pages on their way to disk
+    struct Download {
+        mangadex::Chapter chapter;
+        std::atomic<std::size_t> remaining;
+        std::atomic<bool> failed = false;
+    };
+
+    Options const &options;
+    // No matter how many downloads are running, the bodies held in memory
+    // at once stay under this
+    core::MemoryBudget budget;
+    mangadex::Client client;
+    // Every chapter seen so far, guarded by libraryMutex
+    std::mutex libraryMutex;
+    mangadex::ChapterTable library;
+    std::unordered_map<core::Uuid, Follow> follows;
+    // Chapters being downloaded right now
+    std::unordered_set<core::Uuid> downloading;
+    // Used by the tasks and the writer's completions, so declared before
+    // (and destroyed after) both
+    std::mutex outputMutex;
+    std::atomic<std::size_t> chapters = 0;
+    std::atomic<std::size_t> pages = 0;
+    std::atomic<std::size_t> failures = 0;
+    std::atomic<bool> stopping = false;
+    // Pages are handed off to be written in the background, so workers can
+    // get on with the next download
+    std::unique_ptr<core::FileWriter> writer;
+    // Declared before the scheduler, as running tasks schedule timers
+    core::TimerWheel timers;
+    core::Scheduler scheduler;
+
+    void printSummary() {
+        fmt::print(stderr, "{} titles, {} chapters, {} pages downloaded, {} failures\n",
+            options.ids.size(), chapters.load(), pages.load(), failures.load() + scheduler.failures());
+        fmt::print(stderr, "Peak in flight memory: {:.1f} MiB (budget {:.1f} MiB)\n",
+            static_cast<double>(budget.peak()) / (1024.0 * 1024.0), static_cast<double>(budget.limit()) / (1024.0 * 1024.0));
+        fmt::print(stderr, "Pages written with {}\n", writer->name());
+    }
+
+    static auto randomDuration(std::chrono::steady_clock::duration min, std::chrono::steady_clock::duration max) -> std::chrono::steady_clock::duration {
+        thread_local std::mt19937_64 rng(std::random_device{}());
+        return std::chrono::steady_clock::duration(std::uniform_int_distribution<std::chrono::steady_clock::rep>(min.count(), max.count())(rng));
+    }
+
+    template <typename... Args>
+    void print(fmt::format_string<Args...> format, Args &&...args) {
+        std::lock_guard lock(outputMutex);
+        fmt::print(format, std::forward<Args>(args)...);
+    }
+
+    // Wraps a task so a failure is reported, without taking down the rest
+    // of the batch
+    template <typename Function>
+    void queue(core::Uuid mangaId, core::Scheduler::Priority priority, std::string what, Function function) {
+        scheduler.submit(mangaId.toString(), priority, [this, what = std::move(what), function = std::move(function)]() mutable {
+            if (stopping) {
+                return;
+            }
+            try {
+                function();
+            } catch (std::exception const &err) {
+                failures++;
+                std::lock_guard lock(outputMutex);
+                std::cerr << "Failed to " << what << ": " << err.what() << std::endl;
+            }
+        });
+    }
+
+    void queueFeed(core::Uuid mangaId, std::uint64_t offset) {
+        queue(mangaId, feedPriority, fmt::format("fetch feed for {}", mangaId), [this, mangaId, offset] {
+            auto feed = client.feed(mangaId, offset, options.languages);
+
+            // Queue up the next page straight away, so it isn't waiting on
+            // this page's chapters
+            auto nextOffset = feed.offset + feed.chapters.size();
+            if (!feed.chapters.empty() && nextOffset < feed.total) {
+                queueFeed(mangaId, nextOffset);
+            }
+
+            chapters += feed.chapters.size();
+            {
+                std::lock_guard lock(libraryMutex);
+                for (auto const &chapter : feed.chapters) {
+                    library.append(chapter);
+                }
+            }
+            for (auto &chapter : feed.chapters) {
+                print("{}\tVol.{} Ch.{}\t[{}]\t{} ({} pages)\n", mangaId,
+                    chapter.volume.empty() ? "-" : chapter.volume,
+                    chapter.chapter.empty() ? "-" : chapter.chapter,
+                    chapter.translatedLanguage, chapter.title, chapter.pages);
+
+                if (options.download) {
+                    queueChapter(mangaId, std::move(chapter));
+                }
+            }
+        });
+    }
+
+    auto chapterDirectory(mangadex::Chapter const &chapter) const -> std::filesystem::path {
+        return options.outputDirectory / chapter.mangaId.toString() /
+               fmt::format("Vol.{} Ch.{} [{}] {}",
+                   chapter.volume.empty() ? "-" : chapter.volume,
+                   chapter.chapter.empty() ? "-" : chapter.chapter,
+                   chapter.translatedLanguage, chapter.id);
+    }
+
+    // Every page is already on disk, e.g. from an earlier run
+    auto isDownloaded(mangadex::Chapter const &chapter) const -> bool {
+        std::error_code error;
+        auto files = std::filesystem::directory_iterator(chapterDirectory(chapter), error);
+        if (error || chapter.pages == 0) {
+            return false;
+        }
+        return static_cast<std::size_t>(std::distance(files, std::filesystem::directory_iterator())) >= chapter.pages;
+    }
+
+    void queueChapter(core::Uuid mangaId, mangadex::Chapter chapter) {
+        if (isDownloaded(chapter)) {
+            markDownloaded(chapter.id);
+            return;
+        }
+
+        queue(mangaId, chapterPriority, fmt::format("fetch chapter {}", chapter.id), [this, mangaId, chapter = std::move(chapter)] {
+            std::shared_ptr<const mangadex::AtHomeServer> server;
+            std::filesystem::path directory;
+            try {
+                server = std::make_shared<const mangadex::AtHomeServer>(client.atHomeServer(chapter.id));
+                directory = chapterDirectory(chapter);
+                std::filesystem::create_directories(directory);
+            } catch (...) {
+                downloadFailed(mangaId, chapter);
+                throw;
+            }
+
+            auto pageCount = options.dataSaver ? server->dataSaver.size() : server->data.size();
+            if (pageCount == 0) {
+                // External chapters (hosted somewhere else) never have any
+                // pages here, anything else should
+                if (chapter.pages == 0) {
+                    std::lock_guard lock(libraryMutex);
+                    downloading.erase(chapter.id);
+                    return;
+                }
+                downloadFailed(mangaId, chapter);
+                throw std::runtime_error("the at-home server has no pages for it");
+            }
+
+            auto download = std::make_shared<Download>(chapter, pageCount);
+            for (std::size_t index = 0; index < pageCount; index++) {
+                queuePage(mangaId, download, server, index, directory);
+            }
+        });
+    }
+
+    void queuePage(core::Uuid mangaId, std::shared_ptr<Download> download, std::shared_ptr<const mangadex::AtHomeServer> server, std::size_t index, std::filesystem::path const &directory) {
+        queue(mangaId, pagePriority, fmt::format("download page {} of {}", index + 1, server->hash), [this, mangaId, download, server, index, directory] {
+            std::shared_ptr<http::Response> response;
+            std::filesystem::path path;
+            try {
+                auto const &files = options.dataSaver ? server->dataSaver : server->data;
+                auto extension = std::filesystem::path(files.at(index)).extension().string();
+
+                response = std::make_shared<http::Response>(client.page(*server, index, options.dataSaver));
+                path = directory / fmt::format("{:03}{}", index + 1, extension);
+            } catch (...) {
+                pageDone(mangaId, *download, false);
+                throw;
+            }
+            auto data = std::move(response->body);
+
+            // The response holds on to the page's share of the memory budget
+            // until it's been written
+            writer->write(path, std::move(data), [this, mangaId, download, path, response](std::error_code error) {
+                if (error) {
+                    failures++;
+                    std::lock_guard lock(outputMutex);
+                    std::cerr << "Failed to write " << path.string() << ": " << error.message() << std::endl;
+                } else {
+                    pages++;
+                }
+                pageDone(mangaId, *download, !error);
+            });
+        });
+    }
+
+    // Once every page has either been written or failed
+    void pageDone(core::Uuid mangaId, Download &download, bool written) {
+        if (!written) {
+            download.failed = true;
+        }
+        if (--download.remaining != 0) {
+            return;
+        }
+        if (download.failed) {
+            downloadFailed(mangaId, download.chapter);
+        } else {
+            markDownloaded(download.chapter.id);
+        }
+    }
+
+    void markDownloaded(core::Uuid chapterId) {
+        std::lock_guard lock(libraryMutex);
+        if (auto row = library.find(chapterId)) {
+            library.setFlags(*row, mangadex::ChapterTable::Downloaded);
+        }
+        downloading.erase(chapterId);
+    }
+
+    void downloadFailed(core::Uuid mangaId, mangadex::Chapter const &chapter) {
+        std::lock_guard lock(libraryMutex);
+        downloading.erase(chapter.id);
+        follows[mangaId].retry.push_back(chapter);
+    }
+
+    void schedulePoll(core::Uuid mangaId, std::chrono::steady_clock::duration delay) {
+        if (stopping) {
+            return;
+        }
+        timers.schedule(delay, [this, mangaId] { queuePoll(mangaId); });
+    }
+
+    // Daemon mode's check for new chapters. Unlike queueFeed, the pages of
+    // the feed are fetched one after the other, after the first check
+    // there's rarely more then one.
+    void queuePoll(core::Uuid mangaId) {
+        queue(mangaId, feedPriority, fmt::format("check {} for new chapters", mangaId), [this, mangaId] {
+            auto started = std::chrono::system_clock::now();
+            std::string since;
+            {
+                std::lock_guard lock(libraryMutex);
+                if (auto const &lastChecked = follows[mangaId].lastChecked) {
+                    since = formatTimestamp(*lastChecked - pollOverlap);
+                }
+            }
+
+            std::vector<mangadex::Chapter> fresh;
+            std::vector<mangadex::Chapter> toDownload;
+            try {
+                for (std::uint64_t offset = 0;;) {
+                    auto feed = client.feed(mangaId, offset, options.languages, since);
+
+                    std::lock_guard lock(libraryMutex);
+                    for (auto &chapter : feed.chapters) {
+                        auto known = library.find(chapter.id).has_value();
+                        auto row = library.append(chapter);
+                        if (options.download && (library.flags(row) & mangadex::ChapterTable::Downloaded) == 0 &&
+                            downloading.insert(chapter.id).second) {
+                            toDownload.push_back(chapter);
+                        }
+                        if (!known) {
+                            fresh.push_back(std::move(chapter));
+                        }
+                    }
+
+                    offset = feed.offset + feed.chapters.size();
+                    if (feed.chapters.empty() || offset >= feed.total) {
+                        break;
+                    }
+                }
+            } catch (std::exception const &) {
+                // Back off, with jitter so titles that failed together
+                // (e.g. MangaDex being down) don't all retry together
+                unsigned attempt = 0;
+                {
+                    std::lock_guard lock(libraryMutex);
+                    attempt = follows[mangaId].failures++;
+                }
+                auto ceiling = std::min<std::chrono::steady_clock::duration>(minBackoff * (1U << std::min(attempt, 16U)), maxBackoff);
+                schedulePoll(mangaId, randomDuration(ceiling / 2, ceiling));
+                throw;
+            }
+
+            bool firstCheck = false;
+            {
+                std::lock_guard lock(libraryMutex);
+                auto &follow = follows[mangaId];
+                firstCheck = !follow.lastChecked.has_value();
+                follow.lastChecked = started;
+                follow.failures = 0;
+
+                for (auto &chapter : std::exchange(follow.retry, {})) {
+                    auto row = library.find(chapter.id);
+                    if (row && (library.flags(*row) & mangadex::ChapterTable::Downloaded) == 0 &&
+                        downloading.insert(chapter.id).second) {
+                        toDownload.push_back(std::move(chapter));
+                    }
+                }
+            }
+
+            chapters += fresh.size();
+            if (firstCheck) {
+                print("{}\t{} chapters\n", mangaId, fresh.size());
+            } else {
+                for (auto const &chapter : fresh) {
+                    print("{}\tNew: Vol.{} Ch.{}\t[{}]\t{}\n", mangaId,
+                        chapter.volume.empty() ? "-" : chapter.volume,
+                        chapter.chapter.empty() ? "-" : chapter.chapter,
+                        chapter.translatedLanguage, chapter.title);
+                }
+            }
+
+            for (auto &chapter : toDownload) {
+                queueChapter(mangaId, std::move(chapter));
+            }
+
+            // +/- 10%, so titles added at the same time drift apart
+            auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(options.interval);
+            schedulePoll(mangaId, randomDuration(interval * 9 / 10, interval * 11 / 10));
+        });
+    }
+};
+
+} // namespace
+
+auto main(int argc, const char **argv) -> int try {
     if (argc < 2) {
         show_usage(argv[0]);
         return 1;
     }
 
-    // Unimplemented
+    Options options;
+    std::vector<std::string> ids;
 
-    return 0;
-}
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(arg + " requires a value");
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            show_usage(argv[0]);
+            return 0;
+        } else if (arg == "-V" || arg == "--version") {
+            std::cout << "mangadex-test " << MANGA_MANAGER_VERSION << std::endl;
+            return 0;
+        } else if (arg == "-d" || arg == "--download") {
+            options.download = true;
+        } else if (arg == "-o" || arg == "--output-directory") {
+            options.outputDirectory = value();
+        } else if (arg == "-b" || arg == "--batch") {
+            options.batchFile = value();
+        } else if (arg == "-j" || arg == "--jobs") {
+            options.jobs = std::max<std::size_t>(std::stoul(value()), 1);
+        } else if (arg == "-m" || arg == "--memory") {
+            options.memoryBudget = std::stoull(value()) * 1024 * 1024;
+        } else if (arg == "-l" || arg == "--language") {
+            options.languages.push_back(value());
+        } else if (arg == "--data-saver") {
+            options.dataSaver = true;
+        } else if (arg == "--api-url") {
+            options.apiUrl = value();
+        } else if (arg == "--io-backend") {
+            options.ioBackend = core::parseIoBackend(value());
+        } else if (arg == "--fsync") {
+            options.fsync = true;
+        } else if (arg == "--daemon") {
+            options.daemon = true;
+        } else if (arg == "--interval") {
+            options.interval = std::chrono::minutes(std::max(std::stol(value()), 1L));
+        } else if (arg.starts_with('-') && arg != "-") {
+            std::cerr << "Unknown option: " << arg << "\n\n";
+            show_usage(argv[0]);
+            return 1;
+        } else {
+            ids.push_back(arg);
+        }
+    }
 
+    if (!options.batchFile.empty()) {
+        if (options.batchFile == "-") {
+            auto batch = readIds(std::cin);
+            ids.insert(ids.end(), batch.begin(), batch.end());
+        } else {
+            std::ifstream inf{options.batchFile};
+            if (!inf) {
+                std::cerr << "Unable to open " << options.batchFile << std::endl;
+                return 1;
+            }
+            auto batch = readIds(inf);
+            ids.insert(ids.end(), batch.begin(), batch.end());
+        }
+    }
+
+    for (auto const &id : ids) {
+        auto uuid = core::Uuid::parse(id);
+        if (!uuid) {
+            std::cerr << "Not a MangaDex id: " << id << std::endl;
+            return 1;
+        }
+        options.ids.push_back(*uuid);
+    }
+
+    if (options.ids.empty()) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    Sync sync(options);
+    if (options.daemon) {
+        std::signal(SIGINT, handleSignal);
+        std::signal(SIGTERM, handleSignal);
+        return sync.runDaemon(stopRequested);
+    }
+    return sync.run();
+} catch (std::exception &err) {
+    std::cerr << "std::exception: " << err.what() << std::endl;
+    return 1;
+}
@@ -1,9 +1,223 @@
-#include <fstream>
-#include <iostream>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <random>
+#include <thread>
 
 #include <fmt/core.h>
 
 #include "http.h"
+#include "json_arena.h"
 #include "mangadex.h"
 
-//Unimplemented
+namespace mangadex {
+
+namespace {
+
+constexpr int maxAttempts = 5;
+constexpr auto baseBackoff = std::chrono::milliseconds(250);
+
+// Responses are parsed into the thread's JSON arena, which is thrown away
+// as soon as we've copied out the fields we want, see JsonArena
+using core::ArenaJson;
+using core::toString;
+
+// MangaDex sends null for missing optional strings
+auto stringOrEmpty(ArenaJson const &object, std::string_view key) -> std::string {
+    auto it = object.find(key);
+    if (it == object.end() || !it->is_string()) {
+        return {};
+    }
+    return toString(*it);
+}
+
+auto uuid(ArenaJson const &json) -> core::Uuid {
+    return core::Uuid::fromString(json.get_ref<core::ArenaString const &>());
+}
+
+auto stringList(ArenaJson const &array) -> std::vector<std::string> {
+    std::vector<std::string> strings;
+    strings.reserve(array.size());
+    for (auto const &value : array) {
+        strings.push_back(toString(value));
+    }
+    return strings;
+}
+
+void checkResult(ArenaJson const &json) {
+    if (stringOrEmpty(json, "result") != "ok") {
+        throw Error(200, fmt::format("MangaDex returned result '{}'", stringOrEmpty(json, "result")));
+    }
+}
+
+// Exponential backoff, with "full jitter" so a bunch of threads that failed
+// together don't all come back at exactly the same time
+auto backoff(int attempt) -> std::chrono::milliseconds {
+    thread_local std::mt19937 rng(std::random_device{}());
+    auto ceiling = baseBackoff.count() << attempt;
+    return std::chrono::milliseconds(std::uniform_int_distribution<long long>(0, ceiling)(rng));
+}
+
+// How long MangaDex wants us to wait after a 429
+auto retryAfter(http::Response const &response) -> std::chrono::steady_clock::duration {
+    auto parse = [](std::string_view value) -> long long {
+        long long number = 0;
+        std::from_chars(value.data(), value.data() + value.size(), number);
+        return number;
+    };
+
+    // Unix timestamp of when we are allowed back
+    if (auto header = response.header("x-ratelimit-retry-after")) {
+        auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        return std::chrono::seconds(std::max(parse(*header) - now, 1LL));
+    }
+
+    // Standard HTTP, number of seconds to wait
+    if (auto header = response.header("retry-after")) {
+        return std::chrono::seconds(std::max(parse(*header), 1LL));
+    }
+
+    return std::chrono::seconds(1);
+}
+
+} // namespace
+
+Error::Error(long httpStatus, std::string const &message) : std::runtime_error(message),
+                                                            status(httpStatus) {}
+
+auto AtHomeServer::pageUrl(std::size_t index, bool dataSaverQuality) const -> std::string {
+    auto const &files = dataSaverQuality ? dataSaver : data;
+    return fmt::format("{}/{}/{}/{}", baseUrl, dataSaverQuality ? "data-saver" : "data", hash, files.at(index));
+}
+
+auto parseFeed(std::string_view body) -> Feed {
+    core::JsonArenaScope scope(core::JsonArena::forThread());
+    auto json = ArenaJson::parse(body);
+    checkResult(json);
+
+    Feed feed;
+    feed.limit = json.at("limit").get<std::uint64_t>();
+    feed.offset = json.at("offset").get<std::uint64_t>();
+    feed.total = json.at("total").get<std::uint64_t>();
+
+    auto const &data = json.at("data");
+    feed.chapters.reserve(data.size());
+
+    for (auto const &entry : data) {
+        auto const &attributes = entry.at("attributes");
+
+        Chapter chapter;
+        chapter.id = uuid(entry.at("id"));
+        chapter.volume = stringOrEmpty(attributes, "volume");
+        chapter.chapter = stringOrEmpty(attributes, "chapter");
+        chapter.title = stringOrEmpty(attributes, "title");
+        chapter.translatedLanguage = stringOrEmpty(attributes, "translatedLanguage");
+        chapter.publishAt = stringOrEmpty(attributes, "publishAt");
+        chapter.pages = attributes.value("pages", 0U);
+
+        for (auto const &relationship : entry.at("relationships")) {
+            auto const &type = relationship.at("type");
+            if (type == "manga") {
+                chapter.mangaId = uuid(relationship.at("id"));
+            } else if (type == "scanlation_group") {
+                chapter.scanlationGroups.push_back(uuid(relationship.at("id")));
+            }
+        }
+
+        feed.chapters.push_back(std::move(chapter));
+    }
+
+    return feed;
+}
+
+auto parseAtHomeServer(std::string_view body) -> AtHomeServer {
+    core::JsonArenaScope scope(core::JsonArena::forThread());
+    auto json = ArenaJson::parse(body);
+    checkResult(json);
+
+    auto const &chapter = json.at("chapter");
+    return AtHomeServer{
+        .baseUrl = toString(json.at("baseUrl")),
+        .hash = toString(chapter.at("hash")),
+        .data = stringList(chapter.at("data")),
+        .dataSaver = stringList(chapter.at("dataSaver")),
+    };
+}
+
+Client::Client(std::string apiBaseUrl, core::MemoryBudget *budget) : baseUrl(std::move(apiBaseUrl)),
+                                                                     memoryBudget(budget),
+                                                                     // MangaDex asks for a real user agent
+                                                                     session("manga-manager (https://github.com/HackingPheasant/manga-manager)") {}
+
+auto Client::get(std::string const &url, std::initializer_list<core::RateLimiter *> limiters) -> http::Response {
+    for (int attempt = 0;; attempt++) {
+        for (auto *limiter : limiters) {
+            limiter->acquire();
+        }
+
+        try {
+            auto response = session.get(url, memoryBudget);
+
+            if (response.status == 429) {
+                // Everyone sharing these limiters needs to back off, not just
+                // us. Without any (e.g. page downloads) at least we do, rather
+                // then asking again straight away
+                auto wait = retryAfter(response);
+                for (auto *limiter : limiters) {
+                    limiter->pauseUntil(std::chrono::steady_clock::now() + wait);
+                }
+                if (attempt + 1 < maxAttempts) {
+                    if (limiters.size() == 0) {
+                        std::this_thread::sleep_for(wait);
+                    }
+                    continue;
+                }
+            } else if (response.status >= 500 && attempt + 1 < maxAttempts) {
+                std::this_thread::sleep_for(backoff(attempt));
+                continue;
+            }
+
+            if (response.status != 200) {
+                throw Error(response.status, fmt::format("GET {} returned HTTP {}", url, response.status));
+            }
+
+            return response;
+        } catch (http::Error const &) {
+            // Connection level failure (reset, timeout, etc), worth retrying
+            if (attempt + 1 >= maxAttempts) {
+                throw;
+            }
+            std::this_thread::sleep_for(backoff(attempt));
+        }
+    }
+}
+
+auto Client::feed(core::Uuid mangaId, std::uint64_t offset, std::vector<std::string> const &languages, std::string_view publishedSince) -> Feed {
+    http::Query query = {
+        {"limit", std::to_string(feedLimit)},
+        {"offset", std::to_string(offset)},
+        {"order[volume]", "asc"},
+        {"order[chapter]", "asc"},
+    };
+    for (auto const &language : languages) {
+        query.emplace_back("translatedLanguage[]", language);
+    }
+    if (!publishedSince.empty()) {
+        query.emplace_back("publishAtSince", std::string(publishedSince));
+    }
+
+    auto response = get(http::buildUrl(baseUrl, fmt::format("/manga/{}/feed", mangaId), query), {&apiLimiter});
+    return parseFeed(response.body);
+}
+
+auto Client::atHomeServer(core::Uuid chapterId) -> AtHomeServer {
+    // The at-home endpoint counts against both limits, retries included
+    auto response = get(http::buildUrl(baseUrl, fmt::format("/at-home/server/{}", chapterId)), {&apiLimiter, &atHomeLimiter});
+    return parseAtHomeServer(response.body);
+}
+
+auto Client::page(AtHomeServer const &server, std::size_t index, bool dataSaverQuality) -> http::Response {
+    return get(server.pageUrl(index, dataSaverQuality), {});
+}
+
+} // namespace mangadex
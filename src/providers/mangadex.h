@@ -1,6 +1,102 @@
 #ifndef INCLUDE_MANGADEX_H
 #define INCLUDE_MANGADEX_H
 
-// Unimplemented
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http.h"
+#include "memory_budget.h"
+#include "rate_limiter.h"
+#include "uuid.h"
+
+// MangaDex API (v5)
+// https://api.mangadex.org/docs/
+namespace mangadex {
+
+inline constexpr std::string_view apiUrl = "https://api.mangadex.org";
+// Largest page /manga/{id}/feed will hand out
+inline constexpr std::uint64_t feedLimit = 500;
+
+struct Chapter {
+    core::Uuid id;
+    core::Uuid mangaId;
+    // Usually just the one, but joint releases list every group involved
+    std::vector<core::Uuid> scanlationGroups;
+    // Volume, chapter and title are all optional on MangaDex, they are left
+    // empty when missing. Chapter "numbers" can also be things like "10.5"
+    std::string volume;
+    std::string chapter;
+    std::string title;
+    std::string translatedLanguage;
+    std::string publishAt;
+    std::uint32_t pages = 0;
+};
+
+// One page of a /manga/{id}/feed response
+struct Feed {
+    std::vector<Chapter> chapters;
+    std::uint64_t limit = 0;
+    std::uint64_t offset = 0;
+    std::uint64_t total = 0;
+};
+
+// Where to download a chapters pages from
+// https://api.mangadex.org/docs/04-chapter/retrieving-chapter/
+struct AtHomeServer {
+    std::string baseUrl;
+    std::string hash;
+    std::vector<std::string> data;
+    std::vector<std::string> dataSaver;
+
+    [[nodiscard]] auto pageUrl(std::size_t, bool dataSaverQuality = false) const -> std::string;
+};
+
+// The API answered, but with an error (e.g. a 404 for an unknown id)
+class Error : public std::runtime_error {
+  public:
+    Error(long, std::string const &);
+    long status;
+};
+
+auto parseFeed(std::string_view) -> Feed;
+auto parseAtHomeServer(std::string_view) -> AtHomeServer;
+
+// Thread safe MangaDex client.
+// All requests share one set of connections and respect MangaDex's rate
+// limits across every thread using the client. Rate limited (429) and
+// failed requests are retried with backoff.
+// Response bodies are reserved against the memory budget, when given one.
+class Client {
+  public:
+    explicit Client(std::string baseUrl = std::string(apiUrl), core::MemoryBudget *budget = nullptr);
+
+    // publishedSince (e.g. "2023-01-31T12:00:00", UTC) only asks for chapters
+    // published since then, for cheaply checking for new chapters
+    auto feed(core::Uuid mangaId, std::uint64_t offset, std::vector<std::string> const &languages = {}, std::string_view publishedSince = {}) -> Feed;
+    auto atHomeServer(core::Uuid chapterId) -> AtHomeServer;
+    // Page images come from MangaDex@Home servers, which aren't rate limited.
+    // The image is the response body, which holds on to its share of the
+    // memory budget until the response is destroyed
+    auto page(AtHomeServer const &, std::size_t, bool dataSaverQuality = false) -> http::Response;
+
+  private:
+    const std::string baseUrl;
+    core::MemoryBudget *memoryBudget;
+    http::Session session;
+    // https://api.mangadex.org/docs/2-limitations/#general-rate-limit
+    // ~5 requests per second for the whole API...
+    core::RateLimiter apiLimiter{5.0, 5.0};
+    // ...and 40 requests per minute for /at-home/server
+    core::RateLimiter atHomeLimiter{40.0 / 60.0, 40.0};
+
+    // Every attempt takes a token from each of `limiters` first
+    auto get(std::string const &url, std::initializer_list<core::RateLimiter *> limiters) -> http::Response;
+};
+
+} // namespace mangadex
 
 #endif // INCLUDE_MANGADEX_H
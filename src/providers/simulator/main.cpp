@@ -0,0 +1,141 @@
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <fmt/core.h>
+
+#include "simulator.h"
+
+namespace {
+std::atomic<bool> stopRequested = false;
+
+void handleSignal(int /*signal*/) {
+    stopRequested = true;
+}
+} // namespace
+
+static void show_usage(const std::string &name) {
+    std::cerr << "Usage: " << name << " [options]\n\n"
+              << "Serves a fake MangaDex API and MangaDex@Home image server on loopback.\n\n"
+              << "Options:\n"
+              << "\t-p,--port <port>\t\tPort to listen on, 0 picks a free one (default 8080)\n"
+              << "\t-b,--bind <address>\t\tAddress to bind to (default 127.0.0.1)\n"
+              << "\t-f,--fixtures <dir>\t\tServe recorded responses from <dir>/<path>.json when found\n"
+              << "\t-l,--latency <dist>\t\tResponse latency in ms: fixed:<ms>, uniform:<min>:<max>,\n"
+              << "\t\t\t\t\tnormal:<mean>:<stddev> or lognormal:<mu>:<sigma> (default fixed:0)\n"
+              << "\t--bandwidth <bytes/s>\t\tPer connection bandwidth cap, accepts k/m/g suffixes\n"
+              << "\t--total-bandwidth <bytes/s>\tServer wide bandwidth cap, accepts k/m/g suffixes\n"
+              << "\t--rate-limit <period>:<burst>\tEvery <period> ms answer API requests with 429 for <burst> ms\n"
+              << "\t--reset-rate <0.0-1.0>\t\tChance of a response being cut off by a connection reset\n"
+              << "\t--titles <n>\t\t\tNumber of titles served by /manga (default 1000)\n"
+              << "\t--chapters <n>\t\t\tChapters per title (default 100)\n"
+              << "\t--pages <n>\t\t\tPages per chapter (default 20)\n"
+              << "\t--page-size <bytes>\t\tSize of each page image, accepts k/m/g suffixes (default 512k)\n"
+              << "\t--seed <n>\t\t\tSeed for the generated library and latency\n"
+              << "\t-h,--help\t\t\tShow this help message"
+              << std::endl;
+}
+
+static auto parseSize(std::string_view value) -> std::uint64_t {
+    std::uint64_t multiplier = 1;
+    switch (value.empty() ? '\0' : value.back()) {
+    case 'k':
+    case 'K':
+        multiplier = 1024;
+        break;
+    case 'm':
+    case 'M':
+        multiplier = 1024 * 1024;
+        break;
+    case 'g':
+    case 'G':
+        multiplier = 1024 * 1024 * 1024;
+        break;
+    default:
+        break;
+    }
+
+    if (multiplier != 1) {
+        value.remove_suffix(1);
+    }
+
+    return std::stoull(std::string(value)) * multiplier;
+}
+
+auto main(int argc, const char **argv) -> int try {
+    simulator::Options options;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+
+        auto value = [&]() -> std::string_view {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(fmt::format("{} requires a value", arg));
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            show_usage(argv[0]);
+            return 0;
+        } else if (arg == "-p" || arg == "--port") {
+            options.port = static_cast<std::uint16_t>(std::stoul(std::string(value())));
+        } else if (arg == "-b" || arg == "--bind") {
+            options.bindAddress = value();
+        } else if (arg == "-f" || arg == "--fixtures") {
+            options.fixturesDirectory = value();
+        } else if (arg == "-l" || arg == "--latency") {
+            options.latency = simulator::LatencyDistribution::parse(value());
+        } else if (arg == "--bandwidth") {
+            options.connectionBandwidth = parseSize(value());
+        } else if (arg == "--total-bandwidth") {
+            options.totalBandwidth = parseSize(value());
+        } else if (arg == "--rate-limit") {
+            auto spec = value();
+            auto colon = spec.find(':');
+            if (colon == std::string_view::npos) {
+                throw std::invalid_argument("--rate-limit expects <period>:<burst>");
+            }
+            options.rateLimitPeriod = std::chrono::milliseconds(std::stoll(std::string(spec.substr(0, colon))));
+            options.rateLimitBurst = std::chrono::milliseconds(std::stoll(std::string(spec.substr(colon + 1))));
+        } else if (arg == "--reset-rate") {
+            options.resetProbability = std::stod(std::string(value()));
+        } else if (arg == "--titles") {
+            options.titles = static_cast<std::uint32_t>(std::stoul(std::string(value())));
+        } else if (arg == "--chapters") {
+            options.chaptersPerTitle = static_cast<std::uint32_t>(std::stoul(std::string(value())));
+        } else if (arg == "--pages") {
+            options.pagesPerChapter = static_cast<std::uint32_t>(std::stoul(std::string(value())));
+        } else if (arg == "--page-size") {
+            options.pageSize = parseSize(value());
+        } else if (arg == "--seed") {
+            options.seed = std::stoull(std::string(value()));
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n\n";
+            show_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+
+    simulator::Server server(options);
+    fmt::print("MangaDex simulator listening on http://{}:{}\n", options.bindAddress, server.port());
+    std::fflush(stdout);
+
+    server.run(stopRequested);
+
+    auto const &stats = server.statistics();
+    fmt::print("\nConnections : {}\nRequests    : {}\nRate limited: {}\nResets      : {}\nNot found   : {}\nBytes sent  : {}\n",
+        stats.connections.load(), stats.requests.load(), stats.rateLimited.load(),
+        stats.resets.load(), stats.notFound.load(), stats.bytesSent.load());
+
+    return 0;
+} catch (std::exception &err) {
+    std::cerr << "std::exception: " << err.what() << std::endl;
+    return 1;
+}
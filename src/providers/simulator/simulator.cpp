@@ -0,0 +1,758 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+#include <nlohmann/json.hpp>
+
+#include "simulator.h"
+
+namespace simulator {
+
+namespace {
+
+// Size of each write(), also how often the bandwidth caps get checked
+constexpr std::size_t sendChunkSize = 16 * 1024;
+// Stops a slow (or malicious) client from growing our buffer forever
+constexpr std::size_t maxHeaderSize = 64 * 1024;
+
+// https://prng.di.unimi.it/splitmix64.c
+auto splitmix64(std::uint64_t &state) -> std::uint64_t {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27U)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31U);
+}
+
+// recv() would have blocked, or was interrupted, and is worth trying again.
+// EAGAIN and EWOULDBLOCK are the same value on Linux, and comparing against
+// both trips -Wlogical-op
+auto shouldRetry(int error) -> bool {
+#if EAGAIN != EWOULDBLOCK
+    if (error == EWOULDBLOCK) {
+        return true;
+    }
+#endif
+    return error == EAGAIN || error == EINTR;
+}
+
+// FNV-1a, good enough to turn an id into a seed
+auto fnv1a(std::string_view data) -> std::uint64_t {
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (auto c : data) {
+        hash ^= static_cast<std::uint8_t>(c);
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Deterministic (version 4 looking) UUIDs, so the same id always maps to
+// the same synthetic manga/chapters between runs
+auto makeUuid(std::uint64_t seed, std::uint64_t index) -> std::string {
+    std::uint64_t state = seed ^ (index * 0xD1B54A32D192ED03ULL);
+    auto high = splitmix64(state);
+    auto low = splitmix64(state);
+    high = (high & 0xFFFFFFFFFFFF0FFFULL) | 0x0000000000004000ULL;
+    low = (low & 0x3FFFFFFFFFFFFFFFULL) | 0x8000000000000000ULL;
+    return fmt::format("{:08x}-{:04x}-{:04x}-{:04x}-{:012x}",
+        high >> 32U, (high >> 16U) & 0xFFFFU, high & 0xFFFFU,
+        low >> 48U, low & 0xFFFFFFFFFFFFULL);
+}
+
+auto percentDecode(std::string_view input) -> std::string {
+    std::string output;
+    output.reserve(input.size());
+
+    for (std::size_t i = 0; i < input.size(); i++) {
+        if (input[i] == '%' && i + 2 < input.size()) {
+            unsigned value = 0;
+            auto [ptr, ec] = std::from_chars(input.data() + i + 1, input.data() + i + 3, value, 16);
+            if (ec == std::errc() && ptr == input.data() + i + 3) {
+                output += static_cast<char>(value);
+                i += 2;
+                continue;
+            }
+        }
+        output += input[i] == '+' ? ' ' : input[i];
+    }
+
+    return output;
+}
+
+auto queryNumber(Request const &request, std::string const &key, std::uint64_t fallback) -> std::uint64_t {
+    auto it = request.query.find(key);
+    if (it == request.query.end()) {
+        return fallback;
+    }
+
+    std::uint64_t value = 0;
+    auto [ptr, ec] = std::from_chars(it->second.data(), it->second.data() + it->second.size(), value);
+    return ec == std::errc() ? value : fallback;
+}
+
+// A JSON response in the same shape as MangaDex's error responses
+auto errorResponse(int status, std::string_view detail) -> Response {
+    auto json = nlohmann::json{
+        {"result", "error"},
+        {"errors", nlohmann::json::array({{
+                       {"id", makeUuid(static_cast<std::uint64_t>(status), 0)},
+                       {"status", status},
+                       {"title", statusText(status)},
+                       {"detail", detail},
+                   }})},
+    };
+
+    Response response;
+    response.status = status;
+    response.body = json.dump();
+    return response;
+}
+
+auto timestamp(std::uint64_t daysSinceEpoch) -> std::string {
+    // 2018-01-01 is roughly when MangaDex v5 data starts. Not exact calendar
+    // maths, just something that sorts and parses like the real thing.
+    auto year = 2018 + daysSinceEpoch / 336;
+    auto month = 1 + (daysSinceEpoch / 28) % 12;
+    auto day = 1 + daysSinceEpoch % 28;
+    return fmt::format("{:04}-{:02}-{:02}T12:00:00+00:00", year, month, day);
+}
+
+auto mangaJson(std::string_view id) -> nlohmann::json {
+    auto seed = fnv1a(id);
+    return {
+        {"id", id},
+        {"type", "manga"},
+        {"attributes",
+            {
+                {"title", {{"en", fmt::format("Synthetic Title {:016x}", seed)}}},
+                {"altTitles", nlohmann::json::array()},
+                {"description", {{"en", "Generated by the MangaDex simulator."}}},
+                {"originalLanguage", "ja"},
+                {"status", "ongoing"},
+                {"contentRating", "safe"},
+                {"createdAt", timestamp(seed % 512)},
+                {"updatedAt", timestamp(seed % 512 + 64)},
+                {"version", 1},
+            }},
+        {"relationships", nlohmann::json::array({
+                              {{"id", makeUuid(seed, 0xA0)}, {"type", "author"}},
+                              {{"id", makeUuid(seed, 0xA1)}, {"type", "artist"}},
+                              {{"id", makeUuid(seed, 0xC0)}, {"type", "cover_art"}},
+                          })},
+    };
+}
+
+auto chapterJson(std::string_view mangaId, std::uint64_t index, std::uint32_t pages) -> nlohmann::json {
+    auto seed = fnv1a(mangaId);
+    return {
+        {"id", makeUuid(seed, 0x1000 + index)},
+        {"type", "chapter"},
+        {"attributes",
+            {
+                {"volume", std::to_string(1 + index / 10)},
+                {"chapter", std::to_string(1 + index)},
+                {"title", fmt::format("Chapter {}", 1 + index)},
+                {"translatedLanguage", "en"},
+                {"externalUrl", nullptr},
+                {"publishAt", timestamp(seed % 512 + index * 7)},
+                {"readableAt", timestamp(seed % 512 + index * 7)},
+                {"createdAt", timestamp(seed % 512 + index * 7)},
+                {"updatedAt", timestamp(seed % 512 + index * 7)},
+                {"pages", pages},
+                {"version", 1},
+            }},
+        {"relationships", nlohmann::json::array({
+                              {{"id", makeUuid(seed, 0xB0 + index % 3)}, {"type", "scanlation_group"}},
+                              {{"id", mangaId}, {"type", "manga"}},
+                              {{"id", makeUuid(seed, 0xD0)}, {"type", "user"}},
+                          })},
+    };
+}
+
+auto makePageImage(std::size_t size) -> std::string {
+    // Starts with a PNG signature so anything sniffing the content is happy,
+    // the rest is just noise (which also stops anything compressing it)
+    std::string image = "\x89PNG\r\n\x1a\n";
+    image.reserve(size);
+
+    std::uint64_t state = size;
+    while (image.size() < size) {
+        auto value = splitmix64(state);
+        for (std::size_t i = 0; i < sizeof(value) && image.size() < size; i++) {
+            image += static_cast<char>((value >> (i * 8)) & 0xFFU);
+        }
+    }
+    image.resize(size);
+
+    return image;
+}
+
+// Write everything, respecting both the connection and the server wide
+// bandwidth caps. Returns false if the client went away.
+auto sendAll(int fd, std::string_view data, TokenBucket &connectionBandwidth, TokenBucket &totalBandwidth, Statistics &stats) -> bool {
+    while (!data.empty()) {
+        auto chunk = std::min(data.size(), sendChunkSize);
+        connectionBandwidth.consume(chunk);
+        totalBandwidth.consume(chunk);
+
+        auto sent = ::send(fd, data.data(), chunk, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        stats.bytesSent += static_cast<std::uint64_t>(sent);
+        data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+
+    return true;
+}
+
+// Closing a socket with a zero linger timeout makes the kernel send a RST
+// instead of the usual FIN, which is what a "connection reset by peer"
+// looks like to the client
+void resetConnection(int fd) {
+    auto lingerOption = linger{.l_onoff = 1, .l_linger = 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lingerOption, sizeof(lingerOption));
+    ::close(fd);
+}
+
+} // namespace
+
+auto LatencyDistribution::parse(std::string_view spec) -> LatencyDistribution {
+    std::vector<std::string_view> parts;
+    for (std::size_t start = 0; start <= spec.size();) {
+        auto end = std::min(spec.find(':', start), spec.size());
+        parts.push_back(spec.substr(start, end - start));
+        start = end + 1;
+    }
+
+    auto number = [&](std::size_t index) {
+        if (index >= parts.size()) {
+            throw std::invalid_argument(fmt::format("Latency '{}' is missing a parameter", spec));
+        }
+        auto text = parts[index];
+        double value = 0.0;
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc() || ptr != text.data() + text.size()) {
+            throw std::invalid_argument(fmt::format("Latency '{}' has a parameter that isn't a number: '{}'", spec, text));
+        }
+        return value;
+    };
+
+    LatencyDistribution distribution;
+    if (parts[0] == "fixed") {
+        distribution = {Kind::Fixed, number(1), 0.0};
+    } else if (parts[0] == "uniform") {
+        distribution = {Kind::Uniform, number(1), number(2)};
+    } else if (parts[0] == "normal") {
+        distribution = {Kind::Normal, number(1), number(2)};
+    } else if (parts[0] == "lognormal") {
+        distribution = {Kind::LogNormal, number(1), number(2)};
+    } else {
+        throw std::invalid_argument(fmt::format("Unknown latency distribution '{}'", parts[0]));
+    }
+
+    return distribution;
+}
+
+auto LatencyDistribution::sample(std::mt19937_64 &rng) const -> std::chrono::microseconds {
+    double milliseconds = 0.0;
+
+    switch (kind) {
+    case Kind::Fixed:
+        milliseconds = a;
+        break;
+    case Kind::Uniform:
+        milliseconds = std::uniform_real_distribution<double>(a, b)(rng);
+        break;
+    case Kind::Normal:
+        milliseconds = std::normal_distribution<double>(a, b)(rng);
+        break;
+    case Kind::LogNormal:
+        milliseconds = std::lognormal_distribution<double>(a, b)(rng);
+        break;
+    }
+
+    return std::chrono::microseconds(static_cast<std::int64_t>(std::max(milliseconds, 0.0) * 1000.0));
+}
+
+TokenBucket::TokenBucket(std::uint64_t bytesPerSecond) : rate(bytesPerSecond),
+                                                         tokens(static_cast<double>(bytesPerSecond)),
+                                                         last(std::chrono::steady_clock::now()) {}
+
+void TokenBucket::consume(std::size_t bytes) {
+    if (rate == 0) {
+        return;
+    }
+
+    std::chrono::duration<double> wait{0.0};
+    {
+        std::lock_guard lock(mutex);
+        auto now = std::chrono::steady_clock::now();
+        // Refill, but never hold more then a seconds worth of tokens so
+        // an idle connection can't burst way over the cap
+        tokens = std::min(static_cast<double>(rate),
+            tokens + std::chrono::duration<double>(now - last).count() * static_cast<double>(rate));
+        last = now;
+
+        // Going into debt is fine, the sleep below pays it back
+        tokens -= static_cast<double>(bytes);
+        if (tokens < 0.0) {
+            wait = std::chrono::duration<double>(-tokens / static_cast<double>(rate));
+        }
+    }
+
+    if (wait.count() > 0.0) {
+        std::this_thread::sleep_for(wait);
+    }
+}
+
+auto parseRequest(std::string_view head) -> Request {
+    Request request;
+
+    auto lineEnd = head.find("\r\n");
+    auto requestLine = head.substr(0, lineEnd);
+
+    // METHOD SP TARGET SP VERSION
+    auto methodEnd = requestLine.find(' ');
+    auto targetEnd = requestLine.rfind(' ');
+    if (methodEnd == std::string_view::npos || targetEnd == methodEnd) {
+        throw std::invalid_argument("Malformed request line");
+    }
+
+    request.method = requestLine.substr(0, methodEnd);
+    auto target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    auto version = requestLine.substr(targetEnd + 1);
+    request.keepAlive = (version == "HTTP/1.1");
+
+    auto queryStart = target.find('?');
+    request.path = percentDecode(target.substr(0, queryStart));
+    if (queryStart != std::string_view::npos) {
+        auto query = target.substr(queryStart + 1);
+        while (!query.empty()) {
+            auto pairEnd = std::min(query.find('&'), query.size());
+            auto pair = query.substr(0, pairEnd);
+            auto equals = pair.find('=');
+            if (equals == std::string_view::npos) {
+                request.query.emplace(percentDecode(pair), "");
+            } else {
+                request.query.emplace(percentDecode(pair.substr(0, equals)), percentDecode(pair.substr(equals + 1)));
+            }
+            query.remove_prefix(std::min(pairEnd + 1, query.size()));
+        }
+    }
+
+    // We only care about the Connection header
+    while (lineEnd != std::string_view::npos) {
+        auto start = lineEnd + 2;
+        lineEnd = head.find("\r\n", start);
+        auto line = head.substr(start, lineEnd == std::string_view::npos ? std::string_view::npos : lineEnd - start);
+
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+
+        std::string name(line.substr(0, colon));
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (name != "connection") {
+            continue;
+        }
+
+        std::string value(line.substr(colon + 1));
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (value.find("close") != std::string::npos) {
+            request.keepAlive = false;
+        } else if (value.find("keep-alive") != std::string::npos) {
+            request.keepAlive = true;
+        }
+    }
+
+    return request;
+}
+
+auto statusText(int status) -> std::string_view {
+    switch (status) {
+    case 200:
+        return "OK";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 429:
+        return "Too Many Requests";
+    default:
+        return "Internal Server Error";
+    }
+}
+
+Server::Server(Options serverOptions) : options(std::move(serverOptions)),
+                                        startTime(std::chrono::steady_clock::now()),
+                                        pageImage(makePageImage(options.pageSize)),
+                                        dataSaverPageImage(makePageImage(std::max<std::size_t>(options.pageSize / 4, 8))),
+                                        totalBandwidth(options.totalBandwidth) {
+    listenSocket = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenSocket < 0) {
+        throw std::runtime_error("Unable to create socket");
+    }
+
+    int enable = 1;
+    ::setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    if (::inet_pton(AF_INET, options.bindAddress.c_str(), &address.sin_addr) != 1) {
+        ::close(listenSocket);
+        throw std::invalid_argument("Invalid bind address: " + options.bindAddress);
+    }
+
+    if (::bind(listenSocket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(listenSocket, SOMAXCONN) != 0) {
+        ::close(listenSocket);
+        throw std::runtime_error(fmt::format("Unable to listen on {}:{}", options.bindAddress, options.port));
+    }
+
+    socklen_t length = sizeof(address);
+    ::getsockname(listenSocket, reinterpret_cast<sockaddr *>(&address), &length);
+    boundPort = ntohs(address.sin_port);
+    baseUrl = fmt::format("http://{}:{}", options.bindAddress, boundPort);
+}
+
+Server::~Server() {
+    stopping = true;
+
+    // Connections poll the stopping flag, wait for them to finish up before
+    // we pull the rest of the server out from underneath them
+    std::unique_lock lock(connectionMutex);
+    connectionsDone.wait(lock, [this] { return activeConnections == 0; });
+
+    ::close(listenSocket);
+}
+
+auto Server::port() const -> std::uint16_t {
+    return boundPort;
+}
+
+auto Server::statistics() const -> Statistics const & {
+    return stats;
+}
+
+void Server::run(std::atomic<bool> const &stop) {
+    std::uint64_t connectionId = 0;
+
+    while (!stop) {
+        // Don't block forever in accept(), so we notice being told to stop
+        auto pollFd = pollfd{.fd = listenSocket, .events = POLLIN, .revents = 0};
+        if (::poll(&pollFd, 1, 250) <= 0) {
+            continue;
+        }
+
+        int client = ::accept4(listenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+
+        int enable = 1;
+        ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        // So idle keep-alive connections still notice we are stopping
+        auto timeout = timeval{.tv_sec = 0, .tv_usec = 250000};
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        {
+            std::lock_guard lock(connectionMutex);
+            activeConnections++;
+        }
+        stats.connections++;
+
+        // One thread per connection, simple and more then enough for loopback
+        std::thread([this, client, id = connectionId++] {
+            serveConnection(client, id);
+
+            std::lock_guard lock(connectionMutex);
+            if (--activeConnections == 0) {
+                connectionsDone.notify_all();
+            }
+        }).detach();
+    }
+
+    stopping = true;
+}
+
+void Server::serveConnection(int fd, std::uint64_t connectionId) {
+    std::mt19937_64 rng(options.seed ^ (connectionId * 0x9E3779B97F4A7C15ULL));
+    std::bernoulli_distribution shouldReset(options.resetProbability);
+    TokenBucket connectionBandwidth(options.connectionBandwidth);
+    std::string buffer;
+    std::array<char, 4096> readBuffer{};
+
+    while (!stopping) {
+        auto headerEnd = buffer.find("\r\n\r\n");
+        if (headerEnd == std::string::npos) {
+            if (buffer.size() > maxHeaderSize) {
+                break;
+            }
+
+            auto received = ::recv(fd, readBuffer.data(), readBuffer.size(), 0);
+            if (received < 0 && shouldRetry(errno)) {
+                continue;
+            }
+            if (received <= 0) {
+                break;
+            }
+
+            buffer.append(readBuffer.data(), static_cast<std::size_t>(received));
+            continue;
+        }
+
+        Response response;
+        Request request;
+        try {
+            request = parseRequest(std::string_view(buffer).substr(0, headerEnd));
+            response = route(request);
+        } catch (std::exception const &err) {
+            request.keepAlive = false;
+            response = errorResponse(400, err.what());
+        }
+        // Everything we serve is a GET, so there is never a body to skip
+        buffer.erase(0, headerEnd + 4);
+        stats.requests++;
+
+        std::this_thread::sleep_for(options.latency.sample(rng));
+
+        auto payload = response.payload();
+        std::string head = fmt::format("HTTP/1.1 {} {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: {}\r\n",
+            response.status, statusText(response.status), response.contentType, payload.size(),
+            request.keepAlive ? "keep-alive" : "close");
+        for (auto const &[name, value] : response.headers) {
+            head += fmt::format("{}: {}\r\n", name, value);
+        }
+        head += "\r\n";
+
+        if (options.resetProbability > 0.0 && shouldReset(rng)) {
+            // Get part way through the response then reset
+            sendAll(fd, head, connectionBandwidth, totalBandwidth, stats);
+            sendAll(fd, payload.substr(0, payload.size() / 2), connectionBandwidth, totalBandwidth, stats);
+            stats.resets++;
+            resetConnection(fd);
+            return;
+        }
+
+        if (!sendAll(fd, head, connectionBandwidth, totalBandwidth, stats) ||
+            (request.method != "HEAD" && !sendAll(fd, payload, connectionBandwidth, totalBandwidth, stats))) {
+            break;
+        }
+
+        if (!request.keepAlive) {
+            break;
+        }
+    }
+
+    ::close(fd);
+}
+
+auto Server::isRateLimited() const -> bool {
+    if (options.rateLimitPeriod.count() <= 0 || options.rateLimitBurst.count() <= 0) {
+        return false;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+    return elapsed % options.rateLimitPeriod < options.rateLimitBurst;
+}
+
+auto Server::loadFixture(std::string_view path) const -> std::optional<std::string> {
+    if (options.fixturesDirectory.empty() || path.find("..") != std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    auto file = options.fixturesDirectory / (std::string(path.substr(1)) + ".json");
+    std::ifstream inf{file, std::ios::binary};
+    if (!inf) {
+        return std::nullopt;
+    }
+
+    return std::string(std::istreambuf_iterator<char>(inf), std::istreambuf_iterator<char>());
+}
+
+auto Server::route(Request const &request) -> Response {
+    if (request.method != "GET" && request.method != "HEAD") {
+        return errorResponse(405, "Only GET is supported by the simulator");
+    }
+
+    std::vector<std::string_view> segments;
+    for (std::string_view path = request.path; !path.empty();) {
+        auto end = std::min(path.find('/'), path.size());
+        if (end != 0) {
+            segments.push_back(path.substr(0, end));
+        }
+        path.remove_prefix(std::min(end + 1, path.size()));
+    }
+
+    // MangaDex@Home image server, never rate limited
+    if (segments.size() == 3 && (segments[0] == "data" || segments[0] == "data-saver")) {
+        Response response;
+        response.contentType = "image/png";
+        response.sharedBody = segments[0] == "data" ? pageImage : dataSaverPageImage;
+        return response;
+    }
+
+    if (isRateLimited()) {
+        stats.rateLimited++;
+        auto response = errorResponse(429, "You have been rate limited (simulated)");
+        auto burstLeft = std::chrono::duration_cast<std::chrono::seconds>(options.rateLimitBurst).count() + 1;
+        auto retryAt = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+                           .count() +
+                       burstLeft;
+        response.headers["Retry-After"] = std::to_string(burstLeft);
+        response.headers["X-RateLimit-Limit"] = "5";
+        response.headers["X-RateLimit-Remaining"] = "0";
+        response.headers["X-RateLimit-Retry-After"] = std::to_string(retryAt);
+        return response;
+    }
+
+    if (auto fixture = loadFixture(request.path)) {
+        Response response;
+        response.body = std::move(*fixture);
+        return response;
+    }
+
+    if (segments.size() == 1 && segments[0] == "manga") {
+        return mangaList(request);
+    }
+    if (segments.size() == 2 && segments[0] == "manga") {
+        return manga(segments[1]);
+    }
+    if (segments.size() == 3 && segments[0] == "manga" && segments[2] == "feed") {
+        return mangaFeed(segments[1], request);
+    }
+    if (segments.size() == 3 && segments[0] == "at-home" && segments[1] == "server") {
+        return atHomeServer(segments[2]);
+    }
+
+    stats.notFound++;
+    return errorResponse(404, fmt::format("No route for {}", request.path));
+}
+
+auto Server::mangaList(Request const &request) const -> Response {
+    auto limit = std::min<std::uint64_t>(queryNumber(request, "limit", 10), 100);
+    auto offset = queryNumber(request, "offset", 0);
+
+    auto data = nlohmann::json::array();
+    std::uint64_t total = options.titles;
+
+    auto [idsBegin, idsEnd] = request.query.equal_range("ids[]");
+    if (idsBegin != idsEnd) {
+        // Looking up specific titles
+        total = static_cast<std::uint64_t>(std::distance(idsBegin, idsEnd));
+        for (auto it = idsBegin; it != idsEnd; it++) {
+            data.push_back(mangaJson(it->second));
+        }
+    } else {
+        for (auto i = offset; i < std::min<std::uint64_t>(offset + limit, total); i++) {
+            data.push_back(mangaJson(makeUuid(options.seed, i)));
+        }
+    }
+
+    Response response;
+    response.body = nlohmann::json{
+        {"result", "ok"},
+        {"response", "collection"},
+        {"data", std::move(data)},
+        {"limit", limit},
+        {"offset", offset},
+        {"total", total},
+    }
+                        .dump();
+    return response;
+}
+
+auto Server::manga(std::string_view id) const -> Response {
+    Response response;
+    response.body = nlohmann::json{
+        {"result", "ok"},
+        {"response", "entity"},
+        {"data", mangaJson(id)},
+    }
+                        .dump();
+    return response;
+}
+
+auto Server::mangaFeed(std::string_view id, Request const &request) const -> Response {
+    auto limit = std::min<std::uint64_t>(queryNumber(request, "limit", 100), 500);
+    auto offset = queryNumber(request, "offset", 0);
+    std::uint64_t total = options.chaptersPerTitle;
+
+    auto data = nlohmann::json::array();
+    for (auto i = offset; i < std::min(offset + limit, total); i++) {
+        data.push_back(chapterJson(id, i, options.pagesPerChapter));
+    }
+
+    Response response;
+    response.body = nlohmann::json{
+        {"result", "ok"},
+        {"response", "collection"},
+        {"data", std::move(data)},
+        {"limit", limit},
+        {"offset", offset},
+        {"total", total},
+    }
+                        .dump();
+    return response;
+}
+
+auto Server::atHomeServer(std::string_view chapterId) const -> Response {
+    auto seed = fnv1a(chapterId);
+
+    auto data = nlohmann::json::array();
+    auto dataSaver = nlohmann::json::array();
+    for (std::uint32_t page = 0; page < options.pagesPerChapter; page++) {
+        // One at a time, the order function arguments are evaluated in is
+        // up to the compiler
+        std::uint64_t state = seed + page;
+        auto first = splitmix64(state);
+        auto second = splitmix64(state);
+        auto third = splitmix64(state);
+        auto fourth = splitmix64(state);
+        auto pageHash = fmt::format("{:016x}{:016x}{:016x}{:016x}", first, second, third, fourth);
+        data.push_back(fmt::format("{}-{}.png", page + 1, pageHash));
+        dataSaver.push_back(fmt::format("{}-{}.jpg", page + 1, pageHash));
+    }
+
+    Response response;
+    response.body = nlohmann::json{
+        {"result", "ok"},
+        // Point the client back at ourselves for the images
+        {"baseUrl", baseUrl},
+        {"chapter",
+            {
+                {"hash", fmt::format("{:016x}{:016x}", seed, ~seed)},
+                {"data", std::move(data)},
+                {"dataSaver", std::move(dataSaver)},
+            }},
+    }
+                        .dump();
+    return response;
+}
+
+} // namespace simulator
@@ -0,0 +1,170 @@
+#ifndef PROVIDERS_SIMULATOR_H
+#define PROVIDERS_SIMULATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+
+// A loopback stand-in for the MangaDex API and its MangaDex@Home image
+// servers, so the download pipeline can be load tested on a single machine
+// without hammering the real thing.
+//
+// Serves (either from recorded responses or generated on the fly):
+// - /manga
+// - /manga/{id}
+// - /manga/{id}/feed
+// - /at-home/server/{chapterId}
+// - /data/{hash}/{file} and /data-saver/{hash}/{file}
+//
+// And can misbehave on purpose, with configurable latency, bandwidth caps,
+// bursts of 429 (Too Many Requests) responses and connection resets.
+namespace simulator {
+
+// How long the server waits before it starts answering a request.
+// Parsed from strings such as:
+// - "fixed:50"          Always 50ms
+// - "uniform:20:80"     Anywhere between 20ms and 80ms
+// - "normal:50:10"      Mean of 50ms with a standard deviation of 10ms
+// - "lognormal:3.9:0.5" Log-normal with mu = 3.9 and sigma = 0.5 (in ms),
+//                       which is closest to what real world latency looks like
+struct LatencyDistribution {
+    enum class Kind {
+        Fixed,
+        Uniform,
+        Normal,
+        LogNormal
+    };
+
+    Kind kind = Kind::Fixed;
+    double a = 0.0;
+    double b = 0.0;
+
+    static auto parse(std::string_view) -> LatencyDistribution;
+    auto sample(std::mt19937_64 &) const -> std::chrono::microseconds;
+};
+
+// Blocks callers so that on average no more then `rate` bytes per second
+// get through. A rate of 0 means unlimited.
+class TokenBucket {
+  public:
+    explicit TokenBucket(std::uint64_t);
+    void consume(std::size_t);
+
+  private:
+    std::mutex mutex;
+    const std::uint64_t rate;
+    double tokens;
+    std::chrono::steady_clock::time_point last;
+};
+
+struct Options {
+    std::string bindAddress = "127.0.0.1";
+    std::uint16_t port = 8080;
+    // Recorded responses, e.g. <fixtures>/manga/{id}/feed.json is served for
+    // /manga/{id}/feed. Anything not found is generated instead.
+    std::filesystem::path fixturesDirectory;
+
+    LatencyDistribution latency;
+    // Bytes per second, 0 means unlimited
+    std::uint64_t connectionBandwidth = 0;
+    std::uint64_t totalBandwidth = 0;
+    // Every `rateLimitPeriod` all API requests are answered with a 429 for
+    // `rateLimitBurst`. Image requests are never rate limited.
+    std::chrono::milliseconds rateLimitPeriod{0};
+    std::chrono::milliseconds rateLimitBurst{0};
+    // Chance (0.0 - 1.0) of a response being cut off half way with a reset
+    double resetProbability = 0.0;
+
+    // Shape of the generated library
+    std::uint32_t titles = 1000;
+    std::uint32_t chaptersPerTitle = 100;
+    std::uint32_t pagesPerChapter = 20;
+    std::size_t pageSize = 512 * 1024;
+    std::uint64_t seed = 0;
+};
+
+struct Request {
+    std::string method;
+    std::string path;
+    std::multimap<std::string, std::string> query;
+    bool keepAlive = true;
+};
+
+struct Response {
+    int status = 200;
+    std::string contentType = "application/json";
+    std::map<std::string, std::string> headers;
+    // Either a generated body, or a view of a long lived one (page images)
+    std::string body;
+    std::string_view sharedBody;
+
+    [[nodiscard]] auto payload() const -> std::string_view {
+        return sharedBody.empty() ? std::string_view(body) : sharedBody;
+    }
+};
+
+struct Statistics {
+    std::atomic<std::uint64_t> connections = 0;
+    std::atomic<std::uint64_t> requests = 0;
+    std::atomic<std::uint64_t> rateLimited = 0;
+    std::atomic<std::uint64_t> resets = 0;
+    std::atomic<std::uint64_t> notFound = 0;
+    std::atomic<std::uint64_t> bytesSent = 0;
+};
+
+class Server {
+  public:
+    explicit Server(Options);
+    ~Server();
+    Server(Server const &) = delete;
+    auto operator=(Server const &) -> Server & = delete;
+
+    // Port we actually bound to (useful when asking for port 0)
+    [[nodiscard]] auto port() const -> std::uint16_t;
+    [[nodiscard]] auto statistics() const -> Statistics const &;
+    // Accepts connections until `stop` is set
+    void run(std::atomic<bool> const &stop);
+
+  private:
+    const Options options;
+    const std::chrono::steady_clock::time_point startTime;
+    int listenSocket = -1;
+    std::uint16_t boundPort = 0;
+    std::string baseUrl;
+    // Every page image is the same bytes, so just build it once
+    std::string pageImage;
+    std::string dataSaverPageImage;
+
+    TokenBucket totalBandwidth;
+    Statistics stats;
+
+    std::atomic<bool> stopping = false;
+    std::mutex connectionMutex;
+    std::condition_variable connectionsDone;
+    std::uint64_t activeConnections = 0;
+
+    void serveConnection(int, std::uint64_t);
+    auto route(Request const &) -> Response;
+    auto isRateLimited() const -> bool;
+    auto loadFixture(std::string_view) const -> std::optional<std::string>;
+
+    auto mangaList(Request const &) const -> Response;
+    auto manga(std::string_view) const -> Response;
+    auto mangaFeed(std::string_view, Request const &) const -> Response;
+    auto atHomeServer(std::string_view) const -> Response;
+};
+
+auto parseRequest(std::string_view) -> Request;
+auto statusText(int) -> std::string_view;
+
+} // namespace simulator
+
+#endif // PROVIDERS_SIMULATOR_H
@@ -0,0 +1,22 @@
+#version 450
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Every texture we draw, see BindlessTextures
+layout (set = 0, binding = 0) uniform sampler2D textures[];
+
+layout (push_constant) uniform PushConstants
+{
+  layout (offset = 16) uint texture;
+} pushConstants;
+
+layout (location = 0) in vec2 uv;
+layout (location = 1) in vec4 color;
+
+layout (location = 0) out vec4 outColor;
+
+void main()
+{
+  // The same for the whole draw, so unlike quad.frag no nonuniformEXT
+  outColor = texture(textures[pushConstants.texture], uv) * color;
+}
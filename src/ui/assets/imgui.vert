@@ -0,0 +1,26 @@
+#version 450
+
+// ImGui's vertices, ImDrawVert
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec2 uv;
+layout (location = 2) in vec4 color;
+
+// Matches ImGuiRenderer::PushConstants
+layout (push_constant) uniform PushConstants
+{
+  vec2 scale;
+  vec2 translate;
+  uint texture;
+} pushConstants;
+
+layout (location = 0) out vec2 outUv;
+layout (location = 1) out vec4 outColor;
+
+void main()
+{
+  // From ImGui's display coordinates straight to clip space, y already
+  // points down in both
+  gl_Position = vec4(position * pushConstants.scale + pushConstants.translate, 0.0, 1.0);
+  outUv = uv;
+  outColor = color;
+}
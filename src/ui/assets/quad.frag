@@ -0,0 +1,27 @@
+#version 450
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Every texture we draw, see BindlessTextures
+layout (set = 0, binding = 0) uniform sampler2D textures[];
+
+layout (location = 0) in vec2 uv;
+layout (location = 1) in vec4 tint;
+layout (location = 2) flat in uint textureSlot;
+
+layout (location = 0) out vec4 outColor;
+
+// QuadInstance::noTexture, just the tint (e.g. a placeholder for a cover
+// that's still loading)
+const uint noTexture = 0xFFFFFFFFu;
+
+void main()
+{
+  if (textureSlot == noTexture) {
+    outColor = tint;
+  } else {
+    // Neighbouring pixels can belong to different quads, so the index isn't
+    // uniform across the invocations sampling together
+    outColor = texture(textures[nonuniformEXT(textureSlot)], uv) * tint;
+  }
+}
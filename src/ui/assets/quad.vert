@@ -0,0 +1,48 @@
+#version 450
+
+// One quad per instance, with no vertex buffer: the corners come from the
+// vertex index and everything else from the instance's entry in `quads`.
+// Matches QuadInstance in quad_renderer.h
+
+struct Quad {
+  vec4 rect;   // x, y, width, height in pixels, 0, 0 is the top left
+  vec4 uvRect; // u, v, width, height
+  vec4 tint;
+  uint texture;
+  uint pad0;
+  uint pad1;
+  uint pad2;
+};
+
+layout (std430, set = 1, binding = 0) readonly buffer Quads
+{
+  Quad quads[];
+};
+
+layout (push_constant) uniform PushConstants
+{
+  vec2 viewportSize;
+} pushConstants;
+
+layout (location = 0) out vec2 outUv;
+layout (location = 1) out vec4 outTint;
+layout (location = 2) flat out uint outTexture;
+
+// Two clockwise triangles
+const vec2 corners[6] = vec2[](
+  vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(0.0, 1.0),
+  vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0));
+
+void main()
+{
+  Quad quad = quads[gl_InstanceIndex];
+  vec2 corner = corners[gl_VertexIndex];
+
+  vec2 position = quad.rect.xy + corner * quad.rect.zw;
+  // Vulkan's clip space already has y pointing down
+  gl_Position = vec4(position / pushConstants.viewportSize * 2.0 - 1.0, 0.0, 1.0);
+
+  outUv = quad.uvRect.xy + corner * quad.uvRect.zw;
+  outTint = quad.tint;
+  outTexture = quad.texture;
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "bindless_textures.h"
+
+BindlessTextures::BindlessTextures(vk::raii::PhysicalDevice const &physicalDevice, vk::raii::Device const &logicalDevice,
+    std::size_t framesInFlight, std::uint32_t maxTextures) : device(logicalDevice),
+                                                             frames(framesInFlight) {
+    // Combined image samplers count against both the sampler and the sampled
+    // image limits
+    auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+    auto const &limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+    slotCount = std::min({maxTextures,
+        limits.maxDescriptorSetUpdateAfterBindSampledImages,
+        limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        limits.maxDescriptorSetUpdateAfterBindSamplers,
+        limits.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+    vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                                              vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                                              vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+    auto bindingFlagsCreateInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfo{
+        .bindingCount = 1,
+        .pBindingFlags = &bindingFlags};
+
+    auto binding = vk::DescriptorSetLayoutBinding{
+        .binding = 0,
+        .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+        .descriptorCount = slotCount,
+        .stageFlags = vk::ShaderStageFlagBits::eFragment,
+        .pImmutableSamplers = nullptr};
+
+    setLayout = vk::raii::DescriptorSetLayout(device,
+        vk::DescriptorSetLayoutCreateInfo{
+            .pNext = &bindingFlagsCreateInfo,
+            .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+            .bindingCount = 1,
+            .pBindings = &binding});
+
+    auto poolSize = vk::DescriptorPoolSize{
+        .type = vk::DescriptorType::eCombinedImageSampler,
+        .descriptorCount = slotCount};
+
+    pool = vk::raii::DescriptorPool(device,
+        vk::DescriptorPoolCreateInfo{
+            // eFreeDescriptorSet flag needed when using Vulkan RAII Library
+            .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet | vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+            .maxSets = 1,
+            .poolSizeCount = 1,
+            .pPoolSizes = &poolSize});
+
+    vk::raii::DescriptorSets sets(device,
+        vk::DescriptorSetAllocateInfo{
+            .descriptorPool = *pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &(*setLayout)});
+    descriptorSet = std::move(sets.front());
+}
+
+auto BindlessTextures::add(vk::ImageView view, vk::Sampler sampler) -> std::uint32_t {
+    std::uint32_t slot = 0;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else if (next < slotCount) {
+        slot = next++;
+    } else {
+        throw std::length_error("BindlessTextures: every slot is taken");
+    }
+    used++;
+
+    auto imageInfo = vk::DescriptorImageInfo{
+        .sampler = sampler,
+        .imageView = view,
+        .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+
+    device.updateDescriptorSets(
+        vk::WriteDescriptorSet{
+            .dstSet = *descriptorSet,
+            .dstBinding = 0,
+            .dstArrayElement = slot,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .pImageInfo = &imageInfo,
+            .pBufferInfo = nullptr,
+            .pTexelBufferView = nullptr},
+        nullptr);
+    return slot;
+}
+
+void BindlessTextures::remove(std::uint32_t slot) {
+    // The descriptor is left as is, nothing draws with it anymore and it's
+    // overwritten once the slot is handed out again
+    retired.push_back(Retired{slot, frame});
+    used--;
+}
+
+void BindlessTextures::beginFrame() {
+    // Anything removed at least a full ring of frames ago can't be in use
+    frame++;
+    std::erase_if(retired, [this](Retired const &entry) {
+        if (frame - entry.frame <= frames) {
+            return false;
+        }
+        freeSlots.push_back(entry.slot);
+        return true;
+    });
+}
@@ -0,0 +1,66 @@
+#ifndef UI_BINDLESS_TEXTURES_H
+#define UI_BINDLESS_TEXTURES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vulkan_config.h"
+
+// One big descriptor set holding every texture we draw, indexed from the
+// shader.
+//
+// Binding a descriptor set per thumbnail means a bind and a draw call per
+// thumbnail, and a library grid has thousands of them. Instead every texture
+// gets a slot in a single array of combined image samplers, the set is bound
+// once, and each quad just carries its slot number (see QuadRenderer).
+//
+// Uses descriptor indexing: the array is partially bound (empty slots are
+// fine as long as nothing samples them) and can be written while frames
+// using other slots are still in flight.
+//
+// A removed slot isn't reused until every frame in flight that may have
+// drawn it is done, so remove a texture's slot before retiring the texture.
+// Render thread only.
+class BindlessTextures {
+  public:
+    // `maxTextures` is capped at what the device allows
+    BindlessTextures(vk::raii::PhysicalDevice const &, vk::raii::Device const &, std::size_t framesInFlight,
+        std::uint32_t maxTextures = 16384);
+
+    // Returns the slot for the shader to index with. Throws
+    // std::length_error if every slot is taken
+    auto add(vk::ImageView, vk::Sampler) -> std::uint32_t;
+    void remove(std::uint32_t slot);
+    // Once a frame, after waiting on its fence. Recycles slots no frame in
+    // flight can be using anymore
+    void beginFrame();
+
+    [[nodiscard]] auto layout() const -> vk::DescriptorSetLayout { return *setLayout; }
+    [[nodiscard]] auto set() const -> vk::DescriptorSet { return *descriptorSet; }
+    [[nodiscard]] auto capacity() const -> std::uint32_t { return slotCount; }
+    [[nodiscard]] auto size() const -> std::uint32_t { return used; }
+
+  private:
+    struct Retired {
+        std::uint32_t slot;
+        std::uint64_t frame;
+    };
+
+    vk::raii::Device const &device;
+    const std::size_t frames;
+    std::uint32_t slotCount;
+
+    vk::raii::DescriptorSetLayout setLayout = nullptr;
+    vk::raii::DescriptorPool pool = nullptr;
+    vk::raii::DescriptorSet descriptorSet = nullptr;
+
+    // Slots below `next` that are free again, reused before growing
+    std::vector<std::uint32_t> freeSlots;
+    std::uint32_t next = 0;
+    std::uint32_t used = 0;
+    std::vector<Retired> retired;
+    std::uint64_t frame = 0;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "event_loop.h"
+
+EventLoop::EventLoop(AppWindow &appWindow) : window(appWindow), wakeEvent(SDL_RegisterEvents(1)) {
+    if (wakeEvent == std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Could not register an SDL event: " + std::string(SDL_GetError()));
+    }
+}
+
+auto EventLoop::frameDue(Clock::time_point now) const -> bool {
+    if (hidden) {
+        return false;
+    }
+    return dirty || now < animationEnd || (redrawTime && *redrawTime <= now);
+}
+
+void EventLoop::wait() {
+    auto now = Clock::now();
+    if (frameDue(now)) {
+        return;
+    }
+    if (!redrawTime) {
+        SDL_WaitEvent(nullptr);
+        return;
+    }
+    // Rounded up, waking a little late is fine, waking early just means
+    // coming straight back. Before SDL 2.0.16 this polls every few
+    // milliseconds rather then sleeping properly, still cheap enough
+    auto timeout = std::chrono::ceil<std::chrono::milliseconds>(*redrawTime - now).count();
+    SDL_WaitEventTimeout(nullptr, static_cast<int>(std::min<std::int64_t>(timeout, std::numeric_limits<int>::max())));
+}
+
+auto EventLoop::dispatch(Handler const &handler) -> bool {
+    SDL_Event event;
+    while (SDL_PollEvent(&event) != 0) {
+        if (event.type == wakeEvent) {
+            wakePending = false;
+            invalidate();
+            continue;
+        }
+        if (event.type == SDL_QUIT) {
+            active = false;
+        } else if (event.type == SDL_WINDOWEVENT) {
+            windowEvent(event.window);
+        }
+        handler(event);
+    }
+
+    auto now = Clock::now();
+    if (!active || !frameDue(now)) {
+        return false;
+    }
+    if (redrawTime && *redrawTime <= now) {
+        redrawTime.reset();
+    }
+    dirty = false;
+    return true;
+}
+
+void EventLoop::animateUntil(Clock::time_point end) {
+    animationEnd = std::max(animationEnd, end);
+}
+
+void EventLoop::redrawAt(Clock::time_point when) {
+    if (!redrawTime || when < *redrawTime) {
+        redrawTime = when;
+    }
+}
+
+void EventLoop::post() {
+    if (wakePending.exchange(true)) {
+        return;
+    }
+    SDL_Event event{};
+    event.type = wakeEvent;
+    // Thread safe. If the queue is full there's plenty to wake us up already
+    if (SDL_PushEvent(&event) != 1) {
+        wakePending = false;
+    }
+}
+
+void EventLoop::windowEvent(SDL_WindowEvent const &event) {
+    switch (event.event) {
+    case SDL_WINDOWEVENT_HIDDEN:
+    case SDL_WINDOWEVENT_MINIMIZED:
+        hidden = true;
+        break;
+    case SDL_WINDOWEVENT_SHOWN:
+    case SDL_WINDOWEVENT_RESTORED:
+    case SDL_WINDOWEVENT_MAXIMIZED:
+        hidden = false;
+        invalidate();
+        break;
+    // Whatever was there is gone, or the wrong size
+    case SDL_WINDOWEVENT_EXPOSED:
+    case SDL_WINDOWEVENT_SIZE_CHANGED:
+        invalidate();
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef UI_EVENT_LOOP_H
+#define UI_EVENT_LOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+#include "window.h"
+
+// The app's main loop, on top of an AppWindow. A manga reader sits on the
+// same page most of the time, so rather than drawing flat out this blocks in
+// SDL until something happens, and only asks for a frame when something on
+// screen changed or an animation is running. Idle it costs next to no CPU
+// or GPU, and input still gets its frame straight away.
+//
+// Each time round: wait(), then dispatch() whatever woke it up, which says
+// whether to draw a frame. Main thread only, apart from post().
+class EventLoop {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Handler = std::function<void(SDL_Event const &)>;
+
+    explicit EventLoop(AppWindow &);
+
+    // Blocks until there's an event or a timer is due. Returns straight
+    // away if there's already a frame to draw
+    void wait();
+    // Hands every queued event to `handler`, then returns whether there's a
+    // frame to draw. Quitting, and showing, hiding and resizing the window
+    // are dealt with here, but still passed on
+    auto dispatch(Handler const &) -> bool;
+
+    // Something changed and needs drawing. Frames are always drawn whole,
+    // the renderer has no way to redraw just part of the window
+    void invalidate() { dirty = true; }
+    // Draw every frame until then, e.g. for a page turn or kinetic scroll
+    void animateUntil(Clock::time_point);
+    void animateFor(Clock::duration duration) { animateUntil(Clock::now() + duration); }
+    // Draw a frame at `when` even if nothing else happens by then, e.g. to
+    // hide the cursor after a while
+    void redrawAt(Clock::time_point);
+    // Invalidates the whole window from any thread, e.g. a worker that has
+    // just finished loading a texture. Wakes wait() up
+    void post();
+
+    void quit() { active = false; }
+    [[nodiscard]] auto running() const -> bool { return active; }
+
+  private:
+    AppWindow &window;
+    // Our own event type, for post()
+    std::uint32_t wakeEvent;
+    // Only one wake up in the queue at a time however often post() is
+    // called, it invalidates everything anyway
+    std::atomic<bool> wakePending = false;
+
+    bool active = true;
+    // Minimised or hidden, there's nothing to draw to
+    bool hidden = false;
+    bool dirty = true;
+    Clock::time_point animationEnd;
+    std::optional<Clock::time_point> redrawTime;
+
+    [[nodiscard]] auto frameDue(Clock::time_point now) const -> bool;
+    void windowEvent(SDL_WindowEvent const &);
+};
+
+#endif
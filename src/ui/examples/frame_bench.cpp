@@ -0,0 +1,483 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "resampler.h"
+#include "strip_view.h"
+#include "thumbnail_grid.h"
+#include "vulkan_renderer.h"
+
+// Renders representative scenes offscreen and reports frame time
+// percentiles, so rendering can be benchmarked (and screenshotted for
+// regression checks) on machines without a display or a GPU:
+//
+// VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./ui-bench --frames 300
+//
+// Frame time is measured on the CPU from the start of one frame to the
+// start of the next, so it includes waiting on the GPU once it's lapped the
+// frames in flight. GPU time is the timestamps around the frame's commands.
+
+namespace {
+
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+struct Options {
+    std::uint32_t width = 1280;
+    std::uint32_t height = 720;
+    std::size_t frames = 600;
+    // Dropped from the results, the first frames pay for pipeline
+    // compilation, first touches of memory and so on
+    std::size_t warmup = 60;
+    std::string scene = "all";
+    // Writes <prefix>-<scene>.ppm of each scene's last frame if set
+    std::string screenshot;
+    // Render pass and fences even where dynamic rendering is supported, to
+    // compare the two paths
+    bool legacyRendering = false;
+};
+
+// A texture we own, uploaded once
+struct Texture {
+    GpuImage image;
+    vk::raii::ImageView view = nullptr;
+    vk::Extent2D extent;
+};
+
+auto colorRange() -> vk::ImageSubresourceRange {
+    return vk::ImageSubresourceRange{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = 1};
+}
+
+auto uploadTexture(VulkanRender &renderer, vk::Extent2D extent, std::vector<std::uint8_t> const &pixels) -> std::unique_ptr<Texture> {
+    auto const &device = renderer.logicalDevice();
+    auto texture = std::make_unique<Texture>();
+    texture->extent = extent;
+    texture->image = createGpuImage(renderer.gpuAllocator(), device,
+        vk::ImageCreateInfo{
+            .flags = vk::ImageCreateFlags(),
+            .imageType = vk::ImageType::e2D,
+            .format = vk::Format::eR8G8B8A8Srgb,
+            .extent = vk::Extent3D{.width = extent.width, .height = extent.height, .depth = 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = vk::ImageLayout::eUndefined},
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    texture->view = vk::raii::ImageView(device,
+        vk::ImageViewCreateInfo{
+            .flags = vk::ImageViewCreateFlags(),
+            .image = *texture->image.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = vk::Format::eR8G8B8A8Srgb,
+            .components = vk::ComponentMapping(),
+            .subresourceRange = colorRange()});
+
+    auto staging = createGpuBuffer(renderer.gpuAllocator(), device,
+        vk::BufferCreateInfo{
+            .flags = vk::BufferCreateFlags(),
+            .size = pixels.size(),
+            .usage = vk::BufferUsageFlagBits::eTransferSrc,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr},
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    std::memcpy(staging.allocation.mapped(), pixels.data(), pixels.size());
+
+    renderer.submitNow([&](vk::raii::CommandBuffer const &commandBuffer) {
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(),
+            nullptr, nullptr,
+            vk::ImageMemoryBarrier{
+                .srcAccessMask = vk::AccessFlags(),
+                .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .oldLayout = vk::ImageLayout::eUndefined,
+                .newLayout = vk::ImageLayout::eTransferDstOptimal,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = *texture->image.image,
+                .subresourceRange = colorRange()});
+        commandBuffer.copyBufferToImage(*staging.buffer, *texture->image.image, vk::ImageLayout::eTransferDstOptimal,
+            vk::BufferImageCopy{
+                .bufferOffset = 0,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = vk::ImageSubresourceLayers{
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .mipLevel = 0,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1},
+                .imageOffset = vk::Offset3D{.x = 0, .y = 0, .z = 0},
+                .imageExtent = vk::Extent3D{.width = extent.width, .height = extent.height, .depth = 1}});
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(),
+            nullptr, nullptr,
+            vk::ImageMemoryBarrier{
+                .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+                .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+                .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = *texture->image.image,
+                .subresourceRange = colorRange()});
+    });
+    return texture;
+}
+
+// Screentone dots and a gradient, the kind of detail scanned pages have
+auto syntheticPage(vk::Extent2D extent, std::uint8_t seed) -> std::vector<std::uint8_t> {
+    std::vector<std::uint8_t> pixels(std::size_t(extent.width) * extent.height * 4);
+    for (std::uint32_t y = 0; y < extent.height; y++) {
+        for (std::uint32_t x = 0; x < extent.width; x++) {
+            auto *pixel = &pixels[(std::size_t(y) * extent.width + x) * 4];
+            auto tone = ((x / 3 + y / 3 + seed) % 2 == 0) ? 0 : 255;
+            auto value = x < extent.width / 2 ? tone : static_cast<int>(y * 255 / extent.height);
+            pixel[0] = pixel[1] = pixel[2] = static_cast<std::uint8_t>(value);
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+// Some solid colour covers
+auto syntheticCover(vk::Extent2D extent, std::size_t index) -> std::vector<std::uint8_t> {
+    std::vector<std::uint8_t> pixels(std::size_t(extent.width) * extent.height * 4);
+    for (std::size_t i = 0; i < pixels.size(); i += 4) {
+        pixels[i] = static_cast<std::uint8_t>(index * 37);
+        pixels[i + 1] = static_cast<std::uint8_t>(index * 91);
+        pixels[i + 2] = static_cast<std::uint8_t>(index * 53);
+        pixels[i + 3] = 255;
+    }
+    return pixels;
+}
+
+// Nearest rank
+auto percentile(std::vector<Milliseconds> const &sorted, double p) -> double {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    auto rank = static_cast<std::size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)].count();
+}
+
+void report(std::string_view scene, std::string_view what, std::vector<Milliseconds> times) {
+    std::ranges::sort(times);
+    std::cout << std::left << std::setw(6) << scene << std::setw(6) << what << std::right << std::fixed << std::setprecision(3);
+    if (times.empty()) {
+        std::cout << "  n/a\n";
+        return;
+    }
+    std::cout << "  p50 " << std::setw(8) << percentile(times, 50.0)
+              << "  p90 " << std::setw(8) << percentile(times, 90.0)
+              << "  p99 " << std::setw(8) << percentile(times, 99.0)
+              << "  max " << std::setw(8) << times.back().count() << "  ms (" << times.size() << " frames)\n";
+}
+
+void writePpm(std::string const &path, vk::Extent2D extent, std::vector<std::uint8_t> const &rgba) {
+    std::ofstream outf{path, std::ios::binary};
+    outf << "P6\n"
+         << extent.width << " " << extent.height << "\n255\n";
+    for (std::size_t i = 0; i < rgba.size(); i += 4) {
+        outf.write(reinterpret_cast<char const *>(&rgba[i]), 3);
+    }
+    if (!outf.flush()) {
+        throw std::runtime_error("Could not write " + path);
+    }
+}
+
+// Renders `frames` frames of a scene, `build` queues up what to draw for
+// frame n
+void runScene(VulkanRender &renderer, Options const &options, std::string_view scene, std::function<void(std::size_t)> const &build) {
+    std::vector<Milliseconds> frameTimes;
+    std::vector<Milliseconds> gpuTimes;
+    frameTimes.reserve(options.frames);
+    gpuTimes.reserve(options.frames);
+
+    // Each frame's GPU time is only read back a few frames later, and
+    // stays there until the next one is, so only count new ones
+    std::optional<std::uint64_t> lastGpuFrame;
+    auto last = std::chrono::steady_clock::now();
+    for (std::size_t frame = 0; frame < options.warmup + options.frames; frame++) {
+        build(frame);
+        renderer.render();
+        renderer.present();
+
+        auto now = std::chrono::steady_clock::now();
+        auto gpuTime = renderer.gpuFrameTime();
+        if (frame >= options.warmup) {
+            frameTimes.emplace_back(now - last);
+            if (gpuTime && gpuTime->frame != lastGpuFrame) {
+                gpuTimes.emplace_back(gpuTime->time);
+            }
+        }
+        if (gpuTime) {
+            lastGpuFrame = gpuTime->frame;
+        }
+        last = now;
+    }
+
+    report(scene, "frame", frameTimes);
+    report(scene, "gpu", gpuTimes);
+
+    if (!options.screenshot.empty()) {
+        writePpm(options.screenshot + "-" + std::string(scene) + ".ppm", renderer.renderExtent(), renderer.readPixels());
+    }
+}
+
+auto parseOptions(int argc, char **argv) -> Options {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + std::string(arg));
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--frames") {
+            options.frames = std::stoul(value());
+        } else if (arg == "--warmup") {
+            options.warmup = std::stoul(value());
+        } else if (arg == "--size") {
+            auto size = value();
+            auto x = size.find('x');
+            if (x == std::string::npos) {
+                throw std::invalid_argument("--size takes WIDTHxHEIGHT");
+            }
+            options.width = static_cast<std::uint32_t>(std::stoul(size.substr(0, x)));
+            options.height = static_cast<std::uint32_t>(std::stoul(size.substr(x + 1)));
+        } else if (arg == "--scene") {
+            options.scene = value();
+            if (options.scene != "all" && options.scene != "page" && options.scene != "grid" && options.scene != "strip" &&
+                options.scene != "quads") {
+                throw std::invalid_argument("--scene takes page, grid, strip, quads or all");
+            }
+        } else if (arg == "--screenshot") {
+            options.screenshot = value();
+        } else if (arg == "--legacy-rendering") {
+            options.legacyRendering = true;
+        } else {
+            throw std::invalid_argument("Unknown option: " + std::string(arg));
+        }
+    }
+    return options;
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int try {
+    auto options = parseOptions(argc, argv);
+
+    VulkanRender renderer("manga-manager-ui-bench");
+    if (options.legacyRendering) {
+        renderer.useLegacyRendering();
+    }
+    renderer.selectPhysicalDevice();
+    auto initStart = std::chrono::steady_clock::now();
+    renderer.initDevice();
+    renderer.initOffscreen(options.width, options.height);
+    renderer.createUniformBuffer();
+    renderer.initRenderPass();
+    renderer.initFramebuffers();
+    renderer.createVertexBuffer();
+    renderer.initPipeline();
+    // When a window could have shown its first frame, and when it would have
+    // had everything in it. Frames are only timed after that
+    auto initDone = std::chrono::steady_clock::now();
+    renderer.pipelineManager().waitAll();
+    auto pipelinesDone = std::chrono::steady_clock::now();
+    std::cout << std::fixed << std::setprecision(1) << "Startup " << Milliseconds(initDone - initStart).count()
+              << " ms, pipelines compiled after " << Milliseconds(pipelinesDone - initStart).count() << " ms\n";
+
+    auto const &device = renderer.logicalDevice();
+    auto sampler = vk::raii::Sampler(device,
+        vk::SamplerCreateInfo{
+            .flags = vk::SamplerCreateFlags(),
+            .magFilter = vk::Filter::eLinear,
+            .minFilter = vk::Filter::eLinear,
+            .mipmapMode = vk::SamplerMipmapMode::eNearest,
+            .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+            .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+            .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+            .mipLodBias = 0.0F,
+            .anisotropyEnable = VK_FALSE,
+            .maxAnisotropy = 1.0F,
+            .compareEnable = VK_FALSE,
+            .compareOp = vk::CompareOp::eNever,
+            .minLod = 0.0F,
+            .maxLod = 0.0F,
+            .borderColor = vk::BorderColor::eFloatOpaqueWhite,
+            .unnormalizedCoordinates = VK_FALSE});
+    auto &table = renderer.textureTable();
+    auto viewWidth = static_cast<float>(options.width);
+    auto viewHeight = static_cast<float>(options.height);
+    std::vector<QuadInstance> quads;
+
+    std::cout << "Rendering " << options.frames << " frames (after " << options.warmup << " warmup) per scene at "
+              << options.width << "x" << options.height << "\n";
+
+    if (options.scene == "all" || options.scene == "page") {
+        // A two page spread, fit to the height of the view. Both pages are
+        // resampled again every frame, like during a zoom, the most the
+        // reader ever has to do in a frame
+        constexpr vk::Extent2D pageExtent{.width = 1024, .height = 1536};
+        auto pageHeight = options.height;
+        auto pageWidth = std::max<std::uint32_t>(1, pageHeight * pageExtent.width / pageExtent.height);
+
+        auto &resampler = renderer.pageResampler();
+        std::vector<std::unique_ptr<Texture>> pages;
+        std::vector<std::unique_ptr<Resampler::Target>> targets;
+        std::vector<std::uint32_t> slots;
+        for (std::uint8_t i = 0; i < 2; i++) {
+            pages.push_back(uploadTexture(renderer, pageExtent, syntheticPage(pageExtent, i)));
+            targets.push_back(resampler.createTarget(*pages.back()->view, pageExtent, vk::Extent2D{.width = pageWidth, .height = pageHeight}));
+            slots.push_back(table.add(targets.back()->view(), *sampler));
+        }
+
+        runScene(renderer, options, "page", [&](std::size_t frame) {
+            quads.clear();
+            auto left = viewWidth / 2.0F - static_cast<float>(pageWidth);
+            for (std::size_t i = 0; i < targets.size(); i++) {
+                resampler.queue(*targets[i], frame % 2 == 0 ? ResampleFilter::Lanczos3 : ResampleFilter::Bicubic);
+                quads.push_back(QuadInstance{
+                    .rect = glm::vec4(left + static_cast<float>(i * pageWidth), 0.0F, static_cast<float>(pageWidth), static_cast<float>(pageHeight)),
+                    .uvRect = glm::vec4(0.0F, 0.0F, 1.0F, 1.0F),
+                    .tint = glm::vec4(1.0F),
+                    .texture = slots[i],
+                    .padding = {}});
+            }
+            renderer.drawQuads(quads);
+        });
+
+        renderer.waitIdle();
+        for (auto slot : slots) {
+            table.remove(slot);
+        }
+    }
+
+    if (options.scene == "all" || options.scene == "grid") {
+        // A big library scrolling steadily, with covers for every other item
+        // and placeholders for the ones still loading
+        constexpr vk::Extent2D coverExtent{.width = 160, .height = 240};
+        constexpr std::size_t coverCount = 64;
+        std::vector<std::unique_ptr<Texture>> covers;
+        std::vector<std::uint32_t> slots;
+        for (std::size_t i = 0; i < coverCount; i++) {
+            covers.push_back(uploadTexture(renderer, coverExtent, syntheticCover(coverExtent, i)));
+            slots.push_back(table.add(*covers.back()->view, *sampler));
+        }
+
+        ThumbnailGrid grid;
+        grid.setItemCount(5000);
+        grid.setViewport(viewWidth, viewHeight);
+
+        runScene(renderer, options, "grid", [&](std::size_t /*frame*/) {
+            if (grid.scrollOffset() + viewHeight >= grid.contentHeight()) {
+                grid.scrollTo(0.0F);
+            }
+            grid.scrollBy(16.0F);
+            quads.clear();
+            grid.build(quads, [&](std::size_t item) {
+                return item % 2 == 0 ? slots[(item / 2) % coverCount] : QuadInstance::noTexture;
+            });
+            renderer.drawQuads(quads);
+        });
+
+        renderer.waitIdle();
+        for (auto slot : slots) {
+            table.remove(slot);
+        }
+    }
+
+    if (options.scene == "all" || options.scene == "strip") {
+        // A webtoon chapter scrolling steadily, with tiles streamed in ahead
+        // of the viewport and evicted behind it while it's drawn
+        constexpr std::uint32_t stripWidth = 800;
+        StripView strip(renderer, std::vector<StripImage>(40, StripImage{stripWidth, 12000}),
+            [](std::size_t image, std::uint32_t firstRow, std::uint32_t rowCount, PageWriter &writer) {
+                for (std::uint32_t y = 0; y < rowCount; y++) {
+                    auto row = writer.row(y);
+                    for (std::size_t x = 0; x < row.size(); x += 4) {
+                        auto tone = ((x / 12 + (firstRow + y) / 3 + image) % 2 == 0) ? 0 : 255;
+                        row[x] = row[x + 1] = row[x + 2] = std::byte(tone);
+                        row[x + 3] = std::byte(255);
+                    }
+                }
+            },
+            StripViewOptions{
+                .tileHeight = 2048, .vramBudget = 128 * 1024 * 1024, .prefetchScreens = 1.0F, .decodeThreads = 2, .memoryBudget = nullptr});
+        strip.setViewport(viewWidth, viewHeight);
+
+        runScene(renderer, options, "strip", [&](std::size_t /*frame*/) {
+            if (strip.scrollOffset() + viewHeight >= strip.totalHeight()) {
+                strip.scrollTo(0.0F);
+            }
+            strip.scrollBy(16.0F);
+            strip.update();
+            quads.clear();
+            strip.build(quads);
+            renderer.drawQuads(quads);
+        });
+
+        renderer.waitIdle();
+    }
+
+    if (options.scene == "all" || options.scene == "quads") {
+        // Far more quads then any of the above, enough to be split into
+        // batches recorded on the worker threads. Untextured, so it's the
+        // recording and the instance copies being measured
+        constexpr std::size_t columns = 200;
+        constexpr std::size_t rows = 100;
+        auto cellWidth = viewWidth / static_cast<float>(columns);
+        auto cellHeight = viewHeight / static_cast<float>(rows);
+
+        runScene(renderer, options, "quads", [&](std::size_t frame) {
+            quads.clear();
+            for (std::size_t row = 0; row < rows; row++) {
+                for (std::size_t column = 0; column < columns; column++) {
+                    auto shade = static_cast<float>((row + column + frame) % 64) / 63.0F;
+                    quads.push_back(QuadInstance{
+                        .rect = glm::vec4(static_cast<float>(column) * cellWidth, static_cast<float>(row) * cellHeight, cellWidth, cellHeight),
+                        .uvRect = glm::vec4(0.0F, 0.0F, 1.0F, 1.0F),
+                        .tint = glm::vec4(shade, 0.5F, 1.0F - shade, 1.0F),
+                        .texture = QuadInstance::noTexture,
+                        .padding = {}});
+                }
+            }
+            renderer.drawQuads(quads);
+        });
+
+        renderer.waitIdle();
+    }
+
+    renderer.waitIdle();
+    return 0;
+} catch (vk::SystemError &err) {
+    std::cerr << "vk::SystemError: " << err.what() << std::endl;
+    return -1;
+} catch (std::exception &err) {
+    std::cerr << "std::exception: " << err.what() << std::endl;
+    return -1;
+} catch (...) {
+    std::cerr << "Unknown error\n";
+    return -1;
+}
@@ -1,11 +1,32 @@
+#include <chrono>
 #include <iostream>
+#include <string_view>
+#include <vector>
 
+#include "event_loop.h"
+#include "profiler_overlay.h"
+#include "thumbnail_grid.h"
 #include "vulkan_renderer.h"
 #include "window.h"
 
-auto main() -> int try {
+auto main(int argc, char **argv) -> int try {
     const std::string AppName = "Manga Manager";
 
+    // --vsync for plain fifo, --uncapped to render as fast as possible (e.g.
+    // for benchmarking), otherwise the lowest latency mode without tearing
+    auto presentPolicy = PresentPolicy::LowLatency;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--vsync") {
+            presentPolicy = PresentPolicy::VSync;
+        } else if (arg == "--uncapped") {
+            presentPolicy = PresentPolicy::Uncapped;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
     // Create the window
     // This is where we will later render our content to
     //
@@ -25,6 +46,9 @@ auto main() -> int try {
     // But this seemed the lesser of two evils with less potential for going
     // wrong.
     AppWindow window(AppName, 1280, 720);
+    // Only draws when something changed, idle it sleeps until the next
+    // event. Made before the renderer, whose pipeline workers wake it
+    EventLoop loop(window);
 
     // Initialize Vulkan
     // This setups all the necessary boilerplate code needed to render
@@ -32,18 +56,96 @@ auto main() -> int try {
     renderer.createSurface(window.window);
     renderer.selectPhysicalDevice();
     renderer.initDevice();
+    // Pipelines compile in the background and whatever isn't ready yet is
+    // left out of the frame, so draw again as each one comes in
+    renderer.pipelineManager().onCompiled([&loop] { loop.post(); });
     // Get most recent window size before we go using it in our vulkan code
     // Updates the values in window.extent.{width/height}
     window.getCurrentWindowSize();
+    renderer.setPresentPolicy(presentPolicy);
     renderer.initSwapchain(window.extent.width, window.extent.height);
     renderer.createUniformBuffer();
     renderer.initRenderPass();
     renderer.initFramebuffers();
     renderer.createVertexBuffer();
     renderer.initPipeline();
- 
-    renderer.render();
-    renderer.present();
+    renderer.initImGui(window.window);
+    auto &imgui = renderer.imGui();
+    auto &profiler = renderer.profiler();
+    // F3 shows and hides it, F4 dumps the frame times to frame-profile.csv
+    ProfilerOverlay profilerOverlay;
+
+    // A library's worth of cover placeholders over the cube, scrolled with
+    // the mouse wheel, all drawn in one instanced draw call
+    ThumbnailGrid grid;
+    grid.setItemCount(5000);
+    grid.setViewport(static_cast<float>(window.extent.width), static_cast<float>(window.extent.height));
+    std::vector<QuadInstance> quads;
+
+    bool outOfDate = false;
+    while (loop.running()) {
+        // Waiting isn't part of any stage, it shows up in the frame interval
+        loop.wait();
+        bool changed = false;
+        {
+            auto stage = profiler.time(CpuStage::Events);
+            changed = loop.dispatch([&](SDL_Event const &event) {
+                if (imgui.processEvent(event)) {
+                    // ImGui can take a frame or two to settle after input
+                    // (hover highlights, closing popups), so keep drawing
+                    // for a moment
+                    loop.animateFor(std::chrono::milliseconds(250));
+                    return;
+                }
+                if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                    outOfDate = true;
+                } else if (event.type == SDL_MOUSEWHEEL) {
+                    grid.scrollBy(static_cast<float>(-event.wheel.y) * 60.0F);
+                    loop.invalidate();
+                } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) {
+                    profilerOverlay.toggle();
+                    loop.invalidate();
+                } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F4) {
+                    profilerOverlay.dump(profiler);
+                    loop.invalidate();
+                }
+            });
+        }
+        if (!changed) {
+            continue;
+        }
+
+        if (outOfDate) {
+            window.getCurrentWindowSize();
+            // Minimised, there's nothing to render to until we are restored,
+            // which is a size change of its own
+            if (window.extent.width == 0 || window.extent.height == 0) {
+                continue;
+            }
+            renderer.recreateSwapchain(window.extent.width, window.extent.height);
+            grid.setViewport(static_cast<float>(window.extent.width), static_cast<float>(window.extent.height));
+            outOfDate = false;
+        }
+
+        {
+            auto stage = profiler.time(CpuStage::Update);
+            quads.clear();
+            grid.build(quads, [](std::size_t) { return QuadInstance::noTexture; });
+            renderer.drawQuads(quads);
+
+            imgui.newFrame();
+            profilerOverlay.draw(profiler);
+        }
+
+        // Returns as soon as the frame is submitted, the GPU draws it while
+        // we go round again. A frame that didn't make it to the screen has
+        // to be drawn again once the swapchain is recreated
+        outOfDate = !renderer.render() || !renderer.present();
+        if (outOfDate) {
+            loop.invalidate();
+        }
+    }
+    renderer.waitIdle();
 
     return 0;
 } catch (vk::SystemError &err) {
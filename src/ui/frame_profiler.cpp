@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#include "frame_profiler.h"
+
+namespace {
+
+auto milliseconds(FrameProfiler::Clock::duration duration) -> float {
+    return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+} // namespace
+
+auto FrameProfiler::Frame::cpuTotal() const -> float {
+    return std::accumulate(cpu.begin(), cpu.end(), 0.0F);
+}
+
+auto FrameProfiler::Frame::gpuTotal() const -> float {
+    return std::accumulate(gpu.begin(), gpu.end(), 0.0F);
+}
+
+FrameProfiler::Scope::Scope(FrameProfiler &frameProfiler, CpuStage cpuStage)
+    : profiler(frameProfiler), stage(cpuStage), start(Clock::now()) {
+}
+
+FrameProfiler::Scope::~Scope() {
+    profiler.add(stage, Clock::now() - start);
+}
+
+FrameProfiler::FrameProfiler(vk::raii::PhysicalDevice const &physicalDevice, vk::raii::Device const &device,
+    std::uint32_t queueFamily, std::size_t framesInFlight, std::size_t historyLength)
+    : history(std::max<std::size_t>(historyLength, 1) + 1), frameStart(Clock::now()), slotFrames(framesInFlight) {
+    // Not every queue can do timestamps (timestampValidBits of 0), and the
+    // ones that can may not count all 64 bits
+    auto validBits = physicalDevice.getQueueFamilyProperties().at(queueFamily).timestampValidBits;
+    if (validBits == 0) {
+        return;
+    }
+    timestampMask = validBits >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << validBits) - 1;
+    timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+    queryPool = vk::raii::QueryPool(device,
+        vk::QueryPoolCreateInfo{
+            .flags = vk::QueryPoolCreateFlags(),
+            .queryType = vk::QueryType::eTimestamp,
+            .queryCount = static_cast<std::uint32_t>(framesInFlight) * queriesPerFrame,
+            .pipelineStatistics = vk::QueryPipelineStatisticFlags()});
+}
+
+void FrameProfiler::beginFrame() {
+    auto now = Clock::now();
+    current().interval = milliseconds(now - frameStart);
+    frameStart = now;
+
+    number++;
+    current() = Frame{.number = number};
+}
+
+void FrameProfiler::add(CpuStage stage, Clock::duration duration) {
+    current().cpu[static_cast<std::size_t>(stage)] += milliseconds(duration);
+}
+
+void FrameProfiler::collect(std::size_t slot) {
+    auto frameNumber = std::exchange(slotFrames.at(slot), std::nullopt);
+    if (!frameNumber) {
+        return;
+    }
+
+    // The fence has been waited on, so every query is available
+    auto [result, timestamps] = queryPool.getResults<std::uint64_t>(static_cast<std::uint32_t>(slot) * queriesPerFrame,
+        queriesPerFrame, queriesPerFrame * sizeof(std::uint64_t), sizeof(std::uint64_t), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+        return;
+    }
+
+    std::array<float, gpuPassCount> passes{};
+    for (std::size_t pass = 0; pass < gpuPassCount; pass++) {
+        auto ticks = (timestamps[pass + 1] - timestamps[pass]) & timestampMask;
+        passes[pass] = static_cast<float>(static_cast<double>(ticks) * timestampPeriod / 1e6);
+    }
+    auto total = (timestamps[gpuPassCount] - timestamps[0]) & timestampMask;
+    lastGpuTime = GpuFrameTime{
+        .frame = *frameNumber,
+        .time = std::chrono::nanoseconds(static_cast<std::int64_t>(static_cast<double>(total) * timestampPeriod))};
+
+    // Unless it's already dropped out of the history
+    auto &entry = history[*frameNumber % history.size()];
+    if (entry.number == *frameNumber) {
+        entry.gpu = passes;
+        entry.gpuValid = true;
+    }
+}
+
+void FrameProfiler::beginCommands(vk::raii::CommandBuffer const &commandBuffer, std::size_t slot) {
+    if (!*queryPool) {
+        return;
+    }
+    auto firstQuery = static_cast<std::uint32_t>(slot) * queriesPerFrame;
+    commandBuffer.resetQueryPool(*queryPool, firstQuery, queriesPerFrame);
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *queryPool, firstQuery);
+    slotFrames.at(slot) = number;
+}
+
+void FrameProfiler::abandon(std::size_t slot) {
+    slotFrames.at(slot).reset();
+}
+
+void FrameProfiler::endPass(vk::raii::CommandBuffer const &commandBuffer, std::size_t slot, GpuPass pass) {
+    if (!*queryPool) {
+        return;
+    }
+    // Bottom of pipe, so the timestamp waits for everything recorded
+    // before it to finish
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *queryPool,
+        static_cast<std::uint32_t>(slot) * queriesPerFrame + static_cast<std::uint32_t>(pass) + 1);
+}
+
+auto FrameProfiler::frameCount() const -> std::size_t {
+    return static_cast<std::size_t>(std::min<std::uint64_t>(number, history.size() - 1));
+}
+
+auto FrameProfiler::frame(std::size_t age) const -> Frame const & {
+    if (age >= frameCount()) {
+        throw std::out_of_range("No frame that old in the profiler history");
+    }
+    return history[(number - 1 - age) % history.size()];
+}
+
+void FrameProfiler::dump(std::filesystem::path const &path) const {
+    std::ofstream outf{path, std::ios::trunc};
+    outf << "frame,interval_ms";
+    for (std::size_t stage = 0; stage < cpuStageCount; stage++) {
+        outf << ",cpu_" << name(static_cast<CpuStage>(stage)) << "_ms";
+    }
+    for (std::size_t pass = 0; pass < gpuPassCount; pass++) {
+        outf << ",gpu_" << name(static_cast<GpuPass>(pass)) << "_ms";
+    }
+    outf << ",gpu_total_ms\n";
+
+    for (auto age = frameCount(); age-- > 0;) {
+        auto const &entry = frame(age);
+        outf << entry.number << "," << entry.interval;
+        for (auto time : entry.cpu) {
+            outf << "," << time;
+        }
+        // Left empty rather then 0 when there's nothing measured
+        for (auto time : entry.gpu) {
+            outf << ",";
+            if (entry.gpuValid) {
+                outf << time;
+            }
+        }
+        outf << ",";
+        if (entry.gpuValid) {
+            outf << entry.gpuTotal();
+        }
+        outf << "\n";
+    }
+
+    if (!outf.flush()) {
+        throw std::runtime_error("Could not write " + path.string());
+    }
+}
+
+auto FrameProfiler::name(CpuStage stage) -> std::string_view {
+    switch (stage) {
+    case CpuStage::Events:
+        return "events";
+    case CpuStage::Update:
+        return "update";
+    case CpuStage::Acquire:
+        return "acquire";
+    case CpuStage::Record:
+        return "record";
+    case CpuStage::Submit:
+        return "submit";
+    case CpuStage::Present:
+        return "present";
+    }
+    return "unknown";
+}
+
+auto FrameProfiler::name(GpuPass pass) -> std::string_view {
+    switch (pass) {
+    case GpuPass::Compute:
+        return "compute";
+    case GpuPass::Scene:
+        return "scene";
+    case GpuPass::Quads:
+        return "quads";
+    case GpuPass::Overlay:
+        return "overlay";
+    }
+    return "unknown";
+}
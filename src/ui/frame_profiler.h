@@ -0,0 +1,145 @@
+#ifndef UI_FRAME_PROFILER_H
+#define UI_FRAME_PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "vulkan_config.h"
+
+// Where the render thread's time goes each frame. The first two are for the
+// application's loop to time itself, VulkanRender times the rest
+enum class CpuStage : std::size_t {
+    // Polling and handling SDL events
+    Events,
+    // Everything between the events and render(), e.g. TextureManager
+    // uploads and building the frame's quads
+    Update,
+    // Waiting on the frame's fence, then for a swapchain image
+    Acquire,
+    Record,
+    Submit,
+    Present,
+};
+
+// The passes of a frame on the GPU, in the order they run
+enum class GpuPass : std::size_t {
+    // Resampling pages, before the render pass
+    Compute,
+    Scene,
+    Quads,
+    Overlay,
+};
+
+// Per frame CPU and GPU timings, kept for the last few seconds of frames.
+//
+// CPU stages are timed with a steady clock around each stage. GPU passes
+// with timestamp queries written after each pass, a pool of them per frame
+// in flight. Those can only be read once the frame's fence says it's done,
+// so a frame's GPU times fill in framesInFlight frames after its CPU ones.
+//
+// Render thread only.
+class FrameProfiler {
+  public:
+    static constexpr std::size_t cpuStageCount = 6;
+    static constexpr std::size_t gpuPassCount = 4;
+    using Clock = std::chrono::steady_clock;
+
+    // All times in milliseconds
+    struct Frame {
+        std::uint64_t number = 0;
+        // From the start of this frame to the start of the next
+        float interval = 0.0F;
+        std::array<float, cpuStageCount> cpu{};
+        std::array<float, gpuPassCount> gpu{};
+        // False until the GPU times are in, or if they never will be
+        bool gpuValid = false;
+
+        [[nodiscard]] auto cpuTotal() const -> float;
+        [[nodiscard]] auto gpuTotal() const -> float;
+    };
+
+    // The whole of a frame on the GPU
+    struct GpuFrameTime {
+        // Frame::number of the frame it was measured for
+        std::uint64_t frame;
+        std::chrono::nanoseconds time;
+    };
+
+    // Adds the time until it's destroyed to a stage of the current frame
+    class Scope {
+      public:
+        Scope(FrameProfiler &, CpuStage);
+        ~Scope();
+        Scope(Scope const &) = delete;
+        auto operator=(Scope const &) -> Scope & = delete;
+
+      private:
+        FrameProfiler &profiler;
+        CpuStage stage;
+        Clock::time_point start;
+    };
+
+    FrameProfiler(vk::raii::PhysicalDevice const &, vk::raii::Device const &, std::uint32_t queueFamily,
+        std::size_t framesInFlight, std::size_t historyLength = 240);
+
+    // Ends the current frame and starts the next, VulkanRender does this
+    // once it's presented
+    void beginFrame();
+    [[nodiscard]] auto time(CpuStage stage) -> Scope { return {*this, stage}; }
+    // Adds to what's already there, a stage can run more then once a frame
+    void add(CpuStage, Clock::duration);
+
+    // The GPU side. collect() after waiting on the slot's fence, then
+    // beginCommands() at the start of its command buffer (outside a render
+    // pass) and endPass() after every pass, in order, even empty ones.
+    // endPass() can go in the render pass's secondary command buffers, from
+    // whichever thread records them
+    void collect(std::size_t slot);
+    void beginCommands(vk::raii::CommandBuffer const &, std::size_t slot);
+    void endPass(vk::raii::CommandBuffer const &, std::size_t slot, GpuPass);
+    // The slot's command buffer was thrown away instead of submitted, so
+    // its queries still hold an older frame's timestamps (or none)
+    void abandon(std::size_t slot);
+    // False if the queue can't write timestamps, GPU times are never valid
+    [[nodiscard]] auto gpuSupported() const -> bool { return static_cast<bool>(*queryPool); }
+    // GPU time of the most recent frame that has its GPU times in. Stays
+    // the same until the next one is in, check the frame number to only
+    // count each once
+    [[nodiscard]] auto lastGpuFrameTime() const -> std::optional<GpuFrameTime> { return lastGpuTime; }
+
+    // Finished frames, 0 being the most recent
+    [[nodiscard]] auto frameCount() const -> std::size_t;
+    [[nodiscard]] auto frame(std::size_t age) const -> Frame const &;
+    // Every finished frame still in the history as CSV, oldest first
+    void dump(std::filesystem::path const &) const;
+
+    [[nodiscard]] static auto name(CpuStage) -> std::string_view;
+    [[nodiscard]] static auto name(GpuPass) -> std::string_view;
+
+  private:
+    // One timestamp before the first pass, and one after each
+    static constexpr std::uint32_t queriesPerFrame = gpuPassCount + 1;
+
+    auto current() -> Frame & { return history[number % history.size()]; }
+
+    // One more then asked for, the frame being recorded
+    std::vector<Frame> history;
+    std::uint64_t number = 0;
+    Clock::time_point frameStart;
+
+    vk::raii::QueryPool queryPool = nullptr;
+    // Nanoseconds per tick
+    float timestampPeriod = 0.0F;
+    std::uint64_t timestampMask = 0;
+    // Which frame's timestamps each slot's queries hold
+    std::vector<std::optional<std::uint64_t>> slotFrames;
+    std::optional<GpuFrameTime> lastGpuTime;
+};
+
+#endif
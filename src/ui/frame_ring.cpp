@@ -0,0 +1,44 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "frame_ring.h"
+
+FrameRing::FrameRing(GpuAllocator &allocator, vk::raii::Device const &device, vk::DeviceSize offsetAlignment,
+    vk::DeviceSize bytesPerFrame, std::size_t frames, vk::BufferUsageFlags usage) : alignment(offsetAlignment),
+                                                                                    // Keep every section aligned too
+                                                                                    sectionSize((bytesPerFrame + offsetAlignment - 1) & ~(offsetAlignment - 1)),
+                                                                                    sections(frames) {
+    // Preferably device local as well, with resizable BAR (or on integrated
+    // GPUs) the shaders then read it without going over the bus
+    ring = createGpuBuffer(allocator, device,
+        vk::BufferCreateInfo{
+            .flags = vk::BufferCreateFlags(),
+            .size = sectionSize * sections,
+            .usage = usage,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr},
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+}
+
+void FrameRing::beginFrame(std::size_t frame) {
+    sectionStart = sectionSize * (frame % sections);
+    cursor = 0;
+}
+
+auto FrameRing::push(void const *data, vk::DeviceSize size) -> std::uint32_t {
+    auto reservation = reserve(size);
+    std::memcpy(reservation.data, data, size);
+    return reservation.offset;
+}
+
+auto FrameRing::reserve(vk::DeviceSize size) -> Reservation {
+    if (cursor + size > sectionSize) {
+        throw std::length_error("FrameRing: out of space for this frame");
+    }
+
+    auto offset = sectionStart + cursor;
+    cursor = (cursor + size + alignment - 1) & ~(alignment - 1);
+    return Reservation{.offset = static_cast<std::uint32_t>(offset), .data = ring.allocation.mapped() + offset};
+}
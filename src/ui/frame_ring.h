@@ -0,0 +1,59 @@
+#ifndef UI_FRAME_RING_H
+#define UI_FRAME_RING_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gpu_allocator.h"
+#include "vulkan_config.h"
+
+// Data that's rewritten every frame (uniforms, QuadRenderer's instances,
+// ImGui's vertices and indices), written straight into persistently mapped
+// memory.
+//
+// One buffer is split into a section per frame in flight. Each frame the
+// section belonging to it is reset and filled from the start. The returned
+// offsets are dynamic offsets for eUniformBufferDynamic or
+// eStorageBufferDynamic descriptors, so a single descriptor set covers every
+// frame and every draw, or offsets to bind vertex and index buffers at.
+// Nothing is ever mapped, copied or reallocated.
+//
+// A section must not be reused until the GPU is done with it, i.e. only call
+// beginFrame() after waiting on that frame's fence.
+class FrameRing {
+  public:
+    // `alignment` has to be minUniformBufferOffsetAlignment, or
+    // minStorageBufferOffsetAlignment for storage buffers (or whatever the
+    // vertex or index type needs)
+    FrameRing(GpuAllocator &, vk::raii::Device const &, vk::DeviceSize alignment, vk::DeviceSize bytesPerFrame, std::size_t frames,
+        vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eUniformBuffer);
+
+    void beginFrame(std::size_t frame);
+    // Copies `size` bytes in, returns the dynamic offset to bind them with.
+    // Throws std::length_error if the frame's section is full
+    auto push(void const *data, vk::DeviceSize size) -> std::uint32_t;
+    template <typename T>
+    auto push(T const &data) -> std::uint32_t {
+        return push(&data, sizeof(data));
+    }
+    // Space for `size` bytes that is filled in later, e.g. by whichever
+    // thread records the draw using it, as long as it's before the frame is
+    // submitted
+    struct Reservation {
+        std::uint32_t offset;
+        std::byte *data;
+    };
+    auto reserve(vk::DeviceSize size) -> Reservation;
+
+    [[nodiscard]] auto buffer() const -> vk::Buffer { return *ring.buffer; }
+
+  private:
+    GpuBuffer ring;
+    const vk::DeviceSize alignment;
+    const vk::DeviceSize sectionSize;
+    const std::size_t sections;
+    vk::DeviceSize sectionStart = 0;
+    vk::DeviceSize cursor = 0;
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <iterator>
+
+#include "gpu_allocator.h"
+
+namespace {
+
+auto alignUp(vk::DeviceSize value, vk::DeviceSize alignment) -> vk::DeviceSize {
+    // Vulkan alignments are always powers of two
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+auto poolIndex(std::uint32_t memoryType, GpuAllocator::Kind kind) -> std::uint32_t {
+    return memoryType * 2 + (kind == GpuAllocator::Kind::Optimal ? 1 : 0);
+}
+
+} // namespace
+
+GpuAllocator::GpuAllocator(vk::raii::PhysicalDevice const &physicalDevice, vk::raii::Device const &logicalDevice,
+    vk::DeviceSize size) : device(logicalDevice),
+                           memoryProperties(physicalDevice.getMemoryProperties()),
+                           blockSize(size) {
+}
+
+// Out of line, so Block is complete where the pools are destroyed
+GpuAllocator::~GpuAllocator() = default;
+
+auto GpuAllocator::allocate(vk::MemoryRequirements const &requirements, vk::MemoryPropertyFlags required,
+    vk::MemoryPropertyFlags preferred, Kind kind) -> Allocation {
+    // Candidate memory types, best first
+    std::vector<std::uint32_t> candidates;
+    for (auto flags : {required | preferred, required}) {
+        for (std::uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++) {
+            if ((requirements.memoryTypeBits & (1U << type)) != 0 &&
+                (memoryProperties.memoryTypes[type].propertyFlags & flags) == flags &&
+                std::ranges::find(candidates, type) == candidates.end()) {
+                candidates.push_back(type);
+            }
+        }
+    }
+
+    std::lock_guard lock(mutex);
+
+    for (auto type : candidates) {
+        Block *block = nullptr;
+        std::optional<vk::DeviceSize> offset;
+
+        if (requirements.size <= blockSize / 2) {
+            for (auto &candidate : pools[poolIndex(type, kind)]) {
+                if (candidate->size - candidate->used >= requirements.size) {
+                    offset = tryAllocate(*candidate, requirements.size, requirements.alignment);
+                    if (offset) {
+                        block = candidate.get();
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (block == nullptr) {
+            try {
+                // Big allocations get a block to themselves
+                block = &allocateBlock(type, kind, std::max(blockSize, requirements.size));
+            } catch (vk::OutOfDeviceMemoryError const &) {
+                // This heap is full, try the next type
+                continue;
+            } catch (vk::OutOfHostMemoryError const &) {
+                continue;
+            }
+            offset = tryAllocate(*block, requirements.size, requirements.alignment);
+        }
+
+        used += requirements.size;
+
+        Allocation allocation;
+        allocation.allocator = this;
+        allocation.block = block;
+        allocation.rangeOffset = *offset;
+        allocation.rangeSize = requirements.size;
+        return allocation;
+    }
+
+    throw vk::OutOfDeviceMemoryError("GpuAllocator: no memory type can fit the allocation");
+}
+
+auto GpuAllocator::tryAllocate(Block &block, vk::DeviceSize size, vk::DeviceSize alignment) -> std::optional<vk::DeviceSize> {
+    alignment = std::max<vk::DeviceSize>(alignment, 1);
+
+    for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it) {
+        auto offset = alignUp(it->offset, alignment);
+        auto end = it->offset + it->size;
+        if (offset + size > end) {
+            continue;
+        }
+
+        // Whatever is left either side of the allocation stays free, the
+        // padding in front gets merged back when a neighbour is freed
+        auto before = Range{it->offset, offset - it->offset};
+        auto after = Range{offset + size, end - offset - size};
+        it = block.freeRanges.erase(it);
+        if (after.size != 0) {
+            it = block.freeRanges.insert(it, after);
+        }
+        if (before.size != 0) {
+            block.freeRanges.insert(it, before);
+        }
+
+        block.used += size;
+        return offset;
+    }
+    return std::nullopt;
+}
+
+auto GpuAllocator::allocateBlock(std::uint32_t memoryType, Kind kind, vk::DeviceSize size) -> Block & {
+    auto block = std::make_unique<Block>();
+    block->memory = vk::raii::DeviceMemory(device,
+        vk::MemoryAllocateInfo{
+            .allocationSize = size,
+            .memoryTypeIndex = memoryType});
+    block->size = size;
+    block->freeRanges.push_back(Range{0, size});
+    block->pool = poolIndex(memoryType, kind);
+
+    // Map once and leave it mapped, mapping is far from free and there's no
+    // limit on how much can be mapped at once
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+        block->mapped = static_cast<std::byte *>(block->memory.mapMemory(0, size));
+    }
+
+    reserved += size;
+    auto &pool = pools[block->pool];
+    pool.push_back(std::move(block));
+    return *pool.back();
+}
+
+void GpuAllocator::free(Block *block, vk::DeviceSize offset, vk::DeviceSize size) {
+    std::lock_guard lock(mutex);
+
+    auto &ranges = block->freeRanges;
+    auto it = std::ranges::lower_bound(ranges, offset, {}, &Range::offset);
+    it = ranges.insert(it, Range{offset, size});
+
+    // Merge with the next range, then the previous one
+    if (auto next = std::next(it); next != ranges.end() && it->offset + it->size == next->offset) {
+        it->size += next->size;
+        ranges.erase(next);
+    }
+    if (it != ranges.begin()) {
+        if (auto previous = std::prev(it); previous->offset + previous->size == it->offset) {
+            previous->size += it->size;
+            ranges.erase(it);
+        }
+    }
+
+    block->used -= size;
+    used -= size;
+
+    // Give empty blocks back to the driver, but keep the last one of a pool
+    // around, so allocating and freeing a single buffer in a loop doesn't
+    // hit vkAllocateMemory every time. Oversized blocks always go
+    auto &pool = pools[block->pool];
+    if (block->used == 0 && (pool.size() > 1 || block->size > blockSize)) {
+        reserved -= block->size;
+        std::erase_if(pool, [block](auto const &candidate) { return candidate.get() == block; });
+    }
+}
+
+auto GpuAllocator::deviceAllocations() const -> std::size_t {
+    std::lock_guard lock(mutex);
+    std::size_t count = 0;
+    for (auto const &pool : pools) {
+        count += pool.size();
+    }
+    return count;
+}
+
+auto GpuAllocator::bytesUsed() const -> vk::DeviceSize {
+    std::lock_guard lock(mutex);
+    return used;
+}
+
+auto GpuAllocator::bytesReserved() const -> vk::DeviceSize {
+    std::lock_guard lock(mutex);
+    return reserved;
+}
+
+GpuAllocator::Allocation::Allocation(Allocation &&other) noexcept : allocator(std::exchange(other.allocator, nullptr)),
+                                                                     block(std::exchange(other.block, nullptr)),
+                                                                     rangeOffset(other.rangeOffset),
+                                                                     rangeSize(other.rangeSize) {
+}
+
+auto GpuAllocator::Allocation::operator=(Allocation &&other) noexcept -> Allocation & {
+    if (this != &other) {
+        if (block != nullptr) {
+            allocator->free(block, rangeOffset, rangeSize);
+        }
+        allocator = std::exchange(other.allocator, nullptr);
+        block = std::exchange(other.block, nullptr);
+        rangeOffset = other.rangeOffset;
+        rangeSize = other.rangeSize;
+    }
+    return *this;
+}
+
+GpuAllocator::Allocation::~Allocation() {
+    if (block != nullptr) {
+        allocator->free(block, rangeOffset, rangeSize);
+    }
+}
+
+auto GpuAllocator::Allocation::memory() const -> vk::DeviceMemory {
+    return block != nullptr ? *block->memory : vk::DeviceMemory();
+}
+
+auto GpuAllocator::Allocation::mapped() const -> std::byte * {
+    return (block != nullptr && block->mapped != nullptr) ? block->mapped + rangeOffset : nullptr;
+}
+
+auto createGpuBuffer(GpuAllocator &allocator, vk::raii::Device const &device, vk::BufferCreateInfo const &createInfo,
+    vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) -> GpuBuffer {
+    GpuBuffer buffer;
+    buffer.buffer = vk::raii::Buffer(device, createInfo);
+    buffer.allocation = allocator.allocate(buffer.buffer.getMemoryRequirements(), required, preferred, GpuAllocator::Kind::Linear);
+    buffer.buffer.bindMemory(buffer.allocation.memory(), buffer.allocation.offset());
+    return buffer;
+}
+
+auto createGpuImage(GpuAllocator &allocator, vk::raii::Device const &device, vk::ImageCreateInfo const &createInfo,
+    vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) -> GpuImage {
+    GpuImage image;
+    image.image = vk::raii::Image(device, createInfo);
+    auto kind = createInfo.tiling == vk::ImageTiling::eOptimal ? GpuAllocator::Kind::Optimal : GpuAllocator::Kind::Linear;
+    image.allocation = allocator.allocate(image.image.getMemoryRequirements(), required, preferred, kind);
+    image.image.bindMemory(image.allocation.memory(), image.allocation.offset());
+    return image;
+}
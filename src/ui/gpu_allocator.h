@@ -0,0 +1,132 @@
+#ifndef UI_GPU_ALLOCATOR_H
+#define UI_GPU_ALLOCATOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "vulkan_config.h"
+
+// Sub-allocates GPU memory out of large blocks.
+//
+// Every vkAllocateMemory call is slow, and drivers only have to allow
+// maxMemoryAllocationCount of them at once (4096 on plenty of hardware),
+// which a library's worth of page textures and thumbnails would blow
+// through. Instead we allocate blocks (64 MiB by default) per memory type
+// and hand out aligned ranges of them, first fit from a sorted free list.
+//
+// Buffers and optimal tiling images are kept in separate blocks, so we never
+// have to care about bufferImageGranularity. Anything bigger then half a
+// block gets a block of its own.
+//
+// Host visible blocks are mapped once when allocated and stay mapped, see
+// Allocation::mapped().
+//
+// Thread safe.
+class GpuAllocator {
+  public:
+    // What's going to be bound to the memory
+    enum class Kind {
+        // Buffers and linear tiling images
+        Linear,
+        Optimal,
+    };
+
+    class Allocation;
+
+    GpuAllocator(vk::raii::PhysicalDevice const &, vk::raii::Device const &, vk::DeviceSize blockSize = 64 * 1024 * 1024);
+    ~GpuAllocator();
+    GpuAllocator(GpuAllocator const &) = delete;
+    auto operator=(GpuAllocator const &) -> GpuAllocator & = delete;
+
+    // Memory types have to have every `required` flag, ones with the
+    // `preferred` flags as well are tried first.
+    // Throws vk::OutOfDeviceMemoryError if nothing fits
+    auto allocate(vk::MemoryRequirements const &, vk::MemoryPropertyFlags required,
+        vk::MemoryPropertyFlags preferred = {}, Kind = Kind::Linear) -> Allocation;
+
+    // How many vkAllocateMemory allocations are live right now
+    [[nodiscard]] auto deviceAllocations() const -> std::size_t;
+    // Bytes handed out, out of the blocks' total
+    [[nodiscard]] auto bytesUsed() const -> vk::DeviceSize;
+    [[nodiscard]] auto bytesReserved() const -> vk::DeviceSize;
+
+  private:
+    struct Range {
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+    };
+
+    struct Block {
+        vk::raii::DeviceMemory memory = nullptr;
+        vk::DeviceSize size = 0;
+        vk::DeviceSize used = 0;
+        std::byte *mapped = nullptr;
+        // Sorted by offset, neighbours are always merged
+        std::vector<Range> freeRanges;
+        std::uint32_t pool = 0;
+    };
+
+    auto tryAllocate(Block &, vk::DeviceSize size, vk::DeviceSize alignment) -> std::optional<vk::DeviceSize>;
+    auto allocateBlock(std::uint32_t memoryType, Kind, vk::DeviceSize size) -> Block &;
+    void free(Block *, vk::DeviceSize offset, vk::DeviceSize size);
+
+    vk::raii::Device const &device;
+    vk::PhysicalDeviceMemoryProperties memoryProperties;
+    const vk::DeviceSize blockSize;
+
+    mutable std::mutex mutex;
+    // Indexed by memory type * 2 + kind
+    std::array<std::vector<std::unique_ptr<Block>>, VK_MAX_MEMORY_TYPES * 2> pools;
+    vk::DeviceSize used = 0;
+    vk::DeviceSize reserved = 0;
+};
+
+// A range of device memory, given back to the allocator when destroyed.
+// Make sure whatever is bound to it is destroyed first.
+class GpuAllocator::Allocation {
+  public:
+    Allocation() = default;
+    Allocation(Allocation &&) noexcept;
+    auto operator=(Allocation &&) noexcept -> Allocation &;
+    ~Allocation();
+
+    [[nodiscard]] auto memory() const -> vk::DeviceMemory;
+    [[nodiscard]] auto offset() const -> vk::DeviceSize { return rangeOffset; }
+    [[nodiscard]] auto size() const -> vk::DeviceSize { return rangeSize; }
+    // Start of the range if the memory is host visible, otherwise nullptr
+    [[nodiscard]] auto mapped() const -> std::byte *;
+    explicit operator bool() const { return block != nullptr; }
+
+  private:
+    friend class GpuAllocator;
+
+    GpuAllocator *allocator = nullptr;
+    Block *block = nullptr;
+    vk::DeviceSize rangeOffset = 0;
+    vk::DeviceSize rangeSize = 0;
+};
+
+// Buffers and images along with their memory. The allocation is declared
+// first so it outlives what's bound to it
+struct GpuBuffer {
+    GpuAllocator::Allocation allocation;
+    vk::raii::Buffer buffer = nullptr;
+};
+
+struct GpuImage {
+    GpuAllocator::Allocation allocation;
+    vk::raii::Image image = nullptr;
+};
+
+// Create the buffer/image and bind it to memory from the allocator
+auto createGpuBuffer(GpuAllocator &, vk::raii::Device const &, vk::BufferCreateInfo const &,
+    vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred = {}) -> GpuBuffer;
+auto createGpuImage(GpuAllocator &, vk::raii::Device const &, vk::ImageCreateInfo const &,
+    vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred = {}) -> GpuImage;
+
+#endif
@@ -0,0 +1,85 @@
+#include <stdexcept>
+
+#include <backends/imgui_impl_sdl2.h>
+#include <imgui.h>
+
+#include "imgui_layer.h"
+
+ImGuiLayer::ImGuiLayer(SDL_Window *window, vk::raii::Device const &device, GpuAllocator &allocator, BindlessTextures &textures,
+    RenderTarget const &target, PipelineManager &pipelines, std::size_t framesInFlight) {
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    // Debug tools, not worth an imgui.ini next to wherever we were run from
+    ImGui::GetIO().IniFilename = nullptr;
+    ImGui::StyleColorsDark();
+
+    if (!ImGui_ImplSDL2_InitForVulkan(window)) {
+        ImGui::DestroyContext();
+        throw std::runtime_error("Could not initialise ImGui's SDL2 backend");
+    }
+
+    try {
+        renderer = std::make_unique<ImGuiRenderer>(device, allocator, textures, target, pipelines, framesInFlight);
+    } catch (...) {
+        ImGui_ImplSDL2_Shutdown();
+        ImGui::DestroyContext();
+        throw;
+    }
+}
+
+ImGuiLayer::~ImGuiLayer() {
+    renderer.reset();
+    ImGui_ImplSDL2_Shutdown();
+    ImGui::DestroyContext();
+}
+
+void ImGuiLayer::uploadFonts(vk::raii::CommandBuffer const &commandBuffer) {
+    renderer->uploadFonts(commandBuffer);
+}
+
+void ImGuiLayer::fontsUploaded() {
+    renderer->fontsUploaded();
+}
+
+auto ImGuiLayer::processEvent(SDL_Event const &event) -> bool {
+    ImGui_ImplSDL2_ProcessEvent(&event);
+
+    auto const &io = ImGui::GetIO();
+    switch (event.type) {
+    case SDL_MOUSEMOTION:
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+    case SDL_MOUSEWHEEL:
+        return io.WantCaptureMouse;
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+    case SDL_TEXTINPUT:
+        return io.WantCaptureKeyboard;
+    default:
+        return false;
+    }
+}
+
+void ImGuiLayer::newFrame() {
+    ImGui_ImplSDL2_NewFrame();
+    ImGui::NewFrame();
+    frameStarted = true;
+}
+
+void ImGuiLayer::record(vk::raii::CommandBuffer const &commandBuffer, std::size_t frame, vk::Extent2D extent) {
+    if (!frameStarted) {
+        return;
+    }
+    frameStarted = false;
+
+    ImGui::Render();
+    renderer->record(commandBuffer, *ImGui::GetDrawData(), frame, extent);
+}
+
+void ImGuiLayer::discard() {
+    if (!frameStarted) {
+        return;
+    }
+    frameStarted = false;
+    ImGui::EndFrame();
+}
@@ -0,0 +1,55 @@
+#ifndef UI_IMGUI_LAYER_H
+#define UI_IMGUI_LAYER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <SDL.h>
+
+#include "bindless_textures.h"
+#include "gpu_allocator.h"
+#include "imgui_renderer.h"
+#include "pipeline_manager.h"
+#include "render_target.h"
+#include "vulkan_config.h"
+
+// Dear ImGui on top of everything else, for debug tools like the profiler
+// overlay, and later the library, settings and download windows. Drawn last
+// in VulkanRender's render pass, input comes through ImGui's SDL2 backend
+// and drawing is our own ImGuiRenderer.
+//
+// Made by VulkanRender::initImGui(), which also uploads the font. A frame
+// goes: processEvent() for every event, newFrame(), any ImGui:: calls, then
+// record() draws it. Render thread only, and only one can exist at a time,
+// ImGui's context is global.
+class ImGuiLayer {
+  public:
+    ImGuiLayer(SDL_Window *, vk::raii::Device const &, GpuAllocator &, BindlessTextures &, RenderTarget const &,
+        PipelineManager &, std::size_t framesInFlight);
+    ~ImGuiLayer();
+    ImGuiLayer(ImGuiLayer const &) = delete;
+    auto operator=(ImGuiLayer const &) -> ImGuiLayer & = delete;
+
+    void uploadFonts(vk::raii::CommandBuffer const &);
+    // Once the upload has finished
+    void fontsUploaded();
+
+    // True if ImGui wants the event to itself, e.g. a click on one of its
+    // windows, and the rest of the app should ignore it
+    auto processEvent(SDL_Event const &) -> bool;
+    void newFrame();
+    // Ends the frame and records its draws, inside the render pass, once
+    // the frame's fence has been waited on. Does nothing if no frame was
+    // started
+    void record(vk::raii::CommandBuffer const &, std::size_t frame, vk::Extent2D);
+    // Ends the frame without drawing it, for frames that are dropped
+    void discard();
+
+  private:
+    // Needs the context, so made after it and destroyed before it
+    std::unique_ptr<ImGuiRenderer> renderer;
+    bool frameStarted = false;
+};
+
+#endif
@@ -0,0 +1,513 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <span>
+
+#include "imgui_renderer.h"
+
+namespace {
+
+// Same trick as the tutorial shaders in VulkanRender
+constexpr auto imguiVertShader = std::to_array<std::uint32_t>({
+#include "imgui.vert.inc"
+});
+
+constexpr auto imguiFragShader = std::to_array<std::uint32_t>({
+#include "imgui.frag.inc"
+});
+
+auto colorRange() -> vk::ImageSubresourceRange {
+    return vk::ImageSubresourceRange{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = 1};
+}
+
+auto textureSlot(ImTextureID id) -> std::uint32_t {
+    return static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(id));
+}
+
+} // namespace
+
+ImGuiRenderer::ImGuiRenderer(vk::raii::Device const &logicalDevice,
+    GpuAllocator &gpuAllocator, BindlessTextures &bindlessTextures, RenderTarget const &target,
+    PipelineManager &pipelineManager, std::size_t framesInFlight, std::uint32_t vertexLimit,
+    std::uint32_t indexLimit) : device(logicalDevice),
+                                allocator(gpuAllocator),
+                                textures(bindlessTextures),
+                                pipelines(pipelineManager),
+                                maxVertices(vertexLimit),
+                                maxIndices(indexLimit),
+                                // Offsets only have to be a multiple of the index size, 4 keeps
+                                // FrameRing's power of two rounding happy for both
+                                vertices(gpuAllocator, logicalDevice, 4, vk::DeviceSize(vertexLimit) * sizeof(ImDrawVert),
+                                    framesInFlight, vk::BufferUsageFlagBits::eVertexBuffer),
+                                indices(gpuAllocator, logicalDevice, 4, vk::DeviceSize(indexLimit) * sizeof(ImDrawIdx),
+                                    framesInFlight, vk::BufferUsageFlagBits::eIndexBuffer) {
+    auto &io = ImGui::GetIO();
+    io.BackendRendererName = "manga-manager";
+    // We draw with a vertex offset, so a draw list can go past the 64k
+    // vertices 16 bit indices reach on their own
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+
+    sampler = vk::raii::Sampler(device,
+        vk::SamplerCreateInfo{
+            .flags = vk::SamplerCreateFlags(),
+            .magFilter = vk::Filter::eLinear,
+            .minFilter = vk::Filter::eLinear,
+            .mipmapMode = vk::SamplerMipmapMode::eNearest,
+            .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+            .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+            .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+            .mipLodBias = 0.0F,
+            .anisotropyEnable = VK_FALSE,
+            .maxAnisotropy = 1.0F,
+            .compareEnable = VK_FALSE,
+            .compareOp = vk::CompareOp::eNever,
+            .minLod = 0.0F,
+            .maxLod = 0.0F,
+            .borderColor = vk::BorderColor::eFloatTransparentBlack,
+            .unnormalizedCoordinates = VK_FALSE});
+
+    // Set 0 is the bindless texture table, everything else is push constants
+    auto setLayout = textures.layout();
+    auto pushConstantRange = vk::PushConstantRange{
+        .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+        .offset = 0,
+        .size = sizeof(PushConstants)};
+
+    pipelineLayout = vk::raii::PipelineLayout(device,
+        vk::PipelineLayoutCreateInfo{
+            .flags = vk::PipelineLayoutCreateFlags(),
+            .setLayoutCount = 1,
+            .pSetLayouts = &setLayout,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstantRange});
+
+    vertexShaderModule = vk::raii::ShaderModule(device,
+        vk::ShaderModuleCreateInfo{
+            .flags = vk::ShaderModuleCreateFlags(),
+            .codeSize = imguiVertShader.size() * sizeof(std::uint32_t),
+            .pCode = imguiVertShader.data()});
+
+    fragmentShaderModule = vk::raii::ShaderModule(device,
+        vk::ShaderModuleCreateInfo{
+            .flags = vk::ShaderModuleCreateFlags(),
+            .codeSize = imguiFragShader.size() * sizeof(std::uint32_t),
+            .pCode = imguiFragShader.data()});
+
+    pipelineId = pipelines.compile("ImGui", [this, target](vk::raii::PipelineCache const &cache) {
+        return createPipeline(cache, target);
+    });
+}
+
+auto ImGuiRenderer::createPipeline(vk::raii::PipelineCache const &pipelineCache, RenderTarget const &target) const -> vk::raii::Pipeline {
+    std::array<vk::PipelineShaderStageCreateInfo, 2> pipelineShaderStageCreateInfos = {
+        vk::PipelineShaderStageCreateInfo{
+            .flags = vk::PipelineShaderStageCreateFlags(),
+            .stage = vk::ShaderStageFlagBits::eVertex,
+            .module = *vertexShaderModule,
+            .pName = "main",
+            .pSpecializationInfo = nullptr},
+        vk::PipelineShaderStageCreateInfo{
+            .flags = vk::PipelineShaderStageCreateFlags(),
+            .stage = vk::ShaderStageFlagBits::eFragment,
+            .module = *fragmentShaderModule,
+            .pName = "main",
+            .pSpecializationInfo = nullptr}};
+
+    auto vertexInputBindingDescription = vk::VertexInputBindingDescription{
+        .binding = 0,
+        .stride = sizeof(ImDrawVert),
+        .inputRate = vk::VertexInputRate::eVertex};
+
+    std::array<vk::VertexInputAttributeDescription, 3> vertexInputAttributeDescriptions = {
+        vk::VertexInputAttributeDescription{
+            .location = 0,
+            .binding = 0,
+            .format = vk::Format::eR32G32Sfloat,
+            .offset = offsetof(ImDrawVert, pos)},
+        vk::VertexInputAttributeDescription{
+            .location = 1,
+            .binding = 0,
+            .format = vk::Format::eR32G32Sfloat,
+            .offset = offsetof(ImDrawVert, uv)},
+        // Packed RGBA, one byte each
+        vk::VertexInputAttributeDescription{
+            .location = 2,
+            .binding = 0,
+            .format = vk::Format::eR8G8B8A8Unorm,
+            .offset = offsetof(ImDrawVert, col)}};
+
+    auto pipelineVertexInputStateCreateInfo = vk::PipelineVertexInputStateCreateInfo{
+        .flags = vk::PipelineVertexInputStateCreateFlags(),
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &vertexInputBindingDescription,
+        .vertexAttributeDescriptionCount = static_cast<std::uint32_t>(vertexInputAttributeDescriptions.size()),
+        .pVertexAttributeDescriptions = vertexInputAttributeDescriptions.data()};
+
+    auto pipelineInputAssemblyStateCreateInfo = vk::PipelineInputAssemblyStateCreateInfo{
+        .flags = vk::PipelineInputAssemblyStateCreateFlags(),
+        .topology = vk::PrimitiveTopology::eTriangleList,
+        .primitiveRestartEnable = VK_FALSE};
+
+    auto pipelineViewportStateCreateInfo = vk::PipelineViewportStateCreateInfo{
+        .flags = vk::PipelineViewportStateCreateFlags(),
+        .viewportCount = 1,
+        .pViewports = nullptr,
+        .scissorCount = 1,
+        .pScissors = nullptr};
+
+    // ImGui doesn't keep its triangles wound one way
+    auto pipelineRasterizationStateCreateInfo = vk::PipelineRasterizationStateCreateInfo{
+        .flags = vk::PipelineRasterizationStateCreateFlags(),
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = vk::PolygonMode::eFill,
+        .cullMode = vk::CullModeFlagBits::eNone,
+        .frontFace = vk::FrontFace::eCounterClockwise,
+        .depthBiasEnable = VK_FALSE,
+        .depthBiasConstantFactor = 0.0F,
+        .depthBiasClamp = 0.0F,
+        .depthBiasSlopeFactor = 0.0F,
+        .lineWidth = 1.0F};
+
+    auto pipelineMultisampleStateCreateInfo = vk::PipelineMultisampleStateCreateInfo{
+        .flags = vk::PipelineMultisampleStateCreateFlags(),
+        .rasterizationSamples = vk::SampleCountFlagBits::e1,
+        .sampleShadingEnable = VK_FALSE,
+        .minSampleShading = 0.0F,
+        .pSampleMask = nullptr,
+        .alphaToCoverageEnable = VK_FALSE,
+        .alphaToOneEnable = VK_FALSE};
+
+    auto stencilOpState = vk::StencilOpState{
+        .failOp = vk::StencilOp::eKeep,
+        .passOp = vk::StencilOp::eKeep,
+        .depthFailOp = vk::StencilOp::eKeep,
+        .compareOp = vk::CompareOp::eAlways,
+        .compareMask = 0,
+        .writeMask = 0,
+        .reference = 0};
+
+    // On top of everything, the depth buffer doesn't come into it
+    auto pipelineDepthStencilStateCreateInfo = vk::PipelineDepthStencilStateCreateInfo{
+        .flags = vk::PipelineDepthStencilStateCreateFlags(),
+        .depthTestEnable = VK_FALSE,
+        .depthWriteEnable = VK_FALSE,
+        .depthCompareOp = vk::CompareOp::eAlways,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+        .front = stencilOpState,
+        .back = stencilOpState,
+        .minDepthBounds = 0.0F,
+        .maxDepthBounds = 1.0F};
+
+    vk::ColorComponentFlags colorComponentFlags(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                                vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+
+    // Straight alpha, the same as ImGui's own backends
+    auto pipelineColorBlendAttachmentState = vk::PipelineColorBlendAttachmentState{
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+        .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+        .dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+        .alphaBlendOp = vk::BlendOp::eAdd,
+        .colorWriteMask = colorComponentFlags};
+
+    auto pipelineColorBlendStateCreateInfo = vk::PipelineColorBlendStateCreateInfo{
+        .flags = vk::PipelineColorBlendStateCreateFlags(),
+        .logicOpEnable = VK_FALSE,
+        .logicOp = vk::LogicOp::eNoOp,
+        .attachmentCount = 1,
+        .pAttachments = &pipelineColorBlendAttachmentState,
+        .blendConstants = {{1.0F, 1.0F, 1.0F, 1.0F}}};
+
+    std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+
+    auto pipelineDynamicStateCreateInfo = vk::PipelineDynamicStateCreateInfo{
+        .flags = vk::PipelineDynamicStateCreateFlags(),
+        .dynamicStateCount = static_cast<std::uint32_t>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data()};
+
+    auto pipelineRendering = target.pipelineRendering();
+    return vk::raii::Pipeline(device, pipelineCache,
+        vk::GraphicsPipelineCreateInfo{
+            .pNext = target.dynamic() ? &pipelineRendering : nullptr,
+            .flags = vk::PipelineCreateFlags(),
+            .stageCount = static_cast<std::uint32_t>(pipelineShaderStageCreateInfos.size()),
+            .pStages = pipelineShaderStageCreateInfos.data(),
+            .pVertexInputState = &pipelineVertexInputStateCreateInfo,
+            .pInputAssemblyState = &pipelineInputAssemblyStateCreateInfo,
+            .pTessellationState = nullptr,
+            .pViewportState = &pipelineViewportStateCreateInfo,
+            .pRasterizationState = &pipelineRasterizationStateCreateInfo,
+            .pMultisampleState = &pipelineMultisampleStateCreateInfo,
+            .pDepthStencilState = &pipelineDepthStencilStateCreateInfo,
+            .pColorBlendState = &pipelineColorBlendStateCreateInfo,
+            .pDynamicState = &pipelineDynamicStateCreateInfo,
+            .layout = *pipelineLayout,
+            .renderPass = target.renderPass,
+            .subpass = 0,
+            .basePipelineHandle = nullptr,
+            .basePipelineIndex = 0});
+}
+
+ImGuiRenderer::~ImGuiRenderer() {
+    if (fontAdded) {
+        textures.remove(fontSlot);
+    }
+    auto &io = ImGui::GetIO();
+    io.BackendRendererName = nullptr;
+    io.BackendFlags &= ~ImGuiBackendFlags_RendererHasVtxOffset;
+}
+
+void ImGuiRenderer::uploadFonts(vk::raii::CommandBuffer const &commandBuffer) {
+    auto &io = ImGui::GetIO();
+    unsigned char *pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    auto size = vk::DeviceSize(width) * vk::DeviceSize(height) * 4;
+
+    fontStaging = createGpuBuffer(allocator, device,
+        vk::BufferCreateInfo{
+            .flags = vk::BufferCreateFlags(),
+            .size = size,
+            .usage = vk::BufferUsageFlagBits::eTransferSrc,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr},
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    std::memcpy(fontStaging.allocation.mapped(), pixels, size);
+
+    auto extent = vk::Extent3D{.width = static_cast<std::uint32_t>(width), .height = static_cast<std::uint32_t>(height), .depth = 1};
+    fontImage = createGpuImage(allocator, device,
+        vk::ImageCreateInfo{
+            .flags = vk::ImageCreateFlags(),
+            .imageType = vk::ImageType::e2D,
+            .format = vk::Format::eR8G8B8A8Unorm,
+            .extent = extent,
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = vk::ImageLayout::eUndefined},
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    auto image = *fontImage.image;
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+        vk::DependencyFlags(), nullptr, nullptr,
+        vk::ImageMemoryBarrier{
+            .srcAccessMask = vk::AccessFlags(),
+            .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .oldLayout = vk::ImageLayout::eUndefined,
+            .newLayout = vk::ImageLayout::eTransferDstOptimal,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = colorRange()});
+
+    commandBuffer.copyBufferToImage(*fontStaging.buffer, image, vk::ImageLayout::eTransferDstOptimal,
+        vk::BufferImageCopy{
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = vk::ImageSubresourceLayers{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1},
+            .imageOffset = vk::Offset3D{.x = 0, .y = 0, .z = 0},
+            .imageExtent = extent});
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+        vk::DependencyFlags(), nullptr, nullptr,
+        vk::ImageMemoryBarrier{
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+            .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+            .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = colorRange()});
+
+    fontView = vk::raii::ImageView(device,
+        vk::ImageViewCreateInfo{
+            .flags = vk::ImageViewCreateFlags(),
+            .image = image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = vk::Format::eR8G8B8A8Unorm,
+            .components = vk::ComponentMapping{
+                .r = vk::ComponentSwizzle::eIdentity,
+                .g = vk::ComponentSwizzle::eIdentity,
+                .b = vk::ComponentSwizzle::eIdentity,
+                .a = vk::ComponentSwizzle::eIdentity},
+            .subresourceRange = colorRange()});
+
+    fontSlot = textures.add(*fontView, *sampler);
+    fontAdded = true;
+    io.Fonts->SetTexID(textureId(fontSlot));
+}
+
+void ImGuiRenderer::fontsUploaded() {
+    // The buffer before the memory it's bound to
+    fontStaging.buffer = nullptr;
+    fontStaging.allocation = GpuAllocator::Allocation();
+    // It's on the GPU now, ImGui doesn't need its copy either
+    ImGui::GetIO().Fonts->ClearTexData();
+}
+
+void ImGuiRenderer::setupState(vk::raii::CommandBuffer const &commandBuffer, ImDrawData const &drawData,
+    std::uint32_t vertexOffset, std::uint32_t indexOffset, vk::Extent2D extent) const {
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, framePipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayout, 0, {textures.set()}, nullptr);
+    commandBuffer.bindVertexBuffers(0, {vertices.buffer()}, {vk::DeviceSize(vertexOffset)});
+    commandBuffer.bindIndexBuffer(indices.buffer(), indexOffset, sizeof(ImDrawIdx) == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32);
+    commandBuffer.setViewport(0, vk::Viewport{
+                                     .x = 0.0F,
+                                     .y = 0.0F,
+                                     .width = static_cast<float>(extent.width),
+                                     .height = static_cast<float>(extent.height),
+                                     .minDepth = 0.0F,
+                                     .maxDepth = 1.0F});
+
+    // ImGui's display rectangle to -1..1
+    PushConstants pushConstants{};
+    pushConstants.scale = glm::vec2(2.0F / drawData.DisplaySize.x, 2.0F / drawData.DisplaySize.y);
+    pushConstants.translate = glm::vec2(-1.0F) - glm::vec2(drawData.DisplayPos.x, drawData.DisplayPos.y) * pushConstants.scale;
+    pushConstants.texture = fontSlot;
+    commandBuffer.pushConstants<PushConstants>(*pipelineLayout,
+        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, pushConstants);
+}
+
+void ImGuiRenderer::record(vk::raii::CommandBuffer const &commandBuffer, ImDrawData const &drawData, std::size_t frame,
+    vk::Extent2D extent) {
+    // Minimised, or simply nothing to draw
+    if (drawData.DisplaySize.x <= 0.0F || drawData.DisplaySize.y <= 0.0F || drawData.TotalVtxCount == 0) {
+        return;
+    }
+    // Or nothing to draw it with yet
+    framePipeline = pipelines.ready(pipelineId);
+    if (!framePipeline) {
+        return;
+    }
+    if (static_cast<std::uint32_t>(drawData.TotalVtxCount) > maxVertices || static_cast<std::uint32_t>(drawData.TotalIdxCount) > maxIndices) {
+        if (!warnedFull) {
+            std::cerr << "ImGuiRenderer: " << drawData.TotalVtxCount << " vertices and " << drawData.TotalIdxCount
+                      << " indices don't fit, not drawing the overlay\n";
+            warnedFull = true;
+        }
+        return;
+    }
+
+    // Every draw list one after the other, in one block of each ring
+    vertices.beginFrame(frame);
+    indices.beginFrame(frame);
+    auto vertexBlock = vertices.reserve(vk::DeviceSize(drawData.TotalVtxCount) * sizeof(ImDrawVert));
+    auto indexBlock = indices.reserve(vk::DeviceSize(drawData.TotalIdxCount) * sizeof(ImDrawIdx));
+    auto lists = std::span<ImDrawList *const>(drawData.CmdLists, static_cast<std::size_t>(drawData.CmdListsCount));
+    auto *vertexDestination = vertexBlock.data;
+    auto *indexDestination = indexBlock.data;
+    for (auto const *list : lists) {
+        auto vertexBytes = static_cast<std::size_t>(list->VtxBuffer.Size) * sizeof(ImDrawVert);
+        auto indexBytes = static_cast<std::size_t>(list->IdxBuffer.Size) * sizeof(ImDrawIdx);
+        std::memcpy(vertexDestination, list->VtxBuffer.Data, vertexBytes);
+        std::memcpy(indexDestination, list->IdxBuffer.Data, indexBytes);
+        vertexDestination += vertexBytes;
+        indexDestination += indexBytes;
+    }
+
+    setupState(commandBuffer, drawData, vertexBlock.offset, indexBlock.offset, extent);
+
+    // Draws carrying straight on from the one before, with the same texture
+    // and clip rectangle, are merged, and state is only set when it changes
+    struct Draw {
+        vk::Rect2D scissor;
+        std::uint32_t texture;
+        std::uint32_t firstIndex;
+        std::uint32_t indexCount;
+        std::int32_t vertexOffset;
+    };
+    std::optional<Draw> pending;
+    std::optional<vk::Rect2D> scissor;
+    std::uint32_t texture = fontSlot;
+    auto flush = [&] {
+        if (!pending) {
+            return;
+        }
+        if (scissor != pending->scissor) {
+            commandBuffer.setScissor(0, pending->scissor);
+            scissor = pending->scissor;
+        }
+        if (texture != pending->texture) {
+            commandBuffer.pushConstants<std::uint32_t>(*pipelineLayout,
+                vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, offsetof(PushConstants, texture),
+                pending->texture);
+            texture = pending->texture;
+        }
+        commandBuffer.drawIndexed(pending->indexCount, 1, pending->firstIndex, pending->vertexOffset, 0);
+        pending.reset();
+    };
+
+    // Clip rectangles are in ImGui's display coordinates, scissors in
+    // framebuffer pixels
+    auto clipOffset = drawData.DisplayPos;
+    auto clipScale = drawData.FramebufferScale;
+    std::uint32_t listIndexStart = 0;
+    std::int32_t listVertexStart = 0;
+    for (auto const *list : lists) {
+        for (auto const &command : list->CmdBuffer) {
+            if (command.UserCallback != nullptr) {
+                flush();
+                if (command.UserCallback == ImDrawCallback_ResetRenderState) {
+                    setupState(commandBuffer, drawData, vertexBlock.offset, indexBlock.offset, extent);
+                    scissor.reset();
+                    texture = fontSlot;
+                } else {
+                    command.UserCallback(list, &command);
+                }
+                continue;
+            }
+
+            auto left = std::max((command.ClipRect.x - clipOffset.x) * clipScale.x, 0.0F);
+            auto top = std::max((command.ClipRect.y - clipOffset.y) * clipScale.y, 0.0F);
+            auto right = std::min((command.ClipRect.z - clipOffset.x) * clipScale.x, static_cast<float>(extent.width));
+            auto bottom = std::min((command.ClipRect.w - clipOffset.y) * clipScale.y, static_cast<float>(extent.height));
+            if (right <= left || bottom <= top) {
+                continue;
+            }
+
+            auto draw = Draw{
+                .scissor = vk::Rect2D{
+                    .offset = vk::Offset2D{.x = static_cast<std::int32_t>(left), .y = static_cast<std::int32_t>(top)},
+                    .extent = vk::Extent2D{.width = static_cast<std::uint32_t>(right - left), .height = static_cast<std::uint32_t>(bottom - top)}},
+                .texture = textureSlot(command.GetTexID()),
+                .firstIndex = listIndexStart + command.IdxOffset,
+                .indexCount = command.ElemCount,
+                .vertexOffset = listVertexStart + static_cast<std::int32_t>(command.VtxOffset)};
+            if (pending && pending->scissor == draw.scissor && pending->texture == draw.texture &&
+                pending->vertexOffset == draw.vertexOffset && pending->firstIndex + pending->indexCount == draw.firstIndex) {
+                pending->indexCount += draw.indexCount;
+                continue;
+            }
+            flush();
+            pending = draw;
+        }
+        listIndexStart += static_cast<std::uint32_t>(list->IdxBuffer.Size);
+        listVertexStart += list->VtxBuffer.Size;
+    }
+    flush();
+}
@@ -0,0 +1,96 @@
+#ifndef UI_IMGUI_RENDERER_H
+#define UI_IMGUI_RENDERER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <imgui.h>
+
+#include "bindless_textures.h"
+#include "frame_ring.h"
+#include "gpu_allocator.h"
+#include "pipeline_manager.h"
+#include "render_target.h"
+#include "vulkan_config.h"
+
+// Draws ImGui's draw data, in place of the imgui_impl_vulkan backend.
+//
+// A frame's vertices and indices are copied straight into that frame's
+// section of two persistently mapped rings (see FrameRing), so drawing
+// the overlay never allocates, maps or creates anything. Textures are slots
+// in BindlessTextures, the font atlas included: the table is bound once and
+// a texture change is just a push constant, so draws are only split where
+// the texture or clip rectangle actually changes.
+//
+// The pipeline compiles in the background (see PipelineManager), until it's
+// ready the overlay just isn't drawn.
+//
+// Render thread only, and only one at a time, it registers itself with
+// ImGui's (global) context.
+class ImGuiRenderer {
+  public:
+    // At most `maxVertices` and `maxIndices` a frame, past that the frame's
+    // overlay is skipped. `pipelines` has to be destroyed first
+    ImGuiRenderer(vk::raii::Device const &, GpuAllocator &, BindlessTextures &,
+        RenderTarget const &, PipelineManager &pipelines, std::size_t framesInFlight,
+        std::uint32_t maxVertices = 128 * 1024, std::uint32_t maxIndices = 384 * 1024);
+    ~ImGuiRenderer();
+    ImGuiRenderer(ImGuiRenderer const &) = delete;
+    auto operator=(ImGuiRenderer const &) -> ImGuiRenderer & = delete;
+
+    // Builds the font atlas and records its upload, once, before the first
+    // frame. The staging buffer is kept until fontsUploaded()
+    void uploadFonts(vk::raii::CommandBuffer const &);
+    void fontsUploaded();
+
+    // Records `drawData` into `commandBuffer`, inside the render pass. Only
+    // once the frame's fence has been waited on, it overwrites the frame's
+    // vertices
+    void record(vk::raii::CommandBuffer const &, ImDrawData const &, std::size_t frame, vk::Extent2D);
+
+    // For ImGui::Image() and friends, any slot in the texture table
+    static auto textureId(std::uint32_t slot) -> ImTextureID {
+        return reinterpret_cast<ImTextureID>(static_cast<std::uintptr_t>(slot));
+    }
+
+  private:
+    // Matches imgui.vert
+    struct PushConstants {
+        glm::vec2 scale;
+        glm::vec2 translate;
+        std::uint32_t texture;
+    };
+
+    vk::raii::Device const &device;
+    GpuAllocator &allocator;
+    BindlessTextures &textures;
+    PipelineManager &pipelines;
+    const std::uint32_t maxVertices;
+    const std::uint32_t maxIndices;
+
+    FrameRing vertices;
+    FrameRing indices;
+    bool warnedFull = false;
+
+    GpuImage fontImage;
+    vk::raii::ImageView fontView = nullptr;
+    vk::raii::Sampler sampler = nullptr;
+    GpuBuffer fontStaging;
+    std::uint32_t fontSlot = 0;
+    bool fontAdded = false;
+
+    vk::raii::PipelineLayout pipelineLayout = nullptr;
+    vk::raii::ShaderModule vertexShaderModule = nullptr;
+    vk::raii::ShaderModule fragmentShaderModule = nullptr;
+    PipelineManager::Id pipelineId = 0;
+    // As of the last record()
+    vk::Pipeline framePipeline;
+
+    auto createPipeline(vk::raii::PipelineCache const &, RenderTarget const &) const -> vk::raii::Pipeline;
+
+    void setupState(vk::raii::CommandBuffer const &, ImDrawData const &, std::uint32_t vertexOffset, std::uint32_t indexOffset,
+        vk::Extent2D) const;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "pipeline_manager.h"
+
+PipelineManager::PipelineManager(vk::raii::PipelineCache const &cache, std::size_t threads)
+    : pipelineCache(cache), workers(std::max<std::size_t>(threads, 1)) {
+}
+
+PipelineManager::~PipelineManager() {
+    // Nobody is going to draw with anything that hasn't started yet, and
+    // the callback's target may well be gone already
+    std::lock_guard lock(mutex);
+    stopping = true;
+    callback = nullptr;
+}
+
+auto PipelineManager::compile(std::string name, Build build) -> Id {
+    Entry *entry = nullptr;
+    Id id = 0;
+    {
+        std::lock_guard lock(mutex);
+        id = entries.size();
+        entry = entries.emplace_back(std::make_unique<Entry>()).get();
+        entry->name = std::move(name);
+        remaining++;
+    }
+
+    workers.submit([this, entry, job = std::move(build)] {
+        {
+            std::lock_guard lock(mutex);
+            if (stopping) {
+                return;
+            }
+        }
+
+        // The slow part, so outside the lock
+        vk::raii::Pipeline pipeline = nullptr;
+        std::exception_ptr error;
+        try {
+            pipeline = job(pipelineCache);
+        } catch (std::exception const &err) {
+            error = std::make_exception_ptr(std::runtime_error("Could not compile the " + entry->name + " pipeline: " + err.what()));
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard lock(mutex);
+        entry->pipeline = std::move(pipeline);
+        entry->error = error;
+        entry->done = true;
+        remaining--;
+        compiled.notify_all();
+        if (callback) {
+            callback();
+        }
+    });
+    return id;
+}
+
+auto PipelineManager::lookup(Id id) const -> Entry & {
+    if (id >= entries.size()) {
+        throw std::out_of_range("No such pipeline in the PipelineManager");
+    }
+    return *entries[id];
+}
+
+auto PipelineManager::ready(Id id) -> vk::Pipeline {
+    std::lock_guard lock(mutex);
+    auto const &entry = lookup(id);
+    if (entry.error) {
+        std::rethrow_exception(entry.error);
+    }
+    return entry.done ? *entry.pipeline : vk::Pipeline();
+}
+
+auto PipelineManager::wait(Id id) -> vk::Pipeline {
+    std::unique_lock lock(mutex);
+    auto const &entry = lookup(id);
+    compiled.wait(lock, [&entry] { return entry.done; });
+    if (entry.error) {
+        std::rethrow_exception(entry.error);
+    }
+    return *entry.pipeline;
+}
+
+void PipelineManager::waitAll() {
+    std::unique_lock lock(mutex);
+    compiled.wait(lock, [this] { return remaining == 0; });
+}
+
+auto PipelineManager::pending() -> std::size_t {
+    std::lock_guard lock(mutex);
+    return remaining;
+}
+
+void PipelineManager::onCompiled(std::function<void()> function) {
+    std::lock_guard lock(mutex);
+    callback = std::move(function);
+}
@@ -0,0 +1,84 @@
+#ifndef UI_PIPELINE_MANAGER_H
+#define UI_PIPELINE_MANAGER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "thread_pool.h"
+#include "vulkan_config.h"
+
+// Compiles pipelines in the background, so the window comes up without
+// waiting for every shader to go through the driver's compiler first.
+//
+// Every pipeline is a job on worker threads of our own, all compiling into
+// the one pipeline cache (Vulkan makes a cache safe to share between
+// threads unless it's created externally synchronized). Whoever asked for a
+// pipeline checks whether it's ready when recording and skips its draws
+// until it is, so the first frames show whatever has compiled by then and
+// the rest turns up a frame or two later. Anything that really can't go
+// without its pipeline can wait() for it instead.
+//
+// Variants of one shader are specialization constants rather then copies
+// of the shader (see Resampler), so they share a module, and most of the
+// driver's front end work.
+//
+// Safe to use from any thread. Destroy it before anything the jobs use
+// (layouts, shader modules, the cache), queued jobs that haven't started
+// are dropped and it waits for the rest.
+class PipelineManager {
+  public:
+    // Builds one pipeline with the cache it's given, on a worker thread
+    using Build = std::function<vk::raii::Pipeline(vk::raii::PipelineCache const &)>;
+    using Id = std::size_t;
+
+    PipelineManager(vk::raii::PipelineCache const &, std::size_t threads);
+    ~PipelineManager();
+    PipelineManager(PipelineManager const &) = delete;
+    auto operator=(PipelineManager const &) -> PipelineManager & = delete;
+
+    // Queues `build` up, in order. `name` is for error messages
+    auto compile(std::string name, Build build) -> Id;
+    // Null until it has compiled. Throws if compiling it failed
+    auto ready(Id) -> vk::Pipeline;
+    // Same, but blocks until it has compiled
+    auto wait(Id) -> vk::Pipeline;
+    // Blocks until everything queued so far is done, failed or not, e.g.
+    // for a benchmark that shouldn't time the first frames without
+    void waitAll();
+    [[nodiscard]] auto pending() -> std::size_t;
+    // Called on the worker thread each time a pipeline is done, e.g. to wake
+    // an EventLoop up so it gets drawn. Mustn't call back into the manager.
+    // Empty to stop
+    void onCompiled(std::function<void()>);
+
+  private:
+    struct Entry {
+        std::string name;
+        vk::raii::Pipeline pipeline = nullptr;
+        std::exception_ptr error;
+        bool done = false;
+    };
+
+    vk::raii::PipelineCache const &pipelineCache;
+
+    std::mutex mutex;
+    std::condition_variable compiled;
+    // Pointers so a job can hold on to its own while more are queued
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::size_t remaining = 0;
+    std::function<void()> callback;
+    bool stopping = false;
+
+    auto lookup(Id) const -> Entry &;
+
+    // Last, so it's stopped before anything above goes away
+    core::ThreadPool workers;
+};
+
+#endif
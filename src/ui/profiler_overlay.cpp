@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <exception>
+#include <string_view>
+#include <utility>
+
+#include <imgui.h>
+
+#include "profiler_overlay.h"
+
+namespace {
+
+struct Stat {
+    float last = 0.0F;
+    float total = 0.0F;
+    float worst = 0.0F;
+    std::size_t count = 0;
+
+    void add(float value) {
+        if (count == 0) {
+            last = value;
+        }
+        total += value;
+        worst = std::max(worst, value);
+        count++;
+    }
+    [[nodiscard]] auto average() const -> float { return count == 0 ? 0.0F : total / static_cast<float>(count); }
+};
+
+// Graphs go oldest to newest, left to right
+auto frameInterval(void *data, int index) -> float {
+    auto const &profiler = *static_cast<FrameProfiler const *>(data);
+    return profiler.frame(profiler.frameCount() - 1 - static_cast<std::size_t>(index)).interval;
+}
+
+auto gpuTime(void *data, int index) -> float {
+    auto const &profiler = *static_cast<FrameProfiler const *>(data);
+    auto const &frame = profiler.frame(profiler.frameCount() - 1 - static_cast<std::size_t>(index));
+    return frame.gpuValid ? frame.gpuTotal() : 0.0F;
+}
+
+void statRow(std::string_view name, Stat const &stat) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(name.data(), name.data() + name.size());
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", static_cast<double>(stat.last));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", static_cast<double>(stat.average()));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.2f", static_cast<double>(stat.worst));
+}
+
+} // namespace
+
+ProfilerOverlay::ProfilerOverlay(std::filesystem::path path) : dumpPath(std::move(path)) {
+}
+
+void ProfilerOverlay::draw(FrameProfiler const &profiler) {
+    if (!visible) {
+        return;
+    }
+
+    ImGui::SetNextWindowPos(ImVec2(10.0F, 10.0F), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowBgAlpha(0.8F);
+    if (!ImGui::Begin("Frame profiler", &visible, ImGuiWindowFlags_AlwaysAutoResize)) {
+        ImGui::End();
+        return;
+    }
+
+    auto count = profiler.frameCount();
+    if (count == 0) {
+        ImGui::TextUnformatted("No frames yet");
+        ImGui::End();
+        return;
+    }
+
+    Stat interval;
+    Stat gpuTotal;
+    std::array<Stat, FrameProfiler::cpuStageCount> cpu;
+    std::array<Stat, FrameProfiler::gpuPassCount> gpu;
+    for (std::size_t age = 0; age < count; age++) {
+        auto const &frame = profiler.frame(age);
+        interval.add(frame.interval);
+        for (std::size_t stage = 0; stage < cpu.size(); stage++) {
+            cpu[stage].add(frame.cpu[stage]);
+        }
+        if (frame.gpuValid) {
+            gpuTotal.add(frame.gpuTotal());
+            for (std::size_t pass = 0; pass < gpu.size(); pass++) {
+                gpu[pass].add(frame.gpu[pass]);
+            }
+        }
+    }
+
+    // At least two 60Hz frames high, so a steady 60 fps sits in the middle
+    // and spikes stand out
+    constexpr float minimumScale = 2.0F * 1000.0F / 60.0F;
+    std::array<char, 64> label{};
+    auto average = interval.average();
+    std::snprintf(label.data(), label.size(), "%.2f ms (%.0f fps)", static_cast<double>(average),
+        average > 0.0F ? 1000.0 / static_cast<double>(average) : 0.0);
+    ImGui::PlotLines("Frame", &frameInterval, const_cast<FrameProfiler *>(&profiler), static_cast<int>(count), 0,
+        label.data(), 0.0F, std::max(minimumScale, interval.worst), ImVec2(300.0F, 60.0F));
+
+    if (profiler.gpuSupported()) {
+        std::snprintf(label.data(), label.size(), "%.2f ms", static_cast<double>(gpuTotal.average()));
+        ImGui::PlotLines("GPU", &gpuTime, const_cast<FrameProfiler *>(&profiler), static_cast<int>(count), 0,
+            label.data(), 0.0F, std::max(minimumScale, gpuTotal.worst), ImVec2(300.0F, 60.0F));
+    } else {
+        ImGui::TextUnformatted("GPU timestamps aren't supported");
+    }
+
+    if (ImGui::BeginTable("stages", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("ms");
+        ImGui::TableSetupColumn("last");
+        ImGui::TableSetupColumn("avg");
+        ImGui::TableSetupColumn("max");
+        ImGui::TableHeadersRow();
+
+        for (std::size_t stage = 0; stage < cpu.size(); stage++) {
+            statRow(FrameProfiler::name(static_cast<CpuStage>(stage)), cpu[stage]);
+        }
+        if (gpuTotal.count != 0) {
+            for (std::size_t pass = 0; pass < gpu.size(); pass++) {
+                std::snprintf(label.data(), label.size(), "gpu %s", FrameProfiler::name(static_cast<GpuPass>(pass)).data());
+                statRow(label.data(), gpu[pass]);
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Dump to file")) {
+        dump(profiler);
+    }
+    if (!status.empty()) {
+        ImGui::TextUnformatted(status.c_str());
+    }
+    ImGui::End();
+}
+
+auto ProfilerOverlay::dump(FrameProfiler const &profiler) -> bool {
+    try {
+        profiler.dump(dumpPath);
+        status = "Wrote " + dumpPath.string();
+        return true;
+    } catch (std::exception const &err) {
+        status = err.what();
+        return false;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef UI_PROFILER_OVERLAY_H
+#define UI_PROFILER_OVERLAY_H
+
+#include <filesystem>
+#include <string>
+
+#include "frame_profiler.h"
+
+// An ImGui window over the frame showing where the time goes: rolling
+// graphs of the frame interval and GPU time, and the average and worst
+// time of every CPU stage and GPU pass over the history. For telling at a
+// glance whether a hitch came from the event loop, uploads or the GPU.
+//
+// Call draw() between ImGuiLayer::newFrame() and render().
+class ProfilerOverlay {
+  public:
+    // Where the dump button writes the history to, as CSV
+    explicit ProfilerOverlay(std::filesystem::path dumpPath = "frame-profile.csv");
+
+    void draw(FrameProfiler const &);
+    void toggle() { visible = !visible; }
+    [[nodiscard]] auto shown() const -> bool { return visible; }
+    // Same as the button, returns false (and says why in the overlay) if it
+    // couldn't be written
+    auto dump(FrameProfiler const &) -> bool;
+
+  private:
+    std::filesystem::path dumpPath;
+    std::string status;
+    bool visible = true;
+};
+
+#endif
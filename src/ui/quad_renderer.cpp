@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "quad_renderer.h"
+
+namespace {
+
+// Same trick as the tutorial shaders in VulkanRender
+constexpr auto quadVertShader = std::to_array<std::uint32_t>({
+#include "quad.vert.inc"
+});
+
+constexpr auto quadFragShader = std::to_array<std::uint32_t>({
+#include "quad.frag.inc"
+});
+
+} // namespace
+
+QuadRenderer::QuadRenderer(vk::raii::PhysicalDevice const &physicalDevice, vk::raii::Device const &logicalDevice,
+    GpuAllocator &allocator, BindlessTextures const &bindlessTextures, RenderTarget const &target,
+    PipelineManager &pipelineManager, std::size_t framesInFlight, std::uint32_t quadLimit) : device(logicalDevice),
+                                                                                           textures(bindlessTextures),
+                                                                                           pipelines(pipelineManager),
+                                                                                           maxQuads(quadLimit),
+                                                                                           instances(allocator, logicalDevice,
+                                                                                               physicalDevice.getProperties().limits.minStorageBufferOffsetAlignment,
+                                                                                               vk::DeviceSize(quadLimit) * sizeof(QuadInstance),
+                                                                                               framesInFlight,
+                                                                                               vk::BufferUsageFlagBits::eStorageBuffer) {
+    pending.reserve(1024);
+
+    // Set 1, the frame's instances. Dynamic, so the offset of the frame's
+    // section is given when binding, and one set covers every frame
+    auto instanceBinding = vk::DescriptorSetLayoutBinding{
+        .binding = 0,
+        .descriptorType = vk::DescriptorType::eStorageBufferDynamic,
+        .descriptorCount = 1,
+        .stageFlags = vk::ShaderStageFlagBits::eVertex,
+        .pImmutableSamplers = nullptr};
+
+    instanceSetLayout = vk::raii::DescriptorSetLayout(device,
+        vk::DescriptorSetLayoutCreateInfo{
+            .flags = vk::DescriptorSetLayoutCreateFlags(),
+            .bindingCount = 1,
+            .pBindings = &instanceBinding});
+
+    auto poolSize = vk::DescriptorPoolSize{
+        .type = vk::DescriptorType::eStorageBufferDynamic,
+        .descriptorCount = 1};
+
+    descriptorPool = vk::raii::DescriptorPool(device,
+        vk::DescriptorPoolCreateInfo{
+            // eFreeDescriptorSet flag needed when using Vulkan RAII Library
+            .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+            .maxSets = 1,
+            .poolSizeCount = 1,
+            .pPoolSizes = &poolSize});
+
+    vk::raii::DescriptorSets sets(device,
+        vk::DescriptorSetAllocateInfo{
+            .descriptorPool = *descriptorPool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &(*instanceSetLayout)});
+    instanceSet = std::move(sets.front());
+
+    // A whole frame's section, every frame starts its instances at the
+    // start of it
+    auto bufferInfo = vk::DescriptorBufferInfo{
+        .buffer = instances.buffer(),
+        .offset = 0,
+        .range = vk::DeviceSize(maxQuads) * sizeof(QuadInstance)};
+
+    device.updateDescriptorSets(
+        vk::WriteDescriptorSet{
+            .dstSet = *instanceSet,
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eStorageBufferDynamic,
+            .pImageInfo = nullptr,
+            .pBufferInfo = &bufferInfo,
+            .pTexelBufferView = nullptr},
+        nullptr);
+
+    // Set 0 is the bindless texture table
+    std::array<vk::DescriptorSetLayout, 2> setLayouts = {textures.layout(), *instanceSetLayout};
+
+    auto pushConstantRange = vk::PushConstantRange{
+        .stageFlags = vk::ShaderStageFlagBits::eVertex,
+        .offset = 0,
+        .size = sizeof(glm::vec2)};
+
+    pipelineLayout = vk::raii::PipelineLayout(device,
+        vk::PipelineLayoutCreateInfo{
+            .flags = vk::PipelineLayoutCreateFlags(),
+            .setLayoutCount = static_cast<std::uint32_t>(setLayouts.size()),
+            .pSetLayouts = setLayouts.data(),
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstantRange});
+
+    vertexShaderModule = vk::raii::ShaderModule(device,
+        vk::ShaderModuleCreateInfo{
+            .flags = vk::ShaderModuleCreateFlags(),
+            .codeSize = quadVertShader.size() * sizeof(std::uint32_t),
+            .pCode = quadVertShader.data()});
+
+    fragmentShaderModule = vk::raii::ShaderModule(device,
+        vk::ShaderModuleCreateInfo{
+            .flags = vk::ShaderModuleCreateFlags(),
+            .codeSize = quadFragShader.size() * sizeof(std::uint32_t),
+            .pCode = quadFragShader.data()});
+
+    // The target by value, the job runs after the caller's has gone
+    pipelineId = pipelines.compile("quad", [this, target](vk::raii::PipelineCache const &cache) {
+        return createPipeline(cache, target);
+    });
+}
+
+auto QuadRenderer::createPipeline(vk::raii::PipelineCache const &pipelineCache, RenderTarget const &target) const -> vk::raii::Pipeline {
+    std::array<vk::PipelineShaderStageCreateInfo, 2> pipelineShaderStageCreateInfos = {
+        vk::PipelineShaderStageCreateInfo{
+            .flags = vk::PipelineShaderStageCreateFlags(),
+            .stage = vk::ShaderStageFlagBits::eVertex,
+            .module = *vertexShaderModule,
+            .pName = "main",
+            .pSpecializationInfo = nullptr},
+        vk::PipelineShaderStageCreateInfo{
+            .flags = vk::PipelineShaderStageCreateFlags(),
+            .stage = vk::ShaderStageFlagBits::eFragment,
+            .module = *fragmentShaderModule,
+            .pName = "main",
+            .pSpecializationInfo = nullptr}};
+
+    // No vertex buffers at all
+    auto pipelineVertexInputStateCreateInfo = vk::PipelineVertexInputStateCreateInfo{
+        .flags = vk::PipelineVertexInputStateCreateFlags(),
+        .vertexBindingDescriptionCount = 0,
+        .pVertexBindingDescriptions = nullptr,
+        .vertexAttributeDescriptionCount = 0,
+        .pVertexAttributeDescriptions = nullptr};
+
+    auto pipelineInputAssemblyStateCreateInfo = vk::PipelineInputAssemblyStateCreateInfo{
+        .flags = vk::PipelineInputAssemblyStateCreateFlags(),
+        .topology = vk::PrimitiveTopology::eTriangleList,
+        .primitiveRestartEnable = VK_FALSE};
+
+    auto pipelineViewportStateCreateInfo = vk::PipelineViewportStateCreateInfo{
+        .flags = vk::PipelineViewportStateCreateFlags(),
+        .viewportCount = 1,
+        .pViewports = nullptr,
+        .scissorCount = 1,
+        .pScissors = nullptr};
+
+    // Quads can be mirrored with a negative width or height, so no culling
+    auto pipelineRasterizationStateCreateInfo = vk::PipelineRasterizationStateCreateInfo{
+        .flags = vk::PipelineRasterizationStateCreateFlags(),
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = vk::PolygonMode::eFill,
+        .cullMode = vk::CullModeFlagBits::eNone,
+        .frontFace = vk::FrontFace::eClockwise,
+        .depthBiasEnable = VK_FALSE,
+        .depthBiasConstantFactor = 0.0F,
+        .depthBiasClamp = 0.0F,
+        .depthBiasSlopeFactor = 0.0F,
+        .lineWidth = 1.0F};
+
+    auto pipelineMultisampleStateCreateInfo = vk::PipelineMultisampleStateCreateInfo{
+        .flags = vk::PipelineMultisampleStateCreateFlags(),
+        .rasterizationSamples = vk::SampleCountFlagBits::e1,
+        .sampleShadingEnable = VK_FALSE,
+        .minSampleShading = 0.0F,
+        .pSampleMask = nullptr,
+        .alphaToCoverageEnable = VK_FALSE,
+        .alphaToOneEnable = VK_FALSE};
+
+    auto stencilOpState = vk::StencilOpState{
+        .failOp = vk::StencilOp::eKeep,
+        .passOp = vk::StencilOp::eKeep,
+        .depthFailOp = vk::StencilOp::eKeep,
+        .compareOp = vk::CompareOp::eAlways,
+        .compareMask = 0,
+        .writeMask = 0,
+        .reference = 0};
+
+    // The render pass has a depth attachment, but 2D quads have no use for it
+    auto pipelineDepthStencilStateCreateInfo = vk::PipelineDepthStencilStateCreateInfo{
+        .flags = vk::PipelineDepthStencilStateCreateFlags(),
+        .depthTestEnable = VK_FALSE,
+        .depthWriteEnable = VK_FALSE,
+        .depthCompareOp = vk::CompareOp::eAlways,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+        .front = stencilOpState,
+        .back = stencilOpState,
+        .minDepthBounds = 0.0F,
+        .maxDepthBounds = 1.0F};
+
+    vk::ColorComponentFlags colorComponentFlags(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                                vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+
+    // Straight alpha, covers with transparent corners and faded out
+    // placeholders blend over the background
+    auto pipelineColorBlendAttachmentState = vk::PipelineColorBlendAttachmentState{
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+        .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+        .dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+        .alphaBlendOp = vk::BlendOp::eAdd,
+        .colorWriteMask = colorComponentFlags};
+
+    auto pipelineColorBlendStateCreateInfo = vk::PipelineColorBlendStateCreateInfo{
+        .flags = vk::PipelineColorBlendStateCreateFlags(),
+        .logicOpEnable = VK_FALSE,
+        .logicOp = vk::LogicOp::eNoOp,
+        .attachmentCount = 1,
+        .pAttachments = &pipelineColorBlendAttachmentState,
+        .blendConstants = {{1.0F, 1.0F, 1.0F, 1.0F}}};
+
+    std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+
+    auto pipelineDynamicStateCreateInfo = vk::PipelineDynamicStateCreateInfo{
+        .flags = vk::PipelineDynamicStateCreateFlags(),
+        .dynamicStateCount = static_cast<std::uint32_t>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data()};
+
+    auto pipelineRendering = target.pipelineRendering();
+    return vk::raii::Pipeline(device, pipelineCache,
+        vk::GraphicsPipelineCreateInfo{
+            .pNext = target.dynamic() ? &pipelineRendering : nullptr,
+            .flags = vk::PipelineCreateFlags(),
+            .stageCount = static_cast<std::uint32_t>(pipelineShaderStageCreateInfos.size()),
+            .pStages = pipelineShaderStageCreateInfos.data(),
+            .pVertexInputState = &pipelineVertexInputStateCreateInfo,
+            .pInputAssemblyState = &pipelineInputAssemblyStateCreateInfo,
+            .pTessellationState = nullptr,
+            .pViewportState = &pipelineViewportStateCreateInfo,
+            .pRasterizationState = &pipelineRasterizationStateCreateInfo,
+            .pMultisampleState = &pipelineMultisampleStateCreateInfo,
+            .pDepthStencilState = &pipelineDepthStencilStateCreateInfo,
+            .pColorBlendState = &pipelineColorBlendStateCreateInfo,
+            .pDynamicState = &pipelineDynamicStateCreateInfo,
+            .layout = *pipelineLayout,
+            .renderPass = target.renderPass,
+            .subpass = 0,
+            .basePipelineHandle = nullptr,
+            .basePipelineIndex = 0});
+}
+
+void QuadRenderer::draw(std::span<QuadInstance const> quads) {
+    if (pending.size() + quads.size() > maxQuads) {
+        throw std::length_error("QuadRenderer: more then " + std::to_string(maxQuads) + " quads in one frame");
+    }
+    pending.insert(pending.end(), quads.begin(), quads.end());
+}
+
+auto QuadRenderer::prepare(std::size_t frame, std::size_t batchSize) -> std::span<Batch const> {
+    batches.clear();
+    std::swap(preparing, pending);
+    pending.clear();
+    // Nothing gets drawn until the pipeline has compiled, the quads will be
+    // queued again for the next frame anyway
+    batchPipeline = pipelines.ready(pipelineId);
+    if (preparing.empty() || !batchPipeline) {
+        return batches;
+    }
+
+    // One block of the frame's section for all of them, so every batch
+    // binds the same offset and picks its quads with firstInstance
+    instances.beginFrame(frame);
+    auto reservation = instances.reserve(preparing.size() * sizeof(QuadInstance));
+
+    batchSize = std::max<std::size_t>(batchSize, 1);
+    for (std::size_t first = 0; first < preparing.size(); first += batchSize) {
+        auto count = std::min(batchSize, preparing.size() - first);
+        batches.push_back(Batch{
+            .quads = std::span<QuadInstance const>(preparing).subspan(first, count),
+            .firstInstance = static_cast<std::uint32_t>(first),
+            .offset = reservation.offset,
+            .destination = reservation.data + first * sizeof(QuadInstance)});
+    }
+    return batches;
+}
+
+void QuadRenderer::record(vk::raii::CommandBuffer const &commandBuffer, Batch const &batch, vk::Extent2D extent) const {
+    std::memcpy(batch.destination, batch.quads.data(), batch.quads.size_bytes());
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, batchPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayout, 0,
+        {textures.set(), *instanceSet}, {batch.offset});
+    commandBuffer.pushConstants<glm::vec2>(*pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0,
+        glm::vec2(static_cast<float>(extent.width), static_cast<float>(extent.height)));
+    // Dynamic state doesn't carry over between command buffers, and a batch
+    // may well be in one of its own
+    commandBuffer.setViewport(0, vk::Viewport{
+                                     .x = 0.0F,
+                                     .y = 0.0F,
+                                     .width = static_cast<float>(extent.width),
+                                     .height = static_cast<float>(extent.height),
+                                     .minDepth = 0.0F,
+                                     .maxDepth = 1.0F});
+    commandBuffer.setScissor(0, vk::Rect2D{.offset = vk::Offset2D{.x = 0, .y = 0}, .extent = extent});
+
+    // Six vertices make the two triangles of a quad, one instance per quad
+    commandBuffer.draw(6, static_cast<std::uint32_t>(batch.quads.size()), 0, batch.firstInstance);
+}
@@ -0,0 +1,112 @@
+#ifndef UI_QUAD_RENDERER_H
+#define UI_QUAD_RENDERER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bindless_textures.h"
+#include "frame_ring.h"
+#include "gpu_allocator.h"
+#include "pipeline_manager.h"
+#include "render_target.h"
+#include "vulkan_config.h"
+
+// A textured rectangle on screen, laid out std430 to match quad.vert
+struct QuadInstance {
+    // Draws `tint` on its own, e.g. a placeholder for a cover that's still
+    // loading
+    static constexpr std::uint32_t noTexture = std::numeric_limits<std::uint32_t>::max();
+
+    // x, y, width, height in pixels, 0, 0 is the top left of the viewport
+    glm::vec4 rect{0.0F};
+    // The part of the texture to show, u, v, width, height
+    glm::vec4 uvRect{0.0F, 0.0F, 1.0F, 1.0F};
+    // Multiplied with the texture
+    glm::vec4 tint{1.0F};
+    // Slot in BindlessTextures
+    std::uint32_t texture = noTexture;
+    std::uint32_t padding[3] = {};
+};
+static_assert(sizeof(QuadInstance) == 64, "QuadInstance has to match the layout in quad.vert");
+
+// Draws any number of textured quads in a single instanced draw call.
+//
+// The quads queued up for a frame are copied into that frame's section of a
+// storage buffer, one instance each, and the vertex shader builds the
+// rectangles from them without any vertex buffer. Textures come out of the
+// bindless table, so nothing gets bound per quad either: a screen full of
+// thumbnails costs the same one bind and one draw as a single quad.
+//
+// Quads are drawn in the order they were queued, over whatever was drawn
+// before them, with alpha blending and no depth test.
+//
+// With a lot of quads, copying them in is the expensive part, so they can be
+// split into batches that are copied and recorded in parallel, a draw each.
+//
+// The pipeline compiles in the background (see PipelineManager), frames
+// prepared before it's ready have no batches.
+class QuadRenderer {
+  public:
+    // `pipelines` has to be destroyed first
+    QuadRenderer(vk::raii::PhysicalDevice const &, vk::raii::Device const &, GpuAllocator &, BindlessTextures const &,
+        RenderTarget const &, PipelineManager &pipelines, std::size_t framesInFlight, std::uint32_t maxQuads = 65536);
+
+    // A run of the frame's quads, recorded as one draw
+    struct Batch {
+        std::span<QuadInstance const> quads;
+        std::uint32_t firstInstance;
+        std::uint32_t offset;
+        std::byte *destination;
+    };
+
+    // Queue quads up for the next frame. Throws std::length_error past
+    // maxQuads a frame
+    void draw(std::span<QuadInstance const>);
+    // Takes the queued quads for `frame`, split into batches of at most
+    // `batchSize`, and clears the queue. Only once the frame's fence has
+    // been waited on, it overwrites the frame's instances. The batches stay
+    // valid until the next prepare(). No batches while the pipeline is
+    // still compiling
+    auto prepare(std::size_t frame, std::size_t batchSize) -> std::span<Batch const>;
+    // Copies the batch's instances in and records its draw, inside the
+    // render pass. Batches can be recorded on different threads into
+    // different command buffers, as long as those run in order
+    void record(vk::raii::CommandBuffer const &, Batch const &, vk::Extent2D) const;
+    // Drop the queued quads, for frames that are skipped
+    void discard() { pending.clear(); }
+    [[nodiscard]] auto queued() const -> std::size_t { return pending.size(); }
+
+  private:
+    vk::raii::Device const &device;
+    BindlessTextures const &textures;
+    PipelineManager &pipelines;
+    const std::uint32_t maxQuads;
+
+    std::vector<QuadInstance> pending;
+    // What the last prepare() took from `pending`, for its batches to point
+    // into
+    std::vector<QuadInstance> preparing;
+    // What the last prepare() returned, kept so it isn't allocated again
+    // every frame
+    std::vector<Batch> batches;
+    FrameRing instances;
+
+    vk::raii::DescriptorSetLayout instanceSetLayout = nullptr;
+    vk::raii::DescriptorPool descriptorPool = nullptr;
+    vk::raii::DescriptorSet instanceSet = nullptr;
+    vk::raii::PipelineLayout pipelineLayout = nullptr;
+    vk::raii::ShaderModule vertexShaderModule = nullptr;
+    vk::raii::ShaderModule fragmentShaderModule = nullptr;
+    PipelineManager::Id pipelineId = 0;
+    // As of the last prepare(), for its batches
+    vk::Pipeline batchPipeline;
+
+    auto createPipeline(vk::raii::PipelineCache const &, RenderTarget const &) const -> vk::raii::Pipeline;
+};
+
+#endif
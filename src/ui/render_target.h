@@ -0,0 +1,43 @@
+#ifndef UI_RENDER_TARGET_H
+#define UI_RENDER_TARGET_H
+
+#include "vulkan_config.h"
+
+// What a graphics pipeline (or a secondary command buffer) draws into.
+//
+// On the legacy path that's VulkanRender's render pass. With dynamic
+// rendering there is no render pass at all, and pipelines only need to know
+// the formats of the attachments, through the structs below. Both point
+// into this, so keep it around until they've been used.
+struct RenderTarget {
+    // Null with dynamic rendering
+    vk::RenderPass renderPass;
+    vk::Format colorFormat = vk::Format::eUndefined;
+    vk::Format depthFormat = vk::Format::eUndefined;
+
+    [[nodiscard]] auto dynamic() const -> bool { return !renderPass; }
+
+    // For the pNext of vk::GraphicsPipelineCreateInfo, only when dynamic()
+    [[nodiscard]] auto pipelineRendering() const -> vk::PipelineRenderingCreateInfo {
+        return vk::PipelineRenderingCreateInfo{
+            .viewMask = 0,
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &colorFormat,
+            .depthAttachmentFormat = depthFormat,
+            .stencilAttachmentFormat = vk::Format::eUndefined};
+    }
+
+    // For the pNext of vk::CommandBufferInheritanceInfo, only when dynamic()
+    [[nodiscard]] auto inheritanceRendering() const -> vk::CommandBufferInheritanceRenderingInfo {
+        return vk::CommandBufferInheritanceRenderingInfo{
+            .flags = vk::RenderingFlags(),
+            .viewMask = 0,
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &colorFormat,
+            .depthAttachmentFormat = depthFormat,
+            .stencilAttachmentFormat = vk::Format::eUndefined,
+            .rasterizationSamples = vk::SampleCountFlagBits::e1};
+    }
+};
+
+#endif
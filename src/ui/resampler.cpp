@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <array>
+
+#include "resampler.h"
+
+namespace {
+
+// Both passes, see the vertical specialization constant
+constexpr auto resampleShader = std::to_array<std::uint32_t>({
+#include "resample.comp.inc"
+});
+
+// Matches the push constants in resample.comp
+struct PushConstants {
+    std::int32_t sourceWidth;
+    std::int32_t sourceHeight;
+    std::int32_t destinationWidth;
+    std::int32_t destinationHeight;
+    ResampleFilter filter;
+};
+
+// Workgroups are 16x16
+auto groupCount(std::uint32_t size) -> std::uint32_t {
+    return (size + 15) / 16;
+}
+
+auto colorRange() -> vk::ImageSubresourceRange {
+    return vk::ImageSubresourceRange{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = 1};
+}
+
+} // namespace
+
+Resampler::Resampler(vk::raii::Device const &logicalDevice, GpuAllocator &gpuAllocator, PipelineManager &pipelineManager,
+    std::uint32_t maxTargets) : device(logicalDevice),
+                                allocator(gpuAllocator),
+                                pipelines(pipelineManager) {
+    // Only ever used with texelFetch, which ignores the filtering, but a
+    // combined image sampler needs one
+    sampler = vk::raii::Sampler(device,
+        vk::SamplerCreateInfo{
+            .flags = vk::SamplerCreateFlags(),
+            .magFilter = vk::Filter::eNearest,
+            .minFilter = vk::Filter::eNearest,
+            .mipmapMode = vk::SamplerMipmapMode::eNearest,
+            .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+            .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+            .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+            .mipLodBias = 0.0F,
+            .anisotropyEnable = VK_FALSE,
+            .maxAnisotropy = 1.0F,
+            .compareEnable = VK_FALSE,
+            .compareOp = vk::CompareOp::eNever,
+            .minLod = 0.0F,
+            .maxLod = 0.0F,
+            .borderColor = vk::BorderColor::eFloatTransparentBlack,
+            .unnormalizedCoordinates = VK_FALSE});
+
+    // What the pass reads, then the intermediate and final images it could
+    // write, as resample.comp names their formats
+    std::array<vk::DescriptorSetLayoutBinding, 3> bindings = {
+        vk::DescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .pImmutableSamplers = nullptr},
+        vk::DescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = vk::DescriptorType::eStorageImage,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .pImmutableSamplers = nullptr},
+        vk::DescriptorSetLayoutBinding{
+            .binding = 2,
+            .descriptorType = vk::DescriptorType::eStorageImage,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .pImmutableSamplers = nullptr}};
+
+    setLayout = vk::raii::DescriptorSetLayout(device,
+        vk::DescriptorSetLayoutCreateInfo{
+            .flags = vk::DescriptorSetLayoutCreateFlags(),
+            .bindingCount = static_cast<std::uint32_t>(bindings.size()),
+            .pBindings = bindings.data()});
+
+    // Two sets per target, one for each pass
+    std::array<vk::DescriptorPoolSize, 2> poolSizes = {
+        vk::DescriptorPoolSize{
+            .type = vk::DescriptorType::eCombinedImageSampler,
+            .descriptorCount = maxTargets * 2},
+        vk::DescriptorPoolSize{
+            .type = vk::DescriptorType::eStorageImage,
+            .descriptorCount = maxTargets * 4}};
+
+    descriptorPool = vk::raii::DescriptorPool(device,
+        vk::DescriptorPoolCreateInfo{
+            // eFreeDescriptorSet flag needed when using Vulkan RAII Library
+            .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+            .maxSets = maxTargets * 2,
+            .poolSizeCount = static_cast<std::uint32_t>(poolSizes.size()),
+            .pPoolSizes = poolSizes.data()});
+
+    auto pushConstantRange = vk::PushConstantRange{
+        .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = sizeof(PushConstants)};
+
+    pipelineLayout = vk::raii::PipelineLayout(device,
+        vk::PipelineLayoutCreateInfo{
+            .flags = vk::PipelineLayoutCreateFlags(),
+            .setLayoutCount = 1,
+            .pSetLayouts = &(*setLayout),
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstantRange});
+
+    shaderModule = vk::raii::ShaderModule(device,
+        vk::ShaderModuleCreateInfo{
+            .flags = vk::ShaderModuleCreateFlags(),
+            .codeSize = resampleShader.size() * sizeof(std::uint32_t),
+            .pCode = resampleShader.data()});
+
+    horizontalPipeline = pipelines.compile("horizontal resample", [this](vk::raii::PipelineCache const &cache) {
+        return createPipeline(cache, false);
+    });
+    verticalPipeline = pipelines.compile("vertical resample", [this](vk::raii::PipelineCache const &cache) {
+        return createPipeline(cache, true);
+    });
+}
+
+auto Resampler::createPipeline(vk::raii::PipelineCache const &pipelineCache, bool vertical) const -> vk::raii::Pipeline {
+    // constant_id 0 in resample.comp, booleans are VkBool32 sized
+    auto verticalValue = vk::Bool32(vertical ? VK_TRUE : VK_FALSE);
+    auto mapEntry = vk::SpecializationMapEntry{
+        .constantID = 0,
+        .offset = 0,
+        .size = sizeof(vk::Bool32)};
+    auto specializationInfo = vk::SpecializationInfo{
+        .mapEntryCount = 1,
+        .pMapEntries = &mapEntry,
+        .dataSize = sizeof(vk::Bool32),
+        .pData = &verticalValue};
+
+    return vk::raii::Pipeline(device, pipelineCache,
+        vk::ComputePipelineCreateInfo{
+            .flags = vk::PipelineCreateFlags(),
+            .stage = vk::PipelineShaderStageCreateInfo{
+                .flags = vk::PipelineShaderStageCreateFlags(),
+                .stage = vk::ShaderStageFlagBits::eCompute,
+                .module = *shaderModule,
+                .pName = "main",
+                .pSpecializationInfo = &specializationInfo},
+            .layout = *pipelineLayout,
+            .basePipelineHandle = nullptr,
+            .basePipelineIndex = 0});
+}
+
+auto Resampler::createTarget(vk::ImageView source, vk::Extent2D sourceExtent, vk::Extent2D extent) -> std::unique_ptr<Target> {
+    auto target = std::make_unique<Target>();
+    target->sourceExtent = sourceExtent;
+    target->outputExtent = extent;
+
+    // Horizontal pass output: the destination's width, the source's height
+    target->intermediate = createGpuImage(allocator, device,
+        vk::ImageCreateInfo{
+            .flags = vk::ImageCreateFlags(),
+            .imageType = vk::ImageType::e2D,
+            .format = vk::Format::eR16G16B16A16Sfloat,
+            .extent = vk::Extent3D{.width = extent.width, .height = sourceExtent.height, .depth = 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = vk::ImageLayout::eUndefined},
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    target->intermediateView = vk::raii::ImageView(device,
+        vk::ImageViewCreateInfo{
+            .flags = vk::ImageViewCreateFlags(),
+            .image = *target->intermediate.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = vk::Format::eR16G16B16A16Sfloat,
+            .components = vk::ComponentMapping(),
+            .subresourceRange = colorRange()});
+
+    // sRGB formats can't be storage images, so the image is UNORM, written
+    // through a UNORM view with the shader doing the encoding, and sampled
+    // through an sRGB view so it's decoded again when drawn
+    target->output = createGpuImage(allocator, device,
+        vk::ImageCreateInfo{
+            .flags = vk::ImageCreateFlagBits::eMutableFormat,
+            .imageType = vk::ImageType::e2D,
+            .format = vk::Format::eR8G8B8A8Unorm,
+            .extent = vk::Extent3D{.width = extent.width, .height = extent.height, .depth = 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = vk::ImageLayout::eUndefined},
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    target->storageView = vk::raii::ImageView(device,
+        vk::ImageViewCreateInfo{
+            .flags = vk::ImageViewCreateFlags(),
+            .image = *target->output.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = vk::Format::eR8G8B8A8Unorm,
+            .components = vk::ComponentMapping(),
+            .subresourceRange = colorRange()});
+
+    // The image has storage usage, which the sRGB view can't have
+    auto sampledUsage = vk::ImageViewUsageCreateInfo{.usage = vk::ImageUsageFlagBits::eSampled};
+    target->sampledView = vk::raii::ImageView(device,
+        vk::ImageViewCreateInfo{
+            .pNext = &sampledUsage,
+            .flags = vk::ImageViewCreateFlags(),
+            .image = *target->output.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = vk::Format::eR8G8B8A8Srgb,
+            .components = vk::ComponentMapping(),
+            .subresourceRange = colorRange()});
+
+    std::array<vk::DescriptorSetLayout, 2> layouts = {*setLayout, *setLayout};
+    vk::raii::DescriptorSets sets(device,
+        vk::DescriptorSetAllocateInfo{
+            .descriptorPool = *descriptorPool,
+            .descriptorSetCount = static_cast<std::uint32_t>(layouts.size()),
+            .pSetLayouts = layouts.data()});
+    target->horizontalSet = std::move(sets[0]);
+    target->verticalSet = std::move(sets[1]);
+
+    // Horizontal: source -> intermediate, vertical: intermediate -> output.
+    // Both images stay in eGeneral for both passes, so the storage bindings
+    // can be the same in both sets and the intermediate is read in the
+    // layout it was written in
+    std::array<vk::DescriptorImageInfo, 4> imageInfos = {
+        vk::DescriptorImageInfo{.sampler = *sampler, .imageView = source, .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal},
+        vk::DescriptorImageInfo{.sampler = *sampler, .imageView = *target->intermediateView, .imageLayout = vk::ImageLayout::eGeneral},
+        vk::DescriptorImageInfo{.sampler = nullptr, .imageView = *target->intermediateView, .imageLayout = vk::ImageLayout::eGeneral},
+        vk::DescriptorImageInfo{.sampler = nullptr, .imageView = *target->storageView, .imageLayout = vk::ImageLayout::eGeneral}};
+
+    auto write = [&](vk::raii::DescriptorSet const &set, std::uint32_t binding, vk::DescriptorType type, vk::DescriptorImageInfo const &info) {
+        return vk::WriteDescriptorSet{
+            .dstSet = *set,
+            .dstBinding = binding,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = type,
+            .pImageInfo = &info,
+            .pBufferInfo = nullptr,
+            .pTexelBufferView = nullptr};
+    };
+    std::array<vk::WriteDescriptorSet, 6> writes = {
+        write(target->horizontalSet, 0, vk::DescriptorType::eCombinedImageSampler, imageInfos[0]),
+        write(target->horizontalSet, 1, vk::DescriptorType::eStorageImage, imageInfos[2]),
+        write(target->horizontalSet, 2, vk::DescriptorType::eStorageImage, imageInfos[3]),
+        write(target->verticalSet, 0, vk::DescriptorType::eCombinedImageSampler, imageInfos[1]),
+        write(target->verticalSet, 1, vk::DescriptorType::eStorageImage, imageInfos[2]),
+        write(target->verticalSet, 2, vk::DescriptorType::eStorageImage, imageInfos[3])};
+    device.updateDescriptorSets(writes, nullptr);
+
+    return target;
+}
+
+auto Resampler::ready() -> bool {
+    return pipelines.ready(horizontalPipeline) && pipelines.ready(verticalPipeline);
+}
+
+auto Resampler::record(vk::raii::CommandBuffer const &commandBuffer, Target &target, ResampleFilter filter) -> bool {
+    auto horizontalPass = pipelines.ready(horizontalPipeline);
+    auto verticalPass = pipelines.ready(verticalPipeline);
+    if (!horizontalPass || !verticalPass) {
+        return false;
+    }
+
+    auto barrier = [](vk::Image image, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess, vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
+        return vk::ImageMemoryBarrier{
+            .srcAccessMask = srcAccess,
+            .dstAccessMask = dstAccess,
+            .oldLayout = oldLayout,
+            .newLayout = newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = colorRange()};
+    };
+
+    // Whatever was in both images before is overwritten, but earlier frames
+    // may still be drawing the old output, or an earlier resample reading
+    // the intermediate, so wait for those to finish
+    std::array<vk::ImageMemoryBarrier, 2> toGeneral = {
+        barrier(*target.intermediate.image, {}, vk::AccessFlagBits::eShaderWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral),
+        barrier(*target.output.image, {}, vk::AccessFlagBits::eShaderWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral)};
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), nullptr, nullptr, toGeneral);
+
+    auto horizontal = PushConstants{
+        .sourceWidth = static_cast<std::int32_t>(target.sourceExtent.width),
+        .sourceHeight = static_cast<std::int32_t>(target.sourceExtent.height),
+        .destinationWidth = static_cast<std::int32_t>(target.outputExtent.width),
+        .destinationHeight = static_cast<std::int32_t>(target.sourceExtent.height),
+        .filter = filter};
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, horizontalPass);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayout, 0, {*target.horizontalSet}, nullptr);
+    commandBuffer.pushConstants<PushConstants>(*pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, horizontal);
+    commandBuffer.dispatch(groupCount(target.outputExtent.width), groupCount(target.sourceExtent.height), 1);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+        vk::DependencyFlags(), nullptr, nullptr,
+        barrier(*target.intermediate.image, vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral));
+
+    auto vertical = PushConstants{
+        .sourceWidth = static_cast<std::int32_t>(target.outputExtent.width),
+        .sourceHeight = static_cast<std::int32_t>(target.sourceExtent.height),
+        .destinationWidth = static_cast<std::int32_t>(target.outputExtent.width),
+        .destinationHeight = static_cast<std::int32_t>(target.outputExtent.height),
+        .filter = filter};
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, verticalPass);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayout, 0, {*target.verticalSet}, nullptr);
+    commandBuffer.pushConstants<PushConstants>(*pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, vertical);
+    commandBuffer.dispatch(groupCount(target.outputExtent.width), groupCount(target.outputExtent.height), 1);
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+        vk::DependencyFlags(), nullptr, nullptr,
+        barrier(*target.output.image, vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal));
+    target.recorded = true;
+    return true;
+}
+
+void Resampler::queue(Target &target, ResampleFilter filter) {
+    auto existing = std::ranges::find(queued, &target, &Queued::target);
+    if (existing != queued.end()) {
+        existing->filter = filter;
+        return;
+    }
+    queued.push_back(Queued{&target, filter});
+}
+
+void Resampler::recordQueued(vk::raii::CommandBuffer const &commandBuffer) {
+    if (!ready()) {
+        return;
+    }
+    for (auto const &entry : queued) {
+        record(commandBuffer, *entry.target, entry.filter);
+    }
+    queued.clear();
+}
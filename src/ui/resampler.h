@@ -0,0 +1,108 @@
+#ifndef UI_RESAMPLER_H
+#define UI_RESAMPLER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "gpu_allocator.h"
+#include "pipeline_manager.h"
+#include "vulkan_config.h"
+
+enum class ResampleFilter : std::int32_t {
+    // Catmull-Rom, cheaper and with less ringing next to hard edges
+    Bicubic = 0,
+    // Sharper, the better choice for text and screentones
+    Lanczos3 = 1,
+};
+
+// High quality scaling of page textures on the GPU, in a compute pipeline.
+//
+// A page is shown at whatever size fit-to-width, the zoom level and the
+// display's scale factor work out to, and plain bilinear sampling of a page
+// shrunk to a third of its size aliases badly. So instead of resampling on
+// the CPU every time the zoom changes, a page is resampled into a target of
+// exactly the size it's shown at, which is then drawn 1:1.
+//
+// The filter is separable, so it runs as two passes (horizontal into a
+// half float intermediate, then vertical), in linear light. Both are the
+// same shader, with a specialization constant for the direction.
+class Resampler {
+  public:
+    // A page at the size it's shown at. `view` is an sRGB view to sample it
+    // through, in eShaderReadOnlyOptimal once the resample has run.
+    // Destroy it before the Resampler, only once the GPU is done with it and
+    // not while it's still queued
+    class Target {
+      public:
+        [[nodiscard]] auto view() const -> vk::ImageView { return *sampledView; }
+        [[nodiscard]] auto image() const -> vk::Image { return *output.image; }
+        [[nodiscard]] auto extent() const -> vk::Extent2D { return outputExtent; }
+        // Whether a resample has been recorded into it yet. Until then
+        // there's nothing in it to draw, draw the source texture instead
+        [[nodiscard]] auto resampled() const -> bool { return recorded; }
+
+      private:
+        friend class Resampler;
+
+        vk::Extent2D sourceExtent;
+        vk::Extent2D outputExtent;
+        GpuImage intermediate;
+        vk::raii::ImageView intermediateView = nullptr;
+        GpuImage output;
+        vk::raii::ImageView storageView = nullptr;
+        vk::raii::ImageView sampledView = nullptr;
+        // One set per pass
+        vk::raii::DescriptorSet horizontalSet = nullptr;
+        vk::raii::DescriptorSet verticalSet = nullptr;
+        bool recorded = false;
+    };
+
+    // Up to `maxTargets` targets can exist at once. The pipelines are
+    // compiled by `pipelines`, which has to be destroyed first
+    Resampler(vk::raii::Device const &, GpuAllocator &, PipelineManager &, std::uint32_t maxTargets = 64);
+
+    // `source` has to be an sRGB view (e.g. a TextureManager texture) in
+    // eShaderReadOnlyOptimal, and stay alive as long as the target is
+    // resampled from it
+    auto createTarget(vk::ImageView source, vk::Extent2D sourceExtent, vk::Extent2D extent) -> std::unique_ptr<Target>;
+
+    // Whether the pipelines have compiled, so record() does something
+    [[nodiscard]] auto ready() -> bool;
+    // Records both passes, with the barriers around them, outside of a
+    // render pass. Afterwards the target can be sampled by fragment and
+    // compute shaders. Records nothing and returns false while the
+    // pipelines are still compiling, rather then holding the frame up
+    auto record(vk::raii::CommandBuffer const &, Target &, ResampleFilter) -> bool;
+    // Same, but recorded at the start of the next frame by
+    // VulkanRender::render(), so it's ready to be drawn in that frame. If
+    // the pipelines aren't ready by then it stays queued for the frame
+    // after, queueing a target again only changes the filter
+    void queue(Target &, ResampleFilter);
+    void recordQueued(vk::raii::CommandBuffer const &);
+
+  private:
+    struct Queued {
+        Target *target;
+        ResampleFilter filter;
+    };
+
+    auto createPipeline(vk::raii::PipelineCache const &, bool vertical) const -> vk::raii::Pipeline;
+
+    vk::raii::Device const &device;
+    GpuAllocator &allocator;
+    PipelineManager &pipelines;
+
+    vk::raii::Sampler sampler = nullptr;
+    vk::raii::DescriptorSetLayout setLayout = nullptr;
+    vk::raii::DescriptorPool descriptorPool = nullptr;
+    vk::raii::PipelineLayout pipelineLayout = nullptr;
+    // One module for both passes, kept until they have compiled
+    vk::raii::ShaderModule shaderModule = nullptr;
+    PipelineManager::Id horizontalPipeline = 0;
+    PipelineManager::Id verticalPipeline = 0;
+
+    std::vector<Queued> queued;
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include <utility>
+
+#include "staging_ring.h"
+
+namespace {
+
+auto alignUp(vk::DeviceSize value, vk::DeviceSize alignment) -> vk::DeviceSize {
+    // optimalBufferCopyOffsetAlignment is a power of two, but with the texel
+    // size on top it need not be
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+auto createStagingBuffer(GpuAllocator &allocator, vk::raii::Device const &device, vk::DeviceSize size) -> GpuBuffer {
+    // Only ever read by copies on the upload queue, so no need to share it
+    // with the graphics family
+    return createGpuBuffer(allocator, device,
+        vk::BufferCreateInfo{
+            .flags = vk::BufferCreateFlags(),
+            .size = size,
+            .usage = vk::BufferUsageFlagBits::eTransferSrc,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr},
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+} // namespace
+
+StagingRing::Region::~Region() {
+    release();
+}
+
+StagingRing::Region::Region(Region &&other) noexcept : ring(std::exchange(other.ring, nullptr)),
+                                                        block(other.block),
+                                                        handle(std::exchange(other.handle, nullptr)),
+                                                        bufferOffset(other.bufferOffset),
+                                                        mapped(std::exchange(other.mapped, nullptr)),
+                                                        length(std::exchange(other.length, 0)),
+                                                        ownBuffer(std::exchange(other.ownBuffer, false)),
+                                                        dedicated(std::move(other.dedicated)),
+                                                        reservation(std::move(other.reservation)) {
+}
+
+auto StagingRing::Region::operator=(Region &&other) noexcept -> Region & {
+    if (this != &other) {
+        release();
+        ring = std::exchange(other.ring, nullptr);
+        block = other.block;
+        handle = std::exchange(other.handle, nullptr);
+        bufferOffset = other.bufferOffset;
+        mapped = std::exchange(other.mapped, nullptr);
+        length = std::exchange(other.length, 0);
+        ownBuffer = std::exchange(other.ownBuffer, false);
+        dedicated = std::move(other.dedicated);
+        reservation = std::move(other.reservation);
+    }
+    return *this;
+}
+
+void StagingRing::Region::release() {
+    // The buffer first, its bytes only count as free once it's gone
+    dedicated = GpuBuffer();
+    if (ring != nullptr) {
+        auto *owner = std::exchange(ring, nullptr);
+        if (ownBuffer) {
+            owner->releaseDedicated(length);
+        } else {
+            owner->release(block);
+        }
+    }
+    reservation.release();
+    ownBuffer = false;
+    handle = nullptr;
+    mapped = nullptr;
+    length = 0;
+}
+
+StagingRing::StagingRing(GpuAllocator &gpuAllocator, vk::raii::Device const &logicalDevice, vk::DeviceSize size,
+    vk::DeviceSize offsetAlignment, vk::DeviceSize maxDedicated) : allocator(gpuAllocator),
+                                                                   device(logicalDevice),
+                                                                   alignment(offsetAlignment),
+                                                                   // Whole regions, so one that ends at the end of the buffer is aligned too
+                                                                   ringSize(alignUp(size, offsetAlignment)),
+                                                                   dedicatedLimit(maxDedicated) {
+    ring = createStagingBuffer(allocator, device, ringSize);
+}
+
+auto StagingRing::acquire(vk::DeviceSize size, core::MemoryBudget *budget) -> Region {
+    Region region;
+    if (budget != nullptr) {
+        auto reservation = budget->tryReserve(static_cast<std::size_t>(size));
+        if (!reservation) {
+            return region;
+        }
+        region.reservation = std::move(*reservation);
+    }
+    region.length = size;
+    size = alignUp(size, alignment);
+
+    if (size <= ringSize) {
+        std::lock_guard lock(mutex);
+        // A region never wraps, if it doesn't fit before the end the rest of
+        // the buffer is skipped and counted as part of it
+        auto start = head;
+        auto position = head % ringSize;
+        if (position + size > ringSize) {
+            start += ringSize - position;
+        }
+
+        if (start + size - tail <= ringSize) {
+            blocks.push_back(Block{.start = head, .released = false});
+            region.ring = this;
+            region.block = head;
+            region.handle = *ring.buffer;
+            region.bufferOffset = start % ringSize;
+            region.mapped = ring.allocation.mapped() + region.bufferOffset;
+            head = start + size;
+            return region;
+        }
+    }
+
+    // Full, or it would never fit
+    {
+        std::lock_guard lock(mutex);
+        if (dedicatedBytes != 0 && dedicatedBytes + region.length > dedicatedLimit) {
+            // Gives the reservation back too
+            return Region();
+        }
+        dedicatedBytes += region.length;
+    }
+    try {
+        region.dedicated = createStagingBuffer(allocator, device, region.length);
+    } catch (...) {
+        releaseDedicated(region.length);
+        throw;
+    }
+    region.ring = this;
+    region.ownBuffer = true;
+    region.handle = *region.dedicated.buffer;
+    region.bufferOffset = 0;
+    region.mapped = region.dedicated.allocation.mapped();
+    return region;
+}
+
+void StagingRing::releaseDedicated(vk::DeviceSize size) {
+    std::lock_guard lock(mutex);
+    dedicatedBytes -= size;
+}
+
+void StagingRing::release(vk::DeviceSize start) {
+    std::lock_guard lock(mutex);
+    for (auto &entry : blocks) {
+        if (entry.start == start) {
+            entry.released = true;
+            break;
+        }
+    }
+    while (!blocks.empty() && blocks.front().released) {
+        blocks.pop_front();
+    }
+    tail = blocks.empty() ? head : blocks.front().start;
+}
+
+auto StagingRing::used() -> vk::DeviceSize {
+    std::lock_guard lock(mutex);
+    return head - tail;
+}
+
+auto StagingRing::dedicatedUsed() -> vk::DeviceSize {
+    std::lock_guard lock(mutex);
+    return dedicatedBytes;
+}
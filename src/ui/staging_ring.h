@@ -0,0 +1,121 @@
+#ifndef UI_STAGING_RING_H
+#define UI_STAGING_RING_H
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+#include "gpu_allocator.h"
+#include "memory_budget.h"
+#include "vulkan_config.h"
+
+// Staging memory for uploads, written straight into by whoever produces the
+// data (e.g. a page decoder) so it only has to be copied once more, by the
+// GPU.
+//
+// One persistently mapped buffer, handed out front to back as regions that
+// wrap around at the end. A region is given back when it's destroyed, and
+// its owner has to keep it until the GPU is done copying out of it, i.e. hold
+// on to it with the command buffer and only let go once the fence has been
+// waited on. Regions are given back in any order, but space is only reused
+// once everything before it has been given back too, uploads finish roughly
+// in the order they were made so that's rarely a problem.
+//
+// Never blocks. A region that doesn't fit (too large, or everything is still
+// in use) gets a buffer of its own instead, which is slower but no different
+// to use. Waiting for space would mean waiting for uploads that can't be
+// submitted until the waiting decoder is done. Those buffers are capped too,
+// past that acquire() comes back empty and it's up to the caller to try
+// again once some uploads have finished. A single region bigger then the
+// cap still gets its buffer once it's the only one.
+//
+// Regions can also be counted against a core::MemoryBudget, so staged pages
+// share the app's ceiling with everything else in flight. That doesn't block
+// either, a region the budget has no room for comes back empty the same way.
+//
+// Safe to use from any thread. Destroy every region before the ring.
+class StagingRing {
+  public:
+    class Region {
+      public:
+        Region() = default;
+        ~Region();
+        Region(Region const &) = delete;
+        auto operator=(Region const &) -> Region & = delete;
+        Region(Region &&) noexcept;
+        auto operator=(Region &&) noexcept -> Region &;
+
+        // What to copy from, at offset()
+        [[nodiscard]] auto buffer() const -> vk::Buffer { return handle; }
+        [[nodiscard]] auto offset() const -> vk::DeviceSize { return bufferOffset; }
+        // Write only, it's uncached memory and reading it back is slow
+        [[nodiscard]] auto data() const -> std::byte * { return mapped; }
+        [[nodiscard]] auto size() const -> vk::DeviceSize { return length; }
+        explicit operator bool() const { return mapped != nullptr; }
+
+      private:
+        friend class StagingRing;
+
+        // Null if it's empty
+        StagingRing *ring = nullptr;
+        vk::DeviceSize block = 0;
+        vk::Buffer handle;
+        vk::DeviceSize bufferOffset = 0;
+        std::byte *mapped = nullptr;
+        vk::DeviceSize length = 0;
+        // Not from the ring, but a buffer of its own
+        bool ownBuffer = false;
+        GpuBuffer dedicated;
+        core::MemoryBudget::Reservation reservation;
+
+        void release();
+    };
+
+    // `alignment` has to be at least optimalBufferCopyOffsetAlignment and
+    // the size of a texel. `dedicatedLimit` caps the buffers handed out
+    // when the ring is full, in bytes
+    StagingRing(GpuAllocator &, vk::raii::Device const &, vk::DeviceSize capacity, vk::DeviceSize alignment,
+        vk::DeviceSize dedicatedLimit);
+    ~StagingRing() = default;
+    StagingRing(StagingRing const &) = delete;
+    auto operator=(StagingRing const &) -> StagingRing & = delete;
+
+    // Empty if neither the ring nor the dedicated buffers have room, or
+    // `budget` doesn't right now
+    auto acquire(vk::DeviceSize size, core::MemoryBudget *budget = nullptr) -> Region;
+
+    [[nodiscard]] auto capacity() const -> vk::DeviceSize { return ringSize; }
+    // Bytes not yet given back, including any skipped at the end to wrap
+    // around
+    [[nodiscard]] auto used() -> vk::DeviceSize;
+    // Bytes in dedicated buffers not yet given back
+    [[nodiscard]] auto dedicatedUsed() -> vk::DeviceSize;
+
+  private:
+    // Positions only ever go up, the offset in the buffer is the position
+    // modulo the capacity
+    struct Block {
+        vk::DeviceSize start;
+        bool released;
+    };
+
+    void release(vk::DeviceSize start);
+    void releaseDedicated(vk::DeviceSize size);
+
+    GpuAllocator &allocator;
+    vk::raii::Device const &device;
+    const vk::DeviceSize alignment;
+    const vk::DeviceSize ringSize;
+    const vk::DeviceSize dedicatedLimit;
+    GpuBuffer ring;
+
+    std::mutex mutex;
+    // Every region handed out and not reclaimed yet, oldest first
+    std::deque<Block> blocks;
+    // Where the next region goes, and where the oldest one in use starts
+    vk::DeviceSize head = 0;
+    vk::DeviceSize tail = 0;
+    vk::DeviceSize dedicatedBytes = 0;
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include "strip_view.h"
+
+namespace {
+
+auto clampTileHeight(VulkanRender const &renderer, std::uint32_t tileHeight) -> std::uint32_t {
+    return std::clamp<std::uint32_t>(tileHeight, 1, renderer.deviceLimits().maxImageDimension2D);
+}
+
+auto countTiles(std::vector<StripImage> const &images, std::uint32_t tileHeight) -> std::uint32_t {
+    std::uint32_t count = 0;
+    for (auto const &image : images) {
+        count += (image.height + tileHeight - 1) / tileHeight;
+    }
+    return count;
+}
+
+} // namespace
+
+StripView::StripView(VulkanRender &renderer, std::vector<StripImage> stripImages, RowDecoder decoder,
+    StripViewOptions options) : images(std::move(stripImages)),
+                                tileHeight(clampTileHeight(renderer, options.tileHeight)),
+                                prefetchScreens(options.prefetchScreens),
+                                textures(renderer, countTiles(images, tileHeight),
+                                    // Only reads the images and tile table, which don't change once built
+                                    [this, decoder = std::move(decoder)](TextureManager::PageIndex tile, PageWriter &writer) {
+                                        auto image = tileImage[tile];
+                                        writer.begin(images[image].width, tileRows[tile]);
+                                        decoder(image, tileFirstRow[tile], tileRows[tile], writer);
+                                    },
+                                    TextureManagerOptions{
+                                        .vramBudget = options.vramBudget,
+                                        .prefetch = 0,
+                                        .decodeThreads = options.decodeThreads,
+                                        .memoryBudget = options.memoryBudget}) {
+    auto maxWidth = renderer.deviceLimits().maxImageDimension2D;
+    for (std::size_t index = 0; index < images.size(); index++) {
+        // Nobody makes strips this wide, so we only ever cut horizontally
+        if (images[index].height != 0 && (images[index].width == 0 || images[index].width > maxWidth)) {
+            throw std::invalid_argument("StripView: image " + std::to_string(index) + " is " +
+                                        std::to_string(images[index].width) + " pixels wide, the GPU supports 1 to " + std::to_string(maxWidth));
+        }
+        for (std::uint32_t row = 0; row < images[index].height; row += tileHeight) {
+            tileImage.push_back(index);
+            tileFirstRow.push_back(row);
+            tileRows.push_back(std::min(tileHeight, images[index].height - row));
+        }
+    }
+    layout();
+}
+
+void StripView::setViewport(float width, float height) {
+    // Keep the same part of the strip in view when the width changes
+    auto oldTotal = totalHeight();
+    viewportWidth = width;
+    viewportHeight = height;
+    layout();
+    scrollTo(oldTotal > 0.0F ? scroll * totalHeight() / oldTotal : 0.0F);
+}
+
+void StripView::scrollTo(float offset) {
+    scroll = std::clamp(offset, 0.0F, std::max(0.0F, totalHeight() - viewportHeight));
+}
+
+auto StripView::totalHeight() const -> float {
+    return static_cast<float>(tileTop.back());
+}
+
+void StripView::layout() {
+    tileTop.resize(tileImage.size() + 1);
+    // Kept in double, a long strip is millions of pixels and a float that
+    // big is only good to a fraction of one, which shows as seams between
+    // tiles. Only what's relative to the scroll position goes back to float
+    double top = 0.0;
+    for (std::size_t tile = 0; tile < tileImage.size(); tile++) {
+        tileTop[tile] = top;
+        top += double(tileRows[tile]) * viewportWidth / images[tileImage[tile]].width;
+    }
+    tileTop.back() = top;
+}
+
+auto StripView::tileRange(double top, double bottom) const -> std::pair<TextureManager::PageIndex, TextureManager::PageIndex> {
+    auto last = static_cast<std::ptrdiff_t>(tileImage.size()) - 1;
+    // The last tile starting at or above `top`, and the last one starting
+    // above `bottom`
+    auto first = std::ranges::upper_bound(tileTop, top) - tileTop.begin() - 1;
+    auto end = std::ranges::lower_bound(tileTop, bottom) - tileTop.begin() - 1;
+    first = std::clamp<std::ptrdiff_t>(first, 0, last);
+    end = std::clamp<std::ptrdiff_t>(end, first, last);
+    return {static_cast<TextureManager::PageIndex>(first), static_cast<TextureManager::PageIndex>(end)};
+}
+
+void StripView::update() {
+    if (tileImage.empty() || viewportHeight <= 0.0F) {
+        textures.update();
+        return;
+    }
+
+    auto bottom = scroll + viewportHeight;
+    auto margin = prefetchScreens * viewportHeight;
+    auto [first, last] = tileRange(scroll, bottom);
+
+    // Tiles differ in height (the last one of every image is shorter), so
+    // work out how many fit into the margin from where we are now
+    auto above = tileRange(scroll - margin, scroll).first;
+    auto below = tileRange(bottom, bottom + margin).second;
+    textures.setPrefetch(std::max(first - above, below - last));
+    textures.show(first, last);
+    textures.update();
+}
+
+void StripView::visibleTiles(std::vector<VisibleTile> &tiles) const {
+    tiles.clear();
+    if (tileImage.empty() || viewportHeight <= 0.0F) {
+        return;
+    }
+
+    auto [first, last] = tileRange(scroll, scroll + viewportHeight);
+    for (auto tile = first; tile <= last; tile++) {
+        tiles.push_back(VisibleTile{
+            .texture = textures.find(tile),
+            .top = static_cast<float>(tileTop[tile] - scroll),
+            .height = static_cast<float>(tileTop[tile + 1] - tileTop[tile])});
+    }
+}
+
+void StripView::build(std::vector<QuadInstance> &quads, glm::vec4 placeholder) const {
+    if (tileImage.empty() || viewportHeight <= 0.0F) {
+        return;
+    }
+
+    auto [first, last] = tileRange(scroll, scroll + viewportHeight);
+    for (auto tile = first; tile <= last; tile++) {
+        auto const *texture = textures.find(tile);
+        quads.push_back(QuadInstance{
+            .rect = glm::vec4(0.0F, static_cast<float>(tileTop[tile] - scroll), viewportWidth,
+                static_cast<float>(tileTop[tile + 1] - tileTop[tile])),
+            .uvRect = glm::vec4(0.0F, 0.0F, 1.0F, 1.0F),
+            .tint = texture == nullptr ? placeholder : glm::vec4(1.0F),
+            .texture = texture == nullptr ? QuadInstance::noTexture : texture->slot,
+            .padding = {}});
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef UI_STRIP_VIEW_H
+#define UI_STRIP_VIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "quad_renderer.h"
+#include "texture_manager.h"
+#include "vulkan_config.h"
+#include "vulkan_renderer.h"
+
+// Size of one image of a strip, known before it's decoded (e.g. from the
+// file header)
+struct StripImage {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+};
+
+struct StripViewOptions {
+    // Height of a tile in image rows, clamped to the device's
+    // maxImageDimension2D. Smaller tiles mean less decoded ahead of the
+    // viewport, but more textures to draw
+    std::uint32_t tileHeight = 2048;
+    // Resident tiles past this are evicted, least recently shown first
+    vk::DeviceSize vramBudget = 256 * 1024 * 1024;
+    // How far above and below the viewport to have tiles ready, in
+    // viewport heights
+    float prefetchScreens = 1.0F;
+    std::size_t decodeThreads = 2;
+    // See TextureManagerOptions
+    core::MemoryBudget *memoryBudget = nullptr;
+};
+
+// Continuous vertical scrolling through a webtoon chapter.
+//
+// Webtoon chapters are one long strip, often split into images tens of
+// thousands of pixels tall, which is past maxImageDimension2D on most GPUs
+// (16384, sometimes 8192) and would be hundreds of MiB as a single texture
+// anyway. So every image is cut into tiles of tileHeight rows, and tiles are
+// what gets decoded, uploaded and evicted, through a TextureManager. Only
+// the tiles around the viewport are ever resident, so memory stays the same
+// however long the strip is.
+//
+// Images are scaled to the width of the viewport and stacked top to bottom,
+// positions are in viewport pixels with 0 the top of the strip.
+//
+// Same threading rules as TextureManager, everything but the decoding
+// happens on the render thread.
+class StripView {
+  public:
+    // Decodes `rowCount` rows of `image` starting at `firstRow` into
+    // `writer`, which is already begin()'d at the image's width and
+    // `rowCount` rows. Runs on a worker thread. Formats that can't decode a
+    // range of rows can decode the whole image and cut it, but then it's
+    // worth caching the result for the image's other tiles
+    using RowDecoder = std::function<void(std::size_t image, std::uint32_t firstRow, std::uint32_t rowCount, PageWriter &writer)>;
+
+    // A tile to draw, in viewport pixels relative to the top of the viewport
+    struct VisibleTile {
+        // nullptr while it's still on its way, draw a placeholder
+        TextureManager::Texture const *texture;
+        float top;
+        float height;
+    };
+
+    StripView(VulkanRender &, std::vector<StripImage> images, RowDecoder, StripViewOptions = {});
+
+    void setViewport(float width, float height);
+    // Clamped to the ends of the strip
+    void scrollTo(float offset);
+    void scrollBy(float delta) { scrollTo(scroll + delta); }
+    [[nodiscard]] auto scrollOffset() const -> float { return scroll; }
+    [[nodiscard]] auto totalHeight() const -> float;
+
+    // Once a frame, before visibleTiles()
+    void update();
+    // What overlaps the viewport, top to bottom. Cleared first, so one
+    // vector can be reused every frame
+    void visibleTiles(std::vector<VisibleTile> &) const;
+    // Appends a quad for every tile in view, for VulkanRender::drawQuads().
+    // Tiles still on their way are drawn as a `placeholder` coloured
+    // rectangle
+    void build(std::vector<QuadInstance> &, glm::vec4 placeholder = glm::vec4(0.3F, 0.3F, 0.3F, 1.0F)) const;
+    [[nodiscard]] auto sampler() const -> vk::Sampler { return textures.sampler(); }
+
+    [[nodiscard]] auto tileCount() const -> std::size_t { return tileImage.size(); }
+    [[nodiscard]] auto residentBytes() const -> vk::DeviceSize { return textures.residentBytes(); }
+    // For redrawing as tiles come in, see TextureManager
+    void onDecoded(std::function<void()> function) { textures.onDecoded(std::move(function)); }
+    [[nodiscard]] auto uploadsInFlight() const -> std::size_t { return textures.uploadsInFlight(); }
+    // For tests and benchmarks, see TextureManager::waitIdle()
+    void waitIdle() { textures.waitIdle(); }
+
+  private:
+    // First and last tile overlapping [top, bottom)
+    auto tileRange(double top, double bottom) const -> std::pair<TextureManager::PageIndex, TextureManager::PageIndex>;
+    void layout();
+
+    const std::vector<StripImage> images;
+    const std::uint32_t tileHeight;
+    const float prefetchScreens;
+
+    // Tiles, in strip order
+    std::vector<std::size_t> tileImage;
+    std::vector<std::uint32_t> tileFirstRow;
+    std::vector<std::uint32_t> tileRows;
+    // Top edge of each tile at the current viewport width, plus the bottom
+    // of the strip, for binary searching. Doubles, see layout()
+    std::vector<double> tileTop;
+
+    float viewportWidth = 0.0F;
+    float viewportHeight = 0.0F;
+    float scroll = 0.0F;
+
+    TextureManager textures;
+};
+
+#endif
@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "texture_manager.h"
+
+namespace {
+
+constexpr auto pageFormat = vk::Format::eR8G8B8A8Srgb;
+
+// The StagingRing is out of room, the page is decoded again once some
+// uploads have finished
+class StagingFull : public std::runtime_error {
+  public:
+    explicit StagingFull(vk::DeviceSize stagingPressure) : std::runtime_error("out of staging memory"),
+                                                           pressure(stagingPressure) {}
+
+    // stagingPressure() right before it didn't fit
+    vk::DeviceSize pressure;
+};
+
+// Staging memory in use, going down means some was given back and a page
+// that didn't fit might now
+auto stagingPressure(StagingRing &ring, core::MemoryBudget const *budget) -> vk::DeviceSize {
+    auto used = ring.used() + ring.dedicatedUsed();
+    if (budget != nullptr) {
+        used += budget->used();
+    }
+    return used;
+}
+
+auto colorRange() -> vk::ImageSubresourceRange {
+    return vk::ImageSubresourceRange{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = 1};
+}
+
+} // namespace
+
+void PageWriter::begin(std::uint32_t width, std::uint32_t height) {
+    if (region) {
+        throw std::logic_error("PageWriter: begin() called twice");
+    }
+    if (width == 0 || height == 0) {
+        throw std::runtime_error("decoder returned a " + std::to_string(width) + "x" + std::to_string(height) + " page");
+    }
+    // Before, so memory given back while it's trying still counts as
+    // having made room
+    auto pressure = stagingPressure(ring, budget);
+    region = ring.acquire(vk::DeviceSize(width) * height * 4, budget);
+    if (!region) {
+        throw StagingFull(pressure);
+    }
+    pageWidth = width;
+    pageHeight = height;
+}
+
+auto PageWriter::row(std::uint32_t y) const -> std::span<std::byte> {
+    if (y >= pageHeight) {
+        throw std::out_of_range("PageWriter: no row " + std::to_string(y) + " in a page " + std::to_string(pageHeight) + " rows high");
+    }
+    auto stride = std::size_t(pageWidth) * 4;
+    return {region.data() + stride * y, stride};
+}
+
+auto PageWriter::pixels() const -> std::span<std::byte> {
+    return {region.data(), static_cast<std::size_t>(region.size())};
+}
+
+TextureManager::TextureManager(VulkanRender &vulkanRenderer, std::uint32_t pageCount, Decoder pageDecoder,
+    TextureManagerOptions textureOptions) : renderer(vulkanRenderer),
+                                            device(vulkanRenderer.logicalDevice()),
+                                            decoder(std::move(pageDecoder)),
+                                            options(textureOptions),
+                                            prefetch(textureOptions.prefetch),
+                                            pages(pageCount),
+                                            workers(textureOptions.decodeThreads) {
+    // Uploaded on one queue family and sampled on another. Concurrent sharing
+    // saves us from transferring ownership of every image, and for read only
+    // textures costs next to nothing
+    if (renderer.transferQueueFamily() != renderer.graphicsQueueFamily()) {
+        queueFamilies = {renderer.transferQueueFamily(), renderer.graphicsQueueFamily()};
+    }
+
+    commandPool = vk::raii::CommandPool(device,
+        vk::CommandPoolCreateInfo{
+            .flags = vk::CommandPoolCreateFlagBits::eTransient,
+            .queueFamilyIndex = renderer.transferQueueFamily()});
+
+    linearSampler = vk::raii::Sampler(device,
+        vk::SamplerCreateInfo{
+            .flags = vk::SamplerCreateFlags(),
+            .magFilter = vk::Filter::eLinear,
+            .minFilter = vk::Filter::eLinear,
+            .mipmapMode = vk::SamplerMipmapMode::eNearest,
+            .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+            .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+            .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+            .mipLodBias = 0.0F,
+            .anisotropyEnable = VK_FALSE,
+            .maxAnisotropy = 1.0F,
+            .compareEnable = VK_FALSE,
+            .compareOp = vk::CompareOp::eNever,
+            .minLod = 0.0F,
+            .maxLod = 0.0F,
+            .borderColor = vk::BorderColor::eFloatTransparentBlack,
+            .unnormalizedCoordinates = VK_FALSE});
+}
+
+TextureManager::~TextureManager() {
+    // Let the decodes finish (they touch `decoded`), then the uploads (their
+    // command buffers and images can't be destroyed while they run). The
+    // callback's target may well be gone already
+    onDecoded(nullptr);
+    workers.wait();
+    for (auto const &upload : uploads) {
+        while (vk::Result::eTimeout == device.waitForFences({*upload.fence}, VK_TRUE, 100000000)) {
+            /* do nothing */
+        }
+    }
+    for (auto const &page : pages) {
+        if (page.state == State::Resident) {
+            renderer.textureTable().remove(page.texture->slot);
+        }
+    }
+}
+
+void TextureManager::show(PageIndex first, PageIndex last) {
+    if (first > last || last >= pages.size()) {
+        throw std::out_of_range("TextureManager: no pages " + std::to_string(first) + "-" + std::to_string(last));
+    }
+    currentFirst = first;
+    currentLast = last;
+
+    // What's on screen first, then next pages before previous ones, people
+    // mostly read forwards. The pages on screen go last so they end up the
+    // most recently used, but are decoded first
+    std::vector<PageIndex> wanted;
+    for (auto page = first; page <= last; page++) {
+        wanted.push_back(page);
+    }
+    for (std::uint32_t distance = 1; distance <= prefetch; distance++) {
+        if (last + distance < pages.size()) {
+            wanted.push_back(last + distance);
+        }
+        if (first >= distance) {
+            wanted.push_back(first - distance);
+        }
+    }
+
+    for (auto index : wanted) {
+        if (pages[index].state == State::Absent) {
+            pages[index].state = State::Decoding;
+            workers.submit([this, index] { decode(index); });
+        }
+    }
+    for (auto it = wanted.rbegin(); it != wanted.rend(); ++it) {
+        pages[*it].lastUsed = ++clock;
+    }
+}
+
+void TextureManager::decode(PageIndex index) {
+    Decoded result{.index = index, .width = 0, .height = 0, .staging = {}, .retry = false, .pressure = 0};
+
+    try {
+        // Straight into the memory it's uploaded from, no copy of the page
+        // on the way
+        PageWriter writer(renderer.stagingRing(), options.memoryBudget);
+        decoder(index, writer);
+        if (!writer.region) {
+            throw std::runtime_error("decoder didn't begin() the page");
+        }
+        result.width = writer.pageWidth;
+        result.height = writer.pageHeight;
+        result.staging = std::move(writer.region);
+    } catch (StagingFull const &err) {
+        result.retry = true;
+        result.pressure = err.pressure;
+    } catch (std::exception const &err) {
+        std::cerr << "Failed to decode page " << index << ": " << err.what() << "\n";
+    } catch (...) {
+        // Decoders are the app's, they may throw anything. Letting it out
+        // would take the worker thread down and leave the page Decoding
+        std::cerr << "Failed to decode page " << index << "\n";
+    }
+
+    std::lock_guard lock(decodedMutex);
+    decoded.push_back(std::move(result));
+    if (decodedCallback) {
+        decodedCallback();
+    }
+}
+
+void TextureManager::onDecoded(std::function<void()> function) {
+    std::lock_guard lock(decodedMutex);
+    decodedCallback = std::move(function);
+}
+
+void TextureManager::update() {
+    auto inFlight = uploads.size();
+    collectUploads();
+    auto collected = uploads.size() < inFlight;
+    submitUploads();
+    // Only once some staging memory was given back, by our uploads finishing
+    // or whoever else shares the budget, otherwise they'd just not fit again
+    if (!deferred.empty() &&
+        (collected || stagingPressure(renderer.stagingRing(), options.memoryBudget) < deferredPressure)) {
+        for (auto index : deferred) {
+            workers.submit([this, index] { decode(index); });
+        }
+        deferred.clear();
+    }
+    evict();
+
+    // Anything evicted before the frames the GPU has finished were
+    // submitted can't be in use anymore, update() comes before a frame's
+    // draws so the one being recorded never uses it
+    auto completed = renderer.completedFrames();
+    std::erase_if(retired, [completed](Retired const &entry) {
+        return entry.frame <= completed;
+    });
+}
+
+void TextureManager::collectUploads() {
+    std::erase_if(uploads, [this](Upload &upload) {
+        if (upload.fence.getStatus() != vk::Result::eSuccess) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < upload.indices.size(); i++) {
+            auto &page = pages[upload.indices[i]];
+            // Nothing has used it yet, so it can just go
+            if (!registerTexture(*upload.textures[i], upload.indices[i])) {
+                page.state = State::Failed;
+                continue;
+            }
+            resident += upload.textures[i]->image.allocation.size();
+            page.texture = std::move(upload.textures[i]);
+            page.state = State::Resident;
+        }
+        return true;
+    });
+}
+
+auto TextureManager::registerTexture(Texture &texture, PageIndex index) -> bool {
+    try {
+        texture.slot = renderer.textureTable().add(*texture.view, *linearSampler);
+        return true;
+    } catch (std::length_error const &err) {
+        std::cerr << "Failed to add page " << index << " to the texture table: " << err.what() << "\n";
+        return false;
+    }
+}
+
+auto TextureManager::createTexture(std::uint32_t width, std::uint32_t height) -> std::unique_ptr<Texture> {
+    auto texture = std::make_unique<Texture>();
+    texture->width = width;
+    texture->height = height;
+
+    texture->image = createGpuImage(renderer.gpuAllocator(), device,
+        vk::ImageCreateInfo{
+            .flags = vk::ImageCreateFlags(),
+            .imageType = vk::ImageType::e2D,
+            .format = pageFormat,
+            .extent = vk::Extent3D{.width = width, .height = height, .depth = 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+            .sharingMode = queueFamilies.empty() ? vk::SharingMode::eExclusive : vk::SharingMode::eConcurrent,
+            .queueFamilyIndexCount = static_cast<std::uint32_t>(queueFamilies.size()),
+            .pQueueFamilyIndices = queueFamilies.data(),
+            .initialLayout = vk::ImageLayout::eUndefined},
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    texture->view = vk::raii::ImageView(device,
+        vk::ImageViewCreateInfo{
+            .flags = vk::ImageViewCreateFlags(),
+            .image = *texture->image.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = pageFormat,
+            .components = vk::ComponentMapping{
+                .r = vk::ComponentSwizzle::eIdentity,
+                .g = vk::ComponentSwizzle::eIdentity,
+                .b = vk::ComponentSwizzle::eIdentity,
+                .a = vk::ComponentSwizzle::eIdentity},
+            .subresourceRange = colorRange()});
+
+    return texture;
+}
+
+void TextureManager::submitUploads() {
+    std::vector<Decoded> ready;
+    {
+        std::lock_guard lock(decodedMutex);
+        ready.swap(decoded);
+    }
+    if (ready.empty()) {
+        return;
+    }
+
+    Upload upload;
+    vk::raii::CommandBuffers commandBuffers(device,
+        vk::CommandBufferAllocateInfo{
+            .commandPool = *commandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1});
+    upload.commandBuffer = std::move(commandBuffers.front());
+    upload.commandBuffer.begin(vk::CommandBufferBeginInfo{
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        .pInheritanceInfo = nullptr});
+
+    // Every page in one submission: transition to transfer dst, copy, then
+    // to shader read only. The last barrier only does the layout change, the
+    // render thread waits for the fence before anything samples the image
+    for (auto &page : ready) {
+        if (page.retry) {
+            deferredPressure = deferred.empty() ? page.pressure : std::min(deferredPressure, page.pressure);
+            deferred.push_back(page.index);
+            continue;
+        }
+        if (!page.staging) {
+            pages[page.index].state = State::Failed;
+            continue;
+        }
+
+        auto texture = createTexture(page.width, page.height);
+        auto image = *texture->image.image;
+
+        upload.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+            vk::DependencyFlags(), nullptr, nullptr,
+            vk::ImageMemoryBarrier{
+                .srcAccessMask = vk::AccessFlags(),
+                .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .oldLayout = vk::ImageLayout::eUndefined,
+                .newLayout = vk::ImageLayout::eTransferDstOptimal,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = image,
+                .subresourceRange = colorRange()});
+
+        upload.commandBuffer.copyBufferToImage(page.staging.buffer(), image, vk::ImageLayout::eTransferDstOptimal,
+            vk::BufferImageCopy{
+                .bufferOffset = page.staging.offset(),
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = vk::ImageSubresourceLayers{
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .mipLevel = 0,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1},
+                .imageOffset = vk::Offset3D{.x = 0, .y = 0, .z = 0},
+                .imageExtent = vk::Extent3D{.width = page.width, .height = page.height, .depth = 1}});
+
+        upload.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+            vk::DependencyFlags(), nullptr, nullptr,
+            vk::ImageMemoryBarrier{
+                .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .dstAccessMask = vk::AccessFlags(),
+                .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+                .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = image,
+                .subresourceRange = colorRange()});
+
+        pages[page.index].state = State::Uploading;
+        upload.indices.push_back(page.index);
+        upload.textures.push_back(std::move(texture));
+        upload.staging.push_back(std::move(page.staging));
+    }
+    upload.commandBuffer.end();
+
+    if (upload.indices.empty()) {
+        return;
+    }
+
+    upload.fence = vk::raii::Fence(device, vk::FenceCreateInfo{.flags = vk::FenceCreateFlags()});
+    renderer.uploadQueue().submit(
+        vk::SubmitInfo{
+            .waitSemaphoreCount = 0,
+            .pWaitSemaphores = nullptr,
+            .pWaitDstStageMask = nullptr,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &(*upload.commandBuffer),
+            .signalSemaphoreCount = 0,
+            .pSignalSemaphores = nullptr},
+        *upload.fence);
+    uploads.push_back(std::move(upload));
+}
+
+void TextureManager::evict() {
+    auto protectedFrom = currentFirst >= prefetch ? currentFirst - prefetch : 0;
+    auto protectedTo = currentLast + prefetch;
+
+    while (resident > options.vramBudget) {
+        // Least recently used resident page outside of the prefetch window.
+        // A linear scan, a chapter is at most a few hundred pages
+        Page *victim = nullptr;
+        for (PageIndex index = 0; index < pages.size(); index++) {
+            auto &page = pages[index];
+            if (page.state != State::Resident || (index >= protectedFrom && index <= protectedTo)) {
+                continue;
+            }
+            if (victim == nullptr || page.lastUsed < victim->lastUsed) {
+                victim = &page;
+            }
+        }
+        if (victim == nullptr) {
+            break;
+        }
+
+        // The slot first, BindlessTextures holds on to it for as long as a
+        // frame in flight might sample it, which the texture outlives
+        renderer.textureTable().remove(victim->texture->slot);
+        resident -= victim->texture->image.allocation.size();
+        retired.push_back(Retired{std::move(victim->texture), renderer.submittedFrames()});
+        victim->state = State::Absent;
+    }
+}
+
+auto TextureManager::find(PageIndex index) const -> Texture const * {
+    if (index >= pages.size() || pages[index].state != State::Resident) {
+        return nullptr;
+    }
+    return pages[index].texture.get();
+}
+
+auto TextureManager::failed(PageIndex index) const -> bool {
+    return index < pages.size() && pages[index].state == State::Failed;
+}
+
+void TextureManager::waitIdle() {
+    // Decoded, then submitted, then uploaded. Pages that didn't fit in the
+    // staging memory go round again once the uploads before them are done
+    while (std::ranges::any_of(pages, [](Page const &page) {
+        return page.state == State::Decoding || page.state == State::Uploading;
+    })) {
+        workers.wait();
+        submitUploads();
+        for (auto const &upload : uploads) {
+            while (vk::Result::eTimeout == device.waitForFences({*upload.fence}, VK_TRUE, 100000000)) {
+                /* do nothing */
+            }
+        }
+        update();
+    }
+}
+
+auto TextureManager::residentCount() const -> std::size_t {
+    return static_cast<std::size_t>(std::ranges::count(pages, State::Resident, &Page::state));
+}
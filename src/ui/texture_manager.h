@@ -0,0 +1,222 @@
+#ifndef UI_TEXTURE_MANAGER_H
+#define UI_TEXTURE_MANAGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "gpu_allocator.h"
+#include "memory_budget.h"
+#include "staging_ring.h"
+#include "thread_pool.h"
+#include "vulkan_config.h"
+#include "vulkan_renderer.h"
+
+// Where a decoder puts a page, tightly packed 8 bit RGBA in sRGB. The rows
+// are staging memory the page is uploaded from as is, so decode straight
+// into them rather then into a buffer of your own and copying that over.
+// Write only, reading back from it is slow
+class PageWriter {
+  public:
+    // The page's staging memory is reserved against `memoryBudget` if set
+    explicit PageWriter(StagingRing &stagingRing, core::MemoryBudget *memoryBudget = nullptr) : ring(stagingRing),
+                                                                                               budget(memoryBudget) {}
+
+    // Once the size is known, before writing any rows. Only once. Throws
+    // if there's no staging memory (or budget) left, let that through and
+    // the page is decoded again once there is
+    void begin(std::uint32_t width, std::uint32_t height);
+    [[nodiscard]] auto row(std::uint32_t y) const -> std::span<std::byte>;
+    // Every row, top to bottom
+    [[nodiscard]] auto pixels() const -> std::span<std::byte>;
+    [[nodiscard]] auto width() const -> std::uint32_t { return pageWidth; }
+    [[nodiscard]] auto height() const -> std::uint32_t { return pageHeight; }
+
+  private:
+    friend class TextureManager;
+
+    StagingRing &ring;
+    core::MemoryBudget *budget;
+    std::uint32_t pageWidth = 0;
+    std::uint32_t pageHeight = 0;
+    StagingRing::Region region;
+};
+
+struct TextureManagerOptions {
+    // Once resident textures take up more then this, the ones shown least
+    // recently are evicted (never the current page or its prefetched
+    // neighbours, so it can be exceeded if pages are huge)
+    vk::DeviceSize vramBudget = 512 * 1024 * 1024;
+    // Pages either side of the current one to have ready, for page turns in
+    // either direction
+    std::uint32_t prefetch = 2;
+    std::size_t decodeThreads = 2;
+    // Decoded pages waiting to be uploaded count against it, e.g. the app's
+    // budget shared with downloads. Has to outlive the manager
+    core::MemoryBudget *memoryBudget = nullptr;
+};
+
+// Streams a chapter's pages into GPU textures for the reader.
+//
+// Pages are decoded on worker threads, straight into the renderer's
+// StagingRing, and copied from there into their images on its transfer
+// queue (which runs alongside rendering on GPUs that have one). Nothing here
+// ever waits on the GPU or a decode: a page that isn't resident yet just
+// isn't drawn this frame, which is why the pages either side of the current
+// one are fetched ahead of time.
+//
+// Resident pages are added to the renderer's textureTable() so they can be
+// drawn with drawQuads(), and removed from it again when they're evicted.
+//
+// Everything but the decoding happens on the render thread, call show(),
+// update() and find() from there. Before destroying it, make sure the GPU is
+// done with the textures (e.g. VulkanRender::waitIdle()).
+class TextureManager {
+  public:
+    using PageIndex = std::uint32_t;
+    // Runs on a worker thread, begin()s the writer and fills it in. Throwing
+    // marks the page as failed, it won't be tried again
+    using Decoder = std::function<void(PageIndex, PageWriter &)>;
+
+    struct Texture {
+        GpuImage image;
+        vk::raii::ImageView view = nullptr;
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        // In the renderer's textureTable(), with sampler(), for
+        // QuadInstance::texture
+        std::uint32_t slot = 0;
+    };
+
+    TextureManager(VulkanRender &, std::uint32_t pageCount, Decoder, TextureManagerOptions = {});
+    ~TextureManager();
+    TextureManager(TextureManager const &) = delete;
+    auto operator=(TextureManager const &) -> TextureManager & = delete;
+
+    // The reader is now showing `page`. Queues it and its neighbours up if
+    // they aren't resident yet, and marks them as recently used
+    void show(PageIndex page) { show(page, page); }
+    // Same for a range of pages on screen at once (e.g. the tiles of a long
+    // strip), with the neighbours either side of the range
+    void show(PageIndex first, PageIndex last);
+    // How many neighbours to fetch ahead, e.g. when the viewport grows
+    void setPrefetch(std::uint32_t pages) { prefetch = pages; }
+    // Once a frame, before any of the frame's draws are queued: uploads
+    // decoded pages, picks up finished uploads and evicts anything over
+    // budget. Calling it more often is fine, evicted textures are kept
+    // until the GPU has finished every frame submitted before they were
+    // evicted
+    void update();
+    // Called on a worker thread each time a page is decoded (or failed to),
+    // e.g. to wake an EventLoop up so update() gets to upload it. Mustn't
+    // call back into the manager. Empty to stop
+    void onDecoded(std::function<void()>);
+    // nullptr until the page is resident
+    [[nodiscard]] auto find(PageIndex) const -> Texture const *;
+    [[nodiscard]] auto failed(PageIndex) const -> bool;
+    // Linear filtering, clamped to the edges
+    [[nodiscard]] auto sampler() const -> vk::Sampler { return *linearSampler; }
+
+    // Block until every page requested so far is resident (or failed), for
+    // tests and benchmarks
+    void waitIdle();
+
+    [[nodiscard]] auto residentBytes() const -> vk::DeviceSize { return resident; }
+    [[nodiscard]] auto residentCount() const -> std::size_t;
+    // Nothing signals when an upload is done, so while this isn't zero keep
+    // drawing frames (e.g. EventLoop::redrawAt() a frame from now) for
+    // update() to pick them up
+    [[nodiscard]] auto uploadsInFlight() const -> std::size_t { return uploads.size(); }
+
+  private:
+    enum class State {
+        Absent,
+        Decoding,
+        Uploading,
+        Resident,
+        Failed,
+    };
+
+    struct Page {
+        State state = State::Absent;
+        std::unique_ptr<Texture> texture;
+        // When it was last shown (or prefetched), for LRU eviction
+        std::uint64_t lastUsed = 0;
+    };
+
+    // A page on its way from the decoder, empty staging means it failed
+    struct Decoded {
+        PageIndex index;
+        std::uint32_t width;
+        std::uint32_t height;
+        StagingRing::Region staging;
+        // Or that there was no staging memory left, so try again later
+        bool retry;
+        // How much was in use when it didn't fit
+        vk::DeviceSize pressure;
+    };
+
+    // One submission to the transfer queue
+    struct Upload {
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+        vk::raii::Fence fence = nullptr;
+        std::vector<PageIndex> indices;
+        std::vector<std::unique_ptr<Texture>> textures;
+        // Given back to the ring once the fence has signalled
+        std::vector<StagingRing::Region> staging;
+    };
+
+    // Evicted, but possibly still used by a frame in flight
+    struct Retired {
+        std::unique_ptr<Texture> texture;
+        // VulkanRender::submittedFrames() when it was evicted
+        std::uint64_t frame;
+    };
+
+    void decode(PageIndex);
+    void submitUploads();
+    void collectUploads();
+    void evict();
+    // Into the texture table, false if it's full
+    auto registerTexture(Texture &, PageIndex) -> bool;
+    auto createTexture(std::uint32_t width, std::uint32_t height) -> std::unique_ptr<Texture>;
+
+    VulkanRender &renderer;
+    vk::raii::Device const &device;
+    const Decoder decoder;
+    const TextureManagerOptions options;
+    // Only set if the images have to be shared between two queue families
+    std::vector<std::uint32_t> queueFamilies;
+
+    vk::raii::CommandPool commandPool = nullptr;
+    vk::raii::Sampler linearSampler = nullptr;
+
+    std::vector<Page> pages;
+    // The range last shown, and the prefetch window around it is never
+    // evicted
+    PageIndex currentFirst = 0;
+    PageIndex currentLast = 0;
+    std::uint32_t prefetch;
+    std::uint64_t clock = 0;
+    vk::DeviceSize resident = 0;
+    std::vector<Upload> uploads;
+    std::vector<Retired> retired;
+    // Still Decoding, waiting for staging memory to be given back, i.e. for
+    // less then the lowest pressure any of them saw to be in use
+    std::vector<PageIndex> deferred;
+    vk::DeviceSize deferredPressure = 0;
+
+    std::mutex decodedMutex;
+    std::vector<Decoded> decoded;
+    std::function<void()> decodedCallback;
+
+    // Last, so the workers are stopped before anything they use is destroyed
+    core::ThreadPool workers;
+};
+
+#endif
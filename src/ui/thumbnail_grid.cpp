@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cmath>
+
+#include "thumbnail_grid.h"
+
+ThumbnailGrid::ThumbnailGrid(ThumbnailGridOptions gridOptions) : options(gridOptions) {
+}
+
+void ThumbnailGrid::setItemCount(std::size_t count) {
+    itemCount = count;
+    scrollTo(scroll);
+}
+
+void ThumbnailGrid::setViewport(float width, float height) {
+    // Keep the item at the top of the viewport in view when the number of
+    // columns changes
+    auto topItem = visibleRange().first;
+    viewportWidth = width;
+    viewportHeight = height;
+    auto row = topItem / columns();
+    scrollTo(static_cast<float>(row) * (options.cellHeight + options.spacing));
+}
+
+void ThumbnailGrid::scrollTo(float offset) {
+    scroll = std::clamp(offset, 0.0F, std::max(0.0F, contentHeight() - viewportHeight));
+}
+
+auto ThumbnailGrid::columns() const -> std::size_t {
+    // Always at least one, even if it doesn't fit
+    auto fit = std::floor((viewportWidth - options.spacing) / (options.cellWidth + options.spacing));
+    return std::max<std::size_t>(1, fit > 0.0F ? static_cast<std::size_t>(fit) : 0);
+}
+
+auto ThumbnailGrid::contentHeight() const -> float {
+    auto rows = (itemCount + columns() - 1) / columns();
+    return static_cast<float>(rows) * (options.cellHeight + options.spacing) + options.spacing;
+}
+
+auto ThumbnailGrid::visibleRange() const -> std::pair<std::size_t, std::size_t> {
+    // Rows whose bottom edge is below the top of the viewport, up to the
+    // first one whose top edge is past the bottom of it
+    auto rowHeight = options.cellHeight + options.spacing;
+    auto firstRow = static_cast<std::size_t>(std::max(0.0F, std::floor((scroll - options.spacing - options.cellHeight) / rowHeight) + 1.0F));
+    auto endRow = static_cast<std::size_t>(std::max(0.0F, std::ceil((scroll + viewportHeight - options.spacing) / rowHeight)));
+
+    auto first = std::min(itemCount, firstRow * columns());
+    auto end = std::min(itemCount, endRow * columns());
+    return {first, std::max(first, end)};
+}
+
+auto ThumbnailGrid::itemRect(std::size_t item) const -> glm::vec4 {
+    // Spare width is split evenly between the gaps, so the grid stays
+    // centred whatever the window size
+    auto columnCount = columns();
+    auto spare = std::max(0.0F, viewportWidth - static_cast<float>(columnCount) * options.cellWidth);
+    auto gap = spare / static_cast<float>(columnCount + 1);
+
+    auto column = static_cast<float>(item % columnCount);
+    auto row = static_cast<float>(item / columnCount);
+    return {
+        gap + column * (options.cellWidth + gap),
+        options.spacing + row * (options.cellHeight + options.spacing) - scroll,
+        options.cellWidth,
+        options.cellHeight};
+}
+
+void ThumbnailGrid::build(std::vector<QuadInstance> &quads, TextureLookup const &texture, glm::vec4 placeholder) const {
+    auto [first, end] = visibleRange();
+    for (auto item = first; item < end; item++) {
+        auto slot = texture(item);
+        quads.push_back(QuadInstance{
+            .rect = itemRect(item),
+            .uvRect = glm::vec4(0.0F, 0.0F, 1.0F, 1.0F),
+            .tint = slot == QuadInstance::noTexture ? placeholder : glm::vec4(1.0F),
+            .texture = slot,
+            .padding = {}});
+    }
+}
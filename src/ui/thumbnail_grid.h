@@ -0,0 +1,63 @@
+#ifndef UI_THUMBNAIL_GRID_H
+#define UI_THUMBNAIL_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "quad_renderer.h"
+
+struct ThumbnailGridOptions {
+    // Size of a cover, and the gap around it, in pixels
+    float cellWidth = 180.0F;
+    float cellHeight = 270.0F;
+    float spacing = 12.0F;
+};
+
+// Lays a library's covers out in rows that fill the viewport's width, and
+// scrolls through them.
+//
+// Only the rows overlapping the viewport are ever looked at: working out
+// which items those are is arithmetic on the scroll offset, so building a
+// frame's quads costs the same for a library of a hundred series as for one
+// of a hundred thousand.
+class ThumbnailGrid {
+  public:
+    // Slot in BindlessTextures for an item's cover, or
+    // QuadInstance::noTexture if it isn't loaded (yet)
+    using TextureLookup = std::function<std::uint32_t(std::size_t item)>;
+
+    explicit ThumbnailGrid(ThumbnailGridOptions = {});
+
+    void setItemCount(std::size_t);
+    void setViewport(float width, float height);
+    // Clamped to the ends of the grid
+    void scrollTo(float offset);
+    void scrollBy(float delta) { scrollTo(scroll + delta); }
+    [[nodiscard]] auto scrollOffset() const -> float { return scroll; }
+
+    [[nodiscard]] auto columns() const -> std::size_t;
+    [[nodiscard]] auto contentHeight() const -> float;
+    // First item in view, and one past the last
+    [[nodiscard]] auto visibleRange() const -> std::pair<std::size_t, std::size_t>;
+    // x, y, width, height of an item's cover, relative to the top left of
+    // the viewport
+    [[nodiscard]] auto itemRect(std::size_t item) const -> glm::vec4;
+
+    // Appends a quad for every item in view. Items without a texture are
+    // drawn as a `placeholder` coloured rectangle
+    void build(std::vector<QuadInstance> &, TextureLookup const &, glm::vec4 placeholder = glm::vec4(0.3F, 0.3F, 0.3F, 1.0F)) const;
+
+  private:
+    const ThumbnailGridOptions options;
+    std::size_t itemCount = 0;
+    float viewportWidth = 0.0F;
+    float viewportHeight = 0.0F;
+    float scroll = 0.0F;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef UI_VULKAN_CONFIG_H
+#define UI_VULKAN_CONFIG_H
+
+#include <utility> // vulkan_raii fails to compile without this
+                   // It complains about std::exchange related errors
+
+// Whats the point of this?
+// Well I needed to set a few preprocessor defines so they can enable some
+// more functionality at compile time if the necessary headers are around
+// And since I needed to have these availble in more then one source file
+// it was just easier to throw it in a header
+//
+// Always include this rather then the Vulkan headers directly, every source
+// file has to see Vulkan.hpp with the same defines
+
+// Enable C++ Designated Initializers in Vulkan.hpp
+// https://github.com/KhronosGroup/Vulkan-Hpp#designated-initializers
+#define VULKAN_HPP_NO_CONSTRUCTORS
+// Disable setter member functions
+#define VULKAN_HPP_NO_SETTERS
+
+// Enable Vulkan debug utilities if we compile as Debug
+#ifndef NDEBUG
+#define VULKAN_DEBUG
+#endif
+
+// Now include offical vulkan headers :)
+#include <vulkan/vulkan_raii.hpp>
+
+#endif
@@ -1,6 +1,13 @@
-#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <latch>
+#include <limits>
+#include <system_error>
 #include <thread>
 #include <vector>
 
@@ -71,24 +78,6 @@ VKAPI_ATTR vk::Bool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBi
 }
 #endif
 
-auto VulkanRender::findMemoryType(vk::PhysicalDeviceMemoryProperties const &memoryProperties,
-    std::uint32_t typeBits,
-    vk::MemoryPropertyFlags requirementsMask) -> std::uint32_t {
-    auto typeIndex = std::uint32_t(~0);
-
-    for (std::uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-        if ((typeBits & 1) != 0 &&
-            ((memoryProperties.memoryTypes[i].propertyFlags & requirementsMask) == requirementsMask)) {
-            typeIndex = i;
-            break;
-        }
-        typeBits >>= 1;
-    }
-
-    assert(typeIndex != std::uint32_t(~0));
-    return typeIndex;
-}
-
 auto VulkanRender::enumerateExtensions(std::vector<vk::ExtensionProperties> const &extensionProperties, std::set<std::string> const &desiredExtensions) -> std::vector<char const *> {
     std::vector<char const *> extensions;
 
@@ -161,6 +150,14 @@ auto VulkanRender::getQueueFamilyIndex(std::vector<vk::QueueFamilyProperties> co
 auto VulkanRender::getGraphicsAndPresentQueueFamilyIndex(std::vector<vk::QueueFamilyProperties> const &queueFamilyProperties, std::uint32_t graphicsQueueFamilyIndex) -> std::array<std::uint32_t, 2> {
     std::array<std::uint32_t, 2> queueFamilyIndices;
 
+    if (!*surface) {
+        // No surface (e.g. running headless in the benchmarks), so nothing
+        // will ever be presented. Just use the graphics queue for both
+        queueFamilyIndices.at(0) = graphicsQueueFamilyIndex;
+        queueFamilyIndices.at(1) = graphicsQueueFamilyIndex;
+        return queueFamilyIndices;
+    }
+
     if (physicalDevice.getSurfaceSupportKHR(graphicsQueueFamilyIndex, *surface)) {
         queueFamilyIndices.at(0) = graphicsQueueFamilyIndex;
         queueFamilyIndices.at(1) = graphicsQueueFamilyIndex;
@@ -197,6 +194,141 @@ auto VulkanRender::getGraphicsAndPresentQueueFamilyIndex(std::vector<vk::QueueFa
     throw std::runtime_error("Could not find queues for both graphics or present -> terminating");
 }
 
+namespace {
+
+// Where per user caches go on each platform, empty if we can't tell
+auto userCacheDirectory() -> std::filesystem::path {
+#if defined(_WIN32)
+    if (auto const *localAppData = std::getenv("LOCALAPPDATA")) {
+        return std::filesystem::path(localAppData) / "manga-manager";
+    }
+#elif defined(__APPLE__)
+    if (auto const *home = std::getenv("HOME")) {
+        return std::filesystem::path(home) / "Library" / "Caches" / "manga-manager";
+    }
+#else
+    // https://specifications.freedesktop.org/basedir-spec/latest/
+    if (auto const *cacheHome = std::getenv("XDG_CACHE_HOME"); cacheHome != nullptr && *cacheHome != '\0') {
+        return std::filesystem::path(cacheHome) / "manga-manager";
+    }
+    if (auto const *home = std::getenv("HOME")) {
+        return std::filesystem::path(home) / ".cache" / "manga-manager";
+    }
+#endif
+    return {};
+}
+
+// Descriptor indexing, for the bindless texture table (see BindlessTextures).
+// Core in 1.2, but optional, and older devices can't be asked about 1.2
+// features at all
+auto supportsBindless(vk::raii::PhysicalDevice const &device) -> bool {
+    if (device.getProperties().apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+    auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    auto const &vulkan12Features = features.get<vk::PhysicalDeviceVulkan12Features>();
+    return vulkan12Features.runtimeDescriptorArray && vulkan12Features.descriptorBindingPartiallyBound &&
+           vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+           vulkan12Features.descriptorBindingUpdateUnusedWhilePending &&
+           vulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+}
+
+} // namespace
+
+auto VulkanRender::loadPipelineCache() -> std::vector<std::uint8_t> {
+    auto directory = userCacheDirectory();
+    if (directory.empty()) {
+        return {};
+    }
+    pipelineCachePath = directory / "pipeline-cache.bin";
+
+    std::ifstream inf{pipelineCachePath, std::ios::binary};
+    if (!inf) {
+        // First launch, nothing to load
+        return {};
+    }
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(inf)), std::istreambuf_iterator<char>());
+
+    // Drivers are meant to reject caches that aren't theirs, but not all of
+    // them are that careful, and a cache from another GPU or driver version
+    // is useless anyway. So check the header ourselves
+    // https://registry.khronos.org/vulkan/specs/1.3-extensions/html/vkspec.html#pipelines-cache-header
+    auto properties = physicalDevice.getProperties();
+
+    VkPipelineCacheHeaderVersionOne header{};
+    if (data.size() < sizeof(header)) {
+        std::cout << "Ignoring pipeline cache, it's truncated\n";
+        return {};
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (header.headerSize < sizeof(header) || header.headerSize > data.size() ||
+        header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+        std::cout << "Ignoring pipeline cache, the header is invalid\n";
+        return {};
+    }
+    if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID ||
+        std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0) {
+        std::cout << "Ignoring pipeline cache, it's from a different GPU or driver\n";
+        return {};
+    }
+
+    return data;
+}
+
+void VulkanRender::savePipelineCache() {
+    if (!*pipelineCache || pipelineCachePath.empty()) {
+        return;
+    }
+
+    auto data = pipelineCache.getData();
+    if (data.empty()) {
+        return;
+    }
+
+    std::filesystem::create_directories(pipelineCachePath.parent_path());
+
+    // Write to a temporary file and move it into place, so a crash half way
+    // through never leaves a corrupt cache for the next launch to load
+    auto temporaryPath = pipelineCachePath;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream outf{temporaryPath, std::ios::binary | std::ios::trunc};
+        outf.write(reinterpret_cast<char const *>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!outf.flush()) {
+            throw std::runtime_error("Could not write " + temporaryPath.string());
+        }
+    }
+    std::filesystem::rename(temporaryPath, pipelineCachePath);
+}
+
+auto VulkanRender::choosePresentMode(std::vector<vk::PresentModeKHR> const &available) const -> vk::PresentModeKHR {
+    // In order of preference, the FIFO present mode is guaranteed by the spec
+    // to be supported, so always fall back to it
+    // https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkPresentModeKHR.html
+    std::vector<vk::PresentModeKHR> preferred;
+    switch (presentPolicy) {
+    case PresentPolicy::LowLatency:
+        // Mailbox doesn't tear and lets us show the newest frame at the next
+        // vblank. Fifo relaxed at least doesn't make a late frame wait for
+        // a whole extra vblank
+        preferred = {vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eFifoRelaxed};
+        break;
+    case PresentPolicy::VSync:
+        break;
+    case PresentPolicy::Uncapped:
+        preferred = {vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox};
+        break;
+    }
+
+    for (auto mode : preferred) {
+        if (std::ranges::find(available, mode) != available.end()) {
+            return mode;
+        }
+    }
+    return vk::PresentModeKHR::eFifo;
+}
+
 
 VulkanRender::VulkanRender(const std::string &AppName) {
     // This isn't actually used inside any vulkan code, it's info that is
@@ -256,6 +388,22 @@ VulkanRender::VulkanRender(const std::string &AppName) {
 }
 
 VulkanRender::~VulkanRender() {
+    // Frames may still be in flight, e.g. if we are unwinding from an
+    // exception, wait for them before the members start being destroyed
+    if (*device) {
+        device.waitIdle();
+    }
+    // Anything still compiling finishes, so it makes it into the cache,
+    // anything that hasn't started never will
+    pipelines.reset();
+
+    // Losing the cache only costs us time on the next launch, so never let
+    // it throw out of a destructor
+    try {
+        savePipelineCache();
+    } catch (std::exception const &err) {
+        std::cerr << "Failed to save the pipeline cache: " << err.what() << "\n";
+    }
 }
 
 void VulkanRender::createSurface(SDL_Window *window) {
@@ -278,17 +426,24 @@ void VulkanRender::selectPhysicalDevice() {
     }
 
     // Then go through and select the preferred device
-    // e.g. Prefering a dedicated GPU over an intergrated GPU
+    // e.g. Prefering a dedicated GPU over an intergrated GPU, otherwise just
+    // default to the first available device. Only ones that can do bindless
+    // textures count, a discrete GPU that can't loses to an integrated one
+    // that can
     // NOTE: There could be a lot more here, but for now this is good enough
+    physicalDevice = nullptr;
     for (auto const &pds : physicalDevices) {
-        if (pds.getProperties().deviceType == vk::PhysicalDeviceType::eDiscreteGpu) {
+        if (!supportsBindless(pds)) {
+            std::cout << "Skipping " << pds.getProperties().deviceName << ", it doesn't support descriptor indexing\n";
+            continue;
+        }
+        if (!*physicalDevice || pds.getProperties().deviceType == vk::PhysicalDeviceType::eDiscreteGpu) {
             physicalDevice = pds;
         }
     }
 
     if (!*physicalDevice) {
-        // Otherwise just default to the first available device
-        physicalDevice = physicalDevices.front();
+        throw std::runtime_error("No GPU supports descriptor indexing (Vulkan 1.2), which is needed for bindless textures.");
     }
 
     vk::PhysicalDeviceProperties deviceProperties = physicalDevice.getProperties();
@@ -303,9 +458,37 @@ void VulkanRender::selectPhysicalDevice() {
     // Get Physical Device Features
     // We can see whats available and then choose to enable them in our
     // enableDeviceFeatures virable, which is used in device creation
-    // At the moment, I don't need anything specific so this is more
-    // done to silence a vulkan best practice warning
-    [[maybe_unused]] auto features2 = physicalDevice.getFeatures2();
+    //
+    // The one thing we do need is descriptor indexing, which the device was
+    // picked for having, so it's at least 1.2 and can be asked about (and
+    // given) 1.2 features
+    auto features2 = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    auto const &vulkan12Features = features2.get<vk::PhysicalDeviceVulkan12Features>();
+    enableVulkan12Features.runtimeDescriptorArray = VK_TRUE;
+    enableVulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+    enableVulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    enableVulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    enableVulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+    // The fast path: dynamic rendering instead of a render pass and
+    // framebuffers (nothing to rebuild on resize), synchronization2 barriers
+    // and submits, and a timeline semaphore instead of a fence per frame.
+    // All core in 1.3, but only ask a 1.3 device about its 1.3 features.
+    // Anything missing and we stay on the legacy path
+    dynamicRendering = false;
+    enableVulkan12Features.pNext = nullptr;
+    if (!legacyRequested && deviceProperties.apiVersion >= VK_API_VERSION_1_3 && vulkan12Features.timelineSemaphore) {
+        auto features13 = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan13Features>();
+        auto const &vulkan13Features = features13.get<vk::PhysicalDeviceVulkan13Features>();
+        if (vulkan13Features.dynamicRendering && vulkan13Features.synchronization2) {
+            dynamicRendering = true;
+            enableVulkan12Features.timelineSemaphore = VK_TRUE;
+            enableVulkan13Features.dynamicRendering = VK_TRUE;
+            enableVulkan13Features.synchronization2 = VK_TRUE;
+            enableVulkan12Features.pNext = &enableVulkan13Features;
+        }
+    }
+    std::cout << "Rendering      : " << (dynamicRendering ? "dynamic rendering" : "render pass") << "\n";
 
     // Notes for vulkan terminology (to better understand the next section of code):
     // - A queuefamily descibes what "type" a queue is
@@ -339,6 +522,25 @@ void VulkanRender::selectPhysicalDevice() {
     assert(graphicsQueueFamilyIndex < queueFamilyProperties.size());
 
     graphicsAndPresentQueueFamilyIndex = getGraphicsAndPresentQueueFamilyIndex(queueFamilyProperties, graphicsQueueFamilyIndex);
+
+    // Graphics queues can always do transfers, even if they don't say so, so
+    // only take a transfer family that can't do graphics
+    transferQueueFamilyIndex = graphicsAndPresentQueueFamilyIndex.at(0);
+    transferQueueIndex = 0;
+    transferQueueShared = true;
+    try {
+        auto transferFamily = getQueueFamilyIndex(queueFamilyProperties, vk::QueueFlagBits::eTransfer);
+        if (!(queueFamilyProperties[transferFamily].queueFlags & vk::QueueFlagBits::eGraphics)) {
+            transferQueueFamilyIndex = transferFamily;
+            transferQueueShared = false;
+        }
+    } catch (std::runtime_error const &) {
+        // Nothing advertises transfer on its own
+    }
+    if (transferQueueShared && queueFamilyProperties[transferQueueFamilyIndex].queueCount > 1) {
+        transferQueueIndex = 1;
+        transferQueueShared = false;
+    }
 }
 
 void VulkanRender::initDevice() {
@@ -346,13 +548,28 @@ void VulkanRender::initDevice() {
     auto deviceExtensions = enumerateExtensions(deviceExtensionProperties, desiredDeviceExtensions);
 
     // Create a Device
-    float queuePriority = 0.0F;
-
-    auto deviceQueueCreateInfo = vk::DeviceQueueCreateInfo{
-        .flags = vk::DeviceQueueCreateFlags(),
-        .queueFamilyIndex = graphicsAndPresentQueueFamilyIndex.at(0),
-        .queueCount = 1,
-        .pQueuePriorities = &queuePriority};
+    // Uploads are less urgent then drawing the frame the user is looking at
+    std::array<float, 2> queuePriorities = {1.0F, 0.5F};
+
+    std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos = {
+        vk::DeviceQueueCreateInfo{
+            .flags = vk::DeviceQueueCreateFlags(),
+            .queueFamilyIndex = graphicsAndPresentQueueFamilyIndex.at(0),
+            .queueCount = 1,
+            .pQueuePriorities = queuePriorities.data()}};
+
+    if (!transferQueueShared) {
+        if (transferQueueFamilyIndex == graphicsAndPresentQueueFamilyIndex.at(0)) {
+            // Second queue in the graphics family
+            deviceQueueCreateInfos.front().queueCount = 2;
+        } else {
+            deviceQueueCreateInfos.push_back(vk::DeviceQueueCreateInfo{
+                .flags = vk::DeviceQueueCreateFlags(),
+                .queueFamilyIndex = transferQueueFamilyIndex,
+                .queueCount = 1,
+                .pQueuePriorities = &queuePriorities[1]});
+        }
+    }
 
     // Note for vk:DeviceCreateInfo:
     // Even though Device Layers have been deprecated, it is still
@@ -362,9 +579,10 @@ void VulkanRender::initDevice() {
     // https://registry.khronos.org/vulkan/specs/1.3-extensions/html/vkspec.html#extendingvulkan-layers-devicelayerdeprecation
     device = vk::raii::Device(physicalDevice,
         vk::DeviceCreateInfo{
+            .pNext = &enableVulkan12Features,
             .flags = vk::DeviceCreateFlags(),
-            .queueCreateInfoCount = 1,
-            .pQueueCreateInfos = &deviceQueueCreateInfo,
+            .queueCreateInfoCount = static_cast<std::uint32_t>(deviceQueueCreateInfos.size()),
+            .pQueueCreateInfos = deviceQueueCreateInfos.data(),
             .enabledLayerCount = 0,
             .ppEnabledLayerNames = nullptr,
             .enabledExtensionCount = static_cast<std::uint32_t>(deviceExtensions.size()),
@@ -381,26 +599,76 @@ void VulkanRender::initDevice() {
     // C fuctions way does not mesh well with the raii-approach. So, to handle
     // it correctly you should explicitly destroy vk::raii::CommandBuffers
     // before destroying the related vk::raii::CommandPool
+    //
+    // eResetCommandBuffer lets each frame reset and re-record its own command
+    // buffer without touching the others still in flight
     commandPool = vk::raii::CommandPool(device,
         vk::CommandPoolCreateInfo{
-            .flags = vk::CommandPoolCreateFlags(),
+            .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
             .queueFamilyIndex = graphicsAndPresentQueueFamilyIndex.at(0)});
 
     // The commandBufferCount of the vk::CommandBufferAllocateInfo struct
     // controls how many elements are in the
     // std::vector(vk::raii::CommandBuffers).
-    // At the moment, we only intended to make use of a singular command buffer
-    commandBuffers = vk::raii::CommandBuffers(device,
+    // One for each frame in flight
+    vk::raii::CommandBuffers commandBuffers(device,
         vk::CommandBufferAllocateInfo{
             .commandPool = *commandPool,
             .level = vk::CommandBufferLevel::ePrimary,
-            .commandBufferCount = 1});
+            .commandBufferCount = static_cast<std::uint32_t>(frames.size())});
 
-    commandBuffer = std::move(commandBuffers.front());
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        frames[i].commandBuffer = std::move(commandBuffers[i]);
+        frames[i].imageAcquired = vk::raii::Semaphore(device, vk::SemaphoreCreateInfo());
+        frames[i].inFlight = vk::raii::Fence(device, vk::FenceCreateInfo{
+                                                         .flags = vk::FenceCreateFlagBits::eSignaled});
+    }
+    if (dynamicRendering) {
+        auto semaphoreType = vk::SemaphoreTypeCreateInfo{
+            .semaphoreType = vk::SemaphoreType::eTimeline,
+            .initialValue = 0};
+        frameTimeline = vk::raii::Semaphore(device, vk::SemaphoreCreateInfo{
+                                                        .pNext = &semaphoreType,
+                                                        .flags = vk::SemaphoreCreateFlags()});
+    }
+
+    allocator = std::make_unique<GpuAllocator>(physicalDevice, device);
+    textures = std::make_unique<BindlessTextures>(physicalDevice, device, framesInFlight);
+    // A handful of pages (or strip tiles) on their way at once, and room
+    // for a few times that when decoding gets ahead of the uploads. Offsets
+    // also have to be a whole texel for copies into RGBA8 images
+    staging = std::make_unique<StagingRing>(*allocator, device, 64 * 1024 * 1024,
+        std::max<vk::DeviceSize>(physicalDevice.getProperties().limits.optimalBufferCopyOffsetAlignment, 16),
+        192 * 1024 * 1024);
+
+    // Shared by every pipeline, graphics and compute, so created here rather
+    // then in initPipeline(), compute works without a window
+    // https://github.com/KhronosGroup/Vulkan-Hpp/blob/main/RAII_Samples/PipelineCache/PipelineCache.cpp
+    auto pipelineCacheData = loadPipelineCache();
+    pipelineCache = vk::raii::PipelineCache(device,
+        vk::PipelineCacheCreateInfo{
+            .flags = vk::PipelineCacheCreateFlags(),
+            .initialDataSize = pipelineCacheData.size(),
+            .pInitialData = pipelineCacheData.data()});
+    // Compiling is all CPU, but the window coming up, the first frames and
+    // page decodes want some of that too, so it gets half the cores
+    auto threads = std::max(std::thread::hardware_concurrency(), 2U);
+    pipelines = std::make_unique<PipelineManager>(pipelineCache, std::min(threads / 2, 4U));
+    resampler = std::make_unique<Resampler>(device, *allocator, *pipelines);
+
+    frameProfiler = std::make_unique<FrameProfiler>(physicalDevice, device, graphicsAndPresentQueueFamilyIndex.at(0), frames.size());
+    // The render thread records its share too. Past a handful of threads
+    // the batches get too small to be worth handing out
+    recordWorkers = std::make_unique<core::ThreadPool>(std::min(threads - 1, 7U));
 
     // Create the queues for later use
     graphicsQueue = vk::raii::Queue(device, graphicsAndPresentQueueFamilyIndex.at(0), 0);
     presentQueue = vk::raii::Queue(device, graphicsAndPresentQueueFamilyIndex.at(1), 0);
+    transferQueue = vk::raii::Queue(device, transferQueueFamilyIndex, transferQueueIndex);
+}
+
+void VulkanRender::setPresentPolicy(PresentPolicy policy) {
+    presentPolicy = policy;
 }
 
 void VulkanRender::initSwapchain(int windowWidth, int windowHeight) {
@@ -433,10 +701,16 @@ void VulkanRender::initSwapchain(int windowWidth, int windowHeight) {
         extent = surfaceCapabilities.currentExtent;
     }
 
-    // The FIFO present mode is guaranteed by the spec to be supported
-    // https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkPresentModeKHR.html
-    // We can deal with other present modes down the line if the need ever arises
-    vk::PresentModeKHR swapchainPresentMode = vk::PresentModeKHR::eFifo;
+    vk::PresentModeKHR swapchainPresentMode = choosePresentMode(physicalDevice.getSurfacePresentModesKHR(*surface));
+
+    // One more image then the minimum, so there's always one we can render
+    // to while the others are queued or on screen. Mailbox in particular
+    // needs it to ever replace a queued frame. A maxImageCount of 0 means
+    // there's no limit
+    std::uint32_t imageCount = surfaceCapabilities.minImageCount + 1;
+    if (surfaceCapabilities.maxImageCount != 0) {
+        imageCount = std::min(imageCount, surfaceCapabilities.maxImageCount);
+    }
 
     vk::SurfaceTransformFlagBitsKHR preTransform =
         (surfaceCapabilities.supportedTransforms & vk::SurfaceTransformFlagBitsKHR::eIdentity)
@@ -455,7 +729,7 @@ void VulkanRender::initSwapchain(int windowWidth, int windowHeight) {
     auto swapChainCreateInfo = vk::SwapchainCreateInfoKHR{
         .flags = vk::SwapchainCreateFlagsKHR(),
         .surface = *surface,
-        .minImageCount = surfaceCapabilities.minImageCount,
+        .minImageCount = imageCount,
         .imageFormat = colorFormat,
         .imageColorSpace = vk::ColorSpaceKHR::eSrgbNonlinear,
         .imageExtent = extent,
@@ -468,7 +742,10 @@ void VulkanRender::initSwapchain(int windowWidth, int windowHeight) {
         .compositeAlpha = compositeAlpha,
         .presentMode = swapchainPresentMode,
         .clipped = VK_TRUE,
-        .oldSwapchain = nullptr};
+        // When recreating, handing over the old swapchain lets the driver
+        // reuse its resources, and keep showing its images until ours are
+        // ready
+        .oldSwapchain = *swapChain};
 
     if (graphicsAndPresentQueueFamilyIndex.at(0) != graphicsAndPresentQueueFamilyIndex.at(1)) {
         // If the graphics and present queues are from different queue
@@ -481,6 +758,8 @@ void VulkanRender::initSwapchain(int windowWidth, int windowHeight) {
     }
 
     swapChain = vk::raii::SwapchainKHR(device, swapChainCreateInfo);
+    std::cout << "Swapchain: " << extent.width << "x" << extent.height << ", " << imageCount << " images, "
+              << vk::to_string(swapchainPresentMode) << " present mode\n";
     // Get presentable images associated with vk::raii::SwapchainKHR swapchain
     // This will give us plain VkImages (these are controlled by the swapchain,
     // we should not destroy them ourselves). VkImages basically represents
@@ -490,7 +769,10 @@ void VulkanRender::initSwapchain(int windowWidth, int windowHeight) {
     // Similar in concept as C++'s string and string_view
     swapChainImages = swapChain.getImages();
 
+    imageViews.clear();
+    renderFinishedSemaphores.clear();
     imageViews.reserve(swapChainImages.size());
+    renderFinishedSemaphores.reserve(swapChainImages.size());
 
     // clang-format off
     // clang format breaks on multiple nested direct initialization structs.
@@ -516,8 +798,13 @@ void VulkanRender::initSwapchain(int windowWidth, int windowHeight) {
         imageViewCreateInfo.image = image;
 
         imageViews.emplace_back(device, imageViewCreateInfo);
+        renderFinishedSemaphores.emplace_back(device, vk::SemaphoreCreateInfo());
     }
 
+    createDepthBuffer();
+}
+
+void VulkanRender::createDepthBuffer() {
     // Create a depth buffer
     // Depth buffers allow for 3d graphics
     //
@@ -566,28 +853,19 @@ void VulkanRender::initSwapchain(int windowWidth, int windowHeight) {
         imageCreateInfo.pQueueFamilyIndices = graphicsAndPresentQueueFamilyIndex.data();
     }
 
-    depthImage = vk::raii::Image(device, imageCreateInfo);
-
-    vk::MemoryRequirements memoryRequirements = depthImage.getMemoryRequirements();
-
-    std::uint32_t memoryTypeIndex = findMemoryType(
-        physicalDevice.getMemoryProperties(),
-        memoryRequirements.memoryTypeBits,
-        vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-    depthMemory = vk::raii::DeviceMemory(device,
-        vk::MemoryAllocateInfo{
-            .allocationSize = memoryRequirements.size,
-            .memoryTypeIndex = memoryTypeIndex});
-
-    depthImage.bindMemory(*depthMemory, 0);
+    // Free the old depth buffer first when recreating, so its memory can be
+    // reused for the new one
+    depthView = nullptr;
+    depthImage.image = nullptr;
+    depthImage.allocation = {};
+    depthImage = createGpuImage(*allocator, device, imageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
     // clang-format off
     // clang format breaks on multiple nested direct initialization structs.
     depthView = vk::raii::ImageView(device,
         vk::ImageViewCreateInfo{
             .flags = vk::ImageViewCreateFlags(),
-            .image = *depthImage,
+            .image = *depthImage.image,
             .viewType = vk::ImageViewType::e2D,
             .format = depthFormat,
             .components = vk::ComponentMapping{
@@ -604,6 +882,91 @@ void VulkanRender::initSwapchain(int windowWidth, int windowHeight) {
     // clang-format on
 }
 
+auto VulkanRender::recordersFor(std::size_t count) -> std::span<Recorder const> {
+    auto &slot = recorders[currentFrame];
+    while (slot.size() < count) {
+        // Transient, everything in it is recorded once and thrown away
+        auto pool = vk::raii::CommandPool(device,
+            vk::CommandPoolCreateInfo{
+                .flags = vk::CommandPoolCreateFlagBits::eTransient,
+                .queueFamilyIndex = graphicsAndPresentQueueFamilyIndex.at(0)});
+        auto buffers = vk::raii::CommandBuffers(device,
+            vk::CommandBufferAllocateInfo{
+                .commandPool = *pool,
+                .level = vk::CommandBufferLevel::eSecondary,
+                .commandBufferCount = 1});
+        slot.push_back(Recorder{.pool = std::move(pool), .commandBuffer = std::move(buffers.front())});
+    }
+    return std::span<Recorder const>(slot).first(count);
+}
+
+void VulkanRender::initOffscreen(std::uint32_t width, std::uint32_t height) {
+    // The same layout as a typical sRGB swapchain, so what we measure and
+    // read back is what would have been shown on screen
+    offscreen = true;
+    colorFormat = vk::Format::eR8G8B8A8Srgb;
+    extent = vk::Extent2D{.width = width, .height = height};
+
+    offscreenImages.clear();
+    imageViews.clear();
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        auto image = createGpuImage(*allocator, device,
+            vk::ImageCreateInfo{
+                .flags = vk::ImageCreateFlags(),
+                .imageType = vk::ImageType::e2D,
+                .format = colorFormat,
+                .extent = vk::Extent3D{
+                    .width = extent.width,
+                    .height = extent.height,
+                    .depth = 1},
+                .mipLevels = 1,
+                .arrayLayers = 1,
+                .samples = vk::SampleCountFlagBits::e1,
+                .tiling = vk::ImageTiling::eOptimal,
+                .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = 0,
+                .pQueueFamilyIndices = nullptr,
+                .initialLayout = vk::ImageLayout::eUndefined},
+            vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        // clang-format off
+        imageViews.emplace_back(device,
+            vk::ImageViewCreateInfo{
+                .flags = vk::ImageViewCreateFlags(),
+                .image = *image.image,
+                .viewType = vk::ImageViewType::e2D,
+                .format = colorFormat,
+                .components = vk::ComponentMapping(),
+                .subresourceRange = vk::ImageSubresourceRange{
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .baseMipLevel = 0,
+                    .levelCount = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1}});
+        // clang-format on
+        offscreenImages.push_back(std::move(image));
+    }
+    std::cout << "Offscreen: " << extent.width << "x" << extent.height << ", " << offscreenImages.size() << " images\n";
+
+    createDepthBuffer();
+}
+
+void VulkanRender::recreateSwapchain(int windowWidth, int windowHeight) {
+    // Everything tied to the old swapchain may still be in use by frames in
+    // flight. Resizes are rare enough that simply waiting them out is fine
+    device.waitIdle();
+
+    // The framebuffers point at the old image views, so have to go first.
+    // The render pass and pipeline only care about formats, which don't
+    // change, and viewport and scissor are dynamic state set every frame.
+    // With dynamic rendering there are no framebuffers to rebuild at all
+    framebuffers.clear();
+    initSwapchain(windowWidth, windowHeight);
+    initFramebuffers();
+    swapchainSuboptimal = false;
+}
+
 void VulkanRender::createUniformBuffer() {
     // My specific data that I want to use in the uniform buffer
     // At the moment I'll have it inside the function till I get the inital
@@ -623,12 +986,22 @@ void VulkanRender::createUniformBuffer() {
                                     0.0F,  0.0F, 0.5F, 0.0F,
                                     0.0F,  0.0F, 0.5F, 1.0F );  // vulkan clip space has inverted y and half z !
     // clang-format on
-    const glm::mat4x4 mvpc = clip * projection * view * model;
+    mvpc = clip * projection * view * model;
 
-    std::tie(uniformBufferMemory, uniformDataBuffer) = createBuffer(vk::BufferUsageFlagBits::eUniformBuffer, mvpc);
+    // Room for a few KiB of uniforms per frame, far more then the cube needs.
+    // The matrix itself is written in every frame by render()
+    auto alignment = physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+    uniformRing.emplace(*allocator, device, alignment, 16 * 1024, frames.size());
 }
 
 void VulkanRender::initRenderPass() {
+    // Dynamic rendering gives the attachments when it begins rendering, all
+    // anything else needs to know up front is their formats
+    if (dynamicRendering) {
+        target = RenderTarget{.renderPass = nullptr, .colorFormat = colorFormat, .depthFormat = depthFormat};
+        return;
+    }
+
     std::array<vk::AttachmentDescription, 2> attachmentDescriptions = {
         vk::AttachmentDescription{
             .flags = vk::AttachmentDescriptionFlags(),
@@ -639,7 +1012,8 @@ void VulkanRender::initRenderPass() {
             .stencilLoadOp = vk::AttachmentLoadOp::eDontCare,
             .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
             .initialLayout = vk::ImageLayout::eUndefined,
-            .finalLayout = vk::ImageLayout::ePresentSrcKHR},
+            // Offscreen frames are only ever read back
+            .finalLayout = offscreen ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR},
         vk::AttachmentDescription{
             .flags = vk::AttachmentDescriptionFlags(),
             .format = depthFormat,
@@ -671,6 +1045,20 @@ void VulkanRender::initRenderPass() {
         .preserveAttachmentCount = 0,
         .pPreserveAttachments = nullptr};
 
+    // With more then one frame in flight, the previous frame may still be
+    // using the depth buffer (there's only one) when this one starts, and the
+    // swapchain image only becomes available at the colour output stage
+    // (which is where we wait on the acquire semaphore). Make sure neither
+    // gets cleared until then.
+    auto dependency = vk::SubpassDependency{
+        .srcSubpass = VK_SUBPASS_EXTERNAL,
+        .dstSubpass = 0,
+        .srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests,
+        .dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
+        .srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+        .dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+        .dependencyFlags = vk::DependencyFlags()};
+
     renderPass = vk::raii::RenderPass(device,
         vk::RenderPassCreateInfo{
             .flags = vk::RenderPassCreateFlags(),
@@ -678,14 +1066,19 @@ void VulkanRender::initRenderPass() {
             .pAttachments = attachmentDescriptions.data(),
             .subpassCount = 1,
             .pSubpasses = &subpass,
-            .dependencyCount = 0,
-            .pDependencies = nullptr});
+            .dependencyCount = 1,
+            .pDependencies = &dependency});
+    target = RenderTarget{.renderPass = *renderPass, .colorFormat = colorFormat, .depthFormat = depthFormat};
 }
 
 void VulkanRender::initFramebuffers() {
+    if (dynamicRendering) {
+        return;
+    }
     std::array<vk::ImageView, 2> attachments;
     attachments[1] = *depthView;
 
+    framebuffers.clear();
     framebuffers.reserve(imageViews.size());
 
     for (auto const &imageView : imageViews) {
@@ -705,13 +1098,83 @@ void VulkanRender::initFramebuffers() {
 }
 
 void VulkanRender::createVertexBuffer() {
-    std::tie(vertexBufferMemory, vertexBuffer) = createBuffer(vk::BufferUsageFlagBits::eVertexBuffer, coloredCubeData);
+    vertexBuffer = createBuffer(vk::BufferUsageFlagBits::eVertexBuffer, coloredCubeData);
+}
+
+auto VulkanRender::uploadBuffer(vk::BufferUsageFlags usageFlags, void const *data, vk::DeviceSize size) -> GpuBuffer {
+    auto bufferCreateInfo = vk::BufferCreateInfo{
+        .flags = vk::BufferCreateFlags(),
+        .size = size,
+        .usage = usageFlags | vk::BufferUsageFlagBits::eTransferDst,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = nullptr,
+    };
+
+    if (graphicsAndPresentQueueFamilyIndex.at(0) != graphicsAndPresentQueueFamilyIndex.at(1)) {
+        bufferCreateInfo.sharingMode = vk::SharingMode::eConcurrent;
+        bufferCreateInfo.queueFamilyIndexCount = 2;
+        bufferCreateInfo.pQueueFamilyIndices = graphicsAndPresentQueueFamilyIndex.data();
+    }
+
+    auto buffer = createGpuBuffer(*allocator, device, bufferCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    // The staging buffer is only ever touched by the graphics queue
+    auto staging = createGpuBuffer(*allocator, device,
+        vk::BufferCreateInfo{
+            .flags = vk::BufferCreateFlags(),
+            .size = size,
+            .usage = vk::BufferUsageFlagBits::eTransferSrc,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr},
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    std::memcpy(staging.allocation.mapped(), data, size);
+
+    submitNow([&](vk::raii::CommandBuffer const &commandBuffer) {
+        commandBuffer.copyBuffer(*staging.buffer, *buffer.buffer, vk::BufferCopy{.srcOffset = 0, .dstOffset = 0, .size = size});
+    });
+
+    return buffer;
+}
+
+void VulkanRender::submitNow(std::function<void(vk::raii::CommandBuffer const &)> const &record) {
+    vk::raii::CommandBuffers commandBuffers(device,
+        vk::CommandBufferAllocateInfo{
+            .commandPool = *commandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1});
+    auto const &commandBuffer = commandBuffers.front();
+
+    commandBuffer.begin(vk::CommandBufferBeginInfo{
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        .pInheritanceInfo = nullptr});
+    record(commandBuffer);
+    commandBuffer.end();
+
+    auto fence = vk::raii::Fence(device, vk::FenceCreateInfo{.flags = vk::FenceCreateFlags()});
+    graphicsQueue.submit(
+        vk::SubmitInfo{
+            .waitSemaphoreCount = 0,
+            .pWaitSemaphores = nullptr,
+            .pWaitDstStageMask = nullptr,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &(*commandBuffer),
+            .signalSemaphoreCount = 0,
+            .pSignalSemaphores = nullptr},
+        *fence);
+
+    while (vk::Result::eTimeout == device.waitForFences({*fence}, VK_TRUE, fenceTimeout)) {
+        /* do nothing */
+    }
 }
 
 void VulkanRender::initPipeline() {
+    // Dynamic, so the offset into the uniform ring is given when binding
+    // rather then baked into the descriptor set
     auto descriptorSetLayoutBinding = vk::DescriptorSetLayoutBinding{
         .binding = 0,
-        .descriptorType = vk::DescriptorType::eUniformBuffer,
+        .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
         .descriptorCount = 1,
         .stageFlags = vk::ShaderStageFlagBits::eVertex,
         .pImmutableSamplers = nullptr};
@@ -736,7 +1199,7 @@ void VulkanRender::initPipeline() {
     //  { vk::DescriptorType::eUniformBuffer, 10 }
     // };
     auto poolSize = vk::DescriptorPoolSize{
-        .type = vk::DescriptorType::eUniformBuffer,
+        .type = vk::DescriptorType::eUniformBufferDynamic,
         .descriptorCount = 1};
 
     descriptorPool = vk::raii::DescriptorPool(device,
@@ -756,7 +1219,7 @@ void VulkanRender::initPipeline() {
     descriptorSet = std::move(descriptorSets.front());
 
     vk::DescriptorBufferInfo descriptorBufferInfo{
-        .buffer = *uniformDataBuffer,
+        .buffer = uniformRing->buffer(),
         .offset = 0,
         .range = sizeof(glm::mat4x4)};
 
@@ -765,7 +1228,7 @@ void VulkanRender::initPipeline() {
         .dstBinding = 0,
         .dstArrayElement = 0,
         .descriptorCount = 1,
-        .descriptorType = vk::DescriptorType::eUniformBuffer,
+        .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
         .pImageInfo = nullptr,
         .pBufferInfo = &descriptorBufferInfo,
         .pTexelBufferView = nullptr};
@@ -801,6 +1264,17 @@ void VulkanRender::initPipeline() {
             .codeSize = fragShader.size() * sizeof(std::uint32_t),
             .pCode = fragShader.data()});
 
+    // The target by value, in case initRenderPass() is called again before
+    // the job runs
+    scenePipeline = pipelines->compile("scene", [this, renderTarget = target](vk::raii::PipelineCache const &cache) {
+        return createScenePipeline(cache, renderTarget);
+    });
+
+    quadRenderer = std::make_unique<QuadRenderer>(physicalDevice, device, *allocator, *textures, target,
+        *pipelines, frames.size());
+}
+
+auto VulkanRender::createScenePipeline(vk::raii::PipelineCache const &cache, RenderTarget const &renderTarget) const -> vk::raii::Pipeline {
     std::array<vk::PipelineShaderStageCreateInfo, 2> pipelineShaderStageCreateInfos = {
         vk::PipelineShaderStageCreateInfo{
             .flags = vk::PipelineShaderStageCreateFlags(),
@@ -922,7 +1396,9 @@ void VulkanRender::initPipeline() {
         .dynamicStateCount = static_cast<std::uint32_t>(dynamicStates.size()),
         .pDynamicStates = dynamicStates.data()};
 
+    auto pipelineRendering = renderTarget.pipelineRendering();
     auto graphicsPipelineCreateInfo = vk::GraphicsPipelineCreateInfo{
+        .pNext = renderTarget.dynamic() ? &pipelineRendering : nullptr,
         .flags = vk::PipelineCreateFlags(),
         .stageCount = static_cast<std::uint32_t>(pipelineShaderStageCreateInfos.size()),
         .pStages = pipelineShaderStageCreateInfos.data(),
@@ -936,54 +1412,102 @@ void VulkanRender::initPipeline() {
         .pColorBlendState = &pipelineColorBlendStateCreateInfo,
         .pDynamicState = &pipelineDynamicStateCreateInfo,
         .layout = *pipelineLayout,
-        .renderPass = *renderPass,
+        .renderPass = renderTarget.renderPass,
         .subpass = 0,
         .basePipelineHandle = nullptr,
         .basePipelineIndex = 0};
 
-    // TODO Setup and use pipeline cache properly
-    // https://github.com/KhronosGroup/Vulkan-Hpp/blob/main/RAII_Samples/PipelineCache/PipelineCache.cpp
-    graphicsPipelineCache = vk::raii::PipelineCache(device, vk::PipelineCacheCreateInfo());
-    graphicsPipeline = vk::raii::Pipeline(device, graphicsPipelineCache, graphicsPipelineCreateInfo);
+    auto graphicsPipeline = vk::raii::Pipeline(device, cache, graphicsPipelineCreateInfo);
 
-    switch (graphicsPipeline.getConstructorSuccessCode()) {
-    case vk::Result::eSuccess:
-        break;
-    case vk::Result::ePipelineCompileRequiredEXT:
-        // Do something meaningfull here
-        std::cout << "vk::Pipeline returned vk::Result::ePipelineCompileRequiredEXT !\n";
-        break;
-    default:
-        assert(false); // should never happen
+    // Runs on a PipelineManager thread, which hands anything thrown to
+    // whoever asks for the pipeline. ePipelineCompileRequiredEXT is the only
+    // other success code, and we never ask to fail instead of compiling
+    if (graphicsPipeline.getConstructorSuccessCode() != vk::Result::eSuccess) {
+        throw std::runtime_error("Scene pipeline creation returned " + vk::to_string(graphicsPipeline.getConstructorSuccessCode()));
     }
+    return graphicsPipeline;
 }
 
-void VulkanRender::render() {
-    // Aquire next image
-    imageAcquiredSemaphore = vk::raii::Semaphore(device, vk::SemaphoreCreateInfo());
+void VulkanRender::initImGui(SDL_Window *window) {
+    imguiLayer = std::make_unique<ImGuiLayer>(window, device, *allocator, *textures, target, *pipelines, frames.size());
+    submitNow([&](vk::raii::CommandBuffer const &commandBuffer) {
+        imguiLayer->uploadFonts(commandBuffer);
+    });
+    imguiLayer->fontsUploaded();
+}
 
-    vk::Result result;
-    std::tie(result, imageIndex) = swapChain.acquireNextImage(fenceTimeout, *imageAcquiredSemaphore);
-    assert(imageIndex < swapChainImages.size());
+auto VulkanRender::render() -> bool {
+    auto &frame = frames[currentFrame];
+    std::optional<FrameProfiler::Scope> stage(std::in_place, *frameProfiler, CpuStage::Acquire);
+
+    // Wait for the GPU to finish with the last frame that used this slot,
+    // anything newer can carry on in the background
+    if (dynamicRendering) {
+        auto waitInfo = vk::SemaphoreWaitInfo{
+            .flags = vk::SemaphoreWaitFlags(),
+            .semaphoreCount = 1,
+            .pSemaphores = &(*frameTimeline),
+            .pValues = &frame.timelineValue};
+        while (vk::Result::eTimeout == device.waitSemaphores(waitInfo, fenceTimeout)) {
+            /* do nothing */
+        }
+    } else {
+        while (vk::Result::eTimeout == device.waitForFences({*frame.inFlight}, VK_TRUE, fenceTimeout)) {
+            /* do nothing */
+        }
+    }
+    // Now that it's done, the timestamps it wrote are ready
+    frameProfiler->collect(currentFrame);
 
-    // TODO Properly handle anything other than an Success!
-    switch (result) {
-    case vk::Result::eSuccess:
-        break;
-    case vk::Result::eTimeout:
-        break;
-    case vk::Result::eNotReady:
-        break;
-    case vk::Result::eSuboptimalKHR:
-        break;
-    default:
-        // an unexpected result is returned!
-        assert(false); 
+    if (offscreen) {
+        // Each slot has an image of its own, which the fence we just waited
+        // on says is free
+        imageIndex = static_cast<std::uint32_t>(currentFrame);
+    } else {
+        // Aquire next image
+        // Out of date means the surface changed (e.g. the window was resized)
+        // and the swapchain can't be presented to anymore. Vulkan-Hpp reports
+        // that as an exception, and nothing was acquired or signalled, so the
+        // frame can just be dropped. Suboptimal still gives us an image, so
+        // draw this frame and recreate after presenting it
+        vk::Result result;
+        try {
+            std::tie(result, imageIndex) = swapChain.acquireNextImage(std::numeric_limits<std::uint64_t>::max(), *frame.imageAcquired);
+        } catch (vk::OutOfDateKHRError const &) {
+            quadRenderer->discard();
+            if (imguiLayer) {
+                imguiLayer->discard();
+            }
+            return false;
+        }
+        assert(imageIndex < swapChainImages.size());
+        swapchainSuboptimal = (result == vk::Result::eSuboptimalKHR);
     }
 
+    // From here on the frame has to reach the GPU even if recording throws,
+    // or the acquire semaphore stays signalled (and can't be waited on
+    // again) and the slot's fence or timeline value never comes
+    struct Abandon {
+        VulkanRender &renderer;
+        FrameData &frame;
+        bool submitted = false;
+        ~Abandon() {
+            if (!submitted) {
+                renderer.abandonFrame(frame);
+            }
+        }
+    } abandon{*this, frame};
+    // Only counts frames that get submitted, abandoned ones included, so a
+    // texture slot is never recycled early
+    textures->beginFrame();
+
+    stage.emplace(*frameProfiler, CpuStage::Record);
+    auto &commandBuffer = frame.commandBuffer;
+    commandBuffer.reset();
     commandBuffer.begin(vk::CommandBufferBeginInfo{
         .flags = vk::CommandBufferUsageFlags(),
         .pInheritanceInfo = nullptr});
+    frameProfiler->beginCommands(commandBuffer, currentFrame);
 
     std::array<vk::ClearValue, 2> clearValues = {
         vk::ClearValue{
@@ -991,86 +1515,477 @@ void VulkanRender::render() {
                 .float32 = std::array<float, 4>({{0.2F, 0.2F, 0.2F, 0.2F}})}},
         vk::ClearValue{.depthStencil = vk::ClearDepthStencilValue{.depth = 1.0F, .stencil = 0}}};
 
-    auto renderPassBeginInfo = vk::RenderPassBeginInfo{
-        .renderPass = *renderPass,
-        .framebuffer = *framebuffers[imageIndex],
-        .renderArea = vk::Rect2D{
-            .offset = vk::Offset2D{
-                .x = 0,
-                .y = 0},
-            .extent = extent},
-        .clearValueCount = clearValues.size(),
-        .pClearValues = clearValues.data()};
-
-    commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *graphicsPipeline);
-    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayout, 0, {*descriptorSet}, nullptr);
-
-    commandBuffer.bindVertexBuffers(0, {*vertexBuffer}, {0});
-    commandBuffer.setViewport(0, vk::Viewport{
-                                     .x = 0.0F,
-                                     .y = 0.0F,
-                                     .width = static_cast<float>(extent.width),
-                                     .height = static_cast<float>(extent.height),
-                                     .minDepth = 0.0F,
-                                     .maxDepth = 1.0F});
-    commandBuffer.setScissor(0, vk::Rect2D{
-                                    .offset = vk::Offset2D{
-                                        .x = 0,
-                                        .y = 0},
-                                    .extent = extent});
-
-    commandBuffer.draw(12 * 3, 1, 0, 0);
-    commandBuffer.endRenderPass();
+    // Compute has to happen outside of the render pass, and before anything
+    // in it samples the results
+    resampler->recordQueued(commandBuffer);
+    frameProfiler->endPass(commandBuffer, currentFrame, GpuPass::Compute);
+
+    // Safe to overwrite, the frame that last used this section has finished
+    uniformRing->beginFrame(currentFrame);
+    auto uniformOffset = uniformRing->push(mvpc);
+    // Everything 2D goes on top, split into a batch for each thread, unless
+    // there are so few it's not worth the handoff (64 KiB of instances to
+    // copy in makes a batch worth a worker's while)
+    constexpr std::size_t minQuadsPerBatch = 1024;
+    auto threads = recordWorkers->size() + 1;
+    auto batches = quadRenderer->prepare(currentFrame,
+        std::max(minQuadsPerBatch, (quadRenderer->queued() + threads - 1) / threads));
+
+    // Scene first, the quad batches in order, and the overlay last. Jobs
+    // only ever touch their own recorder, so make them all up front
+    auto jobs = recordersFor(batches.size() + 2);
+    auto const &scene = jobs.front();
+    auto const &overlay = jobs.back();
+
+    auto inheritanceRendering = target.inheritanceRendering();
+    auto inheritanceInfo = vk::CommandBufferInheritanceInfo{
+        .pNext = target.dynamic() ? &inheritanceRendering : nullptr,
+        .renderPass = target.renderPass,
+        .subpass = 0,
+        .framebuffer = target.dynamic() ? vk::Framebuffer() : *framebuffers[imageIndex],
+        .occlusionQueryEnable = VK_FALSE,
+        .queryFlags = vk::QueryControlFlags(),
+        .pipelineStatistics = vk::QueryPipelineStatisticFlags()};
+    auto begin = [&inheritanceInfo](Recorder const &job) {
+        job.pool.reset();
+        job.commandBuffer.begin(vk::CommandBufferBeginInfo{
+            .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+            .pInheritanceInfo = &inheritanceInfo});
+    };
+    // The last batch closes the quads pass, or the scene does when there's
+    // nothing to draw
+    auto recordBatch = [&](std::size_t i) {
+        auto const &job = jobs[i + 1];
+        begin(job);
+        quadRenderer->record(job.commandBuffer, batches[i], extent);
+        if (i + 1 == batches.size()) {
+            frameProfiler->endPass(job.commandBuffer, currentFrame, GpuPass::Quads);
+        }
+        job.commandBuffer.end();
+    };
+
+    // The first batch stays here, the rest go to the workers. Whatever
+    // happens, every job has to finish before anything they use goes away
+    std::size_t handedOut = batches.empty() ? 0 : batches.size() - 1;
+    std::latch done(static_cast<std::ptrdiff_t>(handedOut));
+    recordErrors.assign(handedOut + 1, nullptr);
+    for (std::size_t i = 1; i < batches.size(); i++) {
+        recordWorkers->submit([&, i] {
+            try {
+                recordBatch(i);
+            } catch (...) {
+                recordErrors[i] = std::current_exception();
+            }
+            done.count_down();
+        });
+    }
+
+    try {
+        begin(scene);
+        // Left out until its pipeline has compiled, like the quads and the
+        // overlay
+        if (auto cube = pipelines->ready(scenePipeline)) {
+            scene.commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, cube);
+            scene.commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayout, 0, {*descriptorSet}, {uniformOffset});
+            scene.commandBuffer.bindVertexBuffers(0, {*vertexBuffer.buffer}, {0});
+            scene.commandBuffer.setViewport(0, vk::Viewport{
+                                                   .x = 0.0F,
+                                                   .y = 0.0F,
+                                                   .width = static_cast<float>(extent.width),
+                                                   .height = static_cast<float>(extent.height),
+                                                   .minDepth = 0.0F,
+                                                   .maxDepth = 1.0F});
+            scene.commandBuffer.setScissor(0, vk::Rect2D{
+                                                  .offset = vk::Offset2D{
+                                                      .x = 0,
+                                                      .y = 0},
+                                                  .extent = extent});
+            scene.commandBuffer.draw(12 * 3, 1, 0, 0);
+        }
+        frameProfiler->endPass(scene.commandBuffer, currentFrame, GpuPass::Scene);
+        if (batches.empty()) {
+            frameProfiler->endPass(scene.commandBuffer, currentFrame, GpuPass::Quads);
+        }
+        scene.commandBuffer.end();
+
+        if (!batches.empty()) {
+            recordBatch(0);
+        }
+
+        // And debug tools on top of that
+        begin(overlay);
+        if (imguiLayer) {
+            imguiLayer->record(overlay.commandBuffer, currentFrame, extent);
+        }
+        frameProfiler->endPass(overlay.commandBuffer, currentFrame, GpuPass::Overlay);
+        overlay.commandBuffer.end();
+    } catch (...) {
+        recordErrors[0] = std::current_exception();
+    }
+    done.wait();
+    for (auto const &error : recordErrors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    secondaries.clear();
+    for (auto const &job : jobs) {
+        secondaries.push_back(*job.commandBuffer);
+    }
+    if (dynamicRendering) {
+        beginRendering(commandBuffer, clearValues);
+        commandBuffer.executeCommands(secondaries);
+        endRendering(commandBuffer);
+    } else {
+        commandBuffer.beginRenderPass(
+            vk::RenderPassBeginInfo{
+                .renderPass = *renderPass,
+                .framebuffer = *framebuffers[imageIndex],
+                .renderArea = vk::Rect2D{
+                    .offset = vk::Offset2D{
+                        .x = 0,
+                        .y = 0},
+                    .extent = extent},
+                .clearValueCount = clearValues.size(),
+                .pClearValues = clearValues.data()},
+            vk::SubpassContents::eSecondaryCommandBuffers);
+        commandBuffer.executeCommands(secondaries);
+        commandBuffer.endRenderPass();
+    }
     commandBuffer.end();
 
-    drawFence = vk::raii::Fence(device, vk::FenceCreateInfo{
-                                            .flags = vk::FenceCreateFlags()});
+    // No waiting around for it to finish, present() waits on the semaphore
+    // on the GPU, and the fence (or timeline) is checked next time round
+    // the ring
+    stage.emplace(*frameProfiler, CpuStage::Submit);
+    if (dynamicRendering) {
+        auto timelineValue = frameTimelineValue + 1;
+        auto acquired = vk::SemaphoreSubmitInfo{
+            .semaphore = *frame.imageAcquired,
+            .value = 0,
+            .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+            .deviceIndex = 0};
+        // The timeline only once everything is done, timestamps included,
+        // presenting only needs the colour written
+        std::array<vk::SemaphoreSubmitInfo, 2> signals = {
+            vk::SemaphoreSubmitInfo{
+                .semaphore = *frameTimeline,
+                .value = timelineValue,
+                .stageMask = vk::PipelineStageFlagBits2::eAllCommands,
+                .deviceIndex = 0},
+            vk::SemaphoreSubmitInfo{
+                .semaphore = offscreen ? vk::Semaphore() : *renderFinishedSemaphores[imageIndex],
+                .value = 0,
+                .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                .deviceIndex = 0}};
+        auto commandBufferInfo = vk::CommandBufferSubmitInfo{
+            .commandBuffer = *commandBuffer,
+            .deviceMask = 0};
+        // Offscreen nothing was acquired, and nothing will be presented
+        graphicsQueue.submit2(
+            vk::SubmitInfo2{
+                .flags = vk::SubmitFlags(),
+                .waitSemaphoreInfoCount = offscreen ? 0U : 1U,
+                .pWaitSemaphoreInfos = &acquired,
+                .commandBufferInfoCount = 1,
+                .pCommandBufferInfos = &commandBufferInfo,
+                .signalSemaphoreInfoCount = offscreen ? 1U : 2U,
+                .pSignalSemaphoreInfos = signals.data()},
+            nullptr);
+        // Only once it's really submitted, or the next lap would wait for a
+        // value that never comes
+        frameTimelineValue = timelineValue;
+        frame.timelineValue = timelineValue;
+        frame.number = ++submittedFrameCount;
+        abandon.submitted = true;
+        return true;
+    }
 
     vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
 
     auto submitInfo = vk::SubmitInfo{
         .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &(*imageAcquiredSemaphore),
+        .pWaitSemaphores = &(*frame.imageAcquired),
         .pWaitDstStageMask = &waitDestinationStageMask,
         .commandBufferCount = 1,
         .pCommandBuffers = &(*commandBuffer),
         .signalSemaphoreCount = 0,
         .pSignalSemaphores = nullptr};
+    if (offscreen) {
+        // Nothing was acquired, and nothing will be presented
+        submitInfo.waitSemaphoreCount = 0;
+    } else {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &(*renderFinishedSemaphores[imageIndex]);
+    }
+    // Only now, right before it's signalled again, so an error on the way
+    // here can't leave it unsignalled
+    device.resetFences({*frame.inFlight});
+    graphicsQueue.submit(submitInfo, *frame.inFlight);
+    frame.number = ++submittedFrameCount;
+    abandon.submitted = true;
+    return true;
+}
 
-    graphicsQueue.submit(submitInfo, *drawFence);
-
-    /* Make sure command buffer is finished before presenting */
-    while (vk::Result::eTimeout == device.waitForFences({*drawFence}, VK_TRUE, fenceTimeout)) {
+void VulkanRender::abandonFrame(FrameData &frame) noexcept {
+    // Nothing to draw, just wait on the acquire semaphore and signal what
+    // the next lap waits on. The swapchain image stays acquired, whatever
+    // threw is on its way up anyway. Errors here would only hide that one
+    try {
+        // Its timestamps were never written
+        frameProfiler->abandon(currentFrame);
+        vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+        auto timelineValue = frameTimelineValue + 1;
+        auto timelineInfo = vk::TimelineSemaphoreSubmitInfo{
+            .waitSemaphoreValueCount = 0,
+            .pWaitSemaphoreValues = nullptr,
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &timelineValue};
+        auto submitInfo = vk::SubmitInfo{
+            .pNext = dynamicRendering ? &timelineInfo : nullptr,
+            .waitSemaphoreCount = offscreen ? 0U : 1U,
+            .pWaitSemaphores = &(*frame.imageAcquired),
+            .pWaitDstStageMask = &waitDestinationStageMask,
+            .commandBufferCount = 0,
+            .pCommandBuffers = nullptr,
+            .signalSemaphoreCount = dynamicRendering ? 1U : 0U,
+            .pSignalSemaphores = &(*frameTimeline)};
+        if (dynamicRendering) {
+            graphicsQueue.submit(submitInfo, nullptr);
+            frameTimelineValue = timelineValue;
+            frame.timelineValue = timelineValue;
+        } else {
+            device.resetFences({*frame.inFlight});
+            graphicsQueue.submit(submitInfo, *frame.inFlight);
+        }
+        frame.number = ++submittedFrameCount;
+    } catch (...) {
         /* do nothing */
     }
 }
 
-void VulkanRender::present() {
-    /* Now present the image in the window */
-    auto presentResult = presentQueue.presentKHR(
-        vk::PresentInfoKHR{
-            .waitSemaphoreCount = 0,
-            .pWaitSemaphores = nullptr,
-            .swapchainCount = 1,
-            .pSwapchains = &(*swapChain),
-            .pImageIndices = &imageIndex,
-            .pResults = nullptr});
+auto VulkanRender::completedFrames() const -> std::uint64_t {
+    // The oldest frame still running says how far the GPU got
+    auto completed = submittedFrameCount;
+    auto timelineReached = dynamicRendering ? frameTimeline.getCounterValue() : 0;
+    for (auto const &frame : frames) {
+        if (frame.number == 0) {
+            continue;
+        }
+        auto done = dynamicRendering ? timelineReached >= frame.timelineValue
+                                     : frame.inFlight.getStatus() == vk::Result::eSuccess;
+        if (!done) {
+            completed = std::min(completed, frame.number - 1);
+        }
+    }
+    return completed;
+}
 
-    switch (presentResult) {
-    case vk::Result::eSuccess:
-        break;
-    case vk::Result::eSuboptimalKHR:
-        // Do something meaningfull here
-        std::cout << "vk::Queue::presentKHR returned vk::Result::eSuboptimalKHR !\n";
-        break;
-    default:
-        // an unexpected result is returned !
-        assert(false); 
+void VulkanRender::beginRendering(vk::raii::CommandBuffer const &commandBuffer, std::array<vk::ClearValue, 2> const &clearValues) {
+    auto image = offscreen ? *offscreenImages[imageIndex].image : swapChainImages[imageIndex];
+    // The same as the legacy render pass's dependency: the swapchain image
+    // is only ours from the colour output stage (where we wait on the
+    // acquire semaphore), and the previous frame may still be using the
+    // depth buffer, there's only one. Whatever was in either is thrown away
+    std::array<vk::ImageMemoryBarrier2, 2> barriers = {
+        vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+            .srcAccessMask = vk::AccessFlags2(),
+            .dstStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+            .dstAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite,
+            .oldLayout = vk::ImageLayout::eUndefined,
+            .newLayout = vk::ImageLayout::eColorAttachmentOptimal,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = vk::ImageSubresourceRange{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1}},
+        vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+            .srcAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+            .dstAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentRead | vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+            .oldLayout = vk::ImageLayout::eUndefined,
+            .newLayout = vk::ImageLayout::eDepthAttachmentOptimal,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = *depthImage.image,
+            .subresourceRange = vk::ImageSubresourceRange{
+                .aspectMask = vk::ImageAspectFlagBits::eDepth,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1}}};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{
+        .dependencyFlags = vk::DependencyFlags(),
+        .memoryBarrierCount = 0,
+        .pMemoryBarriers = nullptr,
+        .bufferMemoryBarrierCount = 0,
+        .pBufferMemoryBarriers = nullptr,
+        .imageMemoryBarrierCount = static_cast<std::uint32_t>(barriers.size()),
+        .pImageMemoryBarriers = barriers.data()});
+
+    auto colorAttachment = vk::RenderingAttachmentInfo{
+        .imageView = *imageViews[imageIndex],
+        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+        .resolveMode = vk::ResolveModeFlagBits::eNone,
+        .resolveImageView = nullptr,
+        .resolveImageLayout = vk::ImageLayout::eUndefined,
+        .loadOp = vk::AttachmentLoadOp::eClear,
+        .storeOp = vk::AttachmentStoreOp::eStore,
+        .clearValue = clearValues[0]};
+    auto depthAttachment = vk::RenderingAttachmentInfo{
+        .imageView = *depthView,
+        .imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
+        .resolveMode = vk::ResolveModeFlagBits::eNone,
+        .resolveImageView = nullptr,
+        .resolveImageLayout = vk::ImageLayout::eUndefined,
+        .loadOp = vk::AttachmentLoadOp::eClear,
+        .storeOp = vk::AttachmentStoreOp::eDontCare,
+        .clearValue = clearValues[1]};
+
+    // Everything inside comes from the secondaries, as with the render pass
+    commandBuffer.beginRendering(vk::RenderingInfo{
+        .flags = vk::RenderingFlagBits::eContentsSecondaryCommandBuffers,
+        .renderArea = vk::Rect2D{
+            .offset = vk::Offset2D{
+                .x = 0,
+                .y = 0},
+            .extent = extent},
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+        .pDepthAttachment = &depthAttachment,
+        .pStencilAttachment = nullptr});
+}
+
+void VulkanRender::endRendering(vk::raii::CommandBuffer const &commandBuffer) {
+    commandBuffer.endRendering();
+
+    // Then what the render pass's final layout did. Presenting waits on the
+    // semaphore, which covers the rest. Offscreen frames are only ever read
+    // back
+    auto image = offscreen ? *offscreenImages[imageIndex].image : swapChainImages[imageIndex];
+    auto barrier = vk::ImageMemoryBarrier2{
+        .srcStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+        .srcAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite,
+        .dstStageMask = offscreen ? vk::PipelineStageFlagBits2::eTransfer : vk::PipelineStageFlagBits2::eNone,
+        .dstAccessMask = offscreen ? vk::AccessFlagBits2::eTransferRead : vk::AccessFlagBits2::eNone,
+        .oldLayout = vk::ImageLayout::eColorAttachmentOptimal,
+        .newLayout = offscreen ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = vk::ImageSubresourceRange{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1}};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{
+        .dependencyFlags = vk::DependencyFlags(),
+        .memoryBarrierCount = 0,
+        .pMemoryBarriers = nullptr,
+        .bufferMemoryBarrierCount = 0,
+        .pBufferMemoryBarriers = nullptr,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &barrier});
+}
+
+auto VulkanRender::present() -> bool {
+    // The frame has been submitted either way, so move on to the next slot
+    // even if presenting it fails. Whatever happens next is the next frame's
+    // as far as the profiler is concerned
+    currentFrame = (currentFrame + 1) % frames.size();
+    struct NextFrame {
+        FrameProfiler &profiler;
+        ~NextFrame() { profiler.beginFrame(); }
+    } nextFrame{*frameProfiler};
+    if (offscreen) {
+        return true;
     }
-    // This is purely here so we can actually have a moment to see our glorius rendered cube!
-    // ALL HAIL THE CUBE
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    auto stage = frameProfiler->time(CpuStage::Present);
 
+    /* Now present the image in the window */
+    vk::Result presentResult;
+    try {
+        presentResult = presentQueue.presentKHR(
+            vk::PresentInfoKHR{
+                .waitSemaphoreCount = 1,
+                .pWaitSemaphores = &(*renderFinishedSemaphores[imageIndex]),
+                .swapchainCount = 1,
+                .pSwapchains = &(*swapChain),
+                .pImageIndices = &imageIndex,
+                .pResults = nullptr});
+    } catch (vk::OutOfDateKHRError const &) {
+        return false;
+    }
+
+    return presentResult != vk::Result::eSuboptimalKHR && !swapchainSuboptimal;
+}
+
+void VulkanRender::waitIdle() {
+    // Nothing in flight may be destroyed while the GPU is still using it
+    device.waitIdle();
+}
+
+auto VulkanRender::readPixels() -> std::vector<std::uint8_t> {
+    if (!offscreen) {
+        throw std::logic_error("readPixels() needs initOffscreen()");
+    }
     device.waitIdle();
+
+    vk::DeviceSize size = vk::DeviceSize(extent.width) * extent.height * 4;
+    auto readback = createGpuBuffer(*allocator, device,
+        vk::BufferCreateInfo{
+            .flags = vk::BufferCreateFlags(),
+            .size = size,
+            .usage = vk::BufferUsageFlagBits::eTransferDst,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr},
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    // imageIndex is still the last frame rendered, the render pass left it
+    // ready to copy from
+    auto image = *offscreenImages.at(imageIndex).image;
+    submitNow([&](vk::raii::CommandBuffer const &commandBuffer) {
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
+            vk::DependencyFlags(), nullptr, nullptr,
+            vk::ImageMemoryBarrier{
+                .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
+                .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+                .oldLayout = vk::ImageLayout::eTransferSrcOptimal,
+                .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = image,
+                .subresourceRange = vk::ImageSubresourceRange{
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .baseMipLevel = 0,
+                    .levelCount = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1}});
+        commandBuffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, *readback.buffer,
+            vk::BufferImageCopy{
+                .bufferOffset = 0,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = vk::ImageSubresourceLayers{
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .mipLevel = 0,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1},
+                .imageOffset = vk::Offset3D{.x = 0, .y = 0, .z = 0},
+                .imageExtent = vk::Extent3D{.width = extent.width, .height = extent.height, .depth = 1}});
+    });
+
+    auto const *mapped = reinterpret_cast<std::uint8_t const *>(readback.allocation.mapped());
+    return {mapped, mapped + size};
 }
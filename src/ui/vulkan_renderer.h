@@ -2,37 +2,46 @@
 #define UI_VULKAN_RENDERER_H
 
 #include <array>
+#include <chrono>
 #include <cinttypes>
-#include <utility> // vulkan_raii fails to compile without this
-                   // It complains about std::exchange related errors
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <set>
+#include <span>
 #include <string>
 
-// Whats the point of this?
-// Well I needed to set a few preprocessor defines so they can enable some
-// more functionality at compile time if the necessary headers are around
-// And since I needed to have these availble in more then one source file
-// it was just easier to throw it in a header
-
-// Enable C++ Designated Initializers in Vulkan.hpp
-// https://github.com/KhronosGroup/Vulkan-Hpp#designated-initializers
-#define VULKAN_HPP_NO_CONSTRUCTORS
-// Disable setter member functions
-#define VULKAN_HPP_NO_SETTERS
-
-// Enable Vulkan debug utilities if we compile as Debug
-#ifndef NDEBUG
-#define VULKAN_DEBUG
-#endif
-
-// Now include offical vulkan headers :)
-#include <vulkan/vulkan_raii.hpp>
-
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "bindless_textures.h"
+#include "frame_profiler.h"
+#include "frame_ring.h"
+#include "gpu_allocator.h"
+#include "imgui_layer.h"
+#include "pipeline_manager.h"
+#include "quad_renderer.h"
+#include "render_target.h"
+#include "resampler.h"
+#include "staging_ring.h"
+#include "thread_pool.h"
+#include "vulkan_config.h"
 #include "window.h"
 
+// How to trade latency for tearing and power when presenting
+enum class PresentPolicy {
+    // Mailbox if the driver has it, so a new frame replaces a queued one
+    // instead of waiting behind it, otherwise fifo relaxed, otherwise fifo
+    LowLatency,
+    // Plain fifo, never tears and never renders more frames then shown
+    VSync,
+    // Immediate if available, for benchmarks where we want to know how fast
+    // we can go rather then how fast the display is
+    Uncapped,
+};
+
 class VulkanRender {
   public:
     // Inital Vulkan setup
@@ -48,70 +57,124 @@ class VulkanRender {
     // - Initalise Pipeline
     // - Initalise Framebuffers
     //
+    // Pipelines compile in the background (see PipelineManager), from
+    // initDevice() on. Frames can be rendered straight away, anything whose
+    // pipeline isn't ready yet is left out until it is
+    //
     // General Render Loop
+    // - Wait for the oldest frame in flight to finish, so its slot can be reused
     // - Acquire next image
-    //     - Resize if outdated
+    //     - Resize if outdated (render() or present() return false, call
+    //       recreateSwapchain() with the new window size)
     // - Render
     // - Present
+    // - waitIdle() before tearing anything down
+    //
+    // Headless (benchmarks, build machines without a display), skip
+    // createSurface() and call initOffscreen() instead of initSwapchain().
+    // Frames are rendered into images of our own, present() only moves on
+    // to the next one, and readPixels() reads the last one back
     //
     // Initalization Functions
     VulkanRender(const std::string &);
     ~VulkanRender();
+    // Before selectPhysicalDevice(). Sticks to render passes, framebuffers
+    // and fences even where dynamic rendering is supported, e.g. to compare
+    // the two or to work around a driver
+    void useLegacyRendering() { legacyRequested = true; }
     void selectPhysicalDevice();
     void createSurface(SDL_Window *);
     void initDevice();
+    // Call before initSwapchain(), or recreate the swapchain after
+    void setPresentPolicy(PresentPolicy);
     void initSwapchain(int, int);
+    // After a resize, or whenever the swapchain is out of date
+    void recreateSwapchain(int, int);
+    // Instead of initSwapchain(), with no surface or window needed
+    void initOffscreen(std::uint32_t width, std::uint32_t height);
     void createUniformBuffer();
     void initRenderPass();
     void initFramebuffers();
     void createVertexBuffer();
     void initPipeline();
-    void render();
-    void present();
+    // Optional, after initPipeline(). Dear ImGui drawn over everything
+    void initImGui(SDL_Window *);
+    // Both return false if the swapchain no longer matches the window, in
+    // which case the frame was dropped (render) or shown but should be the
+    // last one before recreating the swapchain (present)
+    auto render() -> bool;
+    auto present() -> bool;
+    void waitIdle();
+    // The last frame rendered offscreen, tightly packed 8 bit RGBA in sRGB.
+    // Waits for the GPU, so meant for tests and screenshots
+    auto readPixels() -> std::vector<std::uint8_t>;
+    // How long the GPU spent on the most recent frame whose slot has come
+    // round again in render(), so it lags framesInFlight frames behind, and
+    // which frame that was. Empty if the graphics queue can't do timestamps
+    [[nodiscard]] auto gpuFrameTime() const -> std::optional<FrameProfiler::GpuFrameTime> { return frameProfiler->lastGpuFrameTime(); }
+    // CPU and GPU timings of recent frames, the app's loop can add its own
+    // stages (see CpuStage). After initDevice()
+    [[nodiscard]] auto profiler() -> FrameProfiler & { return *frameProfiler; }
+    // After initImGui()
+    [[nodiscard]] auto imGui() -> ImGuiLayer & { return *imguiLayer; }
+    [[nodiscard]] auto renderExtent() const -> vk::Extent2D { return extent; }
+    // Whether selectPhysicalDevice() found Vulkan 1.3's dynamic rendering,
+    // synchronization2 and timeline semaphores, see initRenderPass()
+    [[nodiscard]] auto usesDynamicRendering() const -> bool { return dynamicRendering; }
+    // Copies `size` bytes into a new device local buffer through a staging
+    // buffer, so the GPU reads it from its own memory rather then across
+    // the bus. Blocks until the copy is done, so meant for data that is
+    // uploaded once (e.g. vertex buffers)
+    auto uploadBuffer(vk::BufferUsageFlags, void const *data, vk::DeviceSize size) -> GpuBuffer;
     template <typename T>
-    void copyToDevice(vk::raii::DeviceMemory const &deviceMemory, VkDeviceSize const &size, T const &data) {
-        // devicememory.mapMemory(offset, size)
-        std::uint8_t *pData = static_cast<std::uint8_t *>(deviceMemory.mapMemory(0, size));
-        std::memcpy(pData, &data, sizeof(data));
-        deviceMemory.unmapMemory();
+    auto createBuffer(vk::BufferUsageFlags usageFlags, T const &data) -> GpuBuffer {
+        return uploadBuffer(usageFlags, &data, sizeof(data));
     }
-    template <typename T>
-    auto createBuffer(vk::BufferUsageFlagBits usageFlags, T const &data) -> std::pair<vk::raii::DeviceMemory, vk::raii::Buffer> {
-        auto bufferCreateInfo = vk::BufferCreateInfo{
-            .flags = vk::BufferCreateFlags(),
-            .size = sizeof(data),
-            .usage = usageFlags,
-            .sharingMode = vk::SharingMode::eExclusive,
-            .queueFamilyIndexCount = 0,
-            .pQueueFamilyIndices = nullptr,
-        };
-
-        if (graphicsAndPresentQueueFamilyIndex.at(0) != graphicsAndPresentQueueFamilyIndex.at(1)) {
-            bufferCreateInfo.sharingMode = vk::SharingMode::eConcurrent;
-            bufferCreateInfo.queueFamilyIndexCount = 2;
-            bufferCreateInfo.pQueueFamilyIndices = graphicsAndPresentQueueFamilyIndex.data();
-        }
+    // Records whatever `record` does into a one off command buffer, submits
+    // it to the graphics queue and waits for it to finish
+    void submitNow(std::function<void(vk::raii::CommandBuffer const &)> const &record);
+    [[nodiscard]] auto gpuAllocator() -> GpuAllocator & { return *allocator; }
+    // Textures for drawQuads() have to be in here, the quads refer to them by
+    // slot
+    [[nodiscard]] auto textureTable() -> BindlessTextures & { return *textures; }
+    // Persistently mapped memory to upload from, for data that's produced on
+    // other threads (e.g. decoded pages) and written into it directly. After
+    // initDevice()
+    [[nodiscard]] auto stagingRing() -> StagingRing & { return *staging; }
+    // Queue textured quads up for the next render(), drawn over the scene in
+    // one instanced draw call (see QuadRenderer). After initPipeline()
+    void drawQuads(std::span<QuadInstance const> quads) { quadRenderer->draw(quads); }
+    // GPU scaling of pages for fit-to-width, zoom and HiDPI. Resamples
+    // queued on it are run at the start of the next render()
+    [[nodiscard]] auto pageResampler() -> Resampler & { return *resampler; }
+    // Every pipeline we draw with, compiling in the background. After
+    // initDevice()
+    [[nodiscard]] auto pipelineManager() -> PipelineManager & { return *pipelines; }
 
-        auto buffer = vk::raii::Buffer(device, bufferCreateInfo);
+    // For things built on top of the renderer (e.g. TextureManager)
+    [[nodiscard]] auto logicalDevice() const -> vk::raii::Device const & { return device; }
+    [[nodiscard]] auto graphicsQueueFamily() const -> std::uint32_t { return graphicsAndPresentQueueFamilyIndex.at(0); }
+    [[nodiscard]] auto transferQueueFamily() const -> std::uint32_t { return transferQueueFamilyIndex; }
+    // If the device has no queue to spare this is the graphics queue, see
+    // sharesTransferQueue(). Queues can't be submitted to from two threads at
+    // once, so only submit to it from the render thread in that case
+    [[nodiscard]] auto uploadQueue() const -> vk::raii::Queue const & { return transferQueue; }
+    [[nodiscard]] auto sharesTransferQueue() const -> bool { return transferQueueShared; }
+    // Frames submitted so far, and how many of those the GPU has finished
+    // (frames finish in order), for anything that has to outlive the frames
+    // that used it. Never blocks
+    [[nodiscard]] auto submittedFrames() const -> std::uint64_t { return submittedFrameCount; }
+    [[nodiscard]] auto completedFrames() const -> std::uint64_t;
+    // e.g. maxImageDimension2D, the tallest texture we can create
+    [[nodiscard]] auto deviceLimits() const -> vk::PhysicalDeviceLimits { return physicalDevice.getProperties().limits; }
 
-        vk::MemoryRequirements memoryRequirements = buffer.getMemoryRequirements();
-
-        std::uint32_t typeIndex = findMemoryType(
-            physicalDevice.getMemoryProperties(),
-            memoryRequirements.memoryTypeBits,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-
-        vk::raii::DeviceMemory deviceMemory(device,
-            vk::MemoryAllocateInfo{
-                .allocationSize = memoryRequirements.size,
-                .memoryTypeIndex = typeIndex});
-
-        copyToDevice(deviceMemory, memoryRequirements.size, data);
-
-        buffer.bindMemory(*deviceMemory, 0);
-
-        return {std::move(deviceMemory), std::move(buffer)};
-    }
+    // Frames in flight
+    // Instead of waiting for the GPU to finish every frame before starting
+    // on the next, we keep a small ring of everything a frame needs. While
+    // the GPU draws one frame the CPU can already be recording the next,
+    // and only has to wait once it's lapped the ring.
+    // Two is enough to keep both busy, more just adds latency.
+    static constexpr std::size_t framesInFlight = 2;
 
   private:
     // Order of these Vulkan Variables are IMPORTANT
@@ -134,46 +197,129 @@ class VulkanRender {
     // we rely on any optional features at the moment, so no need to enable any.
     // https://registry.khronos.org/vulkan/specs/1.3-extensions/html/vkspec.html#features
     vk::PhysicalDeviceFeatures enableDeviceFeatures;
+    // Descriptor indexing for BindlessTextures, filled in by
+    // selectPhysicalDevice()
+    vk::PhysicalDeviceVulkan12Features enableVulkan12Features;
+    // Dynamic rendering and synchronization2, when they are there
+    vk::PhysicalDeviceVulkan13Features enableVulkan13Features;
+    bool legacyRequested = false;
+    bool dynamicRendering = false;
     vk::raii::Device device = nullptr;
+    // Every buffer and image below gets its memory from here, so it has to
+    // outlive all of them
+    std::unique_ptr<GpuAllocator> allocator;
+    std::unique_ptr<BindlessTextures> textures;
+    std::unique_ptr<StagingRing> staging;
     vk::raii::SurfaceKHR surface = nullptr;
     std::array<std::uint32_t, 2> graphicsAndPresentQueueFamilyIndex{};
+    // Uploads go to a queue of their own when there is one: a dedicated
+    // transfer family (the copy engine on discrete GPUs), or failing that a
+    // second queue in the graphics family
+    std::uint32_t transferQueueFamilyIndex = 0;
+    std::uint32_t transferQueueIndex = 0;
+    bool transferQueueShared = true;
     vk::raii::CommandPool commandPool = nullptr;
-    vk::raii::CommandBuffers commandBuffers = nullptr;
-    vk::raii::CommandBuffer commandBuffer = nullptr;
+
+    struct FrameData {
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+        // Signalled once the swapchain image we acquired is ready to draw to
+        vk::raii::Semaphore imageAcquired = nullptr;
+        // Signalled once the GPU is done with this slot, created signalled so
+        // the first lap around the ring doesn't wait forever. Legacy path
+        // only
+        vk::raii::Fence inFlight = nullptr;
+        // With dynamic rendering, the value of frameTimeline that says the
+        // same. 0 until the slot's first submit, which is already reached
+        std::uint64_t timelineValue = 0;
+        // Which submitted frame the slot last held, 0 for none yet
+        std::uint64_t number = 0;
+    };
+    std::array<FrameData, framesInFlight> frames;
+    std::size_t currentFrame = 0;
+    std::uint64_t submittedFrameCount = 0;
+    // Counts submitted frames, so waiting for a slot is waiting for a value,
+    // no fences to reset
+    vk::raii::Semaphore frameTimeline = nullptr;
+    std::uint64_t frameTimelineValue = 0;
+    // The render pass is recorded into secondary command buffers, in
+    // parallel, and the frame's primary just executes them in order. A
+    // command pool can only be used from one thread at a time, so every
+    // recording job gets a pool (and a buffer) of its own, per frame slot,
+    // reset as a whole at the start of the job. Grown as needed, on the
+    // render thread, before any job starts
+    struct Recorder {
+        vk::raii::CommandPool pool = nullptr;
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+    };
+    std::array<std::vector<Recorder>, framesInFlight> recorders;
+    // Per frame scratch for render(), cleared rather then allocated again
+    // each time
+    std::vector<std::exception_ptr> recordErrors;
+    std::vector<vk::CommandBuffer> secondaries;
+
     vk::Format colorFormat;
     vk::Format depthFormat;
     vk::raii::SwapchainKHR swapChain = nullptr;
     vk::Extent2D extent;
     std::vector<vk::Image> swapChainImages;
     std::vector<vk::raii::ImageView> imageViews;
-    vk::raii::Image depthImage = nullptr;
-    vk::raii::DeviceMemory depthMemory = nullptr;
+    // Signalled when rendering to the swapchain image is done, for present to
+    // wait on. One per swapchain image rather than per frame in flight: the
+    // frame fence says nothing about when the presentation engine is done
+    // waiting on it, only acquiring the same image again does.
+    std::vector<vk::raii::Semaphore> renderFinishedSemaphores;
+    // Stand ins for the swapchain images when rendering offscreen, one per
+    // frame in flight, so the frame's fence is all that guards them
+    bool offscreen = false;
+    std::vector<GpuImage> offscreenImages;
+    GpuImage depthImage;
     vk::raii::ImageView depthView = nullptr;
     vk::raii::DescriptorSetLayout descriptorSetLayout = nullptr;
     vk::raii::DescriptorPool descriptorPool = nullptr;
     vk::raii::DescriptorSets descriptorSets = nullptr;
     vk::raii::DescriptorSet descriptorSet = nullptr;
-    vk::raii::DeviceMemory uniformBufferMemory = nullptr;
-    vk::raii::Buffer uniformDataBuffer = nullptr;
-    vk::raii::DeviceMemory vertexBufferMemory = nullptr;
-    vk::raii::Buffer vertexBuffer = nullptr;
+    // Uniform data is written fresh every frame, into the frame's section
+    std::optional<FrameRing> uniformRing;
+    glm::mat4x4 mvpc{1.0F};
+    GpuBuffer vertexBuffer;
     vk::raii::PipelineLayout pipelineLayout = nullptr;
+    // Null with dynamic rendering, as are the framebuffers
     vk::raii::RenderPass renderPass = nullptr;
+    // What the pipelines are created for, see initRenderPass()
+    RenderTarget target;
     vk::raii::ShaderModule vertexShaderModule = nullptr;
     vk::raii::ShaderModule fragmentShaderModule = nullptr;
     std::vector<vk::raii::Framebuffer> framebuffers;
-    vk::raii::Pipeline graphicsPipeline = nullptr;
-    vk::raii::PipelineCache graphicsPipelineCache = nullptr;
+    PipelineManager::Id scenePipeline = 0;
+    // Compiled pipelines from previous runs, loaded in initDevice() and
+    // written back out when we are destroyed, so only the first launch (or
+    // the first after a driver update) pays for compiling every shader
+    vk::raii::PipelineCache pipelineCache = nullptr;
+    std::filesystem::path pipelineCachePath;
+    // Compiles into the cache above, stopped in our destructor before
+    // anything its jobs use is destroyed and the cache is saved
+    std::unique_ptr<PipelineManager> pipelines;
+    std::unique_ptr<QuadRenderer> quadRenderer;
+    // The compute pipeline scaling pages to the size they are shown at
+    std::unique_ptr<Resampler> resampler;
+    std::unique_ptr<ImGuiLayer> imguiLayer;
+    std::unique_ptr<FrameProfiler> frameProfiler;
     vk::raii::Queue graphicsQueue = nullptr;
     vk::raii::Queue presentQueue = nullptr;
-    //  TODO This is Temp VVV
-    vk::raii::Semaphore imageAcquiredSemaphore = nullptr;
-    vk::raii::Fence drawFence = nullptr;
-    //vk::Result result;
-    std::uint32_t imageIndex;
+    vk::raii::Queue transferQueue = nullptr;
+    std::uint32_t imageIndex = 0;
+    PresentPolicy presentPolicy = PresentPolicy::LowLatency;
+    // Set when acquiring the image said it still works but no longer
+    // matches the surface exactly
+    bool swapchainSuboptimal = false;
+    // Record quad batches alongside the render thread. Idle between frames,
+    // and after everything a job uses, so it's stopped before any of it is
+    // destroyed
+    std::unique_ptr<core::ThreadPool> recordWorkers;
 
-    // FenceTimeout specifies how long the function waits, in nanoseconds, if no image is available
-    // https://khronos.org/registry/vulkan/specs/1.3-extensions/man/html/vkAcquireNextImageKHR.html
+    // FenceTimeout specifies how long each wait on a frame's fence lasts, in
+    // nanoseconds, before we check in and wait again
+    // https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/vkWaitForFences.html
     const std::uint64_t fenceTimeout = 100000000; // 100000000 nanoseconds = 0.1 seconds
 
     // Shader and Frag code for the renderer
@@ -304,17 +450,28 @@ class VulkanRender {
     const std::set<std::string> desiredDeviceExtensions{
         "VK_KHR_swapchain"};
 
-    auto findMemoryType(vk::PhysicalDeviceMemoryProperties const &, std::uint32_t, vk::MemoryPropertyFlags)
-        -> std::uint32_t;
     auto enumerateExtensions(std::vector<vk::ExtensionProperties> const &, std::set<std::string> const &) -> std::vector<char const *>;
     auto enumerateLayers(std::vector<vk::LayerProperties> const &, std::set<std::string> const &) -> std::vector<char const *>;
     auto getQueueFamilyIndex(std::vector<vk::QueueFamilyProperties> const &, vk::QueueFlagBits) -> std::uint32_t;
+    // Empty if there's no usable cache on disk
+    auto loadPipelineCache() -> std::vector<std::uint8_t>;
+    void savePipelineCache();
+    // Shared by the swapchain and offscreen paths, sized to `extent`
+    void createDepthBuffer();
+    // Dynamic rendering only: the layout transitions a render pass would
+    // have done, around beginRendering() and endRendering()
+    void beginRendering(vk::raii::CommandBuffer const &, std::array<vk::ClearValue, 2> const &clearValues);
+    void endRendering(vk::raii::CommandBuffer const &);
+    // The current frame slot's first `count` recording jobs, making pools
+    // and command buffers for any that have never been needed before
+    auto recordersFor(std::size_t count) -> std::span<Recorder const>;
+    // Submits a frame whose recording failed after acquiring its image, so
+    // the acquire semaphore and the slot's fence or timeline are still
+    // taken care of
+    void abandonFrame(FrameData &) noexcept;
+    // The cube, on one of the PipelineManager's threads
+    auto createScenePipeline(vk::raii::PipelineCache const &, RenderTarget const &) const -> vk::raii::Pipeline;
+    auto choosePresentMode(std::vector<vk::PresentModeKHR> const &) const -> vk::PresentModeKHR;
     auto getGraphicsAndPresentQueueFamilyIndex(std::vector<vk::QueueFamilyProperties> const &, std::uint32_t) -> std::array<std::uint32_t, 2>;
-    // TODO For our current example the cube size/shape is stored in a uniform
-    // buffer (?)
-    // So we should create two functions.
-    // 1. Function to create buffers (e.g. I pass vk::BufferUsageFlagBits::eUniformBuffer
-    // to the function and it'll create a uniformbuffer for me
-    // 2. Upload data to device (pass buffer and data, e.g. Uniform buffer and our cube matrix)
 };
 #endif